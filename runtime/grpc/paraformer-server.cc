@@ -5,104 +5,155 @@
 /* 2023 by burkliu(刘柏基) liubaiji@xverse.cn */
 
 #include "paraformer-server.h"
+#include "warm-up-ms.h"
 
-GrpcEngine::GrpcEngine(
-  grpc::ServerReaderWriter<Response, Request>* stream,
-  std::shared_ptr<FUNASR_HANDLE> asr_handler)
-  : stream_(std::move(stream)),
-    asr_handler_(std::move(asr_handler)) {
-
-  request_ = std::make_shared<Request>();
+DecodePool::DecodePool(int thread_num) {
+  for (int i = 0; i < thread_num; i++) {
+    workers_.emplace_back(&DecodePool::Run, this);
+  }
 }
 
-void GrpcEngine::DecodeThreadFunc() {
-  FUNASR_HANDLE tpass_online_handler = FunTpassOnlineInit(*asr_handler_, chunk_size_);
-  int step = (sampling_rate_ * step_duration_ms_ / 1000) * 2; // int16 = 2bytes;
-  std::vector<std::vector<std::string>> punc_cache(2);
-
-  bool is_final = false;
-  std::string online_result = "";
-  std::string tpass_result = "";
+DecodePool::~DecodePool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
 
-  LOG(INFO) << "Decoder init, start decoding loop with mode";
+void DecodePool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tasks_.push(std::move(task));
+  }
+  cv_.notify_one();
+}
 
+void DecodePool::Run() {
   while (true) {
-    if (audio_buffer_.length() > step || is_end_) {
-      if (audio_buffer_.length() <= step && is_end_) {
-        is_final = true;
-        step = audio_buffer_.length();
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) {
+        return;
       }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+GrpcSession::GrpcSession(
+  ASR::AsyncService* service,
+  grpc::ServerCompletionQueue* cq,
+  std::shared_ptr<FUNASR_HANDLE> asr_handler,
+  DecodePool* pool)
+  : service_(service),
+    cq_(cq),
+    asr_handler_(std::move(asr_handler)),
+    pool_(pool),
+    stream_(&context_) {
 
-      FUNASR_RESULT result = FunTpassInferBuffer(*asr_handler_,
-                                                 tpass_online_handler,
-                                                 audio_buffer_.c_str(),
-                                                 step,
-                                                 punc_cache,
-                                                 is_final,
-                                                 sampling_rate_,
-                                                 encoding_,
-                                                 mode_);
-      p_mutex_->lock();
-      audio_buffer_ = audio_buffer_.substr(step);
-      p_mutex_->unlock();
-
-      if (result) {
-        std::string online_message = FunASRGetResult(result, 0);
-        online_result += online_message;
-        if(online_message != ""){
-          Response response;
-          response.set_mode(DecodeMode::online);
-          response.set_text(online_message);
-          response.set_is_final(is_final);
-          stream_->Write(response);
-          LOG(INFO) << "send online results: " << online_message;
+  for (int op = kConnect; op <= kDone; op++) {
+    tags_[op] = {this, Op(op)};
+  }
+  // the done tag comes back once the call is over, finished or cancelled
+  pending_ops_ = 2;
+  context_.AsyncNotifyWhenDone(&tags_[kDone]);
+  service_->RequestRecognize(&context_, &stream_, cq_, cq_, &tags_[kConnect]);
+}
+
+void GrpcSession::OnEvent(Op op, bool ok) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  pending_ops_--;
+  switch (op) {
+    case kConnect:
+      if (!ok) {
+        // the queue is shutting down, no call was started
+        lock.unlock();
+        delete this;
+        return;
+      }
+      LOG(INFO) << "Get Recognize request";
+      // wait for the next stream while this one runs
+      new GrpcSession(service_, cq_, asr_handler_, pool_);
+      StartRead();
+      break;
+    case kRead:
+      reading_ = false;
+      if (ok) {
+        if (!is_start_) {
+          OnSpeechStart();
         }
-        std::string tpass_message = FunASRGetTpassResult(result, 0);
-        tpass_result += tpass_message;
-        if(tpass_message != ""){
-          Response response;
-          response.set_mode(DecodeMode::two_pass);
-          response.set_text(tpass_message);
-          response.set_is_final(is_final);
-          stream_->Write(response);
-          LOG(INFO) << "send offline results: " << tpass_message;
+        incoming_ += request_.audio_data();
+        if (request_.is_final()) {
+          input_end_ = true;
+        } else {
+          StartRead();
         }
-        FunASRFreeResult(result);
+      } else {
+        // the client closed its side without a final request
+        input_end_ = true;
       }
-
-      if (is_final) {
-        FunTpassOnlineUninit(tpass_online_handler);
-        break;
+      if (is_start_) {
+        ScheduleDecodeLocked();
+      } else if (input_end_) {
+        decode_end_ = true;
+        TryWriteLocked();
       }
-    }
-    sleep(0.001);
+      break;
+    case kWrite:
+      writing_ = false;
+      if (ok) {
+        outbound_.pop_front();
+      } else {
+        // the client is gone, drop what is left and stop decoding for it
+        outbound_.clear();
+        cancelled_ = true;
+      }
+      TryWriteLocked();
+      break;
+    case kFinish:
+      LOG(INFO) << "Connect finish";
+      break;
+    case kDone:
+      if (context_.IsCancelled()) {
+        cancelled_ = true;
+      }
+      break;
   }
+  ReleaseLocked(lock);
 }
 
-void GrpcEngine::OnSpeechStart() {
-  if (request_->chunk_size_size() == 3) {
+void GrpcSession::OnSpeechStart() {
+  if (request_.chunk_size_size() == 3) {
     for (int i = 0; i < 3; i++) {
-      chunk_size_[i] = int(request_->chunk_size(i));
+      chunk_size_[i] = int(request_.chunk_size(i));
     }
   }
   std::string chunk_size_str;
   for (int i = 0; i < 3; i++) {
-    chunk_size_str = " " + chunk_size_[i];
+    chunk_size_str += " " + std::to_string(chunk_size_[i]);
   }
   LOG(INFO) << "chunk_size is" << chunk_size_str;
 
-  if (request_->sampling_rate() != 0) {
-    sampling_rate_ = request_->sampling_rate();
+  if (request_.sampling_rate() != 0) {
+    sampling_rate_ = request_.sampling_rate();
   }
   LOG(INFO) << "sampling_rate is " << sampling_rate_;
 
-  switch(request_->wav_format()) {
+  switch(request_.wav_format()) {
     case WavFormat::pcm: encoding_ = "pcm";
   }
   LOG(INFO) << "encoding is " << encoding_;
 
   std::string mode_str;
-  switch(request_->mode()) {
+  switch(request_.mode()) {
     case DecodeMode::offline:
       mode_ = ASR_OFFLINE;
       mode_str = "offline";
@@ -117,87 +168,190 @@ void GrpcEngine::OnSpeechStart() {
       break;
   }
   LOG(INFO) << "decode mode is " << mode_str;
-  
-  decode_thread_ = std::make_shared<std::thread>(&GrpcEngine::DecodeThreadFunc, this);
   is_start_ = true;
 }
 
-void GrpcEngine::OnSpeechData() {
-  p_mutex_->lock();
-  audio_buffer_ += request_->audio_data();
-  p_mutex_->unlock();
+void GrpcSession::StartRead() {
+  reading_ = true;
+  pending_ops_++;
+  stream_.Read(&request_, &tags_[kRead]);
 }
 
-void GrpcEngine::OnSpeechEnd() {
-  is_end_ = true;
-  LOG(INFO) << "Read all pcm data, wait for decoding thread";
-  if (decode_thread_ != nullptr) {
-    decode_thread_->join();
+void GrpcSession::TryWriteLocked() {
+  if (writing_ || finishing_) {
+    return;
+  }
+  if (!outbound_.empty()) {
+    writing_ = true;
+    pending_ops_++;
+    stream_.Write(outbound_.front(), &tags_[kWrite]);
+  } else if (decode_end_ && !reading_) {
+    finishing_ = true;
+    pending_ops_++;
+    stream_.Finish(grpc::Status::OK, &tags_[kFinish]);
   }
 }
 
-void GrpcEngine::operator()() {
-  try {
-    LOG(INFO) << "start engine main loop";
-    while (stream_->Read(request_.get())) {
-      LOG(INFO) << "receive data";
-      if (!is_start_) {
-        OnSpeechStart();
-      }
-      OnSpeechData();
-      if (request_->is_final()) {
+void GrpcSession::ScheduleDecodeLocked() {
+  if (decoding_ || decode_end_) {
+    return;
+  }
+  decoding_ = true;
+  pool_->Submit([this] { Decode(); });
+}
+
+void GrpcSession::Decode() {
+  bool input_end;
+  bool cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    audio_.append(incoming_);
+    incoming_.clear();
+    input_end = input_end_;
+    cancelled = cancelled_;
+  }
+  if (tpass_online_handler_ == nullptr && !cancelled) {
+    tpass_online_handler_ = FunTpassOnlineInit(*asr_handler_, chunk_size_);
+    punc_cache_.assign(2, {});
+    LOG(INFO) << "Decoder init, start decoding";
+  }
+
+  size_t step = (sampling_rate_ * step_duration_ms_ / 1000) * 2; // int16 = 2bytes;
+  // a cancelled stream has no one left to answer
+  bool finished = cancelled;
+  while (!finished) {
+    size_t left = audio_.length() - offset_;
+    size_t len = step;
+    bool is_final = false;
+    if (left <= step) {
+      if (!input_end) {
         break;
       }
+      is_final = true;
+      len = left;
     }
-    OnSpeechEnd();
-    LOG(INFO) << "Connect finish";
-  } catch (std::exception const& e) {
-    LOG(ERROR) << e.what();
+
+    FUNASR_RESULT result = FunTpassInferBuffer(*asr_handler_,
+                                               tpass_online_handler_,
+                                               audio_.data() + offset_,
+                                               len,
+                                               punc_cache_,
+                                               is_final,
+                                               sampling_rate_,
+                                               encoding_,
+                                               mode_);
+    offset_ += len;
+    if (result) {
+      SendResult(result, is_final);
+      FunASRFreeResult(result);
+    }
+    finished = is_final;
+  }
+  if (offset_ * 2 > audio_.length()) {
+    audio_.erase(0, offset_);
+    offset_ = 0;
+  }
+  if (finished && tpass_online_handler_ != nullptr) {
+    FunTpassOnlineUninit(tpass_online_handler_);
+    tpass_online_handler_ = nullptr;
   }
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  if (finished) {
+    decode_end_ = true;
+    TryWriteLocked();
+  } else if (!incoming_.empty() || input_end_ != input_end || cancelled_ != cancelled) {
+    // more arrived during this turn, queue again behind the other streams
+    pool_->Submit([this] { Decode(); });
+    return;
+  }
+  decoding_ = false;
+  ReleaseLocked(lock);
 }
 
-GrpcService::GrpcService(std::map<std::string, std::string>& config, int onnx_thread)
-  : config_(config) {
+void GrpcSession::SendResult(FUNASR_RESULT result, bool is_final) {
+  std::string online_message = FunASRGetResult(result, 0);
+  std::string tpass_message = FunASRGetTpassResult(result, 0);
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (cancelled_) {
+    return;
+  }
+  if(online_message != ""){
+    Response response;
+    response.set_mode(DecodeMode::online);
+    response.set_text(online_message);
+    response.set_is_final(is_final);
+    outbound_.push_back(std::move(response));
+    LOG(INFO) << "send online results: " << online_message;
+  }
+  if(tpass_message != ""){
+    Response response;
+    response.set_mode(DecodeMode::two_pass);
+    response.set_text(tpass_message);
+    response.set_is_final(is_final);
+    outbound_.push_back(std::move(response));
+    LOG(INFO) << "send offline results: " << tpass_message;
+  }
+  TryWriteLocked();
+}
+
+void GrpcSession::ReleaseLocked(std::unique_lock<std::mutex>& lock) {
+  bool release = (pending_ops_ == 0 && !decoding_);
+  lock.unlock();
+  if (release) {
+    delete this;
+  }
+}
+
+GrpcServer::GrpcServer(std::map<std::string, std::string>& config, int onnx_thread,
+                       int decoder_thread_num, int io_thread_num,
+                       const std::vector<int>& warm_up_ms)
+  : config_(config),
+    io_thread_num_(io_thread_num) {
 
   asr_handler_ = std::make_shared<FUNASR_HANDLE>(std::move(FunTpassInit(config_, onnx_thread)));
-  LOG(INFO) << "GrpcService model loaded";
-
-  std::vector<int> chunk_size = {5, 10, 5};
-  FUNASR_HANDLE tmp_online_handler = FunTpassOnlineInit(*asr_handler_, chunk_size);
-  int sampling_rate = 16000;
-  int buffer_len = sampling_rate * 1;
-  std::string tmp_data(buffer_len, '0');
-  std::vector<std::vector<std::string>> punc_cache(2);
-  bool is_final = true;
-  std::string encoding = "pcm";
-  FUNASR_RESULT result = FunTpassInferBuffer(*asr_handler_,
-                                             tmp_online_handler,
-                                             tmp_data.c_str(),
-                                             buffer_len,
-                                             punc_cache,
-                                             is_final,
-                                             buffer_len,
-                                             encoding,
-                                             ASR_TWO_PASS);
-  if (result) {
-      FunASRFreeResult(result);
+  LOG(INFO) << "GrpcServer model loaded";
+
+  if (!warm_up_ms.empty()) {
+    if (!FunTpassWarmUp(*asr_handler_, warm_up_ms)) {
+      LOG(ERROR) << "GrpcServer model warmup failed, the server takes streams cold";
+    } else {
+      LOG(INFO) << "GrpcServer model warmup";
+    }
   }
-  FunTpassOnlineUninit(tmp_online_handler);
-  LOG(INFO) << "GrpcService model warmup";
+
+  pool_ = std::make_unique<DecodePool>(decoder_thread_num);
 }
 
-grpc::Status GrpcService::Recognize(
-  grpc::ServerContext* context,
-  grpc::ServerReaderWriter<Response, Request>* stream) {
-  LOG(INFO) << "Get Recognize request";
-  GrpcEngine engine(
-    stream,
-    asr_handler_
-  );
-
-  std::thread t(std::move(engine));
-  t.join();
-  return grpc::Status::OK;
+void GrpcServer::Run(const std::string& server_address) {
+  // grpc.health.v1 answers SERVING from here on, after the warm-up
+  grpc::EnableDefaultHealthCheckService(true);
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service_);
+  for (int i = 0; i < io_thread_num_; i++) {
+    cqs_.emplace_back(builder.AddCompletionQueue());
+  }
+  server_ = builder.BuildAndStart();
+  LOG(INFO) << "Server listening on " << server_address;
+
+  std::vector<std::thread> io_threads;
+  for (auto& cq : cqs_) {
+    new GrpcSession(&service_, cq.get(), asr_handler_, pool_.get());
+    io_threads.emplace_back(&GrpcServer::HandleEvents, this, cq.get());
+  }
+  for (auto& t : io_threads) {
+    t.join();
+  }
+}
+
+void GrpcServer::HandleEvents(grpc::ServerCompletionQueue* cq) {
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+    GrpcSession::Tag* session_tag = static_cast<GrpcSession::Tag*>(tag);
+    session_tag->session->OnEvent(session_tag->op, ok);
+  }
 }
 
 void GetValue(TCLAP::ValueArg<std::string>& value_arg, std::string key, std::map<std::string, std::string>& config) {
@@ -221,6 +375,9 @@ int main(int argc, char* argv[]) {
   TCLAP::ValueArg<std::string>  punc_quant("", PUNC_QUANT, "false (Default), load the model of model.onnx in punc_dir. If set true, load the model of model_quant.onnx in punc_dir", false, "true", "string");
   TCLAP::ValueArg<std::int32_t>  onnx_thread("", "onnx-inter-thread", "onnxruntime SetIntraOpNumThreads", false, 1, "int32_t");
   TCLAP::ValueArg<std::string> port_id("", PORT_ID, "port id", true, "", "string");
+  TCLAP::ValueArg<int> io_thread_num("", "io-thread-num", "completion queue thread num", false, 2, "int");
+  TCLAP::ValueArg<int> decoder_thread_num("", "decoder-thread-num", "decoder thread num, shared by all streams", false, 8, "int");
+  TCLAP::ValueArg<std::string> warm_up_ms("", "warm-up-ms", "audio lengths (ms) every model runs over before the port opens, e.g. 1000,3000,6000,10000,20000 (Default); empty disables the warm-up", false, "1000,3000,6000,10000,20000", "string");
 
   cmd.add(model_dir);
   cmd.add(online_model_dir);
@@ -231,6 +388,9 @@ int main(int argc, char* argv[]) {
   cmd.add(punc_quant);
   cmd.add(onnx_thread);
   cmd.add(port_id);
+  cmd.add(io_thread_num);
+  cmd.add(decoder_thread_num);
+  cmd.add(warm_up_ms);
   cmd.parse(argc, argv);
 
   std::map<std::string, std::string> config;
@@ -252,14 +412,17 @@ int main(int argc, char* argv[]) {
   }
   std::string server_address;
   server_address = "0.0.0.0:" + port;
-  GrpcService service(config, onnx_thread);
-
-  grpc::ServerBuilder builder;
-  builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-  builder.RegisterService(&service);
-  std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
-  LOG(INFO) << "Server listening on " << server_address;
-  server->Wait();
+  LOG(INFO) << "decoder-thread-num: " << decoder_thread_num.getValue();
+  LOG(INFO) << "io-thread-num: " << io_thread_num.getValue();
+  LOG(INFO) << "warm-up-ms: " << warm_up_ms.getValue();
+  std::vector<int> warm_up_buckets;
+  std::string bad_ms;
+  if (!funasr::ParseWarmUpMs(warm_up_ms.getValue(), warm_up_buckets, bad_ms)) {
+    LOG(ERROR) << "bad warm-up-ms item \"" << bad_ms << "\", expected positive ms";
+    exit(-1);
+  }
+  GrpcServer server(config, onnx_thread, decoder_thread_num.getValue(), io_thread_num.getValue(), warm_up_buckets);
+  server.Run(server_address);
 
   return 0;
 }
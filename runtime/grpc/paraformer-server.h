@@ -4,11 +4,19 @@
  */
 /* 2023 by burkliu(刘柏基) liubaiji@xverse.cn */
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
 #include <string>
 #include <thread>
-#include <mutex>
-#include <unistd.h>
+#include <vector>
 
+#include "grpcpp/grpcpp.h"
 #include "grpcpp/server_builder.h"
 #include "paraformer.grpc.pb.h"
 #include "funasrruntime.h"
@@ -28,41 +36,107 @@ typedef struct
   float  snippet_time;
 } FUNASR_RECOG_RESULT;
 
-class GrpcEngine {
+// Fixed set of threads that decode for every stream of the server. A stream
+// is queued when it has audio to decode and requeued behind the others after
+// each turn, so the thread count does not grow with the number of streams.
+class DecodePool {
+ public:
+  explicit DecodePool(int thread_num);
+  ~DecodePool();
+  void Submit(std::function<void()> task);
+
+ private:
+  void Run();
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+};
+
+// One Recognize stream driven by completion queue events. The completion
+// queue threads only move requests and responses; the audio of a stream is
+// decoded on the DecodePool, at most one turn at a time. A session deletes
+// itself once its last queued operation and its decode turn are over.
+class GrpcSession {
  public:
-  GrpcEngine(grpc::ServerReaderWriter<Response, Request>* stream, std::shared_ptr<FUNASR_HANDLE> asr_handler);
-  void operator()();
+  GrpcSession(ASR::AsyncService* service, grpc::ServerCompletionQueue* cq,
+              std::shared_ptr<FUNASR_HANDLE> asr_handler, DecodePool* pool);
+
+  enum Op { kConnect, kRead, kWrite, kFinish, kDone };
+  struct Tag {
+    GrpcSession* session;
+    Op op;
+  };
+  // completion of the operation of tag, on a completion queue thread
+  void OnEvent(Op op, bool ok);
 
  private:
-  void DecodeThreadFunc();
   void OnSpeechStart();
-  void OnSpeechData();
-  void OnSpeechEnd();
+  void StartRead();
+  // issues the next write, or Finish once the decode is over and every response is out
+  void TryWriteLocked();
+  void ScheduleDecodeLocked();
+  void Decode();
+  void SendResult(FUNASR_RESULT result, bool is_final);
+  // with mtx_ held, releases it and deletes the session if nothing refers to it anymore
+  void ReleaseLocked(std::unique_lock<std::mutex>& lock);
 
-  grpc::ServerReaderWriter<Response, Request>* stream_;
-  std::shared_ptr<Request> request_;
-  std::shared_ptr<Response> response_;
+  ASR::AsyncService* service_;
+  grpc::ServerCompletionQueue* cq_;
   std::shared_ptr<FUNASR_HANDLE> asr_handler_;
-  std::string audio_buffer_;
-  std::shared_ptr<std::thread> decode_thread_ = nullptr;
+  DecodePool* pool_;
+  grpc::ServerContext context_;
+  grpc::ServerAsyncReaderWriter<Response, Request> stream_;
+  Request request_;
+  Tag tags_[kDone + 1];
+
+  std::mutex mtx_;
+  // audio read since the last decode turn, moved to audio_ by the turn
+  std::string incoming_;
+  std::deque<Response> outbound_;
+  int pending_ops_ = 0;
+  bool reading_ = false;
+  bool writing_ = false;
+  bool finishing_ = false;
+  bool decoding_ = false;
+  bool input_end_ = false;
+  bool decode_end_ = false;
+  bool cancelled_ = false;
   bool is_start_ = false;
-  bool is_end_ = false;
+
+  // owned by the decode turn; audio_ is consumed from offset_ and compacted
+  // once the consumed part is the larger half
+  std::string audio_;
+  size_t offset_ = 0;
+  FUNASR_HANDLE tpass_online_handler_ = nullptr;
+  std::vector<std::vector<std::string>> punc_cache_;
 
   std::vector<int> chunk_size_ = {5, 10, 5};
   int sampling_rate_ = 16000;
   std::string encoding_;
   ASR_TYPE mode_ = ASR_TWO_PASS;
   int step_duration_ms_ = 100;
-
-  std::unique_ptr<std::mutex> p_mutex_= std::make_unique<std::mutex>(); // mutex is not moveable
 };
 
-class GrpcService final : public ASR::Service {
-  public:
-    GrpcService(std::map<std::string, std::string>& config, int num_thread);
-    grpc::Status Recognize(grpc::ServerContext* context, grpc::ServerReaderWriter<Response, Request>* stream);
+class GrpcServer {
+ public:
+  // runs the models over warm_up_ms of synthetic audio (FunTpassWarmUp)
+  // before Run opens the port
+  GrpcServer(std::map<std::string, std::string>& config, int onnx_thread,
+             int decoder_thread_num, int io_thread_num,
+             const std::vector<int>& warm_up_ms);
+  void Run(const std::string& server_address);
+
+ private:
+  void HandleEvents(grpc::ServerCompletionQueue* cq);
 
-  private:
-    std::map<std::string, std::string> config_;
-    std::shared_ptr<FUNASR_HANDLE> asr_handler_;
+  std::map<std::string, std::string> config_;
+  std::shared_ptr<FUNASR_HANDLE> asr_handler_;
+  std::unique_ptr<DecodePool> pool_;
+  int io_thread_num_;
+  ASR::AsyncService service_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+  std::unique_ptr<grpc::Server> server_;
 };
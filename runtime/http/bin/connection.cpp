@@ -180,6 +180,13 @@ namespace http
             {
             case State::ReadingHeaders:
 
+              if (is_metrics_request())
+              {
+                data_msg->status = 1;
+                s_timer->cancel();
+                send_metrics_response();
+                return;
+              }
               if (try_parse_headers())
               {
                 if (state_ == State::SendingContinue)
@@ -241,11 +248,28 @@ namespace http
         auto close_thread = std::bind(&connection::write_back, std::ref(*this), "close");
         auto decoder_thread = std::bind(&ModelDecoder::do_decoder,
                            std::ref(*model_decoder), std::ref(data_msg));
-
-        // for decode task
-        strand_->post(decoder_thread);
-        // for close task
-        strand_->post(close_thread);
+        std::shared_ptr<asio::io_context::strand> strand = strand_;
+
+        // the request may wait in the scheduler, the read timeout no longer applies
+        s_timer->cancel();
+        std::string wav_format = data_msg->msg["wav_format"];
+        int audio_fs = data_msg->msg["audio_fs"];
+        size_t bytes = data_msg->samples->size();
+        int retry_after_ms = 0;
+        // for decode task, then close task
+        if (!model_decoder->get_scheduler().Submit(
+                [decoder_thread, close_thread, strand]() {
+                  decoder_thread();
+                  strand->post(close_thread);
+                },
+                OfflineScheduler::EstimateAudioSec(bytes, wav_format, audio_fs),
+                bytes, priority_, &retry_after_ms))
+        {
+          std::cout << "server busy, retry after " << retry_after_ms << " ms" << std::endl;
+          data_msg->status = 1;
+          send_503_busy(retry_after_ms);
+          return;
+        }
         data_msg->sem_resultok.acquire();
         std::cout << "解码线程提交结束！！！！ " << std::endl;
       }
@@ -109,6 +109,45 @@ namespace http
                 socket_.close();
             }
 
+            // GET /metrics is answered with the runtime metrics and never
+            // reaches the decoder
+            bool is_metrics_request()
+            {
+                return received_data_.find("\r\n\r\n") != std::string::npos &&
+                       (received_data_.compare(0, 13, "GET /metrics ") == 0 ||
+                        received_data_.compare(0, 13, "GET /metrics?") == 0);
+            }
+
+            void send_metrics_response()
+            {
+                std::string body = FunASRGetMetrics() +
+                                   model_decoder->get_scheduler().GetMetrics();
+                const std::string response =
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                    "Connection: close\r\n\r\n" + body;
+                asio::error_code ec;
+                asio::write(socket_, asio::buffer(response), ec);
+                socket_.close(ec);
+            }
+
+            // the scheduler is saturated, the client should come back later
+            void send_503_busy(int retry_after_ms)
+            {
+                std::string body = "{\"error\":\"server busy\",\"retry_after_ms\":" +
+                                   std::to_string(retry_after_ms) + "}";
+                const std::string response =
+                    "HTTP/1.1 503 Service Unavailable\r\n"
+                    "Content-Type: application/json\r\n"
+                    "Retry-After: " + std::to_string((retry_after_ms + 999) / 1000) + "\r\n"
+                    "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                    "Connection: close\r\n\r\n" + body;
+                asio::error_code ec;
+                asio::write(socket_, asio::buffer(response), ec);
+                socket_.close(ec);
+            }
+
             void send_417_expectation_failed()
             {
                 const std::string response =
@@ -190,6 +229,15 @@ namespace http
                 }
 
                 filename_ = parse_attachment_filename(headers);
+                // X-Priority: high|normal|low picks the scheduling class
+                size_t prio_pos = headers.find("X-Priority: ");
+                if (prio_pos != std::string::npos)
+                {
+                    prio_pos += 12;
+                    size_t prio_end = headers.find("\r\n", prio_pos);
+                    priority_ = OfflineScheduler::ParsePriority(
+                        headers.substr(prio_pos, prio_end - prio_pos));
+                }
 
                 // 状态转移
                 std::string ext = parese_file_ext(filename_);
@@ -377,6 +425,7 @@ namespace http
             bool expect_100_continue_ = false;
             State state_ = State::ReadingHeaders;
             std::string filename_;
+            int priority_ = SCHED_PRIORITY_NORMAL;
             std::ofstream output_file_;
             int http_version_major_ = 1;
             int http_version_minor_ = 1;
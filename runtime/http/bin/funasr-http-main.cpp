@@ -129,6 +129,25 @@ int main(int argc, char *argv[]) {
         "", "decoder-thread-num", "decoder thread num", false, 32, "int");
     TCLAP::ValueArg<int> model_thread_num("", "model-thread-num",
                                           "model thread num", false, 1, "int");
+    TCLAP::ValueArg<int> max_queue(
+        "", "max-queue",
+        "requests waiting for a decoder thread, more are rejected", false,
+        1024, "int");
+    TCLAP::ValueArg<float> max_audio_sec(
+        "", "max-audio-sec",
+        "seconds of audio queued and being decoded, more are rejected with "
+        "503 and Retry-After, 0 for no limit",
+        false, 7200, "float");
+    TCLAP::ValueArg<int> max_request_mb(
+        "", "max-request-mb",
+        "MB of request data queued and being decoded, more are rejected with "
+        "503 and Retry-After, 0 for no limit",
+        false, 2048, "int");
+    TCLAP::ValueArg<float> sched_aging(
+        "", "sched-aging",
+        "audio seconds a waiting request is moved ahead per second of "
+        "waiting, so long files are not starved",
+        false, 10, "float");
 
     TCLAP::ValueArg<std::string> certfile(
         "", "certfile",
@@ -167,7 +186,12 @@ int main(int argc, char *argv[]) {
         "", FST_INC_WTS, "the fst hotwords incremental bias", false, 20,
         "int32_t");
 
+    TCLAP::SwitchArg enable_metrics(
+        "", "enable-metrics",
+        "record per-stage metrics and serve them on GET /metrics", false);
+
     // add file
+    cmd.add(enable_metrics);
     cmd.add(hotword);
     cmd.add(fst_inc_wts);
     cmd.add(global_beam);
@@ -196,7 +220,14 @@ int main(int argc, char *argv[]) {
     cmd.add(io_thread_num);
     cmd.add(decoder_thread_num);
     cmd.add(model_thread_num);
+    cmd.add(max_queue);
+    cmd.add(max_audio_sec);
+    cmd.add(max_request_mb);
+    cmd.add(sched_aging);
     cmd.parse(argc, argv);
+    if (enable_metrics.getValue()) {
+      FunASRMetricsEnable(true);
+    }
 
     std::map<std::string, std::string> model_path;
     GetValue(model_dir, MODEL_DIR, model_path);
@@ -504,9 +535,16 @@ int main(int argc, char *argv[]) {
     LOG(INFO) << "io-thread-num: " << s_io_thread_num;
     LOG(INFO) << "model-thread-num: " << s_model_thread_num;
 
+    SchedulerOptions sched_opts;
+    sched_opts.max_running = s_decoder_thread_num;
+    sched_opts.max_queue = max_queue.getValue();
+    sched_opts.max_audio_sec = max_audio_sec.getValue();
+    sched_opts.max_bytes = (size_t)std::max(0, max_request_mb.getValue()) << 20;
+    sched_opts.aging = sched_aging.getValue();
+
     http::server2::server s(s_listen_ip, std::to_string(s_port), "./",
                             s_io_thread_num, io_decoder, model_path,
-                            s_model_thread_num);
+                            s_model_thread_num, sched_opts);
 
     s.run();
     LOG(INFO) << "http model loop " << s_port;
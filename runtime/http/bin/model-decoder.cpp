@@ -34,7 +34,7 @@ void ModelDecoder::do_decoder(std::shared_ptr<FUNASR_MESSAGE> session_msg) {
     if (num_samples > 0 && session_msg->hotwords_embedding->size() > 0) {
       std::string asr_result = "";
       std::string stamp_res = "";
-      std::string stamp_sents = "";
+      nlohmann::json stamp_sents;
 
       try {
         std::vector<std::vector<float>> hotwords_embedding_(
@@ -49,7 +49,9 @@ void ModelDecoder::do_decoder(std::shared_ptr<FUNASR_MESSAGE> session_msg) {
         if (Result != nullptr) {
           asr_result = FunASRGetResult(Result, 0);  // get decode result
           stamp_res = FunASRGetStamp(Result);
-          stamp_sents = FunASRGetStampSents(Result);
+          if (FunASRGetStampSentNum(Result) > 0) {
+            stamp_sents = funasr::GetStampSentsJson(Result);
+          }
           FunASRFreeResult(Result);
 
         } else {
@@ -66,14 +68,8 @@ void ModelDecoder::do_decoder(std::shared_ptr<FUNASR_MESSAGE> session_msg) {
       if (stamp_res != "") {
         jsonresult["timestamp"] = stamp_res;
       }
-      if (stamp_sents != "") {
-        try {
-          nlohmann::json json_stamp = nlohmann::json::parse(stamp_sents);
-          jsonresult["stamp_sents"] = json_stamp;
-        } catch (std::exception const &e) {
-          std::cout << "error:" << e.what();
-          jsonresult["stamp_sents"] = "";
-        }
+      if (!stamp_sents.is_null()) {
+        jsonresult["stamp_sents"] = stamp_sents;
       }
       jsonresult["wav_name"] = wav_name;
 
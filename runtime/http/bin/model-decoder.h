@@ -28,14 +28,20 @@
 #include "com-define.h"
 #include "funasrruntime.h"
 #include "nlohmann/json.hpp"
+#include "stamp-sents-json.h"
+#include "offline-scheduler.h"
 #include "tclap/CmdLine.h"
 #include "util/text-utils.h"
 
 class ModelDecoder {
  public:
   ModelDecoder(asio::io_context &io_decoder,
-               std::map<std::string, std::string> &model_path, int thread_num)
-      : io_decoder_(io_decoder) {
+               std::map<std::string, std::string> &model_path, int thread_num,
+               const SchedulerOptions &sched_opts)
+      : io_decoder_(io_decoder),
+        scheduler_(sched_opts, [&io_decoder](std::function<void()> task) {
+          asio::post(io_decoder, std::move(task));
+        }) {
     asr_handle = initAsr(model_path, thread_num);
  
   }
@@ -50,9 +56,11 @@ class ModelDecoder {
   {
     return asr_handle;
   }
+  OfflineScheduler &get_scheduler() { return scheduler_; }
  private:
  
   FUNASR_HANDLE asr_handle;  // asr engine handle
+  OfflineScheduler scheduler_;  // orders the decode jobs
   bool isonline = false;  // online or offline engine, now only support offline
 };
 
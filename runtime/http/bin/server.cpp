@@ -22,7 +22,8 @@ namespace server2 {
 server::server(const std::string &address, const std::string &port,
                const std::string &doc_root, std::size_t io_context_pool_size,
                asio::io_context &decoder_context,
-               std::map<std::string, std::string> &model_path, int thread_num)
+               std::map<std::string, std::string> &model_path, int thread_num,
+               const SchedulerOptions &sched_opts)
     : io_context_pool_(io_context_pool_size),
       signals_(io_context_pool_.get_io_context()),
       acceptor_(io_context_pool_.get_io_context()),
@@ -32,7 +33,8 @@ server::server(const std::string &address, const std::string &port,
   // provided all registration for the specified signal is made through Asio.
   try {
     model_decoder =
-        std::make_shared<ModelDecoder>(decoder_context, model_path, thread_num);
+        std::make_shared<ModelDecoder>(decoder_context, model_path, thread_num,
+                                       sched_opts);
 
     LOG(INFO) << "try to listen on port:" << port << std::endl;
     LOG(INFO) << "still not work, pls wait... " << std::endl;
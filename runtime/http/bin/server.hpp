@@ -34,7 +34,7 @@ class server {
                   const std::string &doc_root, std::size_t io_context_pool_size,
                   asio::io_context &decoder_context,
                   std::map<std::string, std::string> &model_path,
-                  int thread_num);
+                  int thread_num, const SchedulerOptions &sched_opts);
 
   /// Run the server's io_context loop.
   void run();
@@ -0,0 +1,35 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Converts TLG.fst or the itn tagger/verbalizer once to aligned const fsts,
+// in place by default. The runtimes then map them read-only at load time.
+
+#include <iostream>
+#include <string>
+#include <glog/logging.h>
+#include "funasrruntime.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    TCLAP::CmdLine cmd("funasr-fst-const", ' ', "1.0");
+    TCLAP::ValueArg<std::string> input("", "input", "the fst to convert, e.g. lm_dir/TLG.fst or itn_dir/zh_itn_tagger.fst", true, "", "string");
+    TCLAP::ValueArg<std::string> output("", "output", "the const fst to write, the input is replaced if not set", false, "", "string");
+    cmd.add(input);
+    cmd.add(output);
+    cmd.parse(argc, argv);
+
+    std::string out_path = output.isSet() ? output.getValue() : input.getValue();
+    if (!FunASRFstToConst(input.getValue(), out_path)) {
+        LOG(ERROR) << "Failed to convert " << input.getValue();
+        return -1;
+    }
+    LOG(INFO) << "Wrote " << out_path;
+    return 0;
+}
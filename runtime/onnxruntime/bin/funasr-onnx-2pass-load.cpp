@@ -0,0 +1,560 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+// Real-time load generator for the 2pass engine.
+// Unlike funasr-onnx-2pass-rtf, which feeds audio as fast as possible, every
+// stream here is played at wall-clock pace: chunk k is only handed to
+// FunTpassInferBuffer once the audio it contains would have been spoken.
+// For a given number of concurrent streams we report:
+//   - per-chunk processing time and lag behind the real-time schedule,
+//   - first partial latency (first vad speech frame -> first non-empty online result),
+//   - final latency (end of the segment's last token -> 2pass-offline result).
+// With --slo-ms set, the stream count is searched for the largest value whose
+// chosen percentile of chunk lag and final latency stays within the SLO.
+// With --chunk-sizes set, the streams switch chunk size with the load like the
+// 2pass server does, to compare against a fixed --chunk-size.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <glog/logging.h>
+#include "util.h"
+#include "funasrruntime.h"
+#include "tclap/CmdLine.h"
+#include "com-define.h"
+#include "audio.h"
+#include "chunk-policy.h"
+
+using namespace std;
+typedef std::chrono::steady_clock load_clock;
+
+struct WavData {
+    string wav_id;
+    vector<char> pcm;
+    int sampling_rate;
+    // start of the first vad speech segment, latencies of partials are taken from here
+    int speech_onset_ms = 0;
+};
+
+struct LoadConfig {
+    std::vector<int> chunk_size;
+    // adaptive when not empty, chunk_size is then the first size of a stream
+    std::vector<std::vector<int>> chunk_sizes;
+    int chunk_target_ms;
+    string latency_class;
+    int chunk_interval_ms;
+    ASR_TYPE asr_mode;
+    float glob_beam;
+    float lat_beam;
+    float am_scale;
+    int inc_bias;
+    unordered_map<string, int> hws_map;
+    string nn_hotwords;
+};
+
+// all latencies are kept in ms
+struct LoadStats {
+    vector<double> chunk_proc;
+    vector<double> chunk_lag;
+    vector<double> first_partial;
+    vector<double> final_latency;
+    double audio_ms = 0.0;
+    double wall_ms = 0.0;
+
+    void Merge(const LoadStats& other) {
+        chunk_proc.insert(chunk_proc.end(), other.chunk_proc.begin(), other.chunk_proc.end());
+        chunk_lag.insert(chunk_lag.end(), other.chunk_lag.begin(), other.chunk_lag.end());
+        first_partial.insert(first_partial.end(), other.first_partial.begin(), other.first_partial.end());
+        final_latency.insert(final_latency.end(), other.final_latency.begin(), other.final_latency.end());
+        audio_ms += other.audio_ms;
+        wall_ms = std::max(wall_ms, other.wall_ms);
+    }
+};
+
+bool is_target_file(const std::string& filename, const std::string target) {
+    std::size_t pos = filename.find_last_of(".");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    std::string extension = filename.substr(pos + 1);
+    return (extension == target);
+}
+
+void GetValue(TCLAP::ValueArg<std::string>& value_arg, string key, std::map<std::string, std::string>& model_path)
+{
+    model_path.insert({key, value_arg.getValue()});
+    LOG(INFO)<< key << " : " << value_arg.getValue();
+}
+
+double ElapsedMs(load_clock::time_point from, load_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+double Percentile(vector<double> samples, float pct) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    int rank = (int)std::ceil(pct / 100.0 * samples.size()) - 1;
+    rank = std::max(0, std::min(rank, (int)samples.size() - 1));
+    return samples[rank];
+}
+
+// end time (ms, relative to stream start) of the last token of a result, or -1
+// if it carries no timestamp
+int LastStampEnd(FUNASR_RESULT result) {
+    const int* stamps = nullptr;
+    int stamp_num = FunASRGetStampArray(result, &stamps);
+    if (stamp_num <= 0) {
+        return -1;
+    }
+    return stamps[2 * stamp_num - 1];
+}
+
+bool LoadWav(const string& wav_path, int audio_fs, WavData& wav) {
+    int32_t sampling_rate_ = audio_fs;
+    funasr::Audio audio(1);
+    if(is_target_file(wav_path, "wav")){
+        if(!audio.LoadWav2Char(wav_path.c_str(), &sampling_rate_)){
+            return false;
+        }
+    }else if(is_target_file(wav_path, "pcm")){
+        if (!audio.LoadPcmwav2Char(wav_path.c_str(), &sampling_rate_)){
+            return false;
+        }
+    }else{
+        if (!audio.FfmpegLoad(wav_path.c_str(), true)){
+            return false;
+        }
+    }
+    char* speech_buff = audio.GetSpeechChar();
+    int buff_len = audio.GetSpeechLen()*2;
+    wav.pcm.assign(speech_buff, speech_buff + buff_len);
+    wav.sampling_rate = sampling_rate_;
+    return true;
+}
+
+// runs the offline vad once over every wav so that leading silence is not counted as latency
+void FindSpeechOnset(std::map<std::string, std::string>& model_path, vector<WavData>& wav_list) {
+    if (model_path[VAD_DIR].empty()) {
+        LOG(INFO) << "no vad-dir, first partial latency is measured from the start of the audio";
+        return;
+    }
+    std::map<std::string, std::string> vad_path;
+    vad_path[MODEL_DIR] = model_path[VAD_DIR];
+    vad_path[QUANTIZE] = model_path[VAD_QUANT];
+    FUNASR_HANDLE vad_handle = FsmnVadInit(vad_path, 1);
+    if (!vad_handle) {
+        LOG(ERROR) << "FsmnVadInit failed, first partial latency is measured from the start of the audio";
+        return;
+    }
+    for (auto& wav : wav_list) {
+        FUNASR_RESULT result = FsmnVadInferBuffer(vad_handle, wav.pcm.data(), wav.pcm.size(), nullptr, true, wav.sampling_rate);
+        if (!result) {
+            continue;
+        }
+        vector<std::vector<int>>* vad_segments = FsmnVadGetResult(result, 0);
+        if (vad_segments && !vad_segments->empty() && !vad_segments->front().empty()) {
+            wav.speech_onset_ms = std::max(0, vad_segments->front()[0]);
+        }
+        FsmnVadFreeResult(result);
+    }
+    FsmnVadUninit(vad_handle);
+}
+
+// plays wav_list[stream_id], wav_list[stream_id+1], ... back to back at real-time pace
+void RunStream(FUNASR_HANDLE tpass_handle, const vector<WavData>* wav_list, const LoadConfig* config,
+               funasr::ChunkSizePolicy* chunk_policy, int stream_id, int utt_num, load_clock::time_point start_at,
+               LoadStats* stats) {
+    FUNASR_DEC_HANDLE decoder_handle = FunASRWfstDecoderInit(tpass_handle, ASR_TWO_PASS, config->glob_beam, config->lat_beam, config->am_scale);
+    unordered_map<string, int> hws_map = config->hws_map;
+    string nn_hotwords = config->nn_hotwords;
+    FunWfstDecoderLoadHwsRes(decoder_handle, config->inc_bias, hws_map);
+    std::vector<std::vector<float>> hotwords_embedding = CompileHotwordEmbedding(tpass_handle, nn_hotwords, ASR_TWO_PASS);
+    std::vector<int> chunk_size = chunk_policy ? chunk_policy->Pick(config->latency_class) : config->chunk_size;
+    FUNASR_HANDLE tpass_online_handle = FunTpassOnlineInit(tpass_handle, chunk_size);
+    if (!tpass_online_handle) {
+        LOG(ERROR) << "FunTpassOnlineInit failed for stream " << stream_id;
+        FunASRWfstDecoderUninit(decoder_handle);
+        return;
+    }
+    if (chunk_policy) {
+        FunTpassOnlineSetMaxLookback(tpass_online_handle, chunk_policy->MaxLookback());
+    }
+
+    std::this_thread::sleep_until(start_at);
+    load_clock::time_point utt_start = load_clock::now();
+    load_clock::time_point stream_start = utt_start;
+
+    for (int n = 0; n < utt_num; n++) {
+        const WavData& wav = (*wav_list)[(stream_id + n) % wav_list->size()];
+        const char* speech_buff = wav.pcm.data();
+        int buff_len = wav.pcm.size();
+        int step = wav.sampling_rate * config->chunk_interval_ms / 1000 * 2;
+        bool is_final = false;
+        bool got_partial = false;
+        std::vector<std::vector<string>> punc_cache(2);
+
+        for (int sample_offset = 0; sample_offset < buff_len; sample_offset += step) {
+            int cur_step = step;
+            if (sample_offset + step >= buff_len - 1) {
+                cur_step = buff_len - sample_offset;
+                is_final = true;
+            }
+            // the chunk is available once its last sample has been spoken
+            double audio_end_ms = (double)(sample_offset + cur_step) / 2 * 1000 / wav.sampling_rate;
+            load_clock::time_point due = utt_start + std::chrono::microseconds((long)(audio_end_ms * 1000));
+            std::this_thread::sleep_until(due);
+
+            if (chunk_policy) {
+                std::vector<int> picked = chunk_policy->Pick(config->latency_class);
+                if (picked != chunk_size && FunTpassOnlineSetChunkSize(tpass_online_handle, picked)) {
+                    chunk_size = picked;
+                }
+            }
+            load_clock::time_point begin = load_clock::now();
+            FUNASR_RESULT result = FunTpassInferBuffer(tpass_handle, tpass_online_handle, speech_buff+sample_offset, cur_step, punc_cache, is_final,
+                                                        wav.sampling_rate, "pcm", config->asr_mode, hotwords_embedding, true, decoder_handle);
+            load_clock::time_point end = load_clock::now();
+            stats->chunk_proc.push_back(ElapsedMs(begin, end));
+            stats->chunk_lag.push_back(ElapsedMs(due, end));
+            if (chunk_policy) {
+                chunk_policy->Report(ElapsedMs(due, end));
+            }
+
+            if (result)
+            {
+                string online_msg = FunASRGetResult(result, 0);
+                if (!got_partial && online_msg != "") {
+                    stats->first_partial.push_back(ElapsedMs(utt_start, end) - wav.speech_onset_ms);
+                    got_partial = true;
+                }
+                string tpass_msg = FunASRGetTpassResult(result, 0);
+                if (tpass_msg != "") {
+                    // without timestamps fall back to the audio position that triggered the result
+                    int seg_end_ms = LastStampEnd(result);
+                    double speech_end_ms = seg_end_ms >= 0 ? seg_end_ms : audio_end_ms;
+                    stats->final_latency.push_back(ElapsedMs(utt_start, end) - speech_end_ms);
+                }
+                FunASRFreeResult(result);
+            }
+        }
+        stats->audio_ms += (double)buff_len / 2 * 1000 / wav.sampling_rate;
+        // the next utterance follows right after this one, or now if we fell behind
+        utt_start = std::max(load_clock::now(),
+                             utt_start + std::chrono::microseconds((long)((double)buff_len / 2 * 1000000 / wav.sampling_rate)));
+    }
+    stats->wall_ms = ElapsedMs(stream_start, load_clock::now());
+
+    FunWfstDecoderUnloadHwsRes(decoder_handle);
+    FunASRWfstDecoderUninit(decoder_handle);
+    FunTpassOnlineUninit(tpass_online_handle);
+}
+
+LoadStats RunLoad(FUNASR_HANDLE tpass_handle, const vector<WavData>& wav_list, const LoadConfig& config,
+                  int stream_num, int utt_num) {
+    vector<LoadStats> stream_stats(stream_num);
+    // every trial starts from the smallest size
+    std::unique_ptr<funasr::ChunkSizePolicy> chunk_policy;
+    if (!config.chunk_sizes.empty()) {
+        chunk_policy.reset(new funasr::ChunkSizePolicy(config.chunk_sizes, config.chunk_target_ms));
+    }
+    std::vector<std::thread> threads;
+    // spread stream starts over one chunk interval so that chunks do not arrive in lockstep
+    load_clock::time_point base = load_clock::now() + std::chrono::milliseconds(100);
+    for (int i = 0; i < stream_num; i++)
+    {
+        load_clock::time_point start_at = base + std::chrono::microseconds((long)config.chunk_interval_ms * 1000 * i / stream_num);
+        threads.emplace_back(thread(RunStream, tpass_handle, &wav_list, &config, chunk_policy.get(), i, utt_num, start_at,
+                                    &stream_stats[i]));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (chunk_policy) {
+        LOG(INFO) << "chunk size level at the end: " << chunk_policy->Level();
+    }
+    LoadStats total;
+    for (auto& stats : stream_stats) {
+        total.Merge(stats);
+    }
+    return total;
+}
+
+void PrintHistogram(const string& name, const vector<double>& samples) {
+    if (samples.empty()) {
+        LOG(INFO) << name << " : no samples";
+        return;
+    }
+    double sum = 0.0;
+    for (auto& sample : samples) {
+        sum += sample;
+    }
+    LOG(INFO) << name << " (ms) : count " << samples.size()
+              << std::fixed << std::setprecision(1)
+              << ", mean " << sum / samples.size()
+              << ", p50 " << Percentile(samples, 50)
+              << ", p90 " << Percentile(samples, 90)
+              << ", p99 " << Percentile(samples, 99)
+              << ", max " << *std::max_element(samples.begin(), samples.end());
+
+    const double bounds[] = {5, 10, 20, 50, 100, 200, 500, 1000, 2000};
+    const int bucket_num = sizeof(bounds) / sizeof(bounds[0]);
+    vector<int> counts(bucket_num + 1, 0);
+    for (auto& sample : samples) {
+        int b = std::upper_bound(bounds, bounds + bucket_num, sample) - bounds;
+        counts[b]++;
+    }
+    std::ostringstream oss;
+    for (int b = 0; b <= bucket_num; b++) {
+        if (b < bucket_num) {
+            oss << " <=" << bounds[b] << ":" << counts[b];
+        } else {
+            oss << " >" << bounds[bucket_num - 1] << ":" << counts[b];
+        }
+    }
+    LOG(INFO) << name << " histogram :" << oss.str();
+}
+
+void Report(int stream_num, const LoadStats& stats) {
+    LOG(INFO) << "==== streams " << stream_num << " ====";
+    PrintHistogram("chunk processing time", stats.chunk_proc);
+    PrintHistogram("chunk lag behind real time", stats.chunk_lag);
+    PrintHistogram("first partial latency", stats.first_partial);
+    PrintHistogram("final latency after end of speech", stats.final_latency);
+    if (stats.wall_ms > 0) {
+        LOG(INFO) << "audio played " << (long)stats.audio_ms << " ms in " << (long)stats.wall_ms
+                  << " ms wall time (" << stats.audio_ms / stats.wall_ms << "x real time in aggregate)";
+    }
+}
+
+bool MeetsSlo(const LoadStats& stats, float pct, float slo_ms) {
+    if (Percentile(stats.chunk_lag, pct) > slo_ms) {
+        return false;
+    }
+    if (!stats.final_latency.empty() && Percentile(stats.final_latency, pct) > slo_ms) {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    TCLAP::CmdLine cmd("funasr-onnx-2pass-load", ' ', "1.0");
+    TCLAP::ValueArg<std::string>    offline_model_dir("", OFFLINE_MODEL_DIR, "the asr offline model path, which contains model.onnx, config.yaml, am.mvn", true, "", "string");
+    TCLAP::ValueArg<std::string>    online_model_dir("", ONLINE_MODEL_DIR, "the asr online model path, which contains model.onnx, decoder.onnx, config.yaml, am.mvn", true, "", "string");
+    TCLAP::ValueArg<std::string>    quantize("", QUANTIZE, "true (Default), load the model of model.onnx in model_dir. If set true, load the model of model_quant.onnx in model_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    vad_dir("", VAD_DIR, "the vad online model path, which contains model.onnx, vad.yaml, vad.mvn", false, "", "string");
+    TCLAP::ValueArg<std::string>    vad_quant("", VAD_QUANT, "true (Default), load the model of model.onnx in vad_dir. If set true, load the model of model_quant.onnx in vad_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    punc_dir("", PUNC_DIR, "the punc online model path, which contains model.onnx, punc.yaml", false, "", "string");
+    TCLAP::ValueArg<std::string>    punc_quant("", PUNC_QUANT, "true (Default), load the model of model.onnx in punc_dir. If set true, load the model of model_quant.onnx in punc_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    itn_dir("", ITN_DIR, "the itn model(fst) path, which contains zh_itn_tagger.fst and zh_itn_verbalizer.fst", false, "", "string");
+    TCLAP::ValueArg<std::string>    lm_dir("", LM_DIR, "the lm model path, which contains compiled models: TLG.fst, config.yaml, lexicon.txt ", false, "", "string");
+    TCLAP::ValueArg<float>    global_beam("", GLOB_BEAM, "the decoding beam for beam searching ", false, 3.0, "float");
+    TCLAP::ValueArg<float>    lattice_beam("", LAT_BEAM, "the lattice generation beam for beam searching ", false, 3.0, "float");
+    TCLAP::ValueArg<float>    am_scale("", AM_SCALE, "the acoustic scale for beam searching ", false, 10.0, "float");
+    TCLAP::ValueArg<std::int32_t>   fst_inc_wts("", FST_INC_WTS, "the fst hotwords incremental bias", false, 20, "int32_t");
+
+    TCLAP::ValueArg<std::string>    asr_mode("", ASR_MODE, "offline, online, 2pass", false, "2pass", "string");
+    TCLAP::ValueArg<std::int32_t>   onnx_thread("", "model-thread-num", "onnxruntime SetIntraOpNumThreads", false, 1, "int32_t");
+    TCLAP::ValueArg<std::string>    wav_path("", WAV_PATH, "the input could be: wav_path, e.g.: asr_example.wav; pcm_path, e.g.: asr_example.pcm; wav.scp, kaldi style wav list (wav_id \t wav_path)", true, "", "string");
+    TCLAP::ValueArg<std::int32_t>   audio_fs("", AUDIO_FS, "the sample rate of audio", false, 16000, "int32_t");
+    TCLAP::ValueArg<std::string>    hotword("", HOTWORD, "the hotword file, one hotword perline, Format: Hotword Weight (could be: 阿里巴巴 20)", false, "", "string");
+
+    TCLAP::ValueArg<std::int32_t>   stream_num("", "stream-num", "the number of concurrent real-time streams, the start point when searching", false, 1, "int32_t");
+    TCLAP::ValueArg<std::int32_t>   max_stream_num("", "max-stream-num", "the upper bound of streams when searching", false, 256, "int32_t");
+    TCLAP::ValueArg<std::int32_t>   chunk_interval("", "chunk-interval-ms", "the audio duration of every chunk sent, which is also the sending interval", false, 100, "int32_t");
+    TCLAP::ValueArg<std::int32_t>   utt_num("", "utt-num", "the number of utterances played by each stream, 0 means one pass over the wav list", false, 0, "int32_t");
+    TCLAP::ValueArg<float>          slo_ms("", "slo-ms", "the latency slo in ms; if set, search the max stream number meeting it", false, 0, "float");
+    TCLAP::ValueArg<std::string>    chunk_size_arg("", "chunk-size", "the fixed chunk size lookback,chunk,lookahead in 60ms frames", false, "5,10,5", "string");
+    TCLAP::ValueArg<std::string>    chunk_sizes("", "chunk-sizes", "chunk sizes to switch between with the load, e.g. 5,10,5;5,20,5;5,40,5, all with the same lookahead; empty (Default) keeps chunk-size", false, "", "string");
+    TCLAP::ValueArg<std::int32_t>   chunk_target_ms("", "chunk-target-ms", "with chunk-sizes, the p95 chunk lag above which streams go to a larger chunk size", false, 300, "int32_t");
+    TCLAP::ValueArg<std::string>    latency_class("", "latency-class", "with chunk-sizes, the sizes streams may use: low (the smallest), normal (up to the middle one) or high (all)", false, "normal", "string");
+    TCLAP::ValueArg<float>          slo_percentile("", "slo-percentile", "the percentile of chunk lag and final latency checked against slo-ms", false, 90, "float");
+
+    cmd.add(offline_model_dir);
+    cmd.add(online_model_dir);
+    cmd.add(quantize);
+    cmd.add(vad_dir);
+    cmd.add(vad_quant);
+    cmd.add(punc_dir);
+    cmd.add(punc_quant);
+    cmd.add(itn_dir);
+    cmd.add(lm_dir);
+    cmd.add(global_beam);
+    cmd.add(lattice_beam);
+    cmd.add(am_scale);
+    cmd.add(fst_inc_wts);
+    cmd.add(wav_path);
+    cmd.add(audio_fs);
+    cmd.add(asr_mode);
+    cmd.add(onnx_thread);
+    cmd.add(hotword);
+    cmd.add(stream_num);
+    cmd.add(max_stream_num);
+    cmd.add(chunk_interval);
+    cmd.add(utt_num);
+    cmd.add(slo_ms);
+    cmd.add(slo_percentile);
+    cmd.add(chunk_size_arg);
+    cmd.add(chunk_sizes);
+    cmd.add(chunk_target_ms);
+    cmd.add(latency_class);
+    cmd.parse(argc, argv);
+
+    std::map<std::string, std::string> model_path;
+    GetValue(offline_model_dir, OFFLINE_MODEL_DIR, model_path);
+    GetValue(online_model_dir, ONLINE_MODEL_DIR, model_path);
+    GetValue(quantize, QUANTIZE, model_path);
+    GetValue(vad_dir, VAD_DIR, model_path);
+    GetValue(vad_quant, VAD_QUANT, model_path);
+    GetValue(punc_dir, PUNC_DIR, model_path);
+    GetValue(punc_quant, PUNC_QUANT, model_path);
+    GetValue(itn_dir, ITN_DIR, model_path);
+    GetValue(lm_dir, LM_DIR, model_path);
+    GetValue(wav_path, WAV_PATH, model_path);
+    GetValue(asr_mode, ASR_MODE, model_path);
+
+    LoadConfig config;
+    if(model_path[ASR_MODE] == "offline"){
+        config.asr_mode = ASR_OFFLINE;
+    }else if(model_path[ASR_MODE] == "online"){
+        config.asr_mode = ASR_ONLINE;
+    }else if(model_path[ASR_MODE] == "2pass"){
+        config.asr_mode = ASR_TWO_PASS;
+    }else{
+        LOG(ERROR) << "Wrong asr-mode : " << model_path[ASR_MODE];
+        exit(-1);
+    }
+    if (chunk_interval.getValue() <= 0 || stream_num.getValue() <= 0) {
+        LOG(ERROR) << "chunk-interval-ms and stream-num should be positive";
+        exit(-1);
+    }
+
+    FUNASR_HANDLE tpass_hanlde=FunTpassInit(model_path, onnx_thread.getValue());
+    if (!tpass_hanlde)
+    {
+        LOG(ERROR) << "FunTpassInit init failed";
+        exit(-1);
+    }
+    std::vector<std::vector<int>> fixed_size;
+    if (!funasr::ChunkSizePolicy::Parse(chunk_size_arg.getValue(), fixed_size) || fixed_size.size() != 1) {
+        LOG(ERROR) << "Wrong chunk-size : " << chunk_size_arg.getValue();
+        exit(-1);
+    }
+    config.chunk_size = fixed_size[0];
+    if (chunk_sizes.isSet() && !funasr::ChunkSizePolicy::Parse(chunk_sizes.getValue(), config.chunk_sizes)) {
+        exit(-1);
+    }
+    config.chunk_target_ms = chunk_target_ms.getValue();
+    config.latency_class = latency_class.getValue();
+    config.chunk_interval_ms = chunk_interval.getValue();
+    config.glob_beam = 3.0f;
+    config.lat_beam = 3.0f;
+    config.am_scale = 10.0f;
+    if (lm_dir.isSet()) {
+        config.glob_beam = global_beam.getValue();
+        config.lat_beam = lattice_beam.getValue();
+        config.am_scale = am_scale.getValue();
+    }
+    config.inc_bias = fst_inc_wts.getValue();
+    std::string hotword_path = hotword.getValue();
+    LOG(INFO) << "hotword path: " << hotword_path;
+    funasr::ExtractHws(hotword_path, config.hws_map, config.nn_hotwords);
+
+    // read wav_path, all audio is decoded up front so that file io does not disturb pacing
+    vector<WavData> wav_list;
+    string wav_path_ = model_path.at(WAV_PATH);
+    vector<pair<string, string>> wav_entries;
+    if(is_target_file(wav_path_, "scp")){
+        ifstream in(wav_path_);
+        if (!in.is_open()) {
+            LOG(ERROR) << "Failed to open file: " << wav_path_;
+            return 0;
+        }
+        string line;
+        while(getline(in, line))
+        {
+            istringstream iss(line);
+            string column1, column2;
+            iss >> column1 >> column2;
+            if (!column2.empty()) {
+                wav_entries.emplace_back(column1, column2);
+            }
+        }
+        in.close();
+    }else{
+        wav_entries.emplace_back("wav_default_id", wav_path_);
+    }
+    for (auto& entry : wav_entries) {
+        WavData wav;
+        wav.wav_id = entry.first;
+        if (!LoadWav(entry.second, audio_fs.getValue(), wav)) {
+            LOG(ERROR)<<"Failed to load "<< entry.second;
+            exit(-1);
+        }
+        wav_list.emplace_back(std::move(wav));
+    }
+    if (wav_list.empty()) {
+        LOG(ERROR) << "No audio found in " << wav_path_;
+        exit(-1);
+    }
+    FindSpeechOnset(model_path, wav_list);
+    int utt_num_ = utt_num.getValue() > 0 ? utt_num.getValue() : wav_list.size();
+
+    // warm up with a single stream so that the first trial is not skewed
+    RunLoad(tpass_hanlde, wav_list, config, 1, 1);
+
+    if (!slo_ms.isSet()) {
+        LoadStats stats = RunLoad(tpass_hanlde, wav_list, config, stream_num.getValue(), utt_num_);
+        Report(stream_num.getValue(), stats);
+        FunTpassUninit(tpass_hanlde);
+        return 0;
+    }
+
+    // grow the stream number geometrically until the slo breaks, then bisect
+    float pct = slo_percentile.getValue();
+    int good = 0;
+    int bad = max_stream_num.getValue() + 1;
+    int cur = std::min(stream_num.getValue(), max_stream_num.getValue());
+    while (cur > good && cur < bad) {
+        LoadStats stats = RunLoad(tpass_hanlde, wav_list, config, cur, utt_num_);
+        Report(cur, stats);
+        bool pass = MeetsSlo(stats, pct, slo_ms.getValue());
+        LOG(INFO) << "streams " << cur << (pass ? " meet" : " miss") << " the slo of p"
+                  << pct << " <= " << slo_ms.getValue() << " ms";
+        if (pass) {
+            good = cur;
+            cur = (bad > max_stream_num.getValue()) ? std::min(cur * 2, max_stream_num.getValue()) : (good + bad) / 2;
+            if (cur == good && bad > max_stream_num.getValue()) {
+                break;
+            }
+        } else {
+            bad = cur;
+            cur = (good + bad) / 2;
+        }
+    }
+    if (good == 0) {
+        LOG(INFO) << "no stream number meets the slo";
+    } else {
+        LOG(INFO) << "max streams meeting the slo : " << good;
+    }
+
+    FunTpassUninit(tpass_hanlde);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+
+#ifndef _WIN32
+#include <sys/time.h>
+#else
+#include <win_func.h>
+#endif
+
+#include <glog/logging.h>
+#include "funasrruntime.h"
+#include "tclap/CmdLine.h"
+#include "com-define.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "util.h"
+using namespace std;
+
+void GetValue(TCLAP::ValueArg<std::string>& value_arg, string key, std::map<std::string, std::string>& model_path)
+{
+    model_path.insert({key, value_arg.getValue()});
+    LOG(INFO)<< key << " : " << value_arg.getValue();
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    TCLAP::CmdLine cmd("funasr-onnx-offline-batch", ' ', "1.0");
+    TCLAP::ValueArg<std::string>    model_dir("", MODEL_DIR, "the asr model path, which contains model.onnx, config.yaml, am.mvn", true, "", "string");
+    TCLAP::ValueArg<std::string>    quantize("", QUANTIZE, "true (Default), load the model of model.onnx in model_dir. If set true, load the model of model_quant.onnx in model_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    bladedisc("", BLADEDISC, "true (Default), load the model of bladedisc in model_dir.", false, "true", "string");
+    TCLAP::ValueArg<std::string>    vad_dir("", VAD_DIR, "the vad model path, which contains model.onnx, vad.yaml, vad.mvn", false, "", "string");
+    TCLAP::ValueArg<std::string>    vad_quant("", VAD_QUANT, "true (Default), load the model of model.onnx in vad_dir. If set true, load the model of model_quant.onnx in vad_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    punc_dir("", PUNC_DIR, "the punc model path, which contains model.onnx, punc.yaml", false, "", "string");
+    TCLAP::ValueArg<std::string>    punc_quant("", PUNC_QUANT, "true (Default), load the model of model.onnx in punc_dir. If set true, load the model of model_quant.onnx in punc_dir", false, "true", "string");
+    TCLAP::ValueArg<std::string>    lm_dir("", LM_DIR, "the lm model path, which contains compiled models: TLG.fst, config.yaml, lexicon.txt ", false, "", "string");
+    TCLAP::ValueArg<float>    global_beam("", GLOB_BEAM, "the decoding beam for beam searching ", false, 3.0, "float");
+    TCLAP::ValueArg<float>    lattice_beam("", LAT_BEAM, "the lattice generation beam for beam searching ", false, 3.0, "float");
+    TCLAP::ValueArg<float>    am_scale("", AM_SCALE, "the acoustic scale for beam searching ", false, 10.0, "float");
+    TCLAP::ValueArg<std::int32_t>   fst_inc_wts("", FST_INC_WTS, "the fst hotwords incremental bias", false, 20, "int32_t");
+    TCLAP::ValueArg<std::string>    itn_dir("", ITN_DIR, "the itn model(fst) path, which contains zh_itn_tagger.fst and zh_itn_verbalizer.fst", false, "", "string");
+    TCLAP::ValueArg<std::string>    wav_path("", WAV_PATH, "wav.scp, kaldi style wav list (wav_id \t wav_path)", true, "", "string");
+    TCLAP::ValueArg<std::int32_t>   audio_fs("", AUDIO_FS, "the sample rate of the pcm files", false, 16000, "int32_t");
+    TCLAP::ValueArg<std::string>    hotword("", HOTWORD, "the hotword file, one hotword perline, Format: Hotword Weight (could be: 阿里巴巴 20)", false, "", "string");
+    TCLAP::SwitchArg use_gpu("", INFER_GPU, "Whether to use GPU for inference, default is false", false);
+    TCLAP::ValueArg<std::int32_t> batch_size("", BATCHSIZE, "batch_size for ASR model when using GPU", false, 4, "int32_t");
+    TCLAP::ValueArg<std::string>    output("", "output", "the result file, one line per file in wav.scp order: wav_id \t text", true, "", "string");
+    TCLAP::ValueArg<std::string>    checkpoint("", "checkpoint", "the progress file; if it exists, the run resumes after the files it records as written", false, "", "string");
+    TCLAP::ValueArg<std::int32_t> reader_thread_num("", "reader-thread-num", "the number of threads loading and decoding the audio files", false, 2, "int32_t");
+    TCLAP::ValueArg<std::int32_t> vad_thread_num("", "vad-thread-num", "the number of threads cutting the audio into vad segments", false, 2, "int32_t");
+    TCLAP::ValueArg<std::int32_t> asr_thread_num("", "asr-thread-num", "the number of threads decoding the vad segments", false, 4, "int32_t");
+    TCLAP::ValueArg<std::int32_t> punc_thread_num("", "punc-thread-num", "the number of threads running punctuation, itn and timestamps", false, 1, "int32_t");
+    TCLAP::ValueArg<std::int32_t> queue_size("", "queue-size", "the number of files waiting in front of the vad and the punc stage", false, 16, "int32_t");
+    TCLAP::ValueArg<std::int32_t> max_files("", "max-files", "the number of files read but not written yet", false, 64, "int32_t");
+    TCLAP::ValueArg<std::int32_t> window_segs("", "window-segs", "the number of vad segments pooled across files and sorted by length before decoding", false, 64, "int32_t");
+    TCLAP::SwitchArg stamp("", "stamp", "append the timestamps of each file as a third column", false);
+
+    cmd.add(model_dir);
+    cmd.add(quantize);
+    cmd.add(bladedisc);
+    cmd.add(vad_dir);
+    cmd.add(vad_quant);
+    cmd.add(punc_dir);
+    cmd.add(punc_quant);
+    cmd.add(itn_dir);
+    cmd.add(lm_dir);
+    cmd.add(global_beam);
+    cmd.add(lattice_beam);
+    cmd.add(am_scale);
+    cmd.add(fst_inc_wts);
+    cmd.add(wav_path);
+    cmd.add(audio_fs);
+    cmd.add(hotword);
+    cmd.add(use_gpu);
+    cmd.add(batch_size);
+    cmd.add(output);
+    cmd.add(checkpoint);
+    cmd.add(reader_thread_num);
+    cmd.add(vad_thread_num);
+    cmd.add(asr_thread_num);
+    cmd.add(punc_thread_num);
+    cmd.add(queue_size);
+    cmd.add(max_files);
+    cmd.add(window_segs);
+    cmd.add(stamp);
+    cmd.parse(argc, argv);
+
+    std::map<std::string, std::string> model_path;
+    GetValue(model_dir, MODEL_DIR, model_path);
+    GetValue(quantize, QUANTIZE, model_path);
+    GetValue(bladedisc, BLADEDISC, model_path);
+    GetValue(vad_dir, VAD_DIR, model_path);
+    GetValue(vad_quant, VAD_QUANT, model_path);
+    GetValue(punc_dir, PUNC_DIR, model_path);
+    GetValue(punc_quant, PUNC_QUANT, model_path);
+    GetValue(itn_dir, ITN_DIR, model_path);
+    GetValue(lm_dir, LM_DIR, model_path);
+    GetValue(wav_path, WAV_PATH, model_path);
+
+    struct timeval start, end;
+    gettimeofday(&start, nullptr);
+    bool use_gpu_ = use_gpu.getValue();
+    int batch_size_ = batch_size.getValue();
+    FUNASR_HANDLE asr_handle=FunOfflineInit(model_path, 1, use_gpu_, batch_size_);
+    if (!asr_handle)
+    {
+        LOG(ERROR) << "FunASR init failed";
+        exit(-1);
+    }
+    float glob_beam = 3.0f;
+    float lat_beam = 3.0f;
+    float am_sc = 10.0f;
+    if (lm_dir.isSet()) {
+        glob_beam = global_beam.getValue();
+        lat_beam = lattice_beam.getValue();
+        am_sc = am_scale.getValue();
+    }
+    // init wfst decoder, cloned for every asr thread
+    FUNASR_DEC_HANDLE decoder_handle = FunASRWfstDecoderInit(asr_handle, ASR_OFFLINE, glob_beam, lat_beam, am_sc);
+
+    // hotword file
+    unordered_map<string, int> hws_map;
+    std::string nn_hotwords_ = "";
+    std::string hotword_path = hotword.getValue();
+    LOG(INFO) << "hotword path: " << hotword_path;
+    funasr::ExtractHws(hotword_path, hws_map, nn_hotwords_);
+    FunWfstDecoderLoadHwsRes(decoder_handle, fst_inc_wts.getValue(), hws_map);
+    std::vector<std::vector<float>> hotwords_embedding = CompileHotwordEmbedding(asr_handle, nn_hotwords_);
+
+    gettimeofday(&end, nullptr);
+    long seconds = (end.tv_sec - start.tv_sec);
+    long modle_init_micros = ((seconds * 1000000) + end.tv_usec) - (start.tv_usec);
+    LOG(INFO) << "Model initialization takes " << (double)modle_init_micros / 1000000 << " s";
+
+    FUNASR_BATCH_CONF conf;
+    conf.reader_thread_num = reader_thread_num.getValue();
+    conf.vad_thread_num = vad_thread_num.getValue();
+    conf.asr_thread_num = asr_thread_num.getValue();
+    conf.punc_thread_num = punc_thread_num.getValue();
+    conf.queue_size = queue_size.getValue();
+    conf.max_files = max_files.getValue();
+    conf.window_segs = window_segs.getValue();
+    conf.sampling_rate = audio_fs.getValue();
+    conf.stamp = stamp.getValue();
+    FUNASR_BATCH_STATS stats;
+    bool ok = FunOfflineBatch(asr_handle, model_path.at(WAV_PATH).c_str(), output.getValue().c_str(),
+                              checkpoint.getValue().c_str(), conf, &stats, hotwords_embedding, decoder_handle);
+
+    LOG(INFO) << "files " << stats.files << ", failed " << stats.failed << ", resumed " << stats.resumed;
+    LOG(INFO) << "total_time_wav " << (long)(stats.audio_seconds * 1000) << " ms";
+    LOG(INFO) << "total_time_wall " << (long)(stats.wall_seconds * 1000) << " ms";
+    LOG(INFO) << "total_time_cpu " << (long)(stats.cpu_seconds * 1000) << " ms";
+    if (stats.wall_seconds > 0 && stats.cpu_seconds > 0) {
+        LOG(INFO) << "speedup " << stats.audio_seconds / stats.wall_seconds;
+        LOG(INFO) << "audio hours per cpu hour " << stats.audio_seconds / stats.cpu_seconds;
+    }
+
+    FunWfstDecoderUnloadHwsRes(decoder_handle);
+    FunASRWfstDecoderUninit(decoder_handle);
+    FunOfflineUninit(asr_handle);
+    return ok ? 0 : -1;
+}
@@ -61,6 +61,9 @@ int main(int argc, char** argv)
     TCLAP::ValueArg<std::string>    hotword("", HOTWORD, "the hotword file, one hotword perline, Format: Hotword Weight (could be: 阿里巴巴 20)", false, "", "string");
     TCLAP::SwitchArg use_gpu("", INFER_GPU, "Whether to use GPU for inference, default is false", false);
     TCLAP::ValueArg<std::int32_t> batch_size("", BATCHSIZE, "batch_size for ASR model when using GPU", false, 4, "int32_t");
+    TCLAP::ValueArg<std::int32_t> seg_thread_num("", "seg-thread-num", "the number of threads decoding the vad segments of one audio, 1 (Default) decodes them one by one", false, 1, "int32_t");
+    TCLAP::ValueArg<std::int32_t> vad_thread_num("", "vad-thread-num", "the number of threads running the vad of audio longer than two vad windows in parallel windows, 1 (Default) runs it serially", false, 1, "int32_t");
+    TCLAP::ValueArg<std::int32_t> vad_window_ms("", "vad-window-ms", "the vad window (ms) with vad-thread-num > 1", false, 300000, "int32_t");
 
     cmd.add(model_dir);
     cmd.add(quantize);
@@ -80,6 +83,9 @@ int main(int argc, char** argv)
     cmd.add(hotword);
     cmd.add(use_gpu);
     cmd.add(batch_size);
+    cmd.add(seg_thread_num);
+    cmd.add(vad_thread_num);
+    cmd.add(vad_window_ms);
     cmd.parse(argc, argv);
 
     std::map<std::string, std::string> model_path;
@@ -106,6 +112,8 @@ int main(int argc, char** argv)
         LOG(ERROR) << "FunASR init failed";
         exit(-1);
     }
+    FunOfflineSetSegThreadNum(asr_hanlde, seg_thread_num.getValue());
+    FunOfflineSetVadThreadNum(asr_hanlde, vad_thread_num.getValue(), vad_window_ms.getValue());
     float glob_beam = 3.0f;
     float lat_beam = 3.0f;
     float am_sc = 10.0f;
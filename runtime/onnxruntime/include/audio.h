@@ -61,7 +61,10 @@ class DLLAPI Audio {
     queue<AudioFrame *> frame_queue;
     queue<AudioFrame *> asr_online_queue;
     queue<AudioFrame *> asr_offline_queue;
+    queue<AudioFrame *> asr_speculative_queue;
     int dest_sample_rate;
+    template <typename T>
+    bool LoadSamplesImpl(const T* samples, int n_samples, float scale, int32_t* sampling_rate, bool online);
   public:
     Audio(int data_type);
     Audio(int model_sample_rate,int data_type);
@@ -77,10 +80,15 @@ class DLLAPI Audio {
     bool LoadPcmwav(const char* filename, int32_t* sampling_rate, bool resample=true);
     bool LoadPcmwav2Char(const char* filename, int32_t* sampling_rate);
     bool LoadOthers2Char(const char* filename);
+    // decoded samples, samples[i] / scale is the waveform in [-1, 1]. They are
+    // converted once into the float buffer, copied as is when no scaling is needed
+    bool LoadSamples(const int16_t* samples, int n_samples, float scale, int32_t* sampling_rate);
+    bool LoadSamples(const float* samples, int n_samples, float scale, int32_t* sampling_rate);
     bool FfmpegLoad(const char *filename, bool copy2char=false);
     bool FfmpegLoad(const char* buf, int n_file_len);
     int FetchChunck(AudioFrame *&frame);
     int FetchTpass(AudioFrame *&frame);
+    int FetchSpeculative(AudioFrame *&frame);
     int Fetch(float *&dout, int &len, int &flag);
     int Fetch(float *&dout, int &len, int &flag, float &start_time);
     int Fetch(float **&dout, int *&len, int *&flag, float*& start_time, int batch_size, int &batch_in);
@@ -89,7 +97,9 @@ class DLLAPI Audio {
     void Split(OfflineStream* offline_streamj);
     void CutSplit(OfflineStream* offline_streamj, std::vector<int> &index_vector);
     void Split(VadModel* vad_obj, vector<std::vector<int>>& vad_segments, bool input_finished=true);
-    void Split(VadModel* vad_obj, int chunk_len, bool input_finished=true, ASR_TYPE asr_mode=ASR_TWO_PASS);
+    // speculate_ms > 0 also queues the segment in progress for the offline pass once
+    // its silence has lasted speculate_ms, with the end the vad will confirm if it lasts on
+    void Split(VadModel* vad_obj, int chunk_len, bool input_finished=true, ASR_TYPE asr_mode=ASR_TWO_PASS, int speculate_ms=0);
     float GetTimeLen();
     int GetQueueSize() { return (int)frame_queue.size(); }
     char* GetSpeechChar(){return speech_char;}
@@ -100,13 +110,19 @@ class DLLAPI Audio {
     int offset = 0;
     int speech_start=-1, speech_end=0;
     int speech_offline_start=-1;
+    // span in ms of the last speculative segment while its silence goes on, -1 otherwise
+    int spec_start=-1, spec_end=-1;
 
     int seg_sample = MODEL_SAMPLE_RATE/1000;
     bool LoadPcmwavOnline(const char* buf, int n_file_len, int32_t* sampling_rate);
+    bool LoadSamplesOnline(const int16_t* samples, int n_samples, float scale, int32_t* sampling_rate);
+    bool LoadSamplesOnline(const float* samples, int n_samples, float scale, int32_t* sampling_rate);
     void ResetIndex(){
       speech_start=-1;
       speech_end=0;
       speech_offline_start=-1;
+      spec_start=-1;
+      spec_end=-1;
       offset = 0;
       all_samples.clear();
     }
@@ -106,6 +106,11 @@ namespace funasr {
 #define VAD_LFR_N 1
 #endif
 
+// window of the parallel vad of long audio
+#ifndef VAD_WINDOW_MS
+#define VAD_WINDOW_MS 300000
+#endif
+
 // asr
 #ifndef PARA_LFR_M
 #define PARA_LFR_M 7
@@ -122,6 +127,8 @@ namespace funasr {
 // punc
 #define UNK_CHAR "<unk>"
 #define TOKEN_LEN     20
+// tokens at the end of a text prefix that are not punctuated early, they may still change
+#define PUNC_PREFIX_MARGIN 8
 
 #define CANDIDATE_NUM   6
 #define UNKNOW_INDEX 0
@@ -1,7 +1,9 @@
 #pragma once
+#include <functional>
 #include <map>
 #include <vector>
 #include <unordered_map>
+#include <string>
 #ifdef WIN32
 #ifdef _FUNASR_API_EXPORT
 #define  _FUNASRAPI __declspec(dllexport)
@@ -54,7 +56,16 @@ typedef enum {
 	PUNC_ONLINE=1,
 }PUNC_TYPE;
 
+// decoded samples for the *InferSamples APIs, samples[i] / scale is the waveform in [-1, 1]
+typedef enum {
+	FUNASR_SAMPLE_INT16=0,
+	FUNASR_SAMPLE_FLOAT=1,
+}FUNASR_SAMPLE_TYPE;
+
 typedef void (* QM_CALLBACK)(int cur_step, int n_total); // n_total: total steps; cur_step: Current Step.
+// one offline (second pass) result of an online stream: seq_id counts the results of the stream from 0,
+// is_final marks the last one of an utterance; called on an offline pool thread, frees result with FunASRFreeResult
+typedef std::function<void(FUNASR_RESULT result, int seq_id, bool is_final)> TPASS_OFFLINE_CALLBACK;
 
 // ASR
 _FUNASRAPI FUNASR_HANDLE  	FunASRInit(std::map<std::string, std::string>& model_path, int thread_num, ASR_TYPE type=ASR_OFFLINE);
@@ -69,6 +80,13 @@ _FUNASRAPI FUNASR_RESULT	FunASRInfer(FUNASR_HANDLE handle, const char* sz_filena
 _FUNASRAPI const char*	FunASRGetResult(FUNASR_RESULT result,int n_index);
 _FUNASRAPI const char*	FunASRGetStamp(FUNASR_RESULT result);
 _FUNASRAPI const char*	FunASRGetStampSents(FUNASR_RESULT result);
+// timestamps without string parsing: *stamps points to [start0, end0, start1, end1, ...] in ms
+// and stays valid until FunASRFreeResult; returns the number of pairs
+_FUNASRAPI int			FunASRGetStampArray(FUNASR_RESULT result, const int** stamps);
+_FUNASRAPI int			FunASRGetStampSentNum(FUNASR_RESULT result);
+// one sentence of FunASRGetStampSents, stamps are [start, end] pairs in ms as above
+_FUNASRAPI bool			FunASRGetStampSent(FUNASR_RESULT result, int n_index, const char** text_seg, const char** punc,
+										   int* start, int* end, const int** stamps, int* stamp_num);
 _FUNASRAPI const char*	FunASRGetTpassResult(FUNASR_RESULT result,int n_index);
 _FUNASRAPI const int	FunASRGetRetNumber(FUNASR_RESULT result);
 _FUNASRAPI void			FunASRFreeResult(FUNASR_RESULT result);
@@ -80,6 +98,9 @@ _FUNASRAPI FUNASR_HANDLE  	FsmnVadInit(std::map<std::string, std::string>& model
 _FUNASRAPI FUNASR_HANDLE  	FsmnVadOnlineInit(FUNASR_HANDLE fsmnvad_handle);
 // buffer
 _FUNASRAPI FUNASR_RESULT	FsmnVadInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, QM_CALLBACK fn_callback, bool input_finished=true, int sampling_rate=16000, std::string wav_format="pcm");
+// samples, converted once and fed to the model without a pcm byte buffer
+_FUNASRAPI FUNASR_RESULT	FsmnVadInferSamples(FUNASR_HANDLE handle, const void* samples, int n_samples, FUNASR_SAMPLE_TYPE sample_type, float scale,
+												QM_CALLBACK fn_callback, bool input_finished=true, int sampling_rate=16000);
 // file, support wav & pcm
 _FUNASRAPI FUNASR_RESULT	FsmnVadInfer(FUNASR_HANDLE handle, const char* sz_filename, QM_CALLBACK fn_callback, int sampling_rate=16000);
 
@@ -98,15 +119,74 @@ _FUNASRAPI void					CTTransformerUninit(FUNASR_HANDLE handle);
 //OfflineStream
 _FUNASRAPI FUNASR_HANDLE  	FunOfflineInit(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
 _FUNASRAPI void         	FunOfflineReset(FUNASR_HANDLE handle, FUNASR_DEC_HANDLE dec_handle=nullptr);
+// decode the vad segments of one request on up to thread_num threads shared by all requests of the handle, 1 decodes sequentially
+_FUNASRAPI void         	FunOfflineSetSegThreadNum(FUNASR_HANDLE handle, int thread_num);
+// run the vad of requests longer than two windows in windows of window_ms on thread_num threads and stitch
+// the segments at the window boundaries, where they may differ slightly from the serial pass; 1 keeps the
+// serial pass. Progressive requests always run it serially. Call before the handle is used
+_FUNASRAPI void         	FunOfflineSetVadThreadNum(FUNASR_HANDLE handle, int thread_num, int window_ms=300000);
+// cache finished results in up to result_bytes, keyed by a hash of the input and of every option that changes
+// the result; seg_bytes > 0 caches decoded vad segments as well, so audio that shares segments with an earlier
+// request reuses them. 0 for both turns the cache off; call before the handle is used
+_FUNASRAPI void         	FunOfflineSetResultCache(FUNASR_HANDLE handle, size_t result_bytes, size_t seg_bytes=0);
+// run every model of the handle over synthetic input of each length in buckets_ms, the models in parallel, so
+// that the first requests do not pay for kernel selection and arena growth; false if a model failed. Call after
+// the other setters and before the handle serves
+_FUNASRAPI bool				FunOfflineWarmUp(FUNASR_HANDLE handle, const std::vector<int> &buckets_ms={1000, 3000, 6000, 10000, 20000});
 // buffer
 _FUNASRAPI FUNASR_RESULT	FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
 												  FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
 												  int sampling_rate=16000, std::string wav_format="pcm", bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
 												  std::string svs_lang="auto", bool svs_itn=true);
+// samples, converted once and fed to the model without a pcm byte buffer
+_FUNASRAPI FUNASR_RESULT	FunOfflineInferSamples(FUNASR_HANDLE handle, const void* samples, int n_samples, FUNASR_SAMPLE_TYPE sample_type, float scale,
+												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb,
+												   int sampling_rate=16000, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
+												   std::string svs_lang="auto", bool svs_itn=true);
 // file, support wav & pcm
 _FUNASRAPI FUNASR_RESULT	FunOfflineInfer(FUNASR_HANDLE handle, const char* sz_filename, FUNASR_MODE mode, 
 											QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
 											int sampling_rate=16000, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr);
+// batch: a wav.scp list (wav_id wav_path per line) transcribed into output, one "wav_id\ttext" line per file in
+// list order. Files are read, cut by the vad, decoded, punctuated and written by separate stages joined by
+// bounded queues; the asr stage pools the segments of several files and decodes them longest first, in batches
+// of the model's batch size. With a checkpoint file, a rerun with the same list and output resumes after the
+// last file written. dec_handle is used by the first asr thread and cloned for the others
+typedef struct {
+	int reader_thread_num = 2;	// load and decode the audio files
+	int vad_thread_num = 2;
+	int asr_thread_num = 4;
+	int punc_thread_num = 1;	// punctuation, itn and timestamps
+	int queue_size = 16;		// files waiting in front of the vad and the punc stage
+	int max_files = 64;			// files read but not written yet, bounds the memory and the reorder buffer of the writer
+	int window_segs = 64;		// vad segments pooled across files and sorted by length before they are decoded
+	int sampling_rate = 16000;	// of pcm files
+	bool itn = true;
+	bool stamp = false;			// append the timestamps as a third column
+	int checkpoint_ms = 1000;	// how often the progress is saved
+}FUNASR_BATCH_CONF;
+// audio_seconds / cpu_seconds is the audio-hours per cpu-hour of the run
+typedef struct {
+	long long files = 0;		// files finished by this run, failed ones included
+	long long failed = 0;
+	long long resumed = 0;		// files skipped as done by an earlier run
+	double audio_seconds = 0;
+	double wall_seconds = 0;
+	double cpu_seconds = 0;		// of the whole process
+}FUNASR_BATCH_STATS;
+_FUNASRAPI bool				FunOfflineBatch(FUNASR_HANDLE handle, const char* wav_scp, const char* output, const char* checkpoint,
+											const FUNASR_BATCH_CONF &conf, FUNASR_BATCH_STATS* stats=nullptr,
+											const std::vector<std::vector<float>> &hw_emb={{0.0}}, FUNASR_DEC_HANDLE dec_handle=nullptr);
+// progressive: pcm fed while it is still arriving, vad segments are decoded as they close and
+// Finish returns what FunOfflineInferBuffer returns for all of the audio; one thread at a time per handle
+_FUNASRAPI FUNASR_HANDLE	FunOfflineProgressiveInit(FUNASR_HANDLE handle, int sampling_rate=16000);
+_FUNASRAPI bool				FunOfflineProgressiveFeed(FUNASR_HANDLE progressive_handle, const char* sz_buf, int n_len,
+													  const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle=nullptr,
+													  std::string svs_lang="auto", bool svs_itn=true);
+_FUNASRAPI FUNASR_RESULT	FunOfflineProgressiveFinish(FUNASR_HANDLE progressive_handle, const std::vector<std::vector<float>> &hw_emb,
+														bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
+														std::string svs_lang="auto", bool svs_itn=true);
+_FUNASRAPI void				FunOfflineProgressiveUninit(FUNASR_HANDLE progressive_handle);
 //#if !defined(__APPLE__)
 _FUNASRAPI const std::vector<std::vector<float>> CompileHotwordEmbedding(FUNASR_HANDLE handle, std::string &hotwords, ASR_TYPE mode=ASR_OFFLINE);
 //#endif
@@ -116,18 +196,83 @@ _FUNASRAPI void				FunOfflineUninit(FUNASR_HANDLE handle);
 //2passStream
 _FUNASRAPI FUNASR_HANDLE  	FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num);
 _FUNASRAPI FUNASR_HANDLE    FunTpassOnlineInit(FUNASR_HANDLE tpass_handle, std::vector<int> chunk_size={5,10,5});
-// buffer
+// change the chunk size of a stream between two FunTpassInferBuffer calls, the next call is cut with it.
+// Only the lookback and the chunk may change, false if the lookahead differs from the current one
+_FUNASRAPI bool				FunTpassOnlineSetChunkSize(FUNASR_HANDLE online_handle, const std::vector<int> &chunk_size);
+// the largest lookback FunTpassOnlineSetChunkSize will switch to; the stream keeps that many frames of
+// history so that a longer lookback is filled with audio. Without it a longer lookback starts with zeros
+_FUNASRAPI void				FunTpassOnlineSetMaxLookback(FUNASR_HANDLE online_handle, int max_lookback);
+// run the offline pass of all online streams on thread_num threads of its own, at a lower priority than the
+// callers; call before FunTpassOnlineInit. 0 (default) runs it inside FunTpassInferBuffer
+_FUNASRAPI void				FunTpassSetOfflineThreadNum(FUNASR_HANDLE tpass_handle, int thread_num);
+// with offline threads, FunTpassInferBuffer of this stream returns the online part only and queues the offline
+// pass, whose results reach callback in order. The offline pass uses dec_handle and its own punctuation context,
+// keep dec_handle until FunTpassOnlineUninit, which waits for the queued segments
+// start the offline pass of a segment once silence_ms of its end silence have passed, instead of when
+// the vad confirms the end (max_end_silence_time); the result is kept if the vad then ends the segment
+// there and dropped if speech goes on. Larger values waste fewer decodes, 0 (default) disables it.
+// Only streams with an offline lane (FunTpassOnlineSetOfflineCallback) speculate, the others would
+// pay for the decode inside FunTpassInferBuffer
+_FUNASRAPI void				FunTpassSetSpeculation(FUNASR_HANDLE tpass_handle, int silence_ms);
+// the same for the 2pass models, the online ones in chunks of every size in chunk_sizes
+_FUNASRAPI bool				FunTpassWarmUp(FUNASR_HANDLE handle, const std::vector<int> &buckets_ms={1000, 3000, 6000, 10000, 20000},
+										   const std::vector<std::vector<int>> &chunk_sizes={{5, 10, 5}});
+_FUNASRAPI bool				FunTpassOnlineSetOfflineCallback(FUNASR_HANDLE online_handle, TPASS_OFFLINE_CALLBACK callback);
+// buffer, wav_format is pcm or a compressed stream decoded as it arrives: opus (ogg), opus-packet
+// (one raw packet per call) or an ffmpeg decoder with a parser such as mp3, aac
 _FUNASRAPI FUNASR_RESULT	FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
 												int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished=true, 
 												int sampling_rate=16000, std::string wav_format="pcm", ASR_TYPE mode=ASR_TWO_PASS, 
 												const std::vector<std::vector<float>> &hw_emb={{0.0}}, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
 												std::string svs_lang="auto", bool svs_itn=true);
+// samples, converted once and fed to the model without a pcm byte buffer
+_FUNASRAPI FUNASR_RESULT	FunTpassInferSamples(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const void* samples, int n_samples,
+												 FUNASR_SAMPLE_TYPE sample_type, float scale, std::vector<std::vector<std::string>> &punc_cache,
+												 bool input_finished=true, int sampling_rate=16000, ASR_TYPE mode=ASR_TWO_PASS,
+												 const std::vector<std::vector<float>> &hw_emb={{0.0}}, bool itn=true, FUNASR_DEC_HANDLE dec_handle=nullptr,
+												 std::string svs_lang="auto", bool svs_itn=true);
 _FUNASRAPI void				FunTpassUninit(FUNASR_HANDLE handle);
 _FUNASRAPI void				FunTpassOnlineUninit(FUNASR_HANDLE handle);
 
-// wfst decoder
+// model registry, named model sets of one type (ASR_OFFLINE or ASR_TWO_PASS) in one process. A set loads on its
+// first Acquire, every Acquire holds it until Release; idle sets are unloaded, least recently used first, once the
+// loaded ones go over memory_budget_mb (0 keeps them all). setup runs on each set after it loads (thread numbers,
+// warm-up). shared_threads > 0 runs the sessions of all sets on one pool of that many threads, which must be set up
+// before any model of the process loads
+_FUNASRAPI FUNASR_HANDLE	FunModelRegistryInit(ASR_TYPE type, int thread_num, size_t memory_budget_mb=0, int shared_threads=0,
+												 std::function<void(FUNASR_HANDLE)> setup=nullptr, bool use_gpu=false, int batch_size=1);
+// false if the name is taken or a model dir is missing, nothing is loaded here
+_FUNASRAPI bool				FunModelRegistryAdd(FUNASR_HANDLE registry, const std::string &name, std::map<std::string, std::string>& model_path);
+// the FunOfflineInit/FunTpassInit handle of the set, nullptr if it is unknown or fails to load
+_FUNASRAPI FUNASR_HANDLE	FunModelRegistryAcquire(FUNASR_HANDLE registry, const std::string &name);
+_FUNASRAPI void				FunModelRegistryRelease(FUNASR_HANDLE registry, FUNASR_HANDLE handle);
+_FUNASRAPI std::vector<std::string>	FunModelRegistryNames(FUNASR_HANDLE registry);
+// loaded, sessions, memory, loads and evictions of every set in prometheus text exposition format
+_FUNASRAPI std::string		FunModelRegistryGetMetrics(FUNASR_HANDLE registry);
+// unloads all sets, release every handle first
+_FUNASRAPI void				FunModelRegistryUninit(FUNASR_HANDLE registry);
+
+// wfst decoder, taken warm from a pool of the model and handed back by Uninit
 _FUNASRAPI FUNASR_DEC_HANDLE	FunASRWfstDecoderInit(FUNASR_HANDLE handle, int asr_type, float glob_beam, float lat_beam, float am_scale);
 _FUNASRAPI void			FunASRWfstDecoderUninit(FUNASR_DEC_HANDLE handle);
+// idle decoders kept per model (default 64, 0 disables pooling); stats of the pool, false without an lm
+_FUNASRAPI void			FunASRWfstDecoderPoolSetSize(FUNASR_HANDLE handle, int asr_type, int max_idle);
+_FUNASRAPI bool			FunASRWfstDecoderPoolStats(FUNASR_HANDLE handle, int asr_type, int* idle, int* in_use, long long* hits, long long* misses);
 _FUNASRAPI void			FunWfstDecoderLoadHwsRes(FUNASR_DEC_HANDLE handle, int inc_bias, std::unordered_map<std::string, int> &hws_map);
 _FUNASRAPI void			FunWfstDecoderUnloadHwsRes(FUNASR_DEC_HANDLE handle);
+// converts an lm (TLG.fst) or itn fst once to an aligned const fst, which is then mapped read-only
+// at load time and shared by all processes instead of read into each one; output may be input
+_FUNASRAPI bool			FunASRFstToConst(const std::string &input, const std::string &output);
+
 
+// metrics, recording is off unless enabled here or with FUNASR_METRICS=1
+_FUNASRAPI void			FunASRMetricsEnable(bool enable);
+_FUNASRAPI bool			FunASRMetricsEnabled();
+_FUNASRAPI void			FunASRMetricsReset();
+// all stages and counters in prometheus text exposition format
+_FUNASRAPI std::string	FunASRGetMetrics();
+// stage: audio_decode, resample, vad, fbank, encoder, decoder, cif, wfst, punc, itn, timestamp
+_FUNASRAPI bool			FunASRGetStageMetric(const char* stage, long long* calls, double* seconds);
+// counter: offline_requests, tpass_chunks, audio_ms, vad_segments, tpass_segments, tpass_spec_hits, tpass_spec_misses,
+//          wfst_pool_hits, wfst_pool_misses, result_cache_hits, result_cache_misses, seg_cache_hits, seg_cache_misses
+_FUNASRAPI bool			FunASRGetCounterMetric(const char* counter, long long* value);
@@ -7,6 +7,7 @@
 #include "funasrruntime.h"
 #include "vocab.h"
 #include "phone-set.h"
+#include "common-struct.h"
 #include "fst/fstlib.h"
 #include "fst/symbol-table.h"
 namespace funasr {
@@ -28,6 +29,8 @@ class Model {
       {return std::vector<string>();};
     virtual std::vector<std::string> Forward(float** din, int* len, bool input_finished, std::string svs_lang="auto", bool svs_itn=false, int batch_in=1)
       {return std::vector<string>();};
+    // structured variant of the batch Forward, stamps stay integer ms; the default parses Forward's strings
+    virtual std::vector<FUNASR_SEG_RESULT> ForwardSegs(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1);
     virtual std::string Rescoring() = 0;
     virtual void InitHwCompiler(const std::string &hw_model, int thread_num){};
     virtual void InitSegDict(const std::string &seg_dict_model){};
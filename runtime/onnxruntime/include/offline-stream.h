@@ -8,12 +8,15 @@
 #include "punc-model.h"
 #include "com-define.h"
 #include "vad-model.h"
+#include "worker-pool.h"
+#include "result-cache.h"
 #if !defined(__APPLE__)
 #include "itn-model.h"
 #include "com-define.h"
 #endif
 
 namespace funasr {
+class CacheKey;
 class OfflineStream {
   public:
     OfflineStream(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
@@ -29,8 +32,32 @@ class OfflineStream {
     bool UsePunc(){return use_punc;}; 
     bool UseITN(){return use_itn;};
     std::string GetModelType(){return model_type;};
-    
+    // decode the vad segments of a request on thread_num shared workers, 1 keeps
+    // the sequential path; call before the stream is used
+    void SetSegThreadNum(int thread_num);
+    WorkerPool* GetSegPool(){return seg_pool_.get();};
+    // keep finished results in result_bytes and decoded vad segments in
+    // seg_bytes, 0 for both turns the cache off; call before the stream is used
+    void SetResultCache(size_t result_bytes, size_t seg_bytes);
+    ResultCache* GetResultCache(){return result_cache_.get();};
+
+    // decodes a batch of segments; with the segment cache on, only those not seen before go through the model
+    void Forward(float** buff, int* len, int batch_in, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                 bool use_svs, std::string &svs_lang, bool svs_itn, std::vector<FUNASR_SEG_RESULT> &seg_batch);
+    // joins the decoded segments in audio order and runs punc, itn and timestamp
+    // smoothing on the structured stamps, strings are only built by the getters
+    void Assemble(std::vector<FUNASR_SEG_RESULT> &segs, std::vector<float> &seg_stimes, bool itn,
+                  FUNASR_RECOG_RESULT* p_result, PuncProgress &punc_progress);
+    // the options of a request that change its decoded segments; the model is the stream's own
+    static void AddDecodeOptions(CacheKey &key, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                                 bool use_svs, const std::string &svs_lang, bool svs_itn);
+
   private:
+    void ForwardModel(float** buff, int* len, int batch_in, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                      bool use_svs, std::string &svs_lang, bool svs_itn, std::vector<FUNASR_SEG_RESULT> &seg_batch);
+
+    std::unique_ptr<WorkerPool> seg_pool_ = nullptr;
+    std::unique_ptr<ResultCache> result_cache_ = nullptr;
     bool use_vad=false;
     bool use_punc=false;
     bool use_itn=false;
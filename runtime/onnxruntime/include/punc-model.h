@@ -8,12 +8,25 @@
 #include "funasrruntime.h"
 
 namespace funasr {
+// state of an offline punctuation run that is fed growing prefixes of the text,
+// windows inferred early are reused as long as the final text starts with them
+struct PuncProgress {
+    std::vector<int> ids;
+    std::vector<std::string> strs;
+    std::vector<int> remain_ids;
+    std::vector<std::string> remain_str;
+    std::vector<std::string> words;
+};
+
 class PuncModel {
   public:
     virtual ~PuncModel(){};
 	  virtual void InitPunc(const std::string &punc_model, const std::string &punc_config, const std::string &token_file, int thread_num)=0;
 	  virtual std::string AddPunc(const char* sz_input, std::string language="zh-cn"){return "";};
 	  virtual std::string AddPunc(const char* sz_input, std::vector<std::string>& arr_cache, std::string language="zh-cn"){return "";};
+	  // infers the windows of a text prefix that cannot change anymore
+	  virtual void AddPuncPartial(const char* sz_prefix, PuncProgress &progress){};
+	  virtual std::string AddPunc(const char* sz_input, std::string language, PuncProgress &progress){return AddPunc(sz_input, language);};
 };
 
 PuncModel *CreatePuncModel(std::map<std::string, std::string>& model_path, int thread_num, PUNC_TYPE type=PUNC_OFFLINE);
@@ -0,0 +1,40 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#ifndef STAMP_SENTS_JSON_H
+#define STAMP_SENTS_JSON_H
+
+#include "funasrruntime.h"
+#include "nlohmann/json.hpp"
+
+namespace funasr {
+// stamp_sents built from the result arrays, no json string round trip.
+// Header only so that no json type crosses the runtime library boundary.
+inline nlohmann::json GetStampSentsJson(FUNASR_RESULT result) {
+    nlohmann::json stamp_sents = nlohmann::json::array();
+    int sent_num = FunASRGetStampSentNum(result);
+    for (int i = 0; i < sent_num; i++) {
+        const char* text_seg = nullptr;
+        const char* punc = nullptr;
+        const int* stamps = nullptr;
+        int start = 0, end = 0, stamp_num = 0;
+        if (!FunASRGetStampSent(result, i, &text_seg, &punc, &start, &end, &stamps, &stamp_num)) {
+            continue;
+        }
+        nlohmann::json ts_list = nlohmann::json::array();
+        for (int j = 0; j < stamp_num; j++) {
+            ts_list.push_back(nlohmann::json::array({stamps[2 * j], stamps[2 * j + 1]}));
+        }
+        nlohmann::json sent;
+        sent["text_seg"] = text_seg;
+        sent["punc"] = punc;
+        sent["start"] = start;
+        sent["end"] = end;
+        sent["ts_list"] = ts_list;
+        stamp_sents.push_back(sent);
+    }
+    return stamp_sents;
+}
+} // namespace funasr
+#endif
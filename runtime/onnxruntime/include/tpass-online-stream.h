@@ -2,18 +2,43 @@
 #define TPASS_ONLINE_STREAM_H
 
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "funasrruntime.h"
 #include "tpass-stream.h"
 #include "model.h"
 #include "vad-model.h"
+#include "stream-decoder.h"
 
 namespace funasr {
 class TpassOnlineStream {
   public:
     TpassOnlineStream(TpassStream* tpass_stream, std::vector<int> chunk_size);
-    ~TpassOnlineStream(){};
+    ~TpassOnlineStream();
 
     std::unique_ptr<VadModel> vad_online_handle = nullptr;
     std::unique_ptr<Model> asr_online_handle = nullptr;
+    // decoder of a compressed stream, created by its first chunk and dropped after the last
+    std::unique_ptr<StreamDecoder> stream_decoder = nullptr;
+
+    // offline lane: with an offline pool on the TpassStream and a callback set, the
+    // segments closed by the vad are decoded on the pool in order and handed to the
+    // callback with their sequence number, the punctuation context lives here then
+    std::unique_ptr<WorkerStrand> offline_strand = nullptr;
+    TPASS_OFFLINE_CALLBACK offline_callback = nullptr;
+    std::vector<std::string> offline_punc_cache;
+    int offline_seq = 0;
+
+    // speculative offline pass: the span in ms the online lane still waits for,
+    // and the result decoded for a span, which the offline pass takes if the vad
+    // closes the segment there
+    std::mutex spec_mtx;
+    int spec_start = -1;
+    int spec_end = -1;
+    int spec_result_start = -1;
+    int spec_result_end = -1;
+    FUNASR_SEG_RESULT spec_result;
 };
 TpassOnlineStream* CreateTpassOnlineStream(void* tpass_stream, std::vector<int> chunk_size);
 } // namespace funasr
@@ -7,6 +7,7 @@
 #include "model.h"
 #include "punc-model.h"
 #include "vad-model.h"
+#include "worker-pool.h"
 #if !defined(__APPLE__)
 #include "itn-model.h"
 #endif
@@ -27,8 +28,17 @@ class TpassStream {
     bool UsePunc(){return use_punc;}; 
     bool UseITN(){return use_itn;};
     std::string GetModelType(){return model_type;};
+    // a pool of its own for the offline pass of all online streams, 0 runs it inside FunTpassInferBuffer
+    void SetOfflineThreadNum(int thread_num);
+    WorkerPool* GetOfflinePool(){return offline_pool_.get();};
+    // start the offline pass of a segment after speculate_ms of its end silence, 0 waits for the vad;
+    // used by streams with an offline lane only
+    void SetSpeculateMs(int speculate_ms){speculate_ms_ = speculate_ms;};
+    int GetSpeculateMs(){return speculate_ms_;};
     
   private:
+    std::unique_ptr<WorkerPool> offline_pool_ = nullptr;
+    int speculate_ms_ = 0;
     bool use_vad=false;
     bool use_punc=false;
     bool use_itn=false;
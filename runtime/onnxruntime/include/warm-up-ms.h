@@ -0,0 +1,36 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#ifndef WARM_UP_MS_H
+#define WARM_UP_MS_H
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace funasr {
+// The audio lengths of a --warm-up-ms flag, a comma separated list of
+// positive ms up to an hour; an empty list disables the warm-up. On failure
+// bad_item is the offending entry. Header only, shared by the servers.
+inline bool ParseWarmUpMs(const std::string &spec, std::vector<int> &warm_up_ms, std::string &bad_item) {
+    warm_up_ms.clear();
+    if (spec.empty()) {
+        return true;
+    }
+    std::istringstream items(spec + ",");
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        char* end = nullptr;
+        long ms = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || ms <= 0 || ms > 3600 * 1000) {
+            bad_item = item;
+            return false;
+        }
+        warm_up_ms.push_back((int)ms);
+    }
+    return true;
+}
+} // namespace funasr
+#endif
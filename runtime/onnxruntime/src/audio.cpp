@@ -5,6 +5,7 @@
 #include <string.h>
 #include <fstream>
 #include <assert.h>
+#include <type_traits>
 
 #include "audio.h"
 #include "precomp.h"
@@ -236,6 +237,7 @@ Audio::~Audio()
     ClearQueue(frame_queue);
     ClearQueue(asr_online_queue);
     ClearQueue(asr_offline_queue);
+    ClearQueue(asr_speculative_queue);
 }
 
 void Audio::ClearQueue(std::queue<AudioFrame*>& q) {
@@ -259,6 +261,7 @@ float Audio::GetTimeLen()
 void Audio::WavResample(int32_t sampling_rate, const float *waveform,
                           int32_t n)
 {
+    StageTimer timer(STAGE_RESAMPLE);
     LOG(INFO) << "Creating a resampler: "
               << " in_sample_rate: "<< sampling_rate
               << " output_sample_rate: " << static_cast<int32_t>(dest_sample_rate);
@@ -284,6 +287,7 @@ void Audio::WavResample(int32_t sampling_rate, const float *waveform,
 }
 
 bool Audio::FfmpegLoad(const char *filename, bool copy2char){
+    StageTimer timer(STAGE_AUDIO_DECODE);
 #if defined(__APPLE__)
     return false;
 #else
@@ -446,6 +450,7 @@ bool Audio::FfmpegLoad(const char *filename, bool copy2char){
 }
 
 bool Audio::FfmpegLoad(const char* buf, int n_file_len){
+    StageTimer timer(STAGE_AUDIO_DECODE);
 #if defined(__APPLE__)
     return false;
 #else
@@ -621,6 +626,7 @@ bool Audio::FfmpegLoad(const char* buf, int n_file_len){
 
 bool Audio::LoadWav(const char *filename, int32_t* sampling_rate, bool resample)
 {
+    StageTimer timer(STAGE_AUDIO_DECODE);
     WaveHeader header;
     if (speech_data != nullptr) {
         free(speech_data);
@@ -738,6 +744,7 @@ bool Audio::LoadWav2Char(const char *filename, int32_t* sampling_rate)
 
 bool Audio::LoadWav(const char* buf, int n_file_len, int32_t* sampling_rate)
 { 
+    StageTimer timer(STAGE_AUDIO_DECODE);
     WaveHeader header;
     if (speech_data != nullptr) {
         free(speech_data);
@@ -786,6 +793,7 @@ bool Audio::LoadWav(const char* buf, int n_file_len, int32_t* sampling_rate)
 
 bool Audio::LoadPcmwav(const char* buf, int n_buf_len, int32_t* sampling_rate)
 {
+    StageTimer timer(STAGE_AUDIO_DECODE);
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
@@ -820,6 +828,7 @@ bool Audio::LoadPcmwav(const char* buf, int n_buf_len, int32_t* sampling_rate)
 
 bool Audio::LoadPcmwavOnline(const char* buf, int n_buf_len, int32_t* sampling_rate)
 {
+    StageTimer timer(STAGE_AUDIO_DECODE);
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
@@ -843,9 +852,7 @@ bool Audio::LoadPcmwavOnline(const char* buf, int n_buf_len, int32_t* sampling_r
             WavResample(*sampling_rate, speech_data, speech_len);
         }
 
-        for (int32_t i = 0; i != speech_len; ++i) {
-            all_samples.emplace_back(speech_data[i]);
-        }
+        all_samples.insert(all_samples.end(), speech_data, speech_data + speech_len);
 
         AudioFrame* frame = new AudioFrame(speech_len);
         frame_queue.push(frame);
@@ -856,8 +863,73 @@ bool Audio::LoadPcmwavOnline(const char* buf, int n_buf_len, int32_t* sampling_r
     }
 }
 
+template <typename T>
+bool Audio::LoadSamplesImpl(const T* samples, int n_samples, float scale, int32_t* sampling_rate, bool online)
+{
+    StageTimer timer(STAGE_AUDIO_DECODE);
+    if (n_samples < 0 || scale <= 0) {
+        LOG(ERROR) << "Invalid samples, n_samples: " << n_samples << " scale: " << scale;
+        return false;
+    }
+    if (speech_data != nullptr) {
+        free(speech_data);
+        speech_data = nullptr;
+    }
+
+    speech_len = n_samples;
+    speech_data = (float*)malloc(sizeof(float) * speech_len);
+    if(speech_data){
+        // stored like LoadPcmwav does, [-1, 1] for data_type 1 and the int16 range otherwise
+        float factor = (data_type == 1 ? 1.0f : 32768.0f) / scale;
+        if (std::is_same<T, float>::value && factor == 1.0f) {
+            memcpy(speech_data, samples, sizeof(float) * speech_len);
+        } else {
+            for (int32_t i = 0; i < speech_len; ++i) {
+                speech_data[i] = (float)samples[i] * factor;
+            }
+        }
+
+        //resample
+        if(*sampling_rate != dest_sample_rate){
+            WavResample(*sampling_rate, speech_data, speech_len);
+        }
+
+        if (online) {
+            all_samples.insert(all_samples.end(), speech_data, speech_data + speech_len);
+        }
+
+        AudioFrame* frame = new AudioFrame(speech_len);
+        frame_queue.push(frame);
+
+        return true;
+    }else{
+        return false;
+    }
+}
+
+bool Audio::LoadSamples(const int16_t* samples, int n_samples, float scale, int32_t* sampling_rate)
+{
+    return LoadSamplesImpl(samples, n_samples, scale, sampling_rate, false);
+}
+
+bool Audio::LoadSamples(const float* samples, int n_samples, float scale, int32_t* sampling_rate)
+{
+    return LoadSamplesImpl(samples, n_samples, scale, sampling_rate, false);
+}
+
+bool Audio::LoadSamplesOnline(const int16_t* samples, int n_samples, float scale, int32_t* sampling_rate)
+{
+    return LoadSamplesImpl(samples, n_samples, scale, sampling_rate, true);
+}
+
+bool Audio::LoadSamplesOnline(const float* samples, int n_samples, float scale, int32_t* sampling_rate)
+{
+    return LoadSamplesImpl(samples, n_samples, scale, sampling_rate, true);
+}
+
 bool Audio::LoadPcmwav(const char* filename, int32_t* sampling_rate, bool resample)
 {
+    StageTimer timer(STAGE_AUDIO_DECODE);
     if (speech_data != nullptr) {
         free(speech_data);
         speech_data = nullptr;
@@ -979,6 +1051,17 @@ int Audio::FetchTpass(AudioFrame *&frame)
     }
 }
 
+int Audio::FetchSpeculative(AudioFrame *&frame)
+{
+    if (asr_speculative_queue.size() > 0) {
+        frame = asr_speculative_queue.front();
+        asr_speculative_queue.pop();
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
 int Audio::FetchChunck(AudioFrame *&frame)
 {
     if (asr_online_queue.size() > 0) {
@@ -1171,57 +1254,28 @@ void Audio::Split(OfflineStream* offline_stream)
 
 void Audio::CutSplit(OfflineStream* offline_stream, std::vector<int> &index_vector)
 {
-    std::unique_ptr<VadModel> vad_online_handle = make_unique<FsmnVadOnline>((FsmnVad*)(offline_stream->vad_handle).get());
+    FsmnVad* vad = (FsmnVad*)(offline_stream->vad_handle).get();
     AudioFrame *frame;
 
     frame = frame_queue.front();
     frame_queue.pop();
-    int sp_len = frame->GetLen();
     delete frame;
     frame = nullptr;
 
-    int step = dest_sample_rate*1;
-    bool is_final=false;
-    vector<std::vector<int>> vad_segments;
-    for (int sample_offset = 0; sample_offset < speech_len; sample_offset += std::min(step, speech_len - sample_offset)) {
-        if (sample_offset + step >= speech_len - 1) {
-                step = speech_len - sample_offset;
-                is_final = true;
-            } else {
-                is_final = false;
-        }
-        std::vector<float> pcm_data(speech_data+sample_offset, speech_data+sample_offset+step);
-        vector<std::vector<int>> cut_segments = vad_online_handle->Infer(pcm_data, is_final);
-        vad_segments.insert(vad_segments.end(), cut_segments.begin(), cut_segments.end());
-    }    
+    // long audio goes through windows in parallel when the vad has workers
+    vector<std::vector<int>> vad_segments = OfflineVadSegments(vad, speech_data, speech_len);
 
-    int speech_start_i = -1, speech_end_i =-1;
     std::vector<AudioFrame*> vad_frames;
     for(vector<int> vad_segment:vad_segments)
     {
-        if(vad_segment.size() != 2){
-            LOG(ERROR) << "Size of vad_segment is not 2.";
-            break;
-        }
-        if(vad_segment[0] != -1){
-            speech_start_i = vad_segment[0];
-        }
-        if(vad_segment[1] != -1){
-            speech_end_i = vad_segment[1];
-        }
-
-        if(speech_start_i!=-1 && speech_end_i!=-1){
-            int start = speech_start_i*seg_sample;
-            int end = speech_end_i*seg_sample;
-            frame = new AudioFrame(end-start);
-            frame->SetStart(start);
-            frame->SetEnd(end);
-            vad_frames.push_back(frame);
-            frame = nullptr;
-            speech_start_i=-1;
-            speech_end_i=-1;
-        }
-
+        // the vad may end the last segment past the audio, as in ProgressiveStream::Split
+        int start = vad_segment[0]*seg_sample;
+        int end = std::min(vad_segment[1]*seg_sample, speech_len);
+        frame = new AudioFrame(end-start);
+        frame->SetStart(start);
+        frame->SetEnd(end);
+        vad_frames.push_back(frame);
+        frame = nullptr;
     }
     // sort
     {
@@ -1254,7 +1308,7 @@ void Audio::Split(VadModel* vad_obj, vector<std::vector<int>>& vad_segments, boo
 }
 
 // 2pass
-void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYPE asr_mode)
+void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYPE asr_mode, int speculate_ms)
 {
     AudioFrame *frame;
 
@@ -1276,7 +1330,8 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
             int step = chunk_len;
 
             if(asr_mode != ASR_OFFLINE){
-                if(buff_len >= step){
+                // a call may bring several chunks of audio, all go out now
+                while(buff_len >= step){
                     frame = new AudioFrame(step);
                     frame->global_start = speech_start;
                     frame->global_end = speech_start + step/seg_sample;
@@ -1285,6 +1340,8 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                     asr_online_queue.push(frame);
                     frame = nullptr;
                     speech_start += step/seg_sample;
+                    start += step;
+                    buff_len -= step;
                 }
             }
         }
@@ -1338,7 +1395,7 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                 int step = chunk_len;
 
                 if(asr_mode != ASR_OFFLINE){
-                    if(buff_len >= step){
+                    while(buff_len >= step){
                         frame = new AudioFrame(step);
                         frame->global_start = speech_start;
                         frame->global_end = speech_start + step/seg_sample;
@@ -1347,6 +1404,8 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
                         asr_online_queue.push(frame);
                         frame = nullptr;
                         speech_start += step/seg_sample;
+                        start += step;
+                        buff_len -= step;
                     }
                 }
 
@@ -1405,6 +1464,32 @@ void Audio::Split(VadModel* vad_obj, int chunk_len, bool input_finished, ASR_TYP
         }
     }
 
+    // speculative offline segment
+    if(speculate_ms > 0 && asr_mode != ASR_ONLINE){
+        int spec_end_ms = -1;
+        if(speech_offline_start != -1 && !input_finished){
+            spec_end_ms = ((FsmnVadOnline*)vad_obj)->PendingEndMs(speculate_ms);
+        }
+        int start = speech_offline_start*seg_sample;
+        int end = spec_end_ms*seg_sample;
+        if(spec_end_ms == -1 || end <= start || end-offset > (int)all_samples.size()){
+            // speech went on, or the end is not here yet
+            spec_start = -1;
+            spec_end = -1;
+        }else if(spec_start != speech_offline_start || spec_end != spec_end_ms){
+            frame = new AudioFrame(end-start);
+            frame->is_final = true;
+            frame->global_start = speech_offline_start;
+            frame->global_end = spec_end_ms;
+            frame->data = (float*)malloc(sizeof(float) * (end-start));
+            memcpy(frame->data, all_samples.data()+start-offset, (end-start)*sizeof(float));
+            asr_speculative_queue.push(frame);
+            frame = nullptr;
+            spec_start = speech_offline_start;
+            spec_end = spec_end_ms;
+        }
+    }
+
     // erase all_samples
     int vector_cache = dest_sample_rate*2;
     if(speech_offline_start == -1){
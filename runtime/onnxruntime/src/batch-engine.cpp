@@ -0,0 +1,476 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#include <chrono>
+#ifndef _WIN32
+#include <sys/resource.h>
+#else
+#include <fcntl.h>
+#include <share.h>
+#include <sys/stat.h>
+#endif
+
+namespace funasr {
+struct BatchFile {
+    int64_t line;
+    std::string id;
+    std::unique_ptr<Audio> audio;
+    std::vector<FUNASR_SEG_RESULT> segs;
+    std::vector<float> seg_stimes;
+    // segments still with the asr stage
+    std::atomic<int> remaining{0};
+    FUNASR_RECOG_RESULT result;
+    bool failed = false;
+};
+
+static bool LoadFile(Audio &audio, const std::string &path, int32_t sampling_rate)
+{
+    if (is_target_file(path, "wav")) {
+        int32_t wav_rate = -1;
+        return audio.LoadWav(path.c_str(), &wav_rate);
+    } else if (is_target_file(path, "pcm")) {
+        return audio.LoadPcmwav(path.c_str(), &sampling_rate);
+    }
+    return audio.FfmpegLoad(path.c_str());
+}
+
+// user and system time of all threads of the process
+static double CpuSeconds()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// cuts the file at path to its first bytes
+static bool TruncateFile(const std::string &path, int64_t bytes)
+{
+#ifdef _WIN32
+    int fd = -1;
+    if (_sopen_s(&fd, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0) {
+        return false;
+    }
+    bool ok = _chsize_s(fd, bytes) == 0;
+    _close(fd);
+    return ok;
+#else
+    return truncate(path.c_str(), bytes) == 0;
+#endif
+}
+
+// moves from over to, which may exist: rename does not replace a file on windows
+static bool MoveOver(const std::string &from, const std::string &to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// "done bytes total": the first done lines of a list of total are in the first
+// bytes of the output. Written aside and moved over, so it is never half written
+static bool SaveCheckpoint(const std::string &path, int64_t done, int64_t bytes, int64_t total)
+{
+    std::string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "w");
+    if (fp == nullptr) {
+        LOG(ERROR) << "Failed to open checkpoint " << tmp;
+        return false;
+    }
+    fprintf(fp, "%lld %lld %lld\n", (long long)done, (long long)bytes, (long long)total);
+    if (fclose(fp) != 0 || !MoveOver(tmp, path)) {
+        LOG(ERROR) << "Failed to save checkpoint " << path;
+        return false;
+    }
+    return true;
+}
+
+BatchEngine::BatchEngine(OfflineStream* offline_stream, const FUNASR_BATCH_CONF &conf, const std::vector<std::vector<float>> &hw_emb,
+                         void* dec_handle)
+    : offline_stream_(offline_stream), conf_(conf), hw_emb_(hw_emb), dec_handle_(dec_handle),
+      vad_queue_(std::max(1, conf.queue_size)), punc_queue_(std::max(1, conf.queue_size))
+{
+    conf_.reader_thread_num = std::max(1, conf_.reader_thread_num);
+    conf_.vad_thread_num = std::max(1, conf_.vad_thread_num);
+    conf_.asr_thread_num = std::max(1, conf_.asr_thread_num);
+    conf_.punc_thread_num = std::max(1, conf_.punc_thread_num);
+    conf_.max_files = std::max(1, conf_.max_files);
+    conf_.window_segs = std::max(1, conf_.window_segs);
+}
+
+bool BatchEngine::Run(const std::string &wav_scp, const std::string &output, const std::string &checkpoint, FUNASR_BATCH_STATS* stats)
+{
+    auto wall_start = std::chrono::steady_clock::now();
+    double cpu_start = CpuSeconds();
+    std::ifstream in(wav_scp);
+    if (!in.is_open()) {
+        LOG(ERROR) << "Failed to open " << wav_scp;
+        return false;
+    }
+    std::string row;
+    while (getline(in, row)) {
+        std::istringstream iss(row);
+        std::string wav_id, wav_path;
+        if (iss >> wav_id >> wav_path) {
+            entries_.emplace_back(wav_id, wav_path);
+        }
+    }
+    int64_t total = entries_.size();
+
+    int64_t done = 0;
+    int64_t bytes = 0;
+    std::ifstream saved(checkpoint);
+    if (!checkpoint.empty() && saved.is_open()) {
+        int64_t saved_total = 0;
+        if (!(saved >> done >> bytes >> saved_total)) {
+            LOG(ERROR) << "Corrupt checkpoint " << checkpoint;
+            return false;
+        }
+        if (saved_total != total || done > total) {
+            LOG(ERROR) << "Checkpoint " << checkpoint << " is for a list of " << saved_total << " files, " << wav_scp << " has " << total;
+            return false;
+        }
+        std::ifstream written(output, std::ios::binary | std::ios::ate);
+        if (!written.is_open()) {
+            LOG(ERROR) << "Checkpoint " << checkpoint << " records " << done << " files written to " << output
+                       << ", which does not exist; remove the checkpoint to start over";
+            return false;
+        }
+        if ((int64_t)written.tellg() < bytes) {
+            LOG(ERROR) << "Checkpoint " << checkpoint << " records " << bytes << " bytes of " << output << ", it has "
+                       << (int64_t)written.tellg() << "; remove the checkpoint to start over";
+            return false;
+        }
+        written.close();
+        // drop whatever was written after the checkpoint was saved
+        if (!TruncateFile(output, bytes)) {
+            LOG(ERROR) << "Failed to resume " << output << " at byte " << bytes;
+            return false;
+        }
+        LOG(INFO) << "Resume " << wav_scp << " after " << done << " of " << total << " files";
+    }
+    FILE* fp = fopen(output.c_str(), done > 0 ? "ab" : "wb");
+    if (fp == nullptr) {
+        LOG(ERROR) << "Failed to open " << output;
+        return false;
+    }
+
+    next_entry_ = done;
+    readers_left_ = conf_.reader_thread_num;
+    vads_left_ = conf_.vad_thread_num;
+    asrs_left_ = conf_.asr_thread_num;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < conf_.reader_thread_num; i++) {
+        threads.emplace_back(&BatchEngine::ReadStage, this);
+    }
+    for (int i = 0; i < conf_.vad_thread_num; i++) {
+        threads.emplace_back(&BatchEngine::VadStage, this);
+    }
+    for (int lane = 0; lane < conf_.asr_thread_num; lane++) {
+        threads.emplace_back(&BatchEngine::AsrStage, this, lane);
+    }
+    for (int i = 0; i < conf_.punc_thread_num; i++) {
+        threads.emplace_back(&BatchEngine::PuncStage, this);
+    }
+
+    // the writer, on the calling thread
+    FUNASR_BATCH_STATS run_stats;
+    run_stats.resumed = done;
+    auto last_save = std::chrono::steady_clock::now();
+    // after a failed write the output may end in part of a line, so the last
+    // checkpoint saved is the one to resume from
+    bool write_ok = true;
+    bool checkpoint_ok = !checkpoint.empty();
+    for (int64_t line = done; line < total; line++) {
+        BatchFile* file;
+        {
+            std::unique_lock<std::mutex> lock(ready_mtx_);
+            ready_cv_.wait(lock, [this, line] { return ready_.count(line) > 0; });
+            auto it = ready_.find(line);
+            file = it->second;
+            ready_.erase(it);
+        }
+        run_stats.files++;
+        if (file->failed) {
+            run_stats.failed++;
+        } else if (write_ok && Write(file, fp, bytes)) {
+            run_stats.audio_seconds += file->result.snippet_time;
+        } else {
+            write_ok = false;
+            run_stats.failed++;
+        }
+        delete file;
+        {
+            std::lock_guard<std::mutex> lock(flight_mtx_);
+            in_flight_--;
+        }
+        flight_cv_.notify_one();
+
+        auto now = std::chrono::steady_clock::now();
+        if (write_ok && checkpoint_ok && now - last_save >= std::chrono::milliseconds(conf_.checkpoint_ms)) {
+            if (fflush(fp) != 0) {
+                LOG(ERROR) << "Failed to write " << output;
+                write_ok = false;
+                continue;
+            }
+            if (!SaveCheckpoint(checkpoint, line + 1, bytes, total)) {
+                // a rerun resumes from the last checkpoint saved
+                LOG(ERROR) << "Checkpointing stops at " << line + 1 << " of " << total << " files";
+                checkpoint_ok = false;
+            }
+            last_save = now;
+            LOG(INFO) << line + 1 << " of " << total << " files written";
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (fclose(fp) != 0) {
+        LOG(ERROR) << "Failed to close " << output;
+        write_ok = false;
+    }
+    if (write_ok && checkpoint_ok && !SaveCheckpoint(checkpoint, total, bytes, total)) {
+        LOG(ERROR) << "The run is complete, but a rerun resumes from the last checkpoint saved";
+    }
+
+    run_stats.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    run_stats.cpu_seconds = CpuSeconds() - cpu_start;
+    if (stats) {
+        *stats = run_stats;
+    }
+    return write_ok;
+}
+
+void BatchEngine::ReadStage()
+{
+    int sample_rate = offline_stream_->asr_handle->GetAsrSampleRate();
+    while (true) {
+        int64_t line;
+        {
+            std::unique_lock<std::mutex> lock(flight_mtx_);
+            flight_cv_.wait(lock, [this] { return in_flight_ < conf_.max_files || next_entry_ >= (int64_t)entries_.size(); });
+            if (next_entry_ >= (int64_t)entries_.size()) {
+                // the others may still wait for a place
+                flight_cv_.notify_all();
+                break;
+            }
+            line = next_entry_++;
+            in_flight_++;
+        }
+        BatchFile* file = new BatchFile;
+        file->line = line;
+        file->id = entries_[line].first;
+        file->audio = make_unique<Audio>(sample_rate, 1);
+        const std::string &wav_path = entries_[line].second;
+        try{
+            file->failed = !LoadFile(*file->audio, wav_path, conf_.sampling_rate);
+        }catch (std::exception const &e)
+        {
+            LOG(ERROR) << e.what();
+            file->failed = true;
+        }
+        if (file->failed) {
+            LOG(ERROR) << file->id << ": failed to load " << wav_path;
+            Finish(file);
+            continue;
+        }
+        vad_queue_.Push(file);
+    }
+    std::lock_guard<std::mutex> lock(flight_mtx_);
+    if (--readers_left_ == 0) {
+        vad_queue_.Close();
+    }
+}
+
+void BatchEngine::VadStage()
+{
+    size_t max_pool = (size_t)conf_.window_segs * (conf_.asr_thread_num + 1);
+    while (true) {
+        BatchFile* file;
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx_);
+            vad_idle_++;
+        }
+        pool_cv_.notify_all();
+        bool got = vad_queue_.Pop(file);
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx_);
+            vad_idle_--;
+        }
+        if (!got) {
+            break;
+        }
+
+        file->result.snippet_time = file->audio->GetTimeLen();
+        MetricsCount(COUNTER_OFFLINE_REQUESTS);
+        MetricsCount(COUNTER_AUDIO_MS, (int64_t)(file->result.snippet_time * 1000));
+        if (file->result.snippet_time == 0) {
+            Finish(file);
+            continue;
+        }
+        std::vector<int> index_vector = {0};
+        try{
+            if (offline_stream_->UseVad()) {
+                file->audio->CutSplit(offline_stream_, index_vector);
+            }
+        }catch (std::exception const &e)
+        {
+            LOG(ERROR) << file->id << ": " << e.what();
+            file->failed = true;
+            Finish(file);
+            continue;
+        }
+        MetricsCount(COUNTER_VAD_SEGMENTS, index_vector.size());
+        int seg_num = index_vector.size();
+        file->segs.resize(seg_num);
+        file->seg_stimes.resize(seg_num);
+
+        // the frames come out shortest first, index_vector maps them back to audio order
+        std::vector<SegRef> refs;
+        float* data;
+        int len;
+        int flag;
+        float start_time;
+        int msg_idx = 0;
+        while (file->audio->Fetch(data, len, flag, start_time) > 0) {
+            if (msg_idx < seg_num) {
+                int idx = index_vector[msg_idx++];
+                file->seg_stimes[idx] = start_time;
+                refs.push_back({file, idx, data, len});
+            } else {
+                LOG(ERROR) << "msg_idx: " << msg_idx << " is out of range " << seg_num;
+            }
+        }
+        if (refs.empty()) {
+            punc_queue_.Push(file);
+            continue;
+        }
+        file->remaining = refs.size();
+        std::unique_lock<std::mutex> lock(pool_mtx_);
+        pool_cv_.wait(lock, [this, max_pool] { return pool_.size() < max_pool; });
+        pool_.insert(pool_.end(), refs.begin(), refs.end());
+        pool_cv_.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(pool_mtx_);
+    if (--vads_left_ == 0) {
+        vad_done_ = true;
+        pool_cv_.notify_all();
+    }
+}
+
+void BatchEngine::AsrStage(int lane)
+{
+    std::unique_ptr<WfstDecoder, void(*)(WfstDecoder*)> lane_decoder(nullptr, WfstDecoder::Release);
+    WfstDecoder* wfst_decoder = (WfstDecoder*)dec_handle_;
+    if (wfst_decoder && lane > 0) {
+        lane_decoder.reset(wfst_decoder->Clone());
+    }
+    void* lane_handle = lane > 0 ? (void*)lane_decoder.get() : dec_handle_;
+    int batch_size = std::max(1, offline_stream_->asr_handle->GetBatchSize());
+    bool use_svs = offline_stream_->GetModelType() == MODEL_SVS;
+    // file requests never carry sensevoice options
+    std::string svs_lang = "auto";
+    bool svs_itn = false;
+
+    std::vector<SegRef> window;
+    while (true) {
+        window.clear();
+        {
+            std::unique_lock<std::mutex> lock(pool_mtx_);
+            // a partial window once the vad waits for the readers, the files in
+            // it may be the ones that hold back the readers
+            pool_cv_.wait(lock, [this] {
+                return pool_.size() >= (size_t)conf_.window_segs || vad_done_ || (!pool_.empty() && vad_idle_ == conf_.vad_thread_num);
+            });
+            if (pool_.empty()) {
+                break;
+            }
+            size_t seg_num = std::min(pool_.size(), (size_t)conf_.window_segs);
+            window.assign(pool_.begin(), pool_.begin() + seg_num);
+            pool_.erase(pool_.begin(), pool_.begin() + seg_num);
+            pool_cv_.notify_all();
+        }
+        // longest first, so the segments of a batch need little padding
+        std::stable_sort(window.begin(), window.end(), [](const SegRef &a, const SegRef &b) { return a.len > b.len; });
+        for (size_t start = 0; start < window.size(); start += batch_size) {
+            int batch_in = std::min((size_t)batch_size, window.size() - start);
+            std::vector<float*> buff(batch_in);
+            std::vector<int> len(batch_in);
+            for (int idx = 0; idx < batch_in; idx++) {
+                buff[idx] = window[start + idx].data;
+                len[idx] = window[start + idx].len;
+            }
+            std::vector<FUNASR_SEG_RESULT> seg_batch;
+            try{
+                offline_stream_->Forward(buff.data(), len.data(), batch_in, hw_emb_, lane_handle, use_svs, svs_lang, svs_itn, seg_batch);
+            }catch (std::exception const &e)
+            {
+                LOG(ERROR) << e.what();
+            }
+            for (int idx = 0; idx < batch_in; idx++) {
+                SegRef &ref = window[start + idx];
+                if (idx < (int)seg_batch.size()) {
+                    ref.file->segs[ref.idx] = std::move(seg_batch[idx]);
+                }
+                if (--ref.file->remaining == 0) {
+                    punc_queue_.Push(ref.file);
+                }
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(pool_mtx_);
+    if (--asrs_left_ == 0) {
+        punc_queue_.Close();
+    }
+}
+
+void BatchEngine::PuncStage()
+{
+    BatchFile* file;
+    while (punc_queue_.Pop(file)) {
+        try{
+            PuncProgress punc_progress;
+            offline_stream_->Assemble(file->segs, file->seg_stimes, conf_.itn, &file->result, punc_progress);
+        }catch (std::exception const &e)
+        {
+            LOG(ERROR) << file->id << ": " << e.what();
+            file->failed = true;
+        }
+        // only the result waits for the writer
+        file->audio.reset();
+        std::vector<FUNASR_SEG_RESULT>().swap(file->segs);
+        Finish(file);
+    }
+}
+
+void BatchEngine::Finish(BatchFile* file)
+{
+    {
+        std::lock_guard<std::mutex> lock(ready_mtx_);
+        ready_[file->line] = file;
+    }
+    ready_cv_.notify_one();
+}
+
+bool BatchEngine::Write(BatchFile* file, FILE* fp, int64_t &bytes)
+{
+    std::string text = file->id + "\t" + file->result.msg;
+    if (conf_.stamp && !file->result.stamp_list.empty()) {
+        text += "\t" + VectorToString(file->result.stamp_list);
+    }
+    text += "\n";
+    if (fwrite(text.data(), 1, text.size(), fp) != text.size()) {
+        LOG(ERROR) << file->id << ": failed to write the result, the output stops here";
+        return false;
+    }
+    bytes += text.size();
+    return true;
+}
+} // namespace funasr
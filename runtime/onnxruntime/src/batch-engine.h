@@ -0,0 +1,128 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Transcription of a whole wav.scp list as a pipeline: readers load and decode
+// the files ahead of the rest, the vad cuts them into segments, the asr stage
+// decodes the segments of several files together, longest first, and the punc
+// stage finishes a file once its last segment is back. Every stage has its own
+// threads and the stages are joined by bounded queues, so a slow one holds the
+// others back instead of piling files up in memory. A single writer puts the
+// results out in list order and saves the progress to a checkpoint.
+#ifndef BATCH_ENGINE_H
+#define BATCH_ENGINE_H
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace funasr {
+// Push blocks while max_size items wait, Pop blocks until an item arrives and
+// returns false once the queue is closed and empty.
+template<typename T>
+class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t max_size) : max_size_(max_size) {}
+
+    void Push(T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this] { return items_.size() < max_size_; });
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+    }
+
+    bool Pop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+  private:
+    std::deque<T> items_;
+    size_t max_size_;
+    bool closed_ = false;
+    std::mutex mtx_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+struct BatchFile;
+
+class BatchEngine {
+  public:
+    BatchEngine(OfflineStream* offline_stream, const FUNASR_BATCH_CONF &conf, const std::vector<std::vector<float>> &hw_emb,
+                void* dec_handle);
+    // false if the list, the output or the checkpoint cannot be used or a write failed; a file
+    // that fails to decode is logged, counted and left out of the output
+    bool Run(const std::string &wav_scp, const std::string &output, const std::string &checkpoint, FUNASR_BATCH_STATS* stats);
+
+  private:
+    // a vad segment waiting in the pool of the asr stage
+    struct SegRef {
+        BatchFile* file;
+        int idx;
+        float* data;
+        int len;
+    };
+
+    void ReadStage();
+    void VadStage();
+    void AsrStage(int lane);
+    void PuncStage();
+    // hands a finished or failed file to the writer
+    void Finish(BatchFile* file);
+    bool Write(BatchFile* file, FILE* fp, int64_t &bytes);
+
+    OfflineStream* offline_stream_;
+    FUNASR_BATCH_CONF conf_;
+    const std::vector<std::vector<float>> &hw_emb_;
+    void* dec_handle_;
+
+    // wav_id and wav_path by line
+    std::vector<std::pair<std::string, std::string>> entries_;
+
+    // files read and not yet written, at most conf_.max_files; lines are taken
+    // in order, so the line the writer waits for always holds a place
+    std::mutex flight_mtx_;
+    std::condition_variable flight_cv_;
+    int in_flight_ = 0;
+    int64_t next_entry_ = 0;
+    int readers_left_ = 0;
+
+    BoundedQueue<BatchFile*> vad_queue_;
+    BoundedQueue<BatchFile*> punc_queue_;
+
+    // segments of several files; taken a window at a time, or whatever is
+    // there once the vad has nothing else to cut
+    std::mutex pool_mtx_;
+    std::condition_variable pool_cv_;
+    std::deque<SegRef> pool_;
+    int vad_idle_ = 0;
+    int vads_left_ = 0;
+    int asrs_left_ = 0;
+    bool vad_done_ = false;
+
+    // finished files by line, until the writer reaches them
+    std::mutex ready_mtx_;
+    std::condition_variable ready_cv_;
+    std::unordered_map<int64_t, BatchFile*> ready_;
+};
+} // namespace funasr
+#endif
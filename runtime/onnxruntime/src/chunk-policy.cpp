@@ -0,0 +1,108 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+bool ChunkSizePolicy::Parse(const std::string &spec, std::vector<std::vector<int>> &chunk_sizes)
+{
+    chunk_sizes.clear();
+    std::istringstream sizes(spec);
+    std::string size;
+    while (std::getline(sizes, size, ';')) {
+        std::vector<int> chunk_size;
+        std::istringstream values(size);
+        std::string value;
+        try {
+            while (std::getline(values, value, ',')) {
+                chunk_size.push_back(std::stoi(value));
+            }
+        } catch (std::exception const &e) {
+            LOG(ERROR) << "bad chunk size " << size;
+            return false;
+        }
+        if (chunk_size.size() != 3 || chunk_size[0] < 0 || chunk_size[1] <= 0 || chunk_size[2] < 0) {
+            LOG(ERROR) << "bad chunk size " << size << ", expected lookback,chunk,lookahead";
+            return false;
+        }
+        if (!chunk_sizes.empty() && chunk_size[2] != chunk_sizes[0][2]) {
+            LOG(ERROR) << "the chunk sizes " << spec << " differ in lookahead";
+            return false;
+        }
+        chunk_sizes.push_back(chunk_size);
+    }
+    if (chunk_sizes.empty()) {
+        LOG(ERROR) << "no chunk size in " << spec;
+        return false;
+    }
+    std::stable_sort(chunk_sizes.begin(), chunk_sizes.end(),
+                     [](const std::vector<int> &a, const std::vector<int> &b) { return a[1] < b[1]; });
+    return true;
+}
+
+ChunkSizePolicy::ChunkSizePolicy(const std::vector<std::vector<int>> &chunk_sizes, int target_ms, int window_ms)
+    : chunk_sizes_(chunk_sizes), target_ms_(target_ms), window_(window_ms),
+      window_start_(std::chrono::steady_clock::now())
+{
+}
+
+void ChunkSizePolicy::Report(double lag_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    reports_++;
+    over_target_ += lag_ms > target_ms_ ? 1 : 0;
+    over_half_ += lag_ms > target_ms_ / 2 ? 1 : 0;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - window_start_ < window_) {
+        return;
+    }
+    // p95 above the target: more than 5% of the reports over it
+    int level = level_;
+    if (over_target_ * 20 > reports_) {
+        level = std::min(level_ + 1, (int)chunk_sizes_.size() - 1);
+    } else if (over_half_ * 20 <= reports_) {
+        level = std::max(level_ - 1, 0);
+    }
+    if (level != level_) {
+        LOG(INFO) << "chunk size level " << level_ << " -> " << level << ", " << over_target_ << " of " << reports_
+                  << " reports over " << target_ms_ << " ms";
+        level_ = level;
+    }
+    window_start_ = now;
+    reports_ = 0;
+    over_target_ = 0;
+    over_half_ = 0;
+}
+
+int ChunkSizePolicy::Level()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return level_;
+}
+
+std::vector<int> ChunkSizePolicy::Pick(const std::string &latency_class)
+{
+    int cap = (int)chunk_sizes_.size() - 1;
+    if (latency_class == "low") {
+        cap = 0;
+    } else if (latency_class != "high") {
+        cap = cap / 2;
+    }
+    return chunk_sizes_[std::min(Level(), cap)];
+}
+
+bool ChunkSizePolicy::Compatible(const std::vector<int> &chunk_size) const
+{
+    return chunk_size.size() == 3 && chunk_size[2] == chunk_sizes_[0][2];
+}
+
+int ChunkSizePolicy::MaxLookback() const
+{
+    int max_lookback = 0;
+    for (auto &chunk_size : chunk_sizes_) {
+        max_lookback = std::max(max_lookback, chunk_size[0]);
+    }
+    return max_lookback;
+}
+} // namespace funasr
@@ -0,0 +1,51 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Chunk size of the online streams under load. Larger chunks cost less per
+// second of audio, the lookback and lookahead are computed once per chunk,
+// but hold partial results back longer. The policy steps through a set of
+// chunk sizes ordered by chunk length: it goes one size up when the p95 of
+// the decoding lag reported over a window is above the target and one size
+// down when it is below half of it, so streams do not flap between sizes.
+#ifndef CHUNK_POLICY_H
+#define CHUNK_POLICY_H
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace funasr {
+class ChunkSizePolicy {
+  public:
+    // "5,10,5;5,20,5;5,40,5"; false if a size is malformed or the sizes differ
+    // in lookahead, which a stream cannot change
+    static bool Parse(const std::string &spec, std::vector<std::vector<int>> &chunk_sizes);
+
+    ChunkSizePolicy(const std::vector<std::vector<int>> &chunk_sizes, int target_ms, int window_ms = 1000);
+
+    // lag of a chunk or decode turn behind the audio it decoded, from any thread
+    void Report(double lag_ms);
+    int Level();
+    // the size for a stream of latency class "low" (smallest size only),
+    // "normal" (up to the middle of the set) or "high" (the whole set)
+    std::vector<int> Pick(const std::string &latency_class);
+    // whether a stream started with chunk_size can switch to the set
+    bool Compatible(const std::vector<int> &chunk_size) const;
+    // the largest lookback of the set, see FunTpassOnlineSetMaxLookback
+    int MaxLookback() const;
+
+  private:
+    std::vector<std::vector<int>> chunk_sizes_;
+    double target_ms_;
+    std::chrono::milliseconds window_;
+
+    std::mutex mtx_;
+    int level_ = 0;
+    std::chrono::steady_clock::time_point window_start_;
+    int reports_ = 0;
+    int over_target_ = 0;
+    int over_half_ = 0;
+};
+} // namespace funasr
+#endif
@@ -2,5 +2,46 @@
 #ifndef COMMONSTRUCT_H
 #define COMMONSTRUCT_H
 
+#include <string>
+#include <vector>
 
+namespace funasr {
+
+// One decoded segment. Timestamps stay integer milliseconds relative to the
+// segment start and are only serialized at the API boundary.
+typedef struct
+{
+    std::string text;
+    std::vector<int> token_ids;
+    // words after bpe/english merging, one stamp per piece
+    std::vector<std::string> pieces;
+    std::vector<std::vector<int>> stamps;
+}FUNASR_SEG_RESULT;
+
+// one punctuated sentence with its token stamps, see TimestampSentence
+typedef struct
+{
+    std::string text_seg;
+    std::string punc;
+    int start;
+    int end;
+    // flat [start, end, start, end, ...] pairs in ms
+    std::vector<int> ts_list;
+}FUNASR_STAMP_SENT;
+
+typedef struct
+{
+    std::string msg;
+    std::string stamp;
+    std::string stamp_sents;
+    std::string tpass_msg;
+    float snippet_time;
+    // [start, end] in ms and the sentences built from them, stamp and
+    // stamp_sents are serialized from these on first request
+    std::vector<std::vector<int>> stamp_list;
+    std::vector<FUNASR_STAMP_SENT> stamp_sent_list;
+    std::vector<int> stamp_array;
+}FUNASR_RECOG_RESULT;
+
+} // namespace funasr
 #endif
@@ -5,15 +5,6 @@
 #endif
 
 namespace funasr {
-typedef struct
-{
-    std::string msg;
-    std::string stamp;
-    std::string stamp_sents;
-    std::string tpass_msg;
-    float snippet_time;
-}FUNASR_RECOG_RESULT;
-
 typedef struct
 {
     std::vector<std::vector<int>>* segments;
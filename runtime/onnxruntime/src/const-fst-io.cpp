@@ -0,0 +1,47 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+fst::Fst<fst::StdArc>* ReadFst(const std::string &filename)
+{
+    std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+    if (!strm) {
+        LOG(ERROR) << "Could not open fst file " << filename;
+        return nullptr;
+    }
+    // advisory: vector fsts and unaligned const fsts are read as before
+    fst::FstReadOptions opts(filename);
+    opts.mode = fst::FstReadOptions::MAP;
+    return fst::Fst<fst::StdArc>::Read(strm, opts);
+}
+
+bool WriteConstFst(const fst::Fst<fst::StdArc> &fst, const std::string &filename)
+{
+    fst::ConstFst<fst::StdArc> const_fst(fst);
+    std::string tmp_file = filename + ".tmp";
+    {
+        std::ofstream strm(tmp_file, std::ios_base::out | std::ios_base::binary);
+        if (!strm) {
+            LOG(ERROR) << "Could not open " << tmp_file << " for writing";
+            return false;
+        }
+        fst::FstWriteOptions opts(filename);
+        // the states and arcs start at a multiple of the alignment, where mmap can place them
+        opts.align = true;
+        if (!const_fst.Write(strm, opts) || !strm.flush()) {
+            LOG(ERROR) << "Failed to write " << tmp_file;
+            remove(tmp_file.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp_file.c_str(), filename.c_str()) != 0) {
+        LOG(ERROR) << "Failed to rename " << tmp_file << " to " << filename;
+        remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+} // namespace funasr
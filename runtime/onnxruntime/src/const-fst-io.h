@@ -0,0 +1,22 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Loading of the lm (TLG) and itn graphs. A vector fst is parsed into the heap
+// of every process that loads it. Converted once to an aligned const fst, the
+// same file is mapped read-only instead: it loads in the time of the header,
+// its pages come from the page cache on first use and are shared by every
+// process on the host that maps it.
+#ifndef CONST_FST_IO_H
+#define CONST_FST_IO_H
+#include <string>
+#include "fst/fstlib.h"
+
+namespace funasr {
+// reads an fst of any registered type, aligned const fsts are mapped; nullptr on failure
+fst::Fst<fst::StdArc>* ReadFst(const std::string &filename);
+// writes fst in the aligned const format ReadFst maps. The file is replaced by a
+// rename, so filename may be the file fst was mapped from.
+bool WriteConstFst(const fst::Fst<fst::StdArc> &fst, const std::string &filename);
+} // namespace funasr
+#endif
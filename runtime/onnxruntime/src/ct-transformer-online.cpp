@@ -12,7 +12,7 @@ CTTransformerOnline::CTTransformerOnline()
 }
 
 void CTTransformerOnline::InitPunc(const std::string &punc_model, const std::string &punc_config, const std::string &token_file, int thread_num){
-    session_options.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(session_options, thread_num);
     session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     session_options.DisableCpuMemArena();
 
@@ -38,6 +38,7 @@ CTTransformerOnline::~CTTransformerOnline()
 
 string CTTransformerOnline::AddPunc(const char* sz_input, vector<string> &arr_cache, std::string language)
 {
+    StageTimer timer(STAGE_PUNC);
     string strResult;
     vector<string> strOut;
     vector<int> InputData;
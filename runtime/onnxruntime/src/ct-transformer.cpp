@@ -12,7 +12,7 @@ CTTransformer::CTTransformer()
 }
 
 void CTTransformer::InitPunc(const std::string &punc_model, const std::string &punc_config, const std::string &token_file, int thread_num){
-    session_options.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(session_options, thread_num);
     session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     session_options.DisableCpuMemArena();
 
@@ -38,95 +38,115 @@ CTTransformer::~CTTransformer()
 
 string CTTransformer::AddPunc(const char* sz_input, std::string language)
 {
-    string strResult;
-    vector<string> strOut;
-    vector<int> InputData;
-    m_tokenizer.Tokenize(sz_input, strOut, InputData); 
+    PuncProgress progress;
+    return AddPunc(sz_input, language, progress);
+}
 
-    int nTotalBatch = ceil((float)InputData.size() / TOKEN_LEN);
-    int nCurBatch = -1;
-    int nSentEnd = -1, nLastCommaIndex = -1;
-    vector<int32_t> RemainIDs; // 
-    vector<string> RemainStr; //
-    vector<int> NewPunctuation; //
-    vector<string> NewString; //
-    vector<string> NewSentenceOut;
-    vector<int> NewPuncOut;
-    int nDiff = 0;
-    for (size_t i = 0; i < InputData.size(); i += TOKEN_LEN)
+void CTTransformer::PuncWindow(vector<int> &input_data, vector<string> &str_out, PuncProgress &progress, bool is_last)
+{
+    size_t nStart = progress.ids.size();
+    size_t nLen = std::min((size_t)TOKEN_LEN, input_data.size() - nStart);
+    vector<int32_t> InputIDs(input_data.begin() + nStart, input_data.begin() + nStart + nLen);
+    vector<string> InputStr(str_out.begin() + nStart, str_out.begin() + nStart + nLen);
+    progress.ids.insert(progress.ids.end(), InputIDs.begin(), InputIDs.end());
+    progress.strs.insert(progress.strs.end(), InputStr.begin(), InputStr.end());
+    InputIDs.insert(InputIDs.begin(), progress.remain_ids.begin(), progress.remain_ids.end()); // RemainIDs+InputIDs;
+    InputStr.insert(InputStr.begin(), progress.remain_str.begin(), progress.remain_str.end()); // RemainStr+InputStr;
+
+    auto Punction = Infer(InputIDs);
+    if (!is_last) // not the last minisetence
     {
-        nDiff = (i + TOKEN_LEN) < InputData.size() ? (0) : (i + TOKEN_LEN - InputData.size());
-        vector<int32_t> InputIDs(InputData.begin() + i, InputData.begin() + i + (TOKEN_LEN - nDiff));
-        vector<string> InputStr(strOut.begin() + i, strOut.begin() + i + (TOKEN_LEN - nDiff));
-        InputIDs.insert(InputIDs.begin(), RemainIDs.begin(), RemainIDs.end()); // RemainIDs+InputIDs;
-        InputStr.insert(InputStr.begin(), RemainStr.begin(), RemainStr.end()); // RemainStr+InputStr;
-
-        auto Punction = Infer(InputIDs);
-        nCurBatch = i / TOKEN_LEN;
-        if (nCurBatch < nTotalBatch - 1) // not the last minisetence
+        int nSentEnd = -1, nLastCommaIndex = -1;
+        for (int nIndex = Punction.size() - 2; nIndex > 0; nIndex--)
         {
-            nSentEnd = -1;
-            nLastCommaIndex = -1;
-            for (int nIndex = Punction.size() - 2; nIndex > 0; nIndex--)
+            if (m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(PERIOD_INDEX) || m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(QUESTION_INDEX))
             {
-                if (m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(PERIOD_INDEX) || m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(QUESTION_INDEX))
-                {
-                    nSentEnd = nIndex;
-                    break;
-                }
-                if (nLastCommaIndex < 0 && m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(COMMA_INDEX))
-                {
-                    nLastCommaIndex = nIndex;
-                }
+                nSentEnd = nIndex;
+                break;
             }
-            if (nSentEnd < 0 && InputStr.size() > CACHE_POP_TRIGGER_LIMIT && nLastCommaIndex > 0)
+            if (nLastCommaIndex < 0 && m_tokenizer.Id2Punc(Punction[nIndex]) == m_tokenizer.Id2Punc(COMMA_INDEX))
             {
-                nSentEnd = nLastCommaIndex;
-                Punction[nSentEnd] = PERIOD_INDEX;
+                nLastCommaIndex = nIndex;
             }
-            RemainStr.assign(InputStr.begin() + (nSentEnd + 1), InputStr.end());
-            RemainIDs.assign(InputIDs.begin() + (nSentEnd + 1), InputIDs.end());
-            InputStr.assign(InputStr.begin(), InputStr.begin() + (nSentEnd + 1));  // minit_sentence
-            Punction.assign(Punction.begin(), Punction.begin() + (nSentEnd + 1));
         }
-        
-        NewPunctuation.insert(NewPunctuation.end(), Punction.begin(), Punction.end());
-        vector<string> WordWithPunc;
-        for (int i = 0; i < InputStr.size(); i++)
+        if (nSentEnd < 0 && InputStr.size() > CACHE_POP_TRIGGER_LIMIT && nLastCommaIndex > 0)
         {
-            // if (i > 0 && !(InputStr[i][0] & 0x80) && (i + 1) <InputStr.size() && !(InputStr[i+1][0] & 0x80))// �м��Ӣ�ģ�
-            if (i > 0 && !(InputStr[i-1][0] & 0x80) && !(InputStr[i][0] & 0x80))
-            {
-                InputStr[i] = " " + InputStr[i];
-            }
-            WordWithPunc.push_back(InputStr[i]);
+            nSentEnd = nLastCommaIndex;
+            Punction[nSentEnd] = PERIOD_INDEX;
+        }
+        progress.remain_str.assign(InputStr.begin() + (nSentEnd + 1), InputStr.end());
+        progress.remain_ids.assign(InputIDs.begin() + (nSentEnd + 1), InputIDs.end());
+        InputStr.assign(InputStr.begin(), InputStr.begin() + (nSentEnd + 1));  // minit_sentence
+        Punction.assign(Punction.begin(), Punction.begin() + (nSentEnd + 1));
+    }
 
-            if (Punction[i] != NOTPUNC_INDEX) // �»���
-            {
-                WordWithPunc.push_back(m_tokenizer.Id2Punc(Punction[i]));
-            }
+    for (size_t i = 0; i < InputStr.size(); i++)
+    {
+        // if (i > 0 && !(InputStr[i][0] & 0x80) && (i + 1) <InputStr.size() && !(InputStr[i+1][0] & 0x80))// �м��Ӣ�ģ�
+        if (i > 0 && !(InputStr[i-1][0] & 0x80) && !(InputStr[i][0] & 0x80))
+        {
+            InputStr[i] = " " + InputStr[i];
         }
+        progress.words.push_back(InputStr[i]); // new_mini_sentence += "".join(words_with_punc)
 
-        NewString.insert(NewString.end(), WordWithPunc.begin(), WordWithPunc.end()); // new_mini_sentence += "".join(words_with_punc)
-        NewSentenceOut = NewString;
-        NewPuncOut = NewPunctuation;
-        // last mini sentence
-        if(nCurBatch == nTotalBatch - 1)
+        if (Punction[i] != NOTPUNC_INDEX) // �»���
         {
-            if (NewString[NewString.size() - 1] == m_tokenizer.Id2Punc(COMMA_INDEX) || NewString[NewString.size() - 1] == m_tokenizer.Id2Punc(DUN_INDEX))
-            {
-                NewSentenceOut.assign(NewString.begin(), NewString.end() - 1);
-                NewSentenceOut.push_back(m_tokenizer.Id2Punc(PERIOD_INDEX));
-                NewPuncOut.assign(NewPunctuation.begin(), NewPunctuation.end() - 1);
-                NewPuncOut.push_back(PERIOD_INDEX);
-            }
-            else if (NewString[NewString.size() - 1] != m_tokenizer.Id2Punc(PERIOD_INDEX) && NewString[NewString.size() - 1] != m_tokenizer.Id2Punc(QUESTION_INDEX))
-            {
-                NewSentenceOut = NewString;
-                NewSentenceOut.push_back(m_tokenizer.Id2Punc(PERIOD_INDEX));
-                NewPuncOut = NewPunctuation;
-                NewPuncOut.push_back(PERIOD_INDEX);
-            }
+            progress.words.push_back(m_tokenizer.Id2Punc(Punction[i]));
+        }
+    }
+}
+
+// windows that are followed by more tokens never change, so they can be
+// inferred while the rest of the text is still being recognized
+void CTTransformer::AddPuncPartial(const char* sz_prefix, PuncProgress &progress)
+{
+    StageTimer timer(STAGE_PUNC);
+    vector<string> strOut;
+    vector<int> InputData;
+    m_tokenizer.Tokenize(sz_prefix, strOut, InputData);
+    if (progress.ids.size() > InputData.size() ||
+        !std::equal(progress.ids.begin(), progress.ids.end(), InputData.begin()) ||
+        !std::equal(progress.strs.begin(), progress.strs.end(), strOut.begin())) {
+        progress = PuncProgress();
+    }
+    while (progress.ids.size() + TOKEN_LEN + PUNC_PREFIX_MARGIN < InputData.size()) {
+        PuncWindow(InputData, strOut, progress, false);
+    }
+}
+
+string CTTransformer::AddPunc(const char* sz_input, std::string language, PuncProgress &progress)
+{
+    StageTimer timer(STAGE_PUNC);
+    string strResult;
+    vector<string> strOut;
+    vector<int> InputData;
+    m_tokenizer.Tokenize(sz_input, strOut, InputData); 
+
+    // early windows are kept only if the full text starts with the same tokens
+    // and at least the last window is left
+    if (progress.ids.size() >= InputData.size() ||
+        !std::equal(progress.ids.begin(), progress.ids.end(), InputData.begin()) ||
+        !std::equal(progress.strs.begin(), progress.strs.end(), strOut.begin())) {
+        progress = PuncProgress();
+    }
+    while (progress.ids.size() < InputData.size())
+    {
+        PuncWindow(InputData, strOut, progress, progress.ids.size() + TOKEN_LEN >= InputData.size());
+    }
+
+    vector<string> &NewString = progress.words;
+    vector<string> NewSentenceOut = NewString;
+    // last mini sentence
+    if (!NewString.empty())
+    {
+        if (NewString[NewString.size() - 1] == m_tokenizer.Id2Punc(COMMA_INDEX) || NewString[NewString.size() - 1] == m_tokenizer.Id2Punc(DUN_INDEX))
+        {
+            NewSentenceOut.assign(NewString.begin(), NewString.end() - 1);
+            NewSentenceOut.push_back(m_tokenizer.Id2Punc(PERIOD_INDEX));
+        }
+        else if (NewString[NewString.size() - 1] != m_tokenizer.Id2Punc(PERIOD_INDEX) && NewString[NewString.size() - 1] != m_tokenizer.Id2Punc(QUESTION_INDEX))
+        {
+            NewSentenceOut.push_back(m_tokenizer.Id2Punc(PERIOD_INDEX));
         }
     }
 
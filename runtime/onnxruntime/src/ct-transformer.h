@@ -20,6 +20,8 @@ private:
 	vector<const char*> m_szInputNames;
 	vector<const char*> m_szOutputNames;
 
+	void PuncWindow(vector<int> &input_data, vector<string> &str_out, PuncProgress &progress, bool is_last);
+
 	std::shared_ptr<Ort::Session> m_session;
     Ort::Env env_;
     Ort::SessionOptions session_options;
@@ -30,5 +32,7 @@ public:
 	~CTTransformer();
 	vector<int>  Infer(vector<int32_t> input_data);
 	string AddPunc(const char* sz_input, std::string language="zh-cn");
+	void AddPuncPartial(const char* sz_prefix, PuncProgress &progress);
+	string AddPunc(const char* sz_input, std::string language, PuncProgress &progress);
 };
 } // namespace funasr
\ No newline at end of file
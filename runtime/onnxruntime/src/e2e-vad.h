@@ -360,6 +360,32 @@ public:
         return segment_batch;
     }
 
+    // The end in ms OnVoiceEnd will give the current segment if the silence that
+    // has begun lasts until the end point is confirmed, -1 while there is no
+    // such silence or it is shorter than min_silence_ms.
+    int PendingEndMs(int min_silence_ms) {
+        int frm_shift_in_ms = vad_opts.frame_in_ms;
+        if (vad_state_machine != VadStateMachine::kVadInStateInSpeechSegment || continous_silence_frame_count == 0 ||
+            continous_silence_frame_count * frm_shift_in_ms < min_silence_ms) {
+            return -1;
+        }
+        // the frame whose silence count reaches the threshold, and the lookback of DetectOneFrame there
+        int confirm_frame_count = (max_end_sil_frame_cnt_thresh + frm_shift_in_ms - 1) / frm_shift_in_ms;
+        int confirm_frm_idx = frm_cnt - 1 + std::max(0, confirm_frame_count - continous_silence_frame_count);
+        if (confirm_frm_idx - confirmed_start_frame > vad_opts.max_single_segment_time / frm_shift_in_ms) {
+            // the segment is cut at its maximum length first
+            return -1;
+        }
+        int lookback_frame = max_end_sil_frame_cnt_thresh / frm_shift_in_ms;
+        if (vad_opts.do_extend) {
+            lookback_frame -= vad_opts.lookahead_time_end_point / frm_shift_in_ms;
+            lookback_frame -= 1;
+            lookback_frame = std::max(0, lookback_frame);
+        }
+        // PopDataToOutputBuf ends the segment after the end frame
+        return (confirm_frm_idx - lookback_frame + 1) * frm_shift_in_ms;
+    }
+
 private:
     VADXOptions vad_opts;
     WindowDetector windows_detector = WindowDetector(200, 150, 150, 10);
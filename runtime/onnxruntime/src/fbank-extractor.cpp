@@ -0,0 +1,101 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#include "kaldi-native-fbank/csrc/feature-functions.h"
+
+// see kaldi-native-fbank/csrc/fftsg.c
+extern "C" void rdft(int n, int isgn, double *a, int *ip, double *w);
+
+namespace funasr {
+std::shared_ptr<const FbankExtractor> FbankExtractor::Get(const knf::FbankOptions &opts)
+{
+    static std::mutex mtx;
+    static std::map<std::string, std::shared_ptr<const FbankExtractor>> extractors;
+    std::string key = opts.ToString();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto iter = extractors.find(key);
+    if (iter != extractors.end()) {
+        return iter->second;
+    }
+    std::shared_ptr<const FbankExtractor> extractor = std::make_shared<FbankExtractor>(opts);
+    extractors.emplace(key, extractor);
+    return extractor;
+}
+
+FbankExtractor::FbankExtractor(const knf::FbankOptions &opts)
+    : opts_(opts), window_function_(opts.frame_opts)
+{
+    mel_banks_ = std::make_unique<knf::MelBanks>(opts_.mel_opts, opts_.frame_opts, 1.0f);
+    // the fast path covers what the models use, anything else goes through knf
+    int32_t padded = opts_.frame_opts.PaddedWindowSize();
+    fast_path_ = opts_.frame_opts.snip_edges && !opts_.use_energy && padded >= 4 && (padded & (padded - 1)) == 0;
+    if (fast_path_) {
+        // same sizes as knf::Rfft, the first transform fills the tables
+        fft_ip_.assign(2 + std::sqrt(padded / 2), 0);
+        fft_w_.assign(padded / 2, 0);
+        std::vector<double> warm_up(padded, 0);
+        rdft(padded, 1, warm_up.data(), fft_ip_.data(), fft_w_.data());
+    }
+}
+
+void FbankExtractor::Compute(const float *waves, int len, float scale, std::vector<std::vector<float>> &feats) const
+{
+    if (!fast_path_) {
+        ComputeFallback(waves, len, scale, feats);
+        return;
+    }
+    const knf::FrameExtractionOptions &frame_opts = opts_.frame_opts;
+    int32_t frames = knf::NumFrames(len, frame_opts, false);
+    int32_t frame_length = frame_opts.WindowSize();
+    int32_t padded = frame_opts.PaddedWindowSize();
+    int32_t num_bins = opts_.mel_opts.num_bins;
+    std::vector<float> window(padded);
+    std::vector<double> fft(padded);
+    feats.reserve(feats.size() + frames);
+    for (int32_t f = 0; f < frames; f++) {
+        const float *frame = waves + knf::FirstSampleOfFrame(f, frame_opts);
+        for (int32_t s = 0; s < frame_length; s++) {
+            window[s] = frame[s] * scale;
+        }
+        std::fill(window.begin() + frame_length, window.end(), 0);
+        knf::ProcessWindow(frame_opts, window_function_, window.data(), nullptr);
+
+        // the tables are complete, so rdft only reads them
+        std::copy(window.begin(), window.end(), fft.begin());
+        rdft(padded, 1, fft.data(), const_cast<int *>(fft_ip_.data()), const_cast<double *>(fft_w_.data()));
+        std::copy(fft.begin(), fft.end(), window.begin());
+        knf::ComputePowerSpectrum(&window);
+        if (!opts_.use_power) {
+            for (int32_t i = 0; i <= padded / 2; i++) {
+                window[i] = std::sqrt(window[i]);
+            }
+        }
+
+        std::vector<float> feat(num_bins);
+        mel_banks_->Compute(window.data(), feat.data());
+        if (opts_.use_log_fbank) {
+            for (int32_t i = 0; i < num_bins; i++) {
+                feat[i] = std::log(std::max(feat[i], std::numeric_limits<float>::epsilon()));
+            }
+        }
+        feats.emplace_back(std::move(feat));
+    }
+}
+
+void FbankExtractor::ComputeFallback(const float *waves, int len, float scale, std::vector<std::vector<float>> &feats) const
+{
+    knf::OnlineFbank fbank(opts_);
+    std::vector<float> buf(len);
+    for (int32_t i = 0; i != len; ++i) {
+        buf[i] = waves[i] * scale;
+    }
+    fbank.AcceptWaveform(opts_.frame_opts.samp_freq, buf.data(), buf.size());
+    int32_t frames = fbank.NumFramesReady();
+    for (int32_t i = 0; i != frames; ++i) {
+        const float *frame = fbank.GetFrame(i);
+        feats.emplace_back(frame, frame + opts_.mel_opts.num_bins);
+    }
+}
+} // namespace funasr
@@ -0,0 +1,40 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Kaldi fbank of a waveform buffer, with the same output as feeding the buffer
+// to a fresh knf::OnlineFbank. The window, mel banks and FFT tables depend
+// only on the options, so they are built once per option set and shared by
+// every model and stream; a call only does the per-frame FFT and mel work.
+#ifndef FBANK_EXTRACTOR_H
+#define FBANK_EXTRACTOR_H
+#include <memory>
+#include <vector>
+#include "kaldi-native-fbank/csrc/feature-fbank.h"
+#include "kaldi-native-fbank/csrc/feature-window.h"
+#include "kaldi-native-fbank/csrc/mel-computations.h"
+
+namespace funasr {
+class FbankExtractor {
+  public:
+    // the extractor shared by all users of the same options
+    static std::shared_ptr<const FbankExtractor> Get(const knf::FbankOptions &opts);
+
+    explicit FbankExtractor(const knf::FbankOptions &opts);
+    // appends the frames of waves to feats, the samples are multiplied by
+    // scale while they are framed. Thread safe.
+    void Compute(const float *waves, int len, float scale, std::vector<std::vector<float>> &feats) const;
+
+  private:
+    void ComputeFallback(const float *waves, int len, float scale, std::vector<std::vector<float>> &feats) const;
+
+    knf::FbankOptions opts_;
+    knf::FeatureWindowFunction window_function_;
+    std::unique_ptr<knf::MelBanks> mel_banks_;
+    // rdft tables, filled once in the constructor and only read afterwards
+    std::vector<int> fft_ip_;
+    std::vector<double> fft_w_;
+    bool fast_path_ = false;
+};
+} // namespace funasr
+#endif
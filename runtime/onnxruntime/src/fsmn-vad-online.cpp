@@ -10,7 +10,7 @@ namespace funasr {
 
 void FsmnVadOnline::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
                                std::vector<float> &waves) {
-    knf::OnlineFbank fbank(fbank_opts_);
+    StageTimer timer(STAGE_FBANK);
     // cache merge
     waves.insert(waves.begin(), input_cache_.begin(), input_cache_.end());
     int frame_number = ComputeFrameNum(waves.size(), frame_sample_length_, frame_shift_sample_length_);
@@ -23,18 +23,7 @@ void FsmnVadOnline::FbankKaldi(float sample_rate, std::vector<std::vector<float>
     // Delete audio that haven't undergone fbank processing
     waves.erase(waves.begin() + (frame_number - 1) * frame_shift_sample_length_ + frame_sample_length_, waves.end());
 
-    std::vector<float> buf(waves.size());
-    for (int32_t i = 0; i != waves.size(); ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
-    // fbank.AcceptWaveform(sample_rate, &waves[0], waves.size());
-    int32_t frames = fbank.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        vad_feats.emplace_back(frame_vector);
-    }
+    fbank_extractor_->Compute(waves.data(), waves.size(), 32768, vad_feats);
 }
 
 void FsmnVadOnline::ExtractFeats(float sample_rate, vector<std::vector<float>> &vad_feats,
@@ -133,6 +122,7 @@ int FsmnVadOnline::OnlineLfrCmvn(vector<vector<float>> &vad_feats, bool input_fi
 
 std::vector<std::vector<int>>
 FsmnVadOnline::Infer(std::vector<float> &waves, bool input_finished) {
+    StageTimer timer(STAGE_VAD);
     std::vector<std::vector<int>> vad_segments;
     std::vector<std::vector<float>> vad_feats;
     std::vector<std::vector<float>> vad_probs;
@@ -180,6 +170,7 @@ void FsmnVadOnline::InitOnline(std::shared_ptr<Ort::Session> &vad_session,
     vad_in_names_ = vad_in_names;
     vad_out_names_ = vad_out_names;
     fbank_opts_ = fbank_opts;
+    fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
     means_list_ = means_list;
     vars_list_ = vars_list;
     vad_sample_rate_ = vad_sample_rate;
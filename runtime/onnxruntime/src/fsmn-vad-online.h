@@ -22,6 +22,8 @@ public:
     void ExtractFeats(float sample_rate, vector<vector<float>> &vad_feats, vector<float> &waves, bool input_finished);
     void Reset();
     int GetVadSampleRate() { return vad_sample_rate_; };
+    // end in ms of the segment in progress if its silence lasts, see E2EVadModel::PendingEndMs
+    int PendingEndMs(int min_silence_ms) { return vad_scorer.PendingEndMs(min_silence_ms); };
 
     // 2pass
     std::unique_ptr<Audio> audio_handle = nullptr;
@@ -68,6 +70,7 @@ private:
     std::vector<const char *> vad_in_names_;
     std::vector<const char *> vad_out_names_;
     knf::FbankOptions fbank_opts_;
+    std::shared_ptr<const FbankExtractor> fbank_extractor_;
     std::vector<float> means_list_;
     std::vector<float> vars_list_;
 
@@ -8,7 +8,7 @@
 
 namespace funasr {
 void FsmnVad::InitVad(const std::string &vad_model, const std::string &vad_cmvn, const std::string &vad_config, int thread_num) {
-    session_options_.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     session_options_.DisableCpuMemArena();
 
@@ -45,6 +45,7 @@ void FsmnVad::LoadConfigFromYaml(const char* filename){
         fbank_opts_.frame_opts.frame_length_ms = frontend_conf["frame_length"].as<float>();
         fbank_opts_.energy_floor = 0;
         fbank_opts_.mel_opts.debug_mel = false;
+        fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
     }catch(exception const &e){
         LOG(ERROR) << "Error when load argument from vad config YAML.";
         exit(-1);
@@ -131,19 +132,8 @@ void FsmnVad::Forward(
 
 void FsmnVad::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &vad_feats,
                          std::vector<float> &waves) {
-    knf::OnlineFbank fbank(fbank_opts_);
-
-    std::vector<float> buf(waves.size());
-    for (int32_t i = 0; i != waves.size(); ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
-    int32_t frames = fbank.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        vad_feats.emplace_back(frame_vector);
-    }
+    StageTimer timer(STAGE_FBANK);
+    fbank_extractor_->Compute(waves.data(), waves.size(), 32768, vad_feats);
 }
 
 void FsmnVad::LoadCmvn(const char *filename)
@@ -234,6 +224,7 @@ void FsmnVad::LfrCmvn(std::vector<std::vector<float>> &vad_feats) {
 
 std::vector<std::vector<int>>
 FsmnVad::Infer(std::vector<float> &waves, bool input_finished) {
+    StageTimer timer(STAGE_VAD);
     std::vector<std::vector<float>> vad_feats;
     std::vector<std::vector<float>> vad_probs;
     std::vector<std::vector<int>> vad_segments;
@@ -262,6 +253,15 @@ void FsmnVad::Reset(){
   InitCache();
 };
 
+void FsmnVad::SetWindowThreadNum(int thread_num, int window_ms) {
+    window_ms_ = window_ms > 0 ? window_ms : VAD_WINDOW_MS;
+    if (thread_num > 1) {
+        window_pool_ = make_unique<WorkerPool>(thread_num);
+    } else {
+        window_pool_ = nullptr;
+    }
+}
+
 void FsmnVad::Test() {
 }
 
@@ -28,6 +28,13 @@ public:
         std::vector<std::vector<float>> *in_cache,
         bool is_final);
     void Reset();
+    // the online vad segmentation of the offline asr (OfflineVadSegments) runs
+    // audio longer than two windows of window_ms in windows on thread_num
+    // shared workers, 1 keeps the serial pass; Infer is not affected. Call
+    // before the handle is used
+    void SetWindowThreadNum(int thread_num, int window_ms);
+    WorkerPool* GetWindowPool() { return window_pool_.get(); };
+    int GetWindowMs() { return window_ms_; };
 
     int GetVadSampleRate() { return vad_sample_rate_; };
     
@@ -40,6 +47,7 @@ public:
     std::vector<std::vector<float>> in_cache_;
     
     knf::FbankOptions fbank_opts_;
+    std::shared_ptr<const FbankExtractor> fbank_extractor_;
     std::vector<float> means_list_;
     std::vector<float> vars_list_;
 
@@ -51,6 +59,8 @@ public:
     int lfr_n = VAD_LFR_N;
 
 private:
+    std::unique_ptr<WorkerPool> window_pool_ = nullptr;
+    int window_ms_ = VAD_WINDOW_MS;
 
     void ReadModel(const char* vad_model);
     void LoadConfigFromYaml(const char* filename);
@@ -2,6 +2,27 @@
 #include <vector>
 
 
+	// decoded samples of the *InferSamples APIs, converted once on their way into the audio
+	static bool LoadSamples(funasr::Audio &audio, const void* samples, int n_samples, FUNASR_SAMPLE_TYPE sample_type,
+							float scale, int32_t* sampling_rate, bool online)
+	{
+		if (samples == nullptr && n_samples > 0){
+			LOG(ERROR) << "Samples is null";
+			return false;
+		}
+		switch (sample_type){
+			case FUNASR_SAMPLE_INT16:
+				return online ? audio.LoadSamplesOnline((const int16_t*)samples, n_samples, scale, sampling_rate)
+							  : audio.LoadSamples((const int16_t*)samples, n_samples, scale, sampling_rate);
+			case FUNASR_SAMPLE_FLOAT:
+				return online ? audio.LoadSamplesOnline((const float*)samples, n_samples, scale, sampling_rate)
+							  : audio.LoadSamples((const float*)samples, n_samples, scale, sampling_rate);
+			default:
+				LOG(ERROR) << "Wrong sample_type: " << sample_type;
+				return false;
+		}
+	}
+
 	// APIs for Init
 	_FUNASRAPI FUNASR_HANDLE  FunASRInit(std::map<std::string, std::string>& model_path, int thread_num, ASR_TYPE type)
 	{
@@ -39,6 +60,38 @@
 		return mm;
 	}
 
+	_FUNASRAPI void FunOfflineSetSegThreadNum(FUNASR_HANDLE handle, int thread_num)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return;
+		offline_stream->SetSegThreadNum(thread_num);
+	}
+
+	_FUNASRAPI void FunOfflineSetVadThreadNum(FUNASR_HANDLE handle, int thread_num, int window_ms)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream || !offline_stream->UseVad())
+			return;
+		((funasr::FsmnVad*)(offline_stream->vad_handle).get())->SetWindowThreadNum(thread_num, window_ms);
+	}
+
+	_FUNASRAPI bool FunOfflineWarmUp(FUNASR_HANDLE handle, const std::vector<int> &buckets_ms)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return false;
+		return funasr::WarmUpOfflineStream(offline_stream, buckets_ms);
+	}
+
+	_FUNASRAPI void FunOfflineSetResultCache(FUNASR_HANDLE handle, size_t result_bytes, size_t seg_bytes)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return;
+		offline_stream->SetResultCache(result_bytes, seg_bytes);
+	}
+
 	_FUNASRAPI FUNASR_HANDLE  FunTpassInit(std::map<std::string, std::string>& model_path, int thread_num)
 	{
 		funasr::TpassStream* mm = funasr::CreateTpassStream(model_path, thread_num);
@@ -50,6 +103,63 @@
 		return funasr::CreateTpassOnlineStream(tpass_handle, chunk_size);
 	}
 
+	_FUNASRAPI bool FunTpassOnlineSetChunkSize(FUNASR_HANDLE online_handle, const std::vector<int> &chunk_size)
+	{
+		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
+		if (!tpass_online_stream || !tpass_online_stream->asr_online_handle)
+			return false;
+		// the online queue is drained by every call, so this falls on a chunk boundary
+		return ((funasr::ParaformerOnline*)(tpass_online_stream->asr_online_handle).get())->SetChunkSize(chunk_size);
+	}
+
+	_FUNASRAPI void FunTpassOnlineSetMaxLookback(FUNASR_HANDLE online_handle, int max_lookback)
+	{
+		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
+		if (!tpass_online_stream || !tpass_online_stream->asr_online_handle)
+			return;
+		((funasr::ParaformerOnline*)(tpass_online_stream->asr_online_handle).get())->SetMaxLookback(max_lookback);
+	}
+
+	_FUNASRAPI void FunTpassSetOfflineThreadNum(FUNASR_HANDLE tpass_handle, int thread_num)
+	{
+		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)tpass_handle;
+		if (!tpass_stream)
+			return;
+		tpass_stream->SetOfflineThreadNum(thread_num);
+	}
+
+	_FUNASRAPI void FunTpassSetSpeculation(FUNASR_HANDLE tpass_handle, int silence_ms)
+	{
+		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)tpass_handle;
+		if (!tpass_stream)
+			return;
+		tpass_stream->SetSpeculateMs(std::max(0, silence_ms));
+	}
+
+	_FUNASRAPI bool FunTpassWarmUp(FUNASR_HANDLE handle, const std::vector<int> &buckets_ms,
+								   const std::vector<std::vector<int>> &chunk_sizes)
+	{
+		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
+		if (!tpass_stream)
+			return false;
+		return funasr::WarmUpTpassStream(tpass_stream, buckets_ms, chunk_sizes);
+	}
+
+	_FUNASRAPI bool FunTpassOnlineSetOfflineCallback(FUNASR_HANDLE online_handle, TPASS_OFFLINE_CALLBACK callback)
+	{
+		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
+		if (!tpass_online_stream)
+			return false;
+		if (!tpass_online_stream->offline_strand) {
+			LOG(ERROR) << "The tpass handle has no offline threads, call FunTpassSetOfflineThreadNum before FunTpassOnlineInit";
+			return false;
+		}
+		// queued segments may still call the previous one
+		tpass_online_stream->offline_strand->Wait();
+		tpass_online_stream->offline_callback = callback;
+		return true;
+	}
+
 	// APIs for ASR Infer
 	_FUNASRAPI FUNASR_RESULT FunASRInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, FUNASR_MODE mode, QM_CALLBACK fn_callback, bool input_finished, int sampling_rate, std::string wav_format)
 	{
@@ -117,6 +227,22 @@
 	}
 
 	// APIs for VAD Infer
+	static FUNASR_RESULT FsmnVadInferAudio(funasr::VadModel* vad_obj, funasr::Audio &audio, bool input_finished)
+	{
+		funasr::FUNASR_VAD_RESULT* p_result = new funasr::FUNASR_VAD_RESULT;
+		p_result->snippet_time = audio.GetTimeLen();
+		if(p_result->snippet_time == 0){
+			p_result->segments = new vector<std::vector<int>>();
+            return p_result;
+        }
+		
+		vector<std::vector<int>> vad_segments;
+		audio.Split(vad_obj, vad_segments, input_finished);
+		p_result->segments = new vector<std::vector<int>>(vad_segments);
+
+		return p_result;
+	}
+
 	_FUNASRAPI FUNASR_RESULT FsmnVadInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, QM_CALLBACK fn_callback, bool input_finished, int sampling_rate, std::string wav_format)
 	{
 		funasr::VadModel* vad_obj = (funasr::VadModel*)handle;
@@ -131,19 +257,20 @@
 			if (!audio.FfmpegLoad(sz_buf, n_len))
 				return nullptr;
 		}
+		return FsmnVadInferAudio(vad_obj, audio, input_finished);
+	}
 
-		funasr::FUNASR_VAD_RESULT* p_result = new funasr::FUNASR_VAD_RESULT;
-		p_result->snippet_time = audio.GetTimeLen();
-		if(p_result->snippet_time == 0){
-			p_result->segments = new vector<std::vector<int>>();
-            return p_result;
-        }
-		
-		vector<std::vector<int>> vad_segments;
-		audio.Split(vad_obj, vad_segments, input_finished);
-		p_result->segments = new vector<std::vector<int>>(vad_segments);
+	_FUNASRAPI FUNASR_RESULT FsmnVadInferSamples(FUNASR_HANDLE handle, const void* samples, int n_samples, FUNASR_SAMPLE_TYPE sample_type, float scale,
+												 QM_CALLBACK fn_callback, bool input_finished, int sampling_rate)
+	{
+		funasr::VadModel* vad_obj = (funasr::VadModel*)handle;
+		if (!vad_obj)
+			return nullptr;
 
-		return p_result;
+		funasr::Audio audio(vad_obj->GetVadSampleRate(),1);
+		if (!LoadSamples(audio, samples, n_samples, sample_type, scale, &sampling_rate, false))
+			return nullptr;
+		return FsmnVadInferAudio(vad_obj, audio, input_finished);
 	}
 
 	_FUNASRAPI FUNASR_RESULT FsmnVadInfer(FUNASR_HANDLE handle, const char* sz_filename, QM_CALLBACK fn_callback, int sampling_rate)
@@ -204,69 +331,26 @@
 		return p_result;
 	}
 
-	// APIs for Offline-stream Infer
-	_FUNASRAPI FUNASR_RESULT FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
-												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
-												   int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
-												   std::string svs_lang, bool svs_itn)
+	// decodes the vad segments one batch after another on the calling thread
+	static void FunOfflineDecode(funasr::OfflineStream* offline_stream, funasr::Audio &audio, std::vector<int> &index_vector,
+								 const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle, bool use_svs,
+								 std::string &svs_lang, bool svs_itn, std::vector<funasr::FUNASR_SEG_RESULT> &segs,
+								 std::vector<float> &msg_stimes)
 	{
-		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
-		if (!offline_stream)
-			return nullptr;
-
-		funasr::Audio audio(offline_stream->asr_handle->GetAsrSampleRate(),1);
-		try{
-			if(wav_format == "pcm" || wav_format == "PCM"){
-				if (!audio.LoadPcmwav(sz_buf, n_len, &sampling_rate))
-					return nullptr;
-			}else{
-				if (!audio.FfmpegLoad(sz_buf, n_len))
-					return nullptr;
-			}
-		}catch (std::exception const &e)
-		{
-			LOG(ERROR)<<e.what();
-			return nullptr;
-		}
-
-		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
-		p_result->snippet_time = audio.GetTimeLen();
-		if(p_result->snippet_time == 0){
-            return p_result;
-        }
-		std::vector<int> index_vector={0};
-		int msg_idx = 0;
-		if(offline_stream->UseVad()){
-			audio.CutSplit(offline_stream, index_vector);
-		}
-		std::vector<string> msgs(index_vector.size());
-		std::vector<float> msg_stimes(index_vector.size());
-
 		float** buff;
 		int* len;
 		int* flag;
 		float* start_time;
 		int batch_size = offline_stream->asr_handle->GetBatchSize();
 		int batch_in = 0;
+		int msg_idx = 0;
 
-		std::string cur_stamp = "[";
-		std::string lang = (offline_stream->asr_handle)->GetLang();
 		while (audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
-			// dec reset
-			funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
-			if (wfst_decoder){
-				wfst_decoder->StartUtterance();
-			}
-			vector<string> msg_batch;
-			if(offline_stream->GetModelType() == MODEL_SVS){
-				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, svs_lang, svs_itn, batch_in);
-			}else{
-				msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in);
-			}
+			vector<funasr::FUNASR_SEG_RESULT> seg_batch;
+			offline_stream->Forward(buff, len, batch_in, hw_emb, dec_handle, use_svs, svs_lang, svs_itn, seg_batch);
 			for(int idx=0; idx<batch_in; idx++){
-				string msg = msg_batch[idx];
-				if(msg_idx < index_vector.size()){
-					msgs[index_vector[msg_idx]] = msg;
+				if(msg_idx < (int)index_vector.size()){
+					segs[index_vector[msg_idx]] = std::move(seg_batch[idx]);
 					msg_stimes[index_vector[msg_idx]] = start_time[idx];
 					msg_idx++;
 				}else{
@@ -284,72 +368,191 @@
 			delete[] start_time;
 			start_time = nullptr;
 		}
-		for(int idx=0; idx<msgs.size(); idx++){
-			string msg = msgs[idx];
-			std::vector<std::string> msg_vec = funasr::SplitStr(msg, " | ");
-			if(msg_vec.size()==0){
-				continue;
-			}
-			if(lang == "en-bpe" && p_result->msg != ""){
-				p_result->msg += " ";
+	}
+
+	// decodes the vad segments on the stream's segment pool. Every lane takes the
+	// next segment in audio order and owns a wfst decoder; meanwhile the calling
+	// thread punctuates the finished prefix of the text.
+	static void FunOfflineDecodeParallel(funasr::OfflineStream* offline_stream, funasr::Audio &audio, std::vector<int> &index_vector,
+										 const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle, bool use_svs,
+										 std::string &svs_lang, bool svs_itn, std::vector<funasr::FUNASR_SEG_RESULT> &segs,
+										 std::vector<float> &msg_stimes, funasr::PuncProgress &punc_progress)
+	{
+		int seg_num = index_vector.size();
+		std::vector<float*> seg_data(seg_num, nullptr);
+		std::vector<int> seg_len(seg_num, 0);
+		float* data;
+		int len;
+		int flag;
+		float start_time;
+		int msg_idx = 0;
+		while (audio.Fetch(data, len, flag, start_time) > 0) {
+			if(msg_idx < seg_num){
+				seg_data[index_vector[msg_idx]] = data;
+				seg_len[index_vector[msg_idx]] = len;
+				msg_stimes[index_vector[msg_idx]] = start_time;
+				msg_idx++;
+			}else{
+				LOG(ERROR) << "msg_idx: " << msg_idx <<" is out of range " << seg_num;
 			}
-			p_result->msg += msg_vec[0];
-			//timestamp
-			if(msg_vec.size() > 1){
-				std::vector<std::string> msg_stamp = funasr::split(msg_vec[1], ',');
-				if (msg_stamp.size() > 1) {
-					for(int i=0; i<msg_stamp.size()-1; i+=2){
-						float begin = std::stof(msg_stamp[i])+msg_stimes[idx];
-						float end = std::stof(msg_stamp[i+1])+msg_stimes[idx];
-						cur_stamp += "["+std::to_string((int)(1000*begin))+","+std::to_string((int)(1000*end))+"],";
+		}
+
+		funasr::WorkerPool* pool = offline_stream->GetSegPool();
+		funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
+		int lane_num = std::min(pool->Size(), seg_num);
+		int lanes_left = lane_num;
+		std::atomic<int> next_seg(0);
+		std::vector<char> seg_done(seg_num, 0);
+		std::mutex mtx;
+		std::condition_variable cv;
+		for (int lane = 0; lane < lane_num; lane++) {
+			pool->Submit([&, lane]() {
+				{
+					std::unique_ptr<funasr::WfstDecoder, void(*)(funasr::WfstDecoder*)> lane_decoder(nullptr, funasr::WfstDecoder::Release);
+					if (wfst_decoder && lane > 0) {
+						lane_decoder.reset(wfst_decoder->Clone());
+					}
+					FUNASR_DEC_HANDLE lane_handle = lane > 0 ? (FUNASR_DEC_HANDLE)lane_decoder.get() : dec_handle;
+					int idx;
+					while ((idx = next_seg.fetch_add(1)) < seg_num) {
+						vector<funasr::FUNASR_SEG_RESULT> seg_batch;
+						if (seg_data[idx] != nullptr) {
+							try{
+								float* buff[1] = {seg_data[idx]};
+								int buff_len[1] = {seg_len[idx]};
+								offline_stream->Forward(buff, buff_len, 1, hw_emb, lane_handle, use_svs, svs_lang, svs_itn, seg_batch);
+							}catch (std::exception const &e)
+							{
+								LOG(ERROR)<<e.what();
+							}
+						}
+						std::lock_guard<std::mutex> lock(mtx);
+						if (seg_batch.size() > 0) {
+							segs[idx] = std::move(seg_batch[0]);
+						}
+						seg_done[idx] = 1;
+						cv.notify_all();
 					}
 				}
+				std::lock_guard<std::mutex> lock(mtx);
+				lanes_left--;
+				cv.notify_all();
+			});
+		}
+
+		// feed the punctuation with the text finished so far, joined as in OfflineStream::Assemble
+		bool use_punc = offline_stream->UsePunc();
+		std::string lang = (offline_stream->asr_handle)->GetLang();
+		std::string prefix;
+		size_t punc_len = 0;
+		int ready = 0;
+		std::unique_lock<std::mutex> lock(mtx);
+		while (lanes_left > 0) {
+			cv.wait(lock, [&] { return lanes_left == 0 || (ready < seg_num && seg_done[ready]); });
+			while (ready < seg_num && seg_done[ready]) {
+				if(lang == "en-bpe" && prefix != ""){
+					prefix += " ";
+				}
+				prefix += segs[ready].text;
+				ready++;
+			}
+			// tokenizing the prefix again is cheap but not free, so wait for some new text
+			if (use_punc && ready < seg_num && prefix.size() >= punc_len + 1024) {
+				punc_len = prefix.size();
+				lock.unlock();
+				offline_stream->punc_handle->AddPuncPartial(prefix.c_str(), punc_progress);
+				lock.lock();
 			}
 		}
-		if(cur_stamp != "["){
-			cur_stamp.erase(cur_stamp.length() - 1);
-			p_result->stamp += cur_stamp + "]";
+	}
+
+	// decodes the audio loaded by one of the offline APIs, use_svs passes the sensevoice options
+	static FUNASR_RESULT FunOfflineInferAudio(funasr::OfflineStream* offline_stream, funasr::Audio &audio,
+											  const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+											  bool use_svs, std::string &svs_lang, bool svs_itn)
+	{
+		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
+		p_result->snippet_time = audio.GetTimeLen();
+		funasr::MetricsCount(funasr::COUNTER_OFFLINE_REQUESTS);
+		funasr::MetricsCount(funasr::COUNTER_AUDIO_MS, (int64_t)(p_result->snippet_time * 1000));
+		if(p_result->snippet_time == 0){
+            return p_result;
+        }
+		std::vector<int> index_vector={0};
+		if(offline_stream->UseVad()){
+			audio.CutSplit(offline_stream, index_vector);
 		}
-		if(offline_stream->UsePunc()){
-			string punc_res = (offline_stream->punc_handle)->AddPunc((p_result->msg).c_str(), lang);
-			p_result->msg = punc_res;
+		funasr::MetricsCount(funasr::COUNTER_VAD_SEGMENTS, index_vector.size());
+		std::vector<funasr::FUNASR_SEG_RESULT> segs(index_vector.size());
+		std::vector<float> msg_stimes(index_vector.size());
+
+		funasr::PuncProgress punc_progress;
+		if(offline_stream->GetSegPool() != nullptr && offline_stream->asr_handle->GetBatchSize() <= 1 && index_vector.size() > 1){
+			FunOfflineDecodeParallel(offline_stream, audio, index_vector, hw_emb, dec_handle, use_svs, svs_lang, svs_itn,
+									 segs, msg_stimes, punc_progress);
+		}else{
+			FunOfflineDecode(offline_stream, audio, index_vector, hw_emb, dec_handle, use_svs, svs_lang, svs_itn, segs, msg_stimes);
 		}
-#if !defined(__APPLE__)
-		if(offline_stream->UseITN() && itn){
-			string msg_itn = offline_stream->itn_handle->Normalize(p_result->msg);
-			if(!(p_result->stamp).empty()){
-				std::string new_stamp = funasr::TimestampSmooth(p_result->msg, msg_itn, p_result->stamp);
-				if(!new_stamp.empty()){
-					p_result->stamp = new_stamp;
-				}
-			}			
-			p_result->msg = msg_itn;
+		offline_stream->Assemble(segs, msg_stimes, itn, p_result, punc_progress);
+		return p_result;
+	}
+
+	// a copy of the cached result of the same input and options, or nullptr; cache_key is set
+	// for FunOfflineCacheStore whenever the result cache is on
+	static funasr::FUNASR_RECOG_RESULT* FunOfflineCacheLookup(funasr::OfflineStream* offline_stream, const char* buf, int n_len,
+															  const std::string &format, int sampling_rate,
+															  const std::vector<std::vector<float>> &hw_emb, bool itn,
+															  FUNASR_DEC_HANDLE dec_handle, const std::string &svs_lang, bool svs_itn,
+															  std::string &cache_key)
+	{
+		funasr::ResultCache* cache = offline_stream->GetResultCache();
+		if (cache == nullptr || !cache->UseResults() || n_len <= 0) {
+			return nullptr;
 		}
-#endif
-		if (!(p_result->stamp).empty()){
-			p_result->stamp_sents = funasr::TimestampSentence(p_result->msg, p_result->stamp);
+		funasr::CacheKey key;
+		key.AddHash(buf, n_len).AddString(format).Add(sampling_rate).Add(itn);
+		funasr::OfflineStream::AddDecodeOptions(key, hw_emb, dec_handle, offline_stream->GetModelType() == MODEL_SVS, svs_lang, svs_itn);
+		cache_key = key.Str();
+		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
+		if (!cache->GetResult(cache_key, *p_result)) {
+			delete p_result;
+			return nullptr;
 		}
 		return p_result;
 	}
 
-	_FUNASRAPI FUNASR_RESULT FunOfflineInfer(FUNASR_HANDLE handle, const char* sz_filename, FUNASR_MODE mode, QM_CALLBACK fn_callback, 
-											 const std::vector<std::vector<float>> &hw_emb, int sampling_rate, bool itn, FUNASR_DEC_HANDLE dec_handle)
+	static void FunOfflineCacheStore(funasr::OfflineStream* offline_stream, const std::string &cache_key, FUNASR_RESULT result)
+	{
+		funasr::ResultCache* cache = offline_stream->GetResultCache();
+		if (cache == nullptr || cache_key.empty() || result == nullptr) {
+			return;
+		}
+		cache->PutResult(cache_key, *(funasr::FUNASR_RECOG_RESULT*)result);
+	}
+
+	// APIs for Offline-stream Infer
+	_FUNASRAPI FUNASR_RESULT FunOfflineInferBuffer(FUNASR_HANDLE handle, const char* sz_buf, int n_len, 
+												   FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb, 
+												   int sampling_rate, std::string wav_format, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												   std::string svs_lang, bool svs_itn)
 	{
 		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
 		if (!offline_stream)
 			return nullptr;
-		
-		funasr::Audio audio((offline_stream->asr_handle)->GetAsrSampleRate(),1);
+
+		std::string cache_key;
+		funasr::FUNASR_RECOG_RESULT* p_result = FunOfflineCacheLookup(offline_stream, sz_buf, n_len, wav_format, sampling_rate,
+																	  hw_emb, itn, dec_handle, svs_lang, svs_itn, cache_key);
+		if (p_result)
+			return p_result;
+
+		funasr::Audio audio(offline_stream->asr_handle->GetAsrSampleRate(),1);
 		try{
-			if(funasr::is_target_file(sz_filename, "wav")){
-				int32_t sampling_rate_ = -1;
-				if(!audio.LoadWav(sz_filename, &sampling_rate_))
-					return nullptr;
-			}else if(funasr::is_target_file(sz_filename, "pcm")){
-				if (!audio.LoadPcmwav(sz_filename, &sampling_rate))
+			if(wav_format == "pcm" || wav_format == "PCM"){
+				if (!audio.LoadPcmwav(sz_buf, n_len, &sampling_rate))
 					return nullptr;
 			}else{
-				if (!audio.FfmpegLoad(sz_filename))
+				if (!audio.FfmpegLoad(sz_buf, n_len))
 					return nullptr;
 			}
 		}catch (std::exception const &e)
@@ -357,101 +560,170 @@
 			LOG(ERROR)<<e.what();
 			return nullptr;
 		}
-		
-		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
-		p_result->snippet_time = audio.GetTimeLen();
-		if(p_result->snippet_time == 0){
-            return p_result;
-        }
-		std::vector<int> index_vector={0};
-		int msg_idx = 0;
-		if(offline_stream->UseVad()){
-			audio.CutSplit(offline_stream, index_vector);
-		}
-		std::vector<string> msgs(index_vector.size());
-		std::vector<float> msg_stimes(index_vector.size());
 
-		float** buff;
-		int* len;
-		int* flag;
-		float* start_time;
-		int batch_size = offline_stream->asr_handle->GetBatchSize();
-		int batch_in = 0;
+		FUNASR_RESULT result = FunOfflineInferAudio(offline_stream, audio, hw_emb, itn, dec_handle,
+													 offline_stream->GetModelType() == MODEL_SVS, svs_lang, svs_itn);
+		FunOfflineCacheStore(offline_stream, cache_key, result);
+		return result;
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunOfflineInferSamples(FUNASR_HANDLE handle, const void* samples, int n_samples, FUNASR_SAMPLE_TYPE sample_type, float scale,
+													FUNASR_MODE mode, QM_CALLBACK fn_callback, const std::vector<std::vector<float>> &hw_emb,
+													int sampling_rate, bool itn, FUNASR_DEC_HANDLE dec_handle, std::string svs_lang, bool svs_itn)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return nullptr;
+
+		std::string cache_key;
+		int sample_size = (sample_type == FUNASR_SAMPLE_INT16) ? sizeof(int16_t) : sizeof(float);
+		std::string format = (sample_type == FUNASR_SAMPLE_INT16 ? "int16:" : "float:") + std::to_string(scale);
+		funasr::FUNASR_RECOG_RESULT* p_result = FunOfflineCacheLookup(offline_stream, (const char*)samples, n_samples * sample_size, format,
+																	  sampling_rate, hw_emb, itn, dec_handle, svs_lang, svs_itn, cache_key);
+		if (p_result)
+			return p_result;
+
+		funasr::Audio audio(offline_stream->asr_handle->GetAsrSampleRate(),1);
+		try{
+			if (!LoadSamples(audio, samples, n_samples, sample_type, scale, &sampling_rate, false))
+				return nullptr;
+		}catch (std::exception const &e)
+		{
+			LOG(ERROR)<<e.what();
+			return nullptr;
+		}
+		FUNASR_RESULT result = FunOfflineInferAudio(offline_stream, audio, hw_emb, itn, dec_handle,
+													 offline_stream->GetModelType() == MODEL_SVS, svs_lang, svs_itn);
+		FunOfflineCacheStore(offline_stream, cache_key, result);
+		return result;
+	}
 
-		std::string cur_stamp = "[";
+	// decodes the segments the vad has closed so far, input_finished decodes the tail as well
+	static void FunProgressiveDecode(funasr::ProgressiveStream* progressive_stream, bool input_finished,
+									 const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle,
+									 std::string &svs_lang, bool svs_itn)
+	{
+		funasr::OfflineStream* offline_stream = progressive_stream->offline_stream;
+		std::vector<std::vector<int>> segments;
+		progressive_stream->Split(input_finished, segments);
+		bool use_svs = offline_stream->GetModelType() == MODEL_SVS;
 		std::string lang = (offline_stream->asr_handle)->GetLang();
-		while (audio.FetchDynamic(buff, len, flag, start_time, batch_size, batch_in) > 0) {
-			// dec reset
-			funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
-			if (wfst_decoder){
-				wfst_decoder->StartUtterance();
+		int sample_rate = offline_stream->asr_handle->GetAsrSampleRate();
+		for (auto &segment : segments) {
+			float* buff[1] = {(float*)progressive_stream->GetSpeechData() + segment[0]};
+			int len[1] = {segment[1] - segment[0]};
+			vector<funasr::FUNASR_SEG_RESULT> seg_batch;
+			try{
+				offline_stream->Forward(buff, len, 1, hw_emb, dec_handle, use_svs, svs_lang, svs_itn, seg_batch);
+			}catch (std::exception const &e)
+			{
+				LOG(ERROR)<<e.what();
 			}
-			vector<string> msg_batch = (offline_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, batch_in);
-			for(int idx=0; idx<batch_in; idx++){
-				string msg = msg_batch[idx];
-				if(msg_idx < index_vector.size()){
-					msgs[index_vector[msg_idx]] = msg;
-					msg_stimes[index_vector[msg_idx]] = start_time[idx];
-					msg_idx++;
-				}else{
-					LOG(ERROR) << "msg_idx: " << msg_idx <<" is out of range " << index_vector.size();
-				}				
+			progressive_stream->segs.emplace_back(seg_batch.size() > 0 ? std::move(seg_batch[0]) : funasr::FUNASR_SEG_RESULT());
+			progressive_stream->seg_stimes.push_back((float)segment[0] / sample_rate);
+			if(lang == "en-bpe" && progressive_stream->prefix != ""){
+				progressive_stream->prefix += " ";
 			}
+			progressive_stream->prefix += progressive_stream->segs.back().text;
+		}
+		// punctuate the settled text while the rest is still uploading, as FunOfflineDecodeParallel does
+		if (!input_finished && offline_stream->UsePunc() && progressive_stream->prefix.size() >= progressive_stream->punc_len + 1024) {
+			progressive_stream->punc_len = progressive_stream->prefix.size();
+			offline_stream->punc_handle->AddPuncPartial(progressive_stream->prefix.c_str(), progressive_stream->punc_progress);
+		}
+	}
+
+	// APIs for progressive Offline-stream Infer
+	_FUNASRAPI FUNASR_HANDLE FunOfflineProgressiveInit(FUNASR_HANDLE handle, int sampling_rate)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return nullptr;
+		return new funasr::ProgressiveStream(offline_stream, sampling_rate);
+	}
+
+	_FUNASRAPI bool FunOfflineProgressiveFeed(FUNASR_HANDLE progressive_handle, const char* sz_buf, int n_len,
+											  const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle,
+											  std::string svs_lang, bool svs_itn)
+	{
+		funasr::ProgressiveStream* progressive_stream = (funasr::ProgressiveStream*)progressive_handle;
+		if (!progressive_stream)
+			return false;
+		if (!progressive_stream->AcceptPcm(sz_buf, n_len))
+			return false;
+		FunProgressiveDecode(progressive_stream, false, hw_emb, dec_handle, svs_lang, svs_itn);
+		return true;
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunOfflineProgressiveFinish(FUNASR_HANDLE progressive_handle, const std::vector<std::vector<float>> &hw_emb,
+														 bool itn, FUNASR_DEC_HANDLE dec_handle, std::string svs_lang, bool svs_itn)
+	{
+		funasr::ProgressiveStream* progressive_stream = (funasr::ProgressiveStream*)progressive_handle;
+		if (!progressive_stream)
+			return nullptr;
+		FunProgressiveDecode(progressive_stream, true, hw_emb, dec_handle, svs_lang, svs_itn);
+
+		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
+		p_result->snippet_time = progressive_stream->GetTimeLen();
+		funasr::MetricsCount(funasr::COUNTER_OFFLINE_REQUESTS);
+		funasr::MetricsCount(funasr::COUNTER_AUDIO_MS, (int64_t)(p_result->snippet_time * 1000));
+		if(p_result->snippet_time == 0){
+            return p_result;
+        }
+		funasr::MetricsCount(funasr::COUNTER_VAD_SEGMENTS, progressive_stream->segs.size());
+		progressive_stream->offline_stream->Assemble(progressive_stream->segs, progressive_stream->seg_stimes, itn, p_result,
+													 progressive_stream->punc_progress);
+		return p_result;
+	}
+
+	_FUNASRAPI void FunOfflineProgressiveUninit(FUNASR_HANDLE progressive_handle)
+	{
+		funasr::ProgressiveStream* progressive_stream = (funasr::ProgressiveStream*)progressive_handle;
+		if (!progressive_stream)
+			return;
+		delete progressive_stream;
+	}
 
-			// release
-			delete[] buff;
-			buff = nullptr;
-			delete[] len;
-			len = nullptr;
-			delete[] flag;
-			flag = nullptr;
-			delete[] start_time;
-			start_time = nullptr;
-		}
-		for(int idx=0; idx<msgs.size(); idx++){
-			string msg = msgs[idx];
-			std::vector<std::string> msg_vec = funasr::SplitStr(msg, " | ");
-			if(msg_vec.size()==0){
-				continue;
-			}
-			if(lang == "en-bpe" && p_result->msg != ""){
-				p_result->msg += " ";
-			}
-			p_result->msg += msg_vec[0];
-			//timestamp
-			if(msg_vec.size() > 1){
-				std::vector<std::string> msg_stamp = funasr::split(msg_vec[1], ',');
-				for(int i=0; i<msg_stamp.size()-1; i+=2){
-					float begin = std::stof(msg_stamp[i])+msg_stimes[idx];
-					float end = std::stof(msg_stamp[i+1])+msg_stimes[idx];
-					cur_stamp += "["+std::to_string((int)(1000*begin))+","+std::to_string((int)(1000*end))+"],";
-				}
-			}
-		}
-		if(cur_stamp != "["){
-			cur_stamp.erase(cur_stamp.length() - 1);
-			p_result->stamp += cur_stamp + "]";
-		}
-		if(offline_stream->UsePunc()){
-			string punc_res = (offline_stream->punc_handle)->AddPunc((p_result->msg).c_str(), lang);
-			p_result->msg = punc_res;
-		}
-#if !defined(__APPLE__)
-		if(offline_stream->UseITN() && itn){
-			string msg_itn = offline_stream->itn_handle->Normalize(p_result->msg);
-			if(!(p_result->stamp).empty()){
-				std::string new_stamp = funasr::TimestampSmooth(p_result->msg, msg_itn, p_result->stamp);
-				if(!new_stamp.empty()){
-					p_result->stamp = new_stamp;
-				}
+	_FUNASRAPI bool FunOfflineBatch(FUNASR_HANDLE handle, const char* wav_scp, const char* output, const char* checkpoint,
+									const FUNASR_BATCH_CONF &conf, FUNASR_BATCH_STATS* stats,
+									const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream || !wav_scp || !output)
+			return false;
+		funasr::BatchEngine engine(offline_stream, conf, hw_emb, dec_handle);
+		return engine.Run(wav_scp, output, checkpoint ? checkpoint : "", stats);
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunOfflineInfer(FUNASR_HANDLE handle, const char* sz_filename, FUNASR_MODE mode, QM_CALLBACK fn_callback, 
+											 const std::vector<std::vector<float>> &hw_emb, int sampling_rate, bool itn, FUNASR_DEC_HANDLE dec_handle)
+	{
+		funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+		if (!offline_stream)
+			return nullptr;
+		
+		funasr::Audio audio((offline_stream->asr_handle)->GetAsrSampleRate(),1);
+		try{
+			if(funasr::is_target_file(sz_filename, "wav")){
+				int32_t sampling_rate_ = -1;
+				if(!audio.LoadWav(sz_filename, &sampling_rate_))
+					return nullptr;
+			}else if(funasr::is_target_file(sz_filename, "pcm")){
+				if (!audio.LoadPcmwav(sz_filename, &sampling_rate))
+					return nullptr;
+			}else{
+				if (!audio.FfmpegLoad(sz_filename))
+					return nullptr;
 			}
-			p_result->msg = msg_itn;
-		}
-#endif
-		if (!(p_result->stamp).empty()){
-			p_result->stamp_sents = funasr::TimestampSentence(p_result->msg, p_result->stamp);
+		}catch (std::exception const &e)
+		{
+			LOG(ERROR)<<e.what();
+			return nullptr;
 		}
-		return p_result;
+		
+		// file requests never carry sensevoice options
+		std::string svs_lang = "auto";
+		return FunOfflineInferAudio(offline_stream, audio, hw_emb, itn, dec_handle, false, svs_lang, false);
 	}
 
 //#if !defined(__APPLE__)
@@ -481,11 +753,127 @@
 //#endif
 
 	// APIs for 2pass-stream Infer
-	_FUNASRAPI FUNASR_RESULT FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
-												 int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
-												 int sampling_rate, std::string wav_format, ASR_TYPE mode, 
-												 const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
-												 std::string svs_lang, bool svs_itn)
+	// the audio of the online stream, nullptr if one of the models is missing
+	static funasr::Audio* FunTpassAudio(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle)
+	{
+		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
+		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
+		if (!tpass_stream || !tpass_online_stream)
+			return nullptr;
+		if (!tpass_stream->asr_handle || !tpass_stream->punc_online_handle || !tpass_online_stream->asr_online_handle
+			|| !tpass_online_stream->vad_online_handle)
+			return nullptr;
+		return ((funasr::FsmnVadOnline*)(tpass_online_stream->vad_online_handle).get())->audio_handle.get();
+	}
+
+	// runs the chunk just appended to the audio of the online stream through both passes
+	// the offline model over one segment, stamps relative to the segment
+	static funasr::FUNASR_SEG_RESULT FunTpassForwardSegment(funasr::TpassStream* tpass_stream, funasr::AudioFrame* frame,
+															const std::vector<std::vector<float>> &hw_emb, FUNASR_DEC_HANDLE dec_handle,
+															const std::string &svs_lang, bool svs_itn)
+	{
+		// dec reset
+		funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
+		if (wfst_decoder){
+			wfst_decoder->StartUtterance();
+		}
+		float* buff[1] = {frame->data};
+		int len[1] = {frame->len};
+		funasr::FUNASR_SEG_RESULT seg;
+		if(tpass_stream->GetModelType() == MODEL_SVS){
+			vector<string> msgs = (tpass_stream->asr_handle)->Forward(buff, len, true, svs_lang, svs_itn, 1);
+			funasr::ParseSegResult(msgs.size()>0?msgs[0]:"", seg);
+		}else{
+			vector<funasr::FUNASR_SEG_RESULT> segs = (tpass_stream->asr_handle)->ForwardSegs(buff, len, true, hw_emb, dec_handle, 1);
+			if(segs.size()>0){
+				seg = std::move(segs[0]);
+			}
+		}
+		return seg;
+	}
+
+	// decodes a segment the vad is expected to close, unless the online lane has given it up meanwhile
+	static void FunTpassSpeculate(funasr::TpassStream* tpass_stream, funasr::TpassOnlineStream* tpass_online_stream,
+								  funasr::AudioFrame* frame, const std::vector<std::vector<float>> &hw_emb,
+								  FUNASR_DEC_HANDLE dec_handle, const std::string &svs_lang, bool svs_itn)
+	{
+		{
+			std::lock_guard<std::mutex> lock(tpass_online_stream->spec_mtx);
+			if(frame->global_start != tpass_online_stream->spec_start || frame->global_end != tpass_online_stream->spec_end){
+				return;
+			}
+		}
+		funasr::FUNASR_SEG_RESULT seg = FunTpassForwardSegment(tpass_stream, frame, hw_emb, dec_handle, svs_lang, svs_itn);
+		if(tpass_online_stream->spec_result_start != -1){
+			funasr::MetricsCount(funasr::COUNTER_TPASS_SPEC_MISSES);
+		}
+		tpass_online_stream->spec_result_start = frame->global_start;
+		tpass_online_stream->spec_result_end = frame->global_end;
+		tpass_online_stream->spec_result = std::move(seg);
+	}
+
+	// the offline pass over one segment closed by the vad, timestamps are global
+	static void FunTpassOfflineSegment(funasr::TpassStream* tpass_stream, funasr::TpassOnlineStream* tpass_online_stream,
+									   funasr::AudioFrame* frame, std::vector<std::string> &punc_cache,
+									   bool input_finished, const std::vector<std::vector<float>> &hw_emb, bool itn,
+									   FUNASR_DEC_HANDLE dec_handle, const std::string &svs_lang, bool svs_itn,
+									   funasr::FUNASR_RECOG_RESULT* p_result)
+	{
+		funasr::MetricsCount(funasr::COUNTER_TPASS_SEGMENTS);
+		funasr::FUNASR_SEG_RESULT seg;
+		bool spec_hit = false;
+		if(tpass_online_stream->spec_result_start != -1){
+			// the speculation decoded the same samples if the span is the same
+			spec_hit = (tpass_online_stream->spec_result_start == frame->global_start &&
+						tpass_online_stream->spec_result_end == frame->global_end);
+			funasr::MetricsCount(spec_hit ? funasr::COUNTER_TPASS_SPEC_HITS : funasr::COUNTER_TPASS_SPEC_MISSES);
+			if(spec_hit){
+				seg = std::move(tpass_online_stream->spec_result);
+			}
+			tpass_online_stream->spec_result_start = -1;
+			tpass_online_stream->spec_result_end = -1;
+		}
+		if(!spec_hit){
+			seg = FunTpassForwardSegment(tpass_stream, frame, hw_emb, dec_handle, svs_lang, svs_itn);
+		}
+		string msg = seg.text;
+		//timestamp, the stamps follow tpass_msg and cover this segment only
+		for(auto &stamp : seg.stamps){
+			p_result->stamp_list.push_back({stamp[0]+frame->global_start, stamp[1]+frame->global_start});
+		}
+
+		if (tpass_stream->GetModelType() == MODEL_PARA){
+			string msg_punc = tpass_stream->punc_online_handle->AddPunc(msg.c_str(), punc_cache);
+			if(input_finished){
+				msg_punc += "。";
+			}
+			p_result->tpass_msg = msg_punc;
+
+#if !defined(__APPLE__)
+			if(tpass_stream->UseITN() && itn){
+				string msg_itn = tpass_stream->itn_handle->Normalize(msg_punc);
+				// TimestampSmooth
+				if(!(p_result->stamp_list).empty()){
+					std::vector<std::vector<int>> new_stamp;
+					if(funasr::TimestampSmooth(p_result->tpass_msg, msg_itn, p_result->stamp_list, new_stamp)){
+						p_result->stamp_list.swap(new_stamp);
+					}
+				}
+				p_result->tpass_msg = msg_itn;
+			}
+#endif
+		}else{
+			p_result->tpass_msg = msg;
+		}
+		if (!(p_result->stamp_list).empty()){
+			funasr::TimestampSentence(p_result->tpass_msg, p_result->stamp_list, p_result->stamp_sent_list);
+		}
+	}
+
+	static FUNASR_RESULT FunTpassInferAudio(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, 
+											std::vector<std::vector<std::string>> &punc_cache, bool input_finished, ASR_TYPE mode, 
+											const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+											std::string &svs_lang, bool svs_itn)
 	{
 		funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
 		funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
@@ -511,20 +899,21 @@
 		if (!punc_online_handle)
 			return nullptr;
 
-		if(wav_format == "pcm" || wav_format == "PCM"){
-			if (!audio->LoadPcmwavOnline(sz_buf, n_len, &sampling_rate))
-				return nullptr;
-		}else{
-			// if (!audio->FfmpegLoad(sz_buf, n_len))
-			// 	return nullptr;
-			LOG(ERROR) <<"Wrong wav_format: " << wav_format ;
-			return nullptr;
-		}
-
 		funasr::FUNASR_RECOG_RESULT* p_result = new funasr::FUNASR_RECOG_RESULT;
 		p_result->snippet_time = audio->GetTimeLen();
+		funasr::MetricsCount(funasr::COUNTER_TPASS_CHUNKS);
+		funasr::MetricsCount(funasr::COUNTER_AUDIO_MS, (int64_t)(p_result->snippet_time * 1000));
 		
-		audio->Split(vad_online_handle, chunk_len, input_finished, mode);
+		// the offline pass runs apart from this call only with an offline lane; without one a
+		// speculative decode would add offline model latency to the online partial, so skip it
+		bool offline_lane = (tpass_online_stream->offline_strand && tpass_online_stream->offline_callback);
+		int speculate_ms = offline_lane ? tpass_stream->GetSpeculateMs() : 0;
+		audio->Split(vad_online_handle, chunk_len, input_finished, mode, speculate_ms);
+		if(speculate_ms > 0){
+			std::lock_guard<std::mutex> lock(tpass_online_stream->spec_mtx);
+			tpass_online_stream->spec_start = audio->spec_start;
+			tpass_online_stream->spec_end = audio->spec_end;
+		}
 
 		funasr::AudioFrame* frame = nullptr;
 		while(audio->FetchChunck(frame) > 0){
@@ -557,78 +946,81 @@
 		}
 
 		// timestamp
-		std::string cur_stamp = "[";		
-		while(audio->FetchTpass(frame) > 0){
-			// dec reset
-			funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)dec_handle;
-			if (wfst_decoder){
-				wfst_decoder->StartUtterance();
-			}
-			float** buff;
-			int* len;
-			buff = new float*[1];
-        	len = new int[1];
-			buff[0] = frame->data;
-			len[0] = frame->len;
-			vector<string> msgs;
-			if(tpass_stream->GetModelType() == MODEL_SVS){
-				msgs = (tpass_stream->asr_handle)->Forward(buff, len, true, svs_lang, svs_itn, 1);
-			}else{
-				msgs = (tpass_stream->asr_handle)->Forward(buff, len, true, hw_emb, dec_handle, 1);
-			}
-			string msg = msgs.size()>0?msgs[0]:"";
-			std::vector<std::string> msg_vec = funasr::SplitStr(msg, " | ");  // split with timestamp
-			if(msg_vec.size()==0){
-				continue;
+		if(offline_lane){
+			// offline lane: queue the closed segments and return the online part now
+			std::vector<funasr::AudioFrame*> frames;
+			while(audio->FetchTpass(frame) > 0){
+				frames.push_back(frame);
+				frame = nullptr;
 			}
-			msg = msg_vec[0];
-			//timestamp
-			if(msg_vec.size() > 1){
-				std::vector<std::string> msg_stamp = funasr::split(msg_vec[1], ',');
-				for(int i=0; i<msg_stamp.size()-1; i+=2){
-					float begin = std::stof(msg_stamp[i]) + float(frame->global_start)/1000.0;
-					float end = std::stof(msg_stamp[i+1]) + float(frame->global_start)/1000.0;
-					cur_stamp += "["+std::to_string((int)(1000*begin))+","+std::to_string((int)(1000*end))+"],";
-				}
+			if(input_finished && frames.empty()){
+				// the end of the utterance is reported even without a segment
+				frames.push_back(nullptr);
 			}
-
-			if(cur_stamp != "["){
-				cur_stamp.erase(cur_stamp.length() - 1);
-				p_result->stamp += cur_stamp + "]";
+			std::shared_ptr<const std::vector<std::vector<float>>> seg_emb;
+			if(!frames.empty()){
+				seg_emb = std::make_shared<const std::vector<std::vector<float>>>(hw_emb);
 			}
-
-			if (tpass_stream->GetModelType() == MODEL_PARA){
-				string msg_punc = punc_online_handle->AddPunc(msg.c_str(), punc_cache[1]);
-				if(input_finished){
-					msg_punc += "。";
-				}
-				p_result->tpass_msg = msg_punc;
-
-#if !defined(__APPLE__)
-				if(tpass_stream->UseITN() && itn){
-					string msg_itn = tpass_stream->itn_handle->Normalize(msg_punc);
-					// TimestampSmooth
-					if(!(p_result->stamp).empty()){
-						std::string new_stamp = funasr::TimestampSmooth(p_result->tpass_msg, msg_itn, p_result->stamp);
-						if(!new_stamp.empty()){
-							p_result->stamp = new_stamp;
+			for(size_t i = 0; i < frames.size(); i++){
+				std::shared_ptr<funasr::AudioFrame> seg_frame(frames[i]);
+				bool is_final = input_finished && i + 1 == frames.size();
+				int seq_id = tpass_online_stream->offline_seq++;
+				tpass_online_stream->offline_strand->Submit([=](){
+					funasr::FUNASR_RECOG_RESULT* seg_result = new funasr::FUNASR_RECOG_RESULT;
+					seg_result->snippet_time = 0;
+					if(seg_frame){
+						seg_result->snippet_time = (float)seg_frame->len / asr_handle->GetAsrSampleRate();
+						try{
+							FunTpassOfflineSegment(tpass_stream, tpass_online_stream, seg_frame.get(), tpass_online_stream->offline_punc_cache,
+												   input_finished, *seg_emb, itn, dec_handle, svs_lang, svs_itn, seg_result);
+						}catch(std::exception const &e){
+							// the segment is reported empty, so the stream still gets its final result
+							LOG(ERROR) << "offline pass of segment " << seq_id << ": " << e.what();
+							float snippet_time = seg_result->snippet_time;
+							delete seg_result;
+							seg_result = new funasr::FUNASR_RECOG_RESULT;
+							seg_result->snippet_time = snippet_time;
 						}
 					}
-					p_result->tpass_msg = msg_itn;
-				}
-#endif
-			}else{
-				p_result->tpass_msg = msg;
-			}
-			if (!(p_result->stamp).empty()){
-				p_result->stamp_sents = funasr::TimestampSentence(p_result->tpass_msg, p_result->stamp);
+					if(is_final){
+						tpass_online_stream->offline_punc_cache.clear();
+					}
+					tpass_online_stream->offline_callback(seg_result, seq_id, is_final);
+				});
 			}
-			if(frame != nullptr){
-				delete frame;
-				frame = nullptr;
+		}else{
+			// a call fed with a backlog of audio may close several segments, their
+			// results are joined in order
+			while(audio->FetchTpass(frame) > 0){
+				funasr::FUNASR_RECOG_RESULT seg_result;
+				FunTpassOfflineSegment(tpass_stream, tpass_online_stream, frame, punc_cache[1], input_finished,
+									   hw_emb, itn, dec_handle, svs_lang, svs_itn, &seg_result);
+				p_result->tpass_msg += seg_result.tpass_msg;
+				p_result->stamp_list.insert(p_result->stamp_list.end(), seg_result.stamp_list.begin(), seg_result.stamp_list.end());
+				p_result->stamp_sent_list.insert(p_result->stamp_sent_list.end(), seg_result.stamp_sent_list.begin(),
+												 seg_result.stamp_sent_list.end());
+				if(frame != nullptr){
+					delete frame;
+					frame = nullptr;
+				}
 			}
 		}
 
+		// speculation, after the segments already closed; only queued with an offline lane
+		while(audio->FetchSpeculative(frame) > 0){
+			std::shared_ptr<funasr::AudioFrame> spec_frame(frame);
+			auto spec_emb = std::make_shared<const std::vector<std::vector<float>>>(hw_emb);
+			tpass_online_stream->offline_strand->Submit([=](){
+				try{
+					FunTpassSpeculate(tpass_stream, tpass_online_stream, spec_frame.get(), *spec_emb, dec_handle, svs_lang, svs_itn);
+				}catch(std::exception const &e){
+					// the segment is decoded again once it closes
+					LOG(ERROR) << "speculative offline pass: " << e.what();
+				}
+			});
+			frame = nullptr;
+		}
+
 		if(input_finished){
 			audio->ResetIndex();
 		}
@@ -636,6 +1028,54 @@
 		return p_result;
 	}
 
+	_FUNASRAPI FUNASR_RESULT FunTpassInferBuffer(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const char* sz_buf, 
+												 int n_len, std::vector<std::vector<std::string>> &punc_cache, bool input_finished, 
+												 int sampling_rate, std::string wav_format, ASR_TYPE mode, 
+												 const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												 std::string svs_lang, bool svs_itn)
+	{
+		funasr::Audio* audio = FunTpassAudio(handle, online_handle);
+		if (!audio)
+			return nullptr;
+
+		if(wav_format == "pcm" || wav_format == "PCM"){
+			if (!audio->LoadPcmwavOnline(sz_buf, n_len, &sampling_rate))
+				return nullptr;
+		}else{
+			// compressed stream, decoded chunk by chunk straight to the model rate
+			funasr::TpassOnlineStream* tpass_online_stream = (funasr::TpassOnlineStream*)online_handle;
+			int32_t vad_sample_rate = tpass_online_stream->vad_online_handle->GetVadSampleRate();
+			if (!tpass_online_stream->stream_decoder){
+				tpass_online_stream->stream_decoder.reset(funasr::StreamDecoder::Create(wav_format, vad_sample_rate));
+				if (!tpass_online_stream->stream_decoder)
+					return nullptr;
+			}
+			std::vector<float> samples;
+			bool decoded = tpass_online_stream->stream_decoder->Decode(sz_buf, n_len, input_finished, samples);
+			if (!decoded || input_finished){
+				tpass_online_stream->stream_decoder.reset();
+			}
+			if (!decoded || !audio->LoadSamplesOnline(samples.data(), samples.size(), 1.0f, &vad_sample_rate))
+				return nullptr;
+		}
+		return FunTpassInferAudio(handle, online_handle, punc_cache, input_finished, mode, hw_emb, itn, dec_handle, svs_lang, svs_itn);
+	}
+
+	_FUNASRAPI FUNASR_RESULT FunTpassInferSamples(FUNASR_HANDLE handle, FUNASR_HANDLE online_handle, const void* samples, int n_samples,
+												  FUNASR_SAMPLE_TYPE sample_type, float scale, std::vector<std::vector<std::string>> &punc_cache,
+												  bool input_finished, int sampling_rate, ASR_TYPE mode, 
+												  const std::vector<std::vector<float>> &hw_emb, bool itn, FUNASR_DEC_HANDLE dec_handle,
+												  std::string svs_lang, bool svs_itn)
+	{
+		funasr::Audio* audio = FunTpassAudio(handle, online_handle);
+		if (!audio)
+			return nullptr;
+
+		if (!LoadSamples(*audio, samples, n_samples, sample_type, scale, &sampling_rate, true))
+			return nullptr;
+		return FunTpassInferAudio(handle, online_handle, punc_cache, input_finished, mode, hw_emb, itn, dec_handle, svs_lang, svs_itn);
+	}
+
 	_FUNASRAPI const int FunASRGetRetNumber(FUNASR_RESULT result)
 	{
 		if (!result)
@@ -676,6 +1116,9 @@
 		if(!p_result)
 			return nullptr;
 
+		if(p_result->stamp.empty() && !p_result->stamp_list.empty()){
+			p_result->stamp = funasr::VectorToString(p_result->stamp_list);
+		}
 		return p_result->stamp.c_str();
 	}
 
@@ -685,9 +1128,62 @@
 		if(!p_result)
 			return nullptr;
 
+		if(p_result->stamp_sents.empty() && !p_result->stamp_sent_list.empty()){
+			p_result->stamp_sents = funasr::StampSentsToString(p_result->stamp_sent_list);
+		}
 		return p_result->stamp_sents.c_str();
 	}
 
+	_FUNASRAPI int FunASRGetStampArray(FUNASR_RESULT result, const int** stamps)
+	{
+		funasr::FUNASR_RECOG_RESULT * p_result = (funasr::FUNASR_RECOG_RESULT*)result;
+		if(!p_result || !stamps)
+			return 0;
+
+		if(p_result->stamp_array.size() != 2*p_result->stamp_list.size()){
+			p_result->stamp_array.clear();
+			p_result->stamp_array.reserve(2*p_result->stamp_list.size());
+			for(auto &stamp : p_result->stamp_list){
+				p_result->stamp_array.push_back(stamp[0]);
+				p_result->stamp_array.push_back(stamp[1]);
+			}
+		}
+		*stamps = p_result->stamp_array.data();
+		return p_result->stamp_list.size();
+	}
+
+	_FUNASRAPI int FunASRGetStampSentNum(FUNASR_RESULT result)
+	{
+		funasr::FUNASR_RECOG_RESULT * p_result = (funasr::FUNASR_RECOG_RESULT*)result;
+		if(!p_result)
+			return 0;
+
+		return p_result->stamp_sent_list.size();
+	}
+
+	_FUNASRAPI bool FunASRGetStampSent(FUNASR_RESULT result, int n_index, const char** text_seg, const char** punc,
+									   int* start, int* end, const int** stamps, int* stamp_num)
+	{
+		funasr::FUNASR_RECOG_RESULT * p_result = (funasr::FUNASR_RECOG_RESULT*)result;
+		if(!p_result || n_index < 0 || n_index >= (int)p_result->stamp_sent_list.size())
+			return false;
+
+		const funasr::FUNASR_STAMP_SENT &sent = p_result->stamp_sent_list[n_index];
+		if(text_seg)
+			*text_seg = sent.text_seg.c_str();
+		if(punc)
+			*punc = sent.punc.c_str();
+		if(start)
+			*start = sent.start;
+		if(end)
+			*end = sent.end;
+		if(stamps)
+			*stamps = sent.ts_list.data();
+		if(stamp_num)
+			*stamp_num = sent.ts_list.size() / 2;
+		return true;
+	}
+
 	_FUNASRAPI const char* FunASRGetTpassResult(FUNASR_RESULT result,int n_index)
 	{
 		funasr::FUNASR_RECOG_RESULT * p_result = (funasr::FUNASR_RECOG_RESULT*)result;
@@ -824,60 +1320,134 @@
 		delete tpass_online_stream;
 	}
 
-	_FUNASRAPI FUNASR_DEC_HANDLE FunASRWfstDecoderInit(FUNASR_HANDLE handle, int asr_type, float glob_beam, float lat_beam, float am_scale)
+	_FUNASRAPI FUNASR_HANDLE FunModelRegistryInit(ASR_TYPE type, int thread_num, size_t memory_budget_mb, int shared_threads,
+												  std::function<void(FUNASR_HANDLE)> setup, bool use_gpu, int batch_size)
 	{
-		funasr::WfstDecoder* mm = nullptr;
-		if (asr_type == ASR_OFFLINE) {
-			funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
-			auto paraformer = dynamic_cast<funasr::Paraformer*>(offline_stream->asr_handle.get());
-			if(paraformer !=nullptr){
-				if (paraformer->lm_){
-					mm = new funasr::WfstDecoder(paraformer->lm_.get(),
-						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale);
-				}
-				return mm;
+		if (type != ASR_OFFLINE && type != ASR_TWO_PASS) {
+			LOG(ERROR) << "The model registry hosts offline or 2pass model sets only";
+			return nullptr;
+		}
+		if (shared_threads > 0 && !funasr::SharedThreadPoolsEnabled() && !funasr::EnableSharedThreadPools(shared_threads)) {
+			return nullptr;
+		}
+		funasr::ModelRegistry::Loader loader = [type, thread_num, setup, use_gpu, batch_size](std::map<std::string, std::string> &model_path) {
+			FUNASR_HANDLE handle = type == ASR_OFFLINE ? FunOfflineInit(model_path, thread_num, use_gpu, batch_size)
+													   : FunTpassInit(model_path, thread_num);
+			if (handle && setup) {
+				setup(handle);
 			}
-			#ifdef USE_GPU
-			auto paraformer_torch = dynamic_cast<funasr::ParaformerTorch*>(offline_stream->asr_handle.get());
-			if(paraformer_torch !=nullptr){
-				if (paraformer_torch->lm_){
-					mm = new funasr::WfstDecoder(paraformer_torch->lm_.get(),
-						paraformer_torch->GetPhoneSet(), paraformer_torch->GetLmVocab(), glob_beam, lat_beam, am_scale);
-				}
-				return mm;
+			return handle;
+		};
+		funasr::ModelRegistry::Unloader unloader = [type](void* handle) {
+			if (type == ASR_OFFLINE) {
+				FunOfflineUninit(handle);
+			} else {
+				FunTpassUninit(handle);
 			}
-			#endif
+		};
+		return new funasr::ModelRegistry(memory_budget_mb * 1024 * 1024, loader, unloader);
+	}
+
+	_FUNASRAPI bool FunModelRegistryAdd(FUNASR_HANDLE registry, const std::string &name, std::map<std::string, std::string>& model_path)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry)
+			return false;
+		return model_registry->Add(name, model_path);
+	}
+
+	_FUNASRAPI FUNASR_HANDLE FunModelRegistryAcquire(FUNASR_HANDLE registry, const std::string &name)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry)
+			return nullptr;
+		return model_registry->Acquire(name);
+	}
+
+	_FUNASRAPI void FunModelRegistryRelease(FUNASR_HANDLE registry, FUNASR_HANDLE handle)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry || !handle)
+			return;
+		model_registry->Release(handle);
+	}
+
+	_FUNASRAPI std::vector<std::string> FunModelRegistryNames(FUNASR_HANDLE registry)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry)
+			return {};
+		return model_registry->Names();
+	}
 
+	_FUNASRAPI std::string FunModelRegistryGetMetrics(FUNASR_HANDLE registry)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry)
+			return "";
+		return model_registry->PrometheusText();
+	}
+
+	_FUNASRAPI void FunModelRegistryUninit(FUNASR_HANDLE registry)
+	{
+		funasr::ModelRegistry* model_registry = (funasr::ModelRegistry*)registry;
+		if (!model_registry)
+			return;
+		delete model_registry;
+	}
+
+	// the decoder pool of the lm model behind an offline or 2pass handle, nullptr without an lm
+	static funasr::WfstDecoderPool* FunGetWfstDecoderPool(FUNASR_HANDLE handle, int asr_type)
+	{
+		funasr::Model* asr_handle = nullptr;
+		if (asr_type == ASR_OFFLINE) {
+			funasr::OfflineStream* offline_stream = (funasr::OfflineStream*)handle;
+			asr_handle = offline_stream->asr_handle.get();
 		} else if (asr_type == ASR_TWO_PASS){
 			funasr::TpassStream* tpass_stream = (funasr::TpassStream*)handle;
-			auto paraformer = dynamic_cast<funasr::Paraformer*>(tpass_stream->asr_handle.get());
-			if(paraformer !=nullptr){
-				if (paraformer->lm_){
-					mm = new funasr::WfstDecoder(paraformer->lm_.get(),
-						paraformer->GetPhoneSet(), paraformer->GetLmVocab(), glob_beam, lat_beam, am_scale);
-				}
-				return mm;
-			}
-			#ifdef USE_GPU
-			auto paraformer_torch = dynamic_cast<funasr::ParaformerTorch*>(tpass_stream->asr_handle.get());
-			if(paraformer_torch !=nullptr){
-				if (paraformer_torch->lm_){
-					mm = new funasr::WfstDecoder(paraformer_torch->lm_.get(),
-						paraformer_torch->GetPhoneSet(), paraformer_torch->GetLmVocab(), glob_beam, lat_beam, am_scale);
-				}
-				return mm;
-			}
-			#endif
+			asr_handle = tpass_stream->asr_handle.get();
 		}
-		return mm;
+		auto paraformer = dynamic_cast<funasr::Paraformer*>(asr_handle);
+		if(paraformer !=nullptr){
+			return paraformer->wfst_pool_.get();
+		}
+		#ifdef USE_GPU
+		auto paraformer_torch = dynamic_cast<funasr::ParaformerTorch*>(asr_handle);
+		if(paraformer_torch !=nullptr){
+			return paraformer_torch->wfst_pool_.get();
+		}
+		#endif
+		return nullptr;
+	}
+
+	_FUNASRAPI FUNASR_DEC_HANDLE FunASRWfstDecoderInit(FUNASR_HANDLE handle, int asr_type, float glob_beam, float lat_beam, float am_scale)
+	{
+		funasr::WfstDecoderPool* pool = FunGetWfstDecoderPool(handle, asr_type);
+		if (!pool)
+			return nullptr;
+		return pool->Acquire(glob_beam, lat_beam, am_scale);
 	}
 
 	_FUNASRAPI void FunASRWfstDecoderUninit(FUNASR_DEC_HANDLE handle)
 	{
-		funasr::WfstDecoder* wfst_decoder = (funasr::WfstDecoder*)handle;
-		if (!wfst_decoder)
+		funasr::WfstDecoder::Release((funasr::WfstDecoder*)handle);
+	}
+
+	_FUNASRAPI void FunASRWfstDecoderPoolSetSize(FUNASR_HANDLE handle, int asr_type, int max_idle)
+	{
+		funasr::WfstDecoderPool* pool = FunGetWfstDecoderPool(handle, asr_type);
+		if (!pool)
 			return;
-		delete wfst_decoder;
+		pool->SetMaxIdle(max_idle);
+	}
+
+	_FUNASRAPI bool FunASRWfstDecoderPoolStats(FUNASR_HANDLE handle, int asr_type, int* idle, int* in_use, long long* hits, long long* misses)
+	{
+		funasr::WfstDecoderPool* pool = FunGetWfstDecoderPool(handle, asr_type);
+		if (!pool)
+			return false;
+		pool->GetStats(idle, in_use, hits, misses);
+		return true;
 	}
 
 	_FUNASRAPI void FunWfstDecoderLoadHwsRes(FUNASR_DEC_HANDLE handle, int inc_bias, unordered_map<string, int> &hws_map)
@@ -894,3 +1464,66 @@
 			return;
 		wfst_decoder->UnloadHwsRes();
 	}
+
+	_FUNASRAPI bool FunASRFstToConst(const std::string &input, const std::string &output)
+	{
+		std::unique_ptr<fst::Fst<fst::StdArc>> fst(funasr::ReadFst(input));
+		if (!fst) {
+			LOG(ERROR) << "Failed to read fst " << input;
+			return false;
+		}
+		return funasr::WriteConstFst(*fst, output);
+	}
+
+	// APIs for metrics
+	_FUNASRAPI void FunASRMetricsEnable(bool enable)
+	{
+		funasr::Metrics::Instance().SetEnabled(enable);
+	}
+
+	_FUNASRAPI bool FunASRMetricsEnabled()
+	{
+		return funasr::Metrics::Instance().Enabled();
+	}
+
+	_FUNASRAPI void FunASRMetricsReset()
+	{
+		funasr::Metrics::Instance().Reset();
+	}
+
+	_FUNASRAPI std::string FunASRGetMetrics()
+	{
+		return funasr::Metrics::Instance().PrometheusText();
+	}
+
+	_FUNASRAPI bool FunASRGetStageMetric(const char* stage, long long* calls, double* seconds)
+	{
+		if (!stage)
+			return false;
+		funasr::MetricsSnapshot snapshot = funasr::Metrics::Instance().Snapshot();
+		for (int i = 0; i < funasr::STAGE_NUM; i++) {
+			if (strcmp(stage, funasr::Metrics::StageName(i)) == 0) {
+				if (calls)
+					*calls = snapshot.stage_calls[i];
+				if (seconds)
+					*seconds = snapshot.stage_ns[i] / 1e9;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	_FUNASRAPI bool FunASRGetCounterMetric(const char* counter, long long* value)
+	{
+		if (!counter)
+			return false;
+		funasr::MetricsSnapshot snapshot = funasr::Metrics::Instance().Snapshot();
+		for (int i = 0; i < funasr::COUNTER_NUM; i++) {
+			if (strcmp(counter, funasr::Metrics::CounterName(i)) == 0) {
+				if (value)
+					*value = snapshot.counters[i];
+				return true;
+			}
+		}
+		return false;
+	}
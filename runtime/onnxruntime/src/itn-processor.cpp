@@ -29,9 +29,13 @@ void  ITNProcessor::InitITN(const std::string& tagger_path,
                      const std::string& verbalizer_path, 
                      int thread_num) {
   try{
-    tagger_.reset(StdVectorFst::Read(tagger_path));
+    tagger_.reset(ReadFst(tagger_path));
+    verbalizer_.reset(ReadFst(verbalizer_path));
+    if (!tagger_ || !verbalizer_) {
+      LOG(ERROR) << "Error loading itn models";
+      exit(-1);
+    }
     LOG(INFO) << "Successfully load model from " << tagger_path;
-    verbalizer_.reset(StdVectorFst::Read(verbalizer_path));
     LOG(INFO) << "Successfully load model from " << verbalizer_path;
   }catch(exception const &e){
     LOG(ERROR) << "Error loading itn models";
@@ -60,7 +64,7 @@ std::string ITNProcessor::shortest_path(const StdVectorFst& lattice) {
 }
 
 std::string ITNProcessor::compose(const std::string& input,
-                               const StdVectorFst* fst) {
+                               const fst::Fst<StdArc>* fst) {
   StdVectorFst input_fst;
   compiler_->operator()(input, &input_fst);
 
@@ -83,6 +87,7 @@ std::string ITNProcessor::verbalize(const std::string& input) {
 }
 
 std::string ITNProcessor::Normalize(const std::string& input) {
+  StageTimer timer(STAGE_ITN);
   return verbalize(tag(input));
 }
 
@@ -42,11 +42,12 @@ class ITNProcessor : public ITNModel {
 
  private:
   std::string shortest_path(const StdVectorFst& lattice);
-  std::string compose(const std::string& input, const StdVectorFst* fst);
+  std::string compose(const std::string& input, const fst::Fst<StdArc>* fst);
 
   ParseType parse_type_;
-  std::shared_ptr<StdVectorFst> tagger_ = nullptr;
-  std::shared_ptr<StdVectorFst> verbalizer_ = nullptr;
+  // vector or const fsts, see ReadFst
+  std::shared_ptr<fst::Fst<StdArc>> tagger_ = nullptr;
+  std::shared_ptr<fst::Fst<StdArc>> verbalizer_ = nullptr;
   std::shared_ptr<StringCompiler<StdArc>> compiler_ = nullptr;
   std::shared_ptr<StringPrinter<StdArc>> printer_ = nullptr;
 };
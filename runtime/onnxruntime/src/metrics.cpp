@@ -0,0 +1,155 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+
+static const char* kStageNames[STAGE_NUM] = {
+    "audio_decode", "resample", "vad", "fbank", "encoder", "decoder",
+    "cif", "wfst", "punc", "itn", "timestamp"};
+
+static const char* kCounterNames[COUNTER_NUM] = {
+    "offline_requests", "tpass_chunks", "audio_ms", "vad_segments", "tpass_segments",
+    "tpass_spec_hits", "tpass_spec_misses", "wfst_pool_hits", "wfst_pool_misses",
+    "result_cache_hits", "result_cache_misses", "seg_cache_hits", "seg_cache_misses"};
+
+static const double kBucketBounds[METRIC_BUCKET_NUM] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5};
+
+MetricsShard::MetricsShard() {
+    Clear();
+}
+
+void MetricsShard::Clear() {
+    for (int i = 0; i < STAGE_NUM; i++) {
+        stage_calls[i].store(0, std::memory_order_relaxed);
+        stage_ns[i].store(0, std::memory_order_relaxed);
+        for (int b = 0; b <= METRIC_BUCKET_NUM; b++) {
+            stage_buckets[i][b].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < COUNTER_NUM; i++) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// only the owner thread writes a shard, so a load plus store is enough
+static inline void ShardAdd(std::atomic<int64_t>& value, int64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+Metrics& Metrics::Instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() : enabled_(false) {
+    const char* env = getenv("FUNASR_METRICS");
+    if (env != nullptr && strcmp(env, "0") != 0) {
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+}
+
+const char* Metrics::StageName(int stage) {
+    if (stage < 0 || stage >= STAGE_NUM) {
+        return "";
+    }
+    return kStageNames[stage];
+}
+
+const char* Metrics::CounterName(int counter) {
+    if (counter < 0 || counter >= COUNTER_NUM) {
+        return "";
+    }
+    return kCounterNames[counter];
+}
+
+MetricsShard* Metrics::LocalShard() {
+    thread_local MetricsShard* shard = nullptr;
+    if (shard == nullptr) {
+        std::shared_ptr<MetricsShard> new_shard = std::make_shared<MetricsShard>();
+        std::lock_guard<std::mutex> lock(mtx_);
+        shards_.push_back(new_shard);
+        shard = new_shard.get();
+    }
+    return shard;
+}
+
+void Metrics::AddStage(MetricStage stage, int64_t ns) {
+    MetricsShard* shard = LocalShard();
+    ShardAdd(shard->stage_calls[stage], 1);
+    ShardAdd(shard->stage_ns[stage], ns);
+    double seconds = ns / 1e9;
+    int bucket = 0;
+    while (bucket < METRIC_BUCKET_NUM && seconds > kBucketBounds[bucket]) {
+        bucket++;
+    }
+    ShardAdd(shard->stage_buckets[stage][bucket], 1);
+}
+
+void Metrics::AddCounter(MetricCounter counter, int64_t value) {
+    ShardAdd(LocalShard()->counters[counter], value);
+}
+
+void Metrics::Reset() {
+    // racy against concurrent writers by design, a reset may lose a few samples
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& shard : shards_) {
+        shard->Clear();
+    }
+}
+
+MetricsSnapshot Metrics::Snapshot() {
+    MetricsSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& shard : shards_) {
+        for (int i = 0; i < STAGE_NUM; i++) {
+            snapshot.stage_calls[i] += shard->stage_calls[i].load(std::memory_order_relaxed);
+            snapshot.stage_ns[i] += shard->stage_ns[i].load(std::memory_order_relaxed);
+            for (int b = 0; b <= METRIC_BUCKET_NUM; b++) {
+                snapshot.stage_buckets[i][b] += shard->stage_buckets[i][b].load(std::memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < COUNTER_NUM; i++) {
+            snapshot.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+std::string Metrics::PrometheusText() {
+    MetricsSnapshot snapshot = Snapshot();
+    std::ostringstream oss;
+    oss << "# HELP funasr_metrics_enabled Whether the runtime records metrics.\n";
+    oss << "# TYPE funasr_metrics_enabled gauge\n";
+    oss << "funasr_metrics_enabled " << (Enabled() ? 1 : 0) << "\n";
+
+    oss << "# HELP funasr_stage_duration_seconds Time spent in each runtime stage.\n";
+    oss << "# TYPE funasr_stage_duration_seconds histogram\n";
+    for (int i = 0; i < STAGE_NUM; i++) {
+        int64_t cumulative = 0;
+        for (int b = 0; b < METRIC_BUCKET_NUM; b++) {
+            cumulative += snapshot.stage_buckets[i][b];
+            oss << "funasr_stage_duration_seconds_bucket{stage=\"" << kStageNames[i]
+                << "\",le=\"" << kBucketBounds[b] << "\"} " << cumulative << "\n";
+        }
+        cumulative += snapshot.stage_buckets[i][METRIC_BUCKET_NUM];
+        oss << "funasr_stage_duration_seconds_bucket{stage=\"" << kStageNames[i]
+            << "\",le=\"+Inf\"} " << cumulative << "\n";
+        oss << "funasr_stage_duration_seconds_sum{stage=\"" << kStageNames[i] << "\"} "
+            << snapshot.stage_ns[i] / 1e9 << "\n";
+        oss << "funasr_stage_duration_seconds_count{stage=\"" << kStageNames[i] << "\"} "
+            << snapshot.stage_calls[i] << "\n";
+    }
+
+    for (int i = 0; i < COUNTER_NUM; i++) {
+        oss << "# TYPE funasr_" << kCounterNames[i] << "_total counter\n";
+        oss << "funasr_" << kCounterNames[i] << "_total " << snapshot.counters[i] << "\n";
+    }
+    return oss.str();
+}
+
+} // namespace funasr
@@ -0,0 +1,140 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Per-stage timers and counters of the runtime.
+// Every thread writes to its own shard, so recording is a couple of relaxed
+// stores without contention; readers sum the shards on demand. When metrics
+// are disabled (the default, or FUNASR_METRICS=0) a StageTimer costs a single
+// relaxed load.
+#ifndef METRICS_H
+#define METRICS_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace funasr {
+
+// stages nest where the pipeline does, e.g. AUDIO_DECODE covers RESAMPLE and
+// VAD covers its own fbank, so the stage times are not meant to be summed
+enum MetricStage {
+    STAGE_AUDIO_DECODE = 0,
+    STAGE_RESAMPLE,
+    STAGE_VAD,
+    STAGE_FBANK,
+    STAGE_ENCODER,
+    STAGE_DECODER,
+    STAGE_CIF,
+    STAGE_WFST,
+    STAGE_PUNC,
+    STAGE_ITN,
+    STAGE_TIMESTAMP,
+    STAGE_NUM
+};
+
+enum MetricCounter {
+    COUNTER_OFFLINE_REQUESTS = 0,
+    COUNTER_TPASS_CHUNKS,
+    COUNTER_AUDIO_MS,
+    COUNTER_VAD_SEGMENTS,
+    COUNTER_TPASS_SEGMENTS,
+    // speculative offline passes used for a segment, and those decoded in vain
+    COUNTER_TPASS_SPEC_HITS,
+    COUNTER_TPASS_SPEC_MISSES,
+    // wfst decoders taken warm from a pool, and those built anew
+    COUNTER_WFST_POOL_HITS,
+    COUNTER_WFST_POOL_MISSES,
+    // offline requests and vad segments answered from the result cache, and
+    // those decoded
+    COUNTER_RESULT_CACHE_HITS,
+    COUNTER_RESULT_CACHE_MISSES,
+    COUNTER_SEG_CACHE_HITS,
+    COUNTER_SEG_CACHE_MISSES,
+    COUNTER_NUM
+};
+
+// upper bounds (in seconds) of the stage latency histogram, +Inf is implicit
+#define METRIC_BUCKET_NUM 12
+
+struct MetricsShard {
+    std::atomic<int64_t> stage_calls[STAGE_NUM];
+    std::atomic<int64_t> stage_ns[STAGE_NUM];
+    std::atomic<int64_t> stage_buckets[STAGE_NUM][METRIC_BUCKET_NUM + 1];
+    std::atomic<int64_t> counters[COUNTER_NUM];
+    MetricsShard();
+    void Clear();
+};
+
+struct MetricsSnapshot {
+    int64_t stage_calls[STAGE_NUM];
+    int64_t stage_ns[STAGE_NUM];
+    int64_t stage_buckets[STAGE_NUM][METRIC_BUCKET_NUM + 1];
+    int64_t counters[COUNTER_NUM];
+};
+
+class Metrics {
+  public:
+    static Metrics& Instance();
+    static const char* StageName(int stage);
+    static const char* CounterName(int counter);
+
+    bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    void AddStage(MetricStage stage, int64_t ns);
+    void AddCounter(MetricCounter counter, int64_t value);
+    void Reset();
+    MetricsSnapshot Snapshot();
+    std::string PrometheusText();
+
+  private:
+    Metrics();
+    MetricsShard* LocalShard();
+
+    std::atomic<bool> enabled_;
+    std::mutex mtx_;
+    // shards are never freed, so counts of finished threads are kept
+    std::vector<std::shared_ptr<MetricsShard>> shards_;
+};
+
+// measures the enclosing scope into one stage
+class StageTimer {
+  public:
+    explicit StageTimer(MetricStage stage) : stage_(stage), active_(Metrics::Instance().Enabled()) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~StageTimer() {
+        Stop();
+    }
+    // ends the measurement before the scope does
+    void Stop() {
+        if (active_) {
+            Metrics::Instance().AddStage(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count());
+            active_ = false;
+        }
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+  private:
+    MetricStage stage_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline void MetricsCount(MetricCounter counter, int64_t value = 1) {
+    Metrics& metrics = Metrics::Instance();
+    if (metrics.Enabled()) {
+        metrics.AddCounter(counter, value);
+    }
+}
+
+} // namespace funasr
+#endif
@@ -0,0 +1,304 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#include <set>
+
+namespace funasr {
+static bool IsDirKey(const std::string &key)
+{
+    return key.size() > 4 && key.compare(key.size() - 4, 4, "-dir") == 0;
+}
+
+static size_t FileSize(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        return 0;
+    }
+    std::streamoff size = in.tellg();
+    return size > 0 ? (size_t)size : 0;
+}
+
+static bool IsTrue(const std::map<std::string, std::string> &model_path, const std::string &key)
+{
+    auto it = model_path.find(key);
+    return it != model_path.end() && it->second == "true";
+}
+
+std::string ModelRegistry::MissingFile(const std::map<std::string, std::string> &model_path)
+{
+    std::vector<std::string> required;
+    std::vector<std::string> am_models;
+    auto model_dir = model_path.find(MODEL_DIR);
+    if (model_dir == model_path.end() || model_dir->second.empty()) {
+        return MODEL_DIR;
+    }
+    const std::string &dir = model_dir->second;
+    // a gpu set loads the torchscript instead
+    am_models.push_back(PathAppend(dir, IsTrue(model_path, QUANTIZE) ? QUANT_MODEL_NAME : MODEL_NAME));
+    am_models.push_back(PathAppend(dir, TORCH_MODEL_NAME));
+    am_models.push_back(PathAppend(dir, BLADE_MODEL_NAME));
+    required.push_back(PathAppend(dir, TOKEN_PATH));
+    auto online_dir = model_path.find(ONLINE_MODEL_DIR);
+    if (online_dir != model_path.end()) {
+        // 2pass: the online dir holds the features and the streaming model
+        const std::string &online = online_dir->second;
+        bool quant = IsTrue(model_path, QUANTIZE);
+        required.push_back(PathAppend(online, quant ? QUANT_ENCODER_NAME : ENCODER_NAME));
+        required.push_back(PathAppend(online, quant ? QUANT_DECODER_NAME : DECODER_NAME));
+        required.push_back(PathAppend(online, AM_CMVN_NAME));
+        required.push_back(PathAppend(online, AM_CONFIG_NAME));
+        required.push_back(PathAppend(online, TOKEN_PATH));
+    } else {
+        required.push_back(PathAppend(dir, AM_CMVN_NAME));
+        required.push_back(PathAppend(dir, AM_CONFIG_NAME));
+    }
+    // an lm without lexicon is skipped, with one it must be complete
+    auto lm_dir = model_path.find(LM_DIR);
+    if (lm_dir != model_path.end() && !lm_dir->second.empty() &&
+        access(PathAppend(lm_dir->second, LEX_PATH).c_str(), F_OK) == 0) {
+        required.push_back(PathAppend(lm_dir->second, LM_FST_RES));
+        required.push_back(PathAppend(lm_dir->second, LM_CONFIG_NAME));
+    }
+    // vad, punc and itn are skipped when incomplete
+
+    bool am_model = false;
+    for (const std::string &path : am_models) {
+        am_model = am_model || access(path.c_str(), F_OK) == 0;
+    }
+    if (!am_model) {
+        return am_models[0];
+    }
+    for (const std::string &path : required) {
+        if (access(path.c_str(), F_OK) != 0) {
+            return path;
+        }
+    }
+    return "";
+}
+
+size_t ModelRegistry::EstimateMemory(const std::map<std::string, std::string> &model_path)
+{
+    std::map<std::string, std::string> quant_keys = {
+        {MODEL_DIR, QUANTIZE}, {ONLINE_MODEL_DIR, QUANTIZE}, {VAD_DIR, VAD_QUANT}, {PUNC_DIR, PUNC_QUANT}};
+    std::set<std::string> dirs;
+    size_t bytes = 0;
+    for (const auto &kv : model_path) {
+        if (!IsDirKey(kv.first) || kv.second.empty() || !dirs.insert(kv.second).second) {
+            continue;
+        }
+        bool quant = false;
+        auto quant_key = quant_keys.find(kv.first);
+        if (quant_key != quant_keys.end()) {
+            auto quant_value = model_path.find(quant_key->second);
+            quant = quant_value != model_path.end() && quant_value->second == "true";
+        }
+        std::vector<std::string> names = {MODEL_EB_NAME, LM_FST_RES, ITN_TAGGER_NAME, ITN_VERBALIZER_NAME};
+        names.push_back(quant ? QUANT_MODEL_NAME : MODEL_NAME);
+        names.push_back(quant ? QUANT_DECODER_NAME : DECODER_NAME);
+        for (const std::string &name : names) {
+            bytes += FileSize(PathAppend(kv.second, name));
+        }
+    }
+    return bytes;
+}
+
+ModelRegistry::ModelRegistry(size_t memory_budget, Loader loader, Unloader unloader)
+    : memory_budget_(memory_budget), loader_(loader), unloader_(unloader)
+{
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    for (auto &kv : sets_) {
+        if (kv.second.refs > 0) {
+            LOG(ERROR) << "Model set " << kv.first << " is unloaded with " << kv.second.refs << " references";
+        }
+        if (kv.second.handle) {
+            unloader_(kv.second.handle);
+        }
+    }
+}
+
+bool ModelRegistry::Add(const std::string &name, const std::map<std::string, std::string> &model_path, size_t memory_bytes)
+{
+    // the streams exit on a missing model, which must not happen at a lazy load
+    for (const auto &kv : model_path) {
+        if (IsDirKey(kv.first) && !kv.second.empty() && access(kv.second.c_str(), F_OK) != 0) {
+            LOG(ERROR) << "Model set " << name << ": " << kv.first << " " << kv.second << " does not exist";
+            return false;
+        }
+    }
+    std::string missing = MissingFile(model_path);
+    if (!missing.empty()) {
+        LOG(ERROR) << "Model set " << name << ": " << missing << " does not exist";
+        return false;
+    }
+    if (memory_bytes == 0) {
+        memory_bytes = EstimateMemory(model_path);
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (sets_.find(name) != sets_.end()) {
+        LOG(ERROR) << "Model set " << name << " is already registered";
+        return false;
+    }
+    ModelSet &model_set = sets_[name];
+    model_set.model_path = model_path;
+    model_set.memory_bytes = memory_bytes;
+    LOG(INFO) << "Model set " << name << " registered, about " << memory_bytes / (1024 * 1024) << " MB";
+    return true;
+}
+
+void ModelRegistry::EvictIdle(size_t need, std::vector<void*> &to_unload)
+{
+    while (memory_budget_ > 0 && loaded_bytes_ + need > memory_budget_) {
+        ModelSet* lru = nullptr;
+        std::string lru_name;
+        for (auto &kv : sets_) {
+            ModelSet &model_set = kv.second;
+            if (model_set.handle && model_set.refs == 0 && (!lru || model_set.last_used < lru->last_used)) {
+                lru = &model_set;
+                lru_name = kv.first;
+            }
+        }
+        if (!lru) {
+            return;
+        }
+        LOG(INFO) << "Model set " << lru_name << " is idle and unloaded";
+        to_unload.push_back(lru->handle);
+        handle_names_.erase(lru->handle);
+        lru->handle = nullptr;
+        lru->evictions++;
+        loaded_bytes_ -= lru->memory_bytes;
+    }
+}
+
+void* ModelRegistry::Acquire(const std::string &name)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto it = sets_.find(name);
+    if (it == sets_.end()) {
+        LOG(ERROR) << "Model set " << name << " is not registered";
+        return nullptr;
+    }
+    ModelSet &model_set = it->second;
+    loaded_cv_.wait(lock, [&model_set]() { return !model_set.loading; });
+    model_set.last_used = ++use_clock_;
+    if (model_set.handle) {
+        model_set.refs++;
+        return model_set.handle;
+    }
+
+    // the bytes are counted from now on, so that concurrent loads of other sets see them
+    std::vector<void*> to_unload;
+    EvictIdle(model_set.memory_bytes, to_unload);
+    loaded_bytes_ += model_set.memory_bytes;
+    if (memory_budget_ > 0 && loaded_bytes_ > memory_budget_) {
+        LOG(WARNING) << "Model set " << name << " is loaded over the memory budget, the other sets are in use";
+    }
+    model_set.loading = true;
+    std::map<std::string, std::string> model_path = model_set.model_path;
+    lock.unlock();
+
+    for (void* handle : to_unload) {
+        unloader_(handle);
+    }
+    LOG(INFO) << "Loading model set " << name;
+    void* handle = nullptr;
+    // the files may have gone since Add
+    std::string missing = MissingFile(model_path);
+    if (!missing.empty()) {
+        LOG(ERROR) << "Error when loading model set " << name << ": " << missing << " does not exist";
+    } else {
+        try {
+            handle = loader_(model_path);
+        } catch (std::exception const &e) {
+            LOG(ERROR) << "Error when loading model set " << name << ": " << e.what();
+        }
+    }
+
+    lock.lock();
+    model_set.loading = false;
+    if (handle) {
+        model_set.handle = handle;
+        model_set.refs++;
+        model_set.loads++;
+        handle_names_[handle] = name;
+    } else {
+        loaded_bytes_ -= model_set.memory_bytes;
+    }
+    loaded_cv_.notify_all();
+    return handle;
+}
+
+void ModelRegistry::Release(void* handle)
+{
+    std::vector<void*> to_unload;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = handle_names_.find(handle);
+        if (it == handle_names_.end()) {
+            LOG(ERROR) << "Released handle is not a loaded model set";
+            return;
+        }
+        ModelSet &model_set = sets_[it->second];
+        if (model_set.refs <= 0) {
+            LOG(ERROR) << "Model set " << it->second << " is released more often than acquired";
+            return;
+        }
+        model_set.refs--;
+        model_set.last_used = ++use_clock_;
+        // a set loaded over the budget gives it back once the others become idle
+        EvictIdle(0, to_unload);
+    }
+    for (void* idle_handle : to_unload) {
+        unloader_(idle_handle);
+    }
+}
+
+std::vector<std::string> ModelRegistry::Names()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<std::string> names;
+    for (const auto &kv : sets_) {
+        names.push_back(kv.first);
+    }
+    return names;
+}
+
+std::string ModelRegistry::PrometheusText()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::ostringstream oss;
+    oss << "# HELP funasr_model_set_loaded Whether the model set is loaded.\n";
+    oss << "# TYPE funasr_model_set_loaded gauge\n";
+    for (const auto &kv : sets_) {
+        oss << "funasr_model_set_loaded{set=\"" << kv.first << "\"} " << (kv.second.handle ? 1 : 0) << "\n";
+    }
+    oss << "# HELP funasr_model_set_sessions Sessions that hold the model set.\n";
+    oss << "# TYPE funasr_model_set_sessions gauge\n";
+    for (const auto &kv : sets_) {
+        oss << "funasr_model_set_sessions{set=\"" << kv.first << "\"} " << kv.second.refs << "\n";
+    }
+    oss << "# HELP funasr_model_set_memory_bytes Estimated memory of the model set.\n";
+    oss << "# TYPE funasr_model_set_memory_bytes gauge\n";
+    for (const auto &kv : sets_) {
+        oss << "funasr_model_set_memory_bytes{set=\"" << kv.first << "\"} " << kv.second.memory_bytes << "\n";
+    }
+    oss << "# TYPE funasr_model_set_loads_total counter\n";
+    for (const auto &kv : sets_) {
+        oss << "funasr_model_set_loads_total{set=\"" << kv.first << "\"} " << kv.second.loads << "\n";
+    }
+    oss << "# TYPE funasr_model_set_evictions_total counter\n";
+    for (const auto &kv : sets_) {
+        oss << "funasr_model_set_evictions_total{set=\"" << kv.first << "\"} " << kv.second.evictions << "\n";
+    }
+    oss << "# HELP funasr_model_sets_memory_bytes Estimated memory of the loaded model sets and the budget.\n";
+    oss << "# TYPE funasr_model_sets_memory_bytes gauge\n";
+    oss << "funasr_model_sets_memory_bytes{kind=\"loaded\"} " << loaded_bytes_ << "\n";
+    oss << "funasr_model_sets_memory_bytes{kind=\"budget\"} " << memory_budget_ << "\n";
+    return oss.str();
+}
+} // namespace funasr
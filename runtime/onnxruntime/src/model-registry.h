@@ -0,0 +1,74 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Named model sets hosted in one process. A set is registered with its
+// model_path map and loaded on its first Acquire; every Acquire takes a
+// reference that Release hands back. Sets without references stay loaded
+// until the memory of the loaded sets goes over the budget, then the least
+// recently used idle ones are unloaded. The memory of a set is estimated from
+// the size of the model files it loads. Loads and unloads run outside the
+// lock, concurrent Acquires of a set that is loading wait for it.
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace funasr {
+class ModelRegistry {
+  public:
+    typedef std::function<void*(std::map<std::string, std::string> &model_path)> Loader;
+    typedef std::function<void(void* handle)> Unloader;
+
+    // memory_budget of 0 never unloads
+    ModelRegistry(size_t memory_budget, Loader loader, Unloader unloader);
+    // unloads every set, the handles must have been released
+    ~ModelRegistry();
+
+    // false if the name is taken or a model dir or a file its loader requires
+    // does not exist; memory_bytes of 0 is estimated from the model files
+    bool Add(const std::string &name, const std::map<std::string, std::string> &model_path, size_t memory_bytes = 0);
+    // the loaded set, nullptr if the name is unknown or the load failed
+    void* Acquire(const std::string &name);
+    void Release(void* handle);
+    std::vector<std::string> Names();
+    std::string PrometheusText();
+
+    // the size of the onnx models and fsts the dirs of model_path point to
+    static size_t EstimateMemory(const std::map<std::string, std::string> &model_path);
+    // the first file the loaders of model_path require that does not exist,
+    // empty if none; the loaders exit the process on a missing file
+    static std::string MissingFile(const std::map<std::string, std::string> &model_path);
+
+  private:
+    struct ModelSet {
+        std::map<std::string, std::string> model_path;
+        size_t memory_bytes = 0;
+        void* handle = nullptr;
+        bool loading = false;
+        int refs = 0;
+        uint64_t last_used = 0;
+        int64_t loads = 0;
+        int64_t evictions = 0;
+    };
+    // takes the least recently used idle sets off until need more bytes fit
+    // the budget, their handles are left in to_unload
+    void EvictIdle(size_t need, std::vector<void*> &to_unload);
+
+    size_t memory_budget_;
+    Loader loader_;
+    Unloader unloader_;
+    std::mutex mtx_;
+    std::condition_variable loaded_cv_;
+    std::map<std::string, ModelSet> sets_;
+    std::unordered_map<void*, std::string> handle_names_;
+    size_t loaded_bytes_ = 0;
+    uint64_t use_clock_ = 0;
+};
+} // namespace funasr
+#endif
@@ -1,6 +1,16 @@
 #include "precomp.h"
 
 namespace funasr {
+std::vector<FUNASR_SEG_RESULT> Model::ForwardSegs(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* wfst_decoder, int batch_in)
+{
+    std::vector<std::string> msgs = Forward(din, len, input_finished, hw_emb, wfst_decoder, batch_in);
+    std::vector<FUNASR_SEG_RESULT> segs(msgs.size());
+    for (size_t i = 0; i < msgs.size(); i++) {
+        ParseSegResult(msgs[i], segs[i]);
+    }
+    return segs;
+}
+
 Model *CreateModel(std::map<std::string, std::string>& model_path, int thread_num, ASR_TYPE type)
 {
     // offline
@@ -150,6 +150,131 @@ OfflineStream::OfflineStream(std::map<std::string, std::string>& model_path, int
     }
 }
 
+void OfflineStream::SetSegThreadNum(int thread_num)
+{
+    if (thread_num > 1) {
+        seg_pool_ = make_unique<WorkerPool>(thread_num);
+    } else {
+        seg_pool_ = nullptr;
+    }
+}
+
+void OfflineStream::SetResultCache(size_t result_bytes, size_t seg_bytes)
+{
+    if (result_bytes > 0 || seg_bytes > 0) {
+        result_cache_ = make_unique<ResultCache>(result_bytes, seg_bytes);
+    } else {
+        result_cache_ = nullptr;
+    }
+}
+
+void OfflineStream::AddDecodeOptions(CacheKey &key, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                                     bool use_svs, const std::string &svs_lang, bool svs_itn)
+{
+    uint64_t hw_num = hw_emb.size();
+    key.Add(hw_num);
+    for (auto &emb : hw_emb) {
+        key.AddHash(emb.data(), emb.size() * sizeof(float));
+    }
+    WfstDecoder* wfst_decoder = (WfstDecoder*)dec_handle;
+    key.Add(wfst_decoder ? wfst_decoder->ConfigHash() : (uint64_t)0);
+    if (use_svs) {
+        key.AddString(svs_lang).Add(svs_itn);
+    }
+}
+
+void OfflineStream::ForwardModel(float** buff, int* len, int batch_in, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                                 bool use_svs, std::string &svs_lang, bool svs_itn, std::vector<FUNASR_SEG_RESULT> &seg_batch)
+{
+    // dec reset
+    WfstDecoder* wfst_decoder = (WfstDecoder*)dec_handle;
+    if (wfst_decoder){
+        wfst_decoder->StartUtterance();
+    }
+    if(use_svs){
+        vector<string> msg_batch = asr_handle->Forward(buff, len, true, svs_lang, svs_itn, batch_in);
+        seg_batch.resize(msg_batch.size());
+        for(size_t idx=0; idx<msg_batch.size(); idx++){
+            ParseSegResult(msg_batch[idx], seg_batch[idx]);
+        }
+    }else{
+        seg_batch = asr_handle->ForwardSegs(buff, len, true, hw_emb, dec_handle, batch_in);
+    }
+}
+
+void OfflineStream::Forward(float** buff, int* len, int batch_in, const std::vector<std::vector<float>> &hw_emb, void* dec_handle,
+                            bool use_svs, std::string &svs_lang, bool svs_itn, std::vector<FUNASR_SEG_RESULT> &seg_batch)
+{
+    ResultCache* cache = result_cache_.get();
+    if (cache == nullptr || !cache->UseSegs()) {
+        ForwardModel(buff, len, batch_in, hw_emb, dec_handle, use_svs, svs_lang, svs_itn, seg_batch);
+        return;
+    }
+    CacheKey options;
+    AddDecodeOptions(options, hw_emb, dec_handle, use_svs, svs_lang, svs_itn);
+    seg_batch.resize(batch_in);
+    std::vector<std::string> keys(batch_in);
+    std::vector<float*> miss_buff;
+    std::vector<int> miss_len;
+    std::vector<int> miss_idx;
+    for (int idx = 0; idx < batch_in; idx++) {
+        CacheKey key;
+        key.AddHash(buff[idx], len[idx] * sizeof(float)).AddString(options.Str());
+        keys[idx] = key.Str();
+        if (!cache->GetSeg(keys[idx], seg_batch[idx])) {
+            miss_buff.push_back(buff[idx]);
+            miss_len.push_back(len[idx]);
+            miss_idx.push_back(idx);
+        }
+    }
+    if (miss_idx.empty()) {
+        return;
+    }
+    std::vector<FUNASR_SEG_RESULT> miss_batch;
+    ForwardModel(miss_buff.data(), miss_len.data(), miss_idx.size(), hw_emb, dec_handle, use_svs, svs_lang, svs_itn, miss_batch);
+    for (size_t idx = 0; idx < miss_batch.size() && idx < miss_idx.size(); idx++) {
+        cache->PutSeg(keys[miss_idx[idx]], miss_batch[idx]);
+        seg_batch[miss_idx[idx]] = std::move(miss_batch[idx]);
+    }
+}
+
+void OfflineStream::Assemble(std::vector<FUNASR_SEG_RESULT> &segs, std::vector<float> &seg_stimes, bool itn,
+                             FUNASR_RECOG_RESULT* p_result, PuncProgress &punc_progress)
+{
+    std::string lang = asr_handle->GetLang();
+    for(size_t idx=0; idx<segs.size(); idx++){
+        FUNASR_SEG_RESULT &seg = segs[idx];
+        if(lang == "en-bpe" && p_result->msg != ""){
+            p_result->msg += " ";
+        }
+        p_result->msg += seg.text;
+        //timestamp
+        int offset_ms = (int)lround(1000*seg_stimes[idx]);
+        for(auto &stamp : seg.stamps){
+            p_result->stamp_list.push_back({stamp[0]+offset_ms, stamp[1]+offset_ms});
+        }
+    }
+    if(use_punc){
+        string punc_res = punc_handle->AddPunc((p_result->msg).c_str(), lang, punc_progress);
+        p_result->msg = punc_res;
+    }
+#if !defined(__APPLE__)
+    if(use_itn && itn){
+        string msg_itn = itn_handle->Normalize(p_result->msg);
+        if(!(p_result->stamp_list).empty()){
+            std::vector<std::vector<int>> new_stamp;
+            if(TimestampSmooth(p_result->msg, msg_itn, p_result->stamp_list, new_stamp)){
+                p_result->stamp_list.swap(new_stamp);
+            }
+        }
+        p_result->msg = msg_itn;
+    }
+#endif
+    if (!(p_result->stamp_list).empty()){
+        TimestampSentence(p_result->msg, p_result->stamp_list, p_result->stamp_sent_list);
+    }
+}
+
 OfflineStream *CreateOfflineStream(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu, int batch_size)
 {
     OfflineStream *mm;
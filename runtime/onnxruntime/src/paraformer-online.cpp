@@ -83,6 +83,7 @@ void ParaformerOnline::InitOnline(
         float cif_threshold_,
         float tail_alphas_){
     fbank_opts_ = fbank_opts;
+    fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
     encoder_session_ = encoder_session;
     decoder_session_ = decoder_session;
     en_szInputNames_ = en_szInputNames;
@@ -118,7 +119,7 @@ void ParaformerOnline::InitOnline(
 
 void ParaformerOnline::FbankKaldi(float sample_rate, std::vector<std::vector<float>> &wav_feats,
                                std::vector<float> &waves) {
-    knf::OnlineFbank fbank(fbank_opts_);
+    StageTimer timer(STAGE_FBANK);
     // cache merge
     waves.insert(waves.begin(), input_cache_.begin(), input_cache_.end());
     int frame_number = ComputeFrameNum(waves.size(), frame_sample_length_, frame_shift_sample_length_);
@@ -131,17 +132,7 @@ void ParaformerOnline::FbankKaldi(float sample_rate, std::vector<std::vector<flo
     // Delete audio that haven't undergone fbank processing
     waves.erase(waves.begin() + (frame_number - 1) * frame_shift_sample_length_ + frame_sample_length_, waves.end());
 
-    std::vector<float> buf(waves.size());
-    for (int32_t i = 0; i != waves.size(); ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank.AcceptWaveform(sample_rate, buf.data(), buf.size());
-    int32_t frames = fbank.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank.GetFrame(i);
-        vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        wav_feats.emplace_back(frame_vector);
-    }
+    fbank_extractor_->Compute(waves.data(), waves.size(), 32768, wav_feats);
 }
 
 void ParaformerOnline::ExtractFeats(float sample_rate, vector<std::vector<float>> &wav_feats,
@@ -237,38 +228,40 @@ int ParaformerOnline::OnlineLfrCmvn(vector<vector<float>> &wav_feats, bool input
     return lfr_splice_frame_idxs;
 }
 
+// scales the features by sqrt_factor and adds the sinusoidal position encoding.
+// Only the rows of this chunk are evaluated, so the cost does not grow with
+// the age of the stream.
 void ParaformerOnline::GetPosEmb(std::vector<std::vector<float>> &wav_feats, int timesteps, int feat_dim)
 {
     int start_idx = start_idx_cache_;
     start_idx_cache_ += timesteps;
-    int mm = start_idx_cache_;
-
-    int i;
-    float scale = -0.0330119726594128;
-
-    std::vector<float> tmp(mm*feat_dim);
-
-    for (i = 0; i < feat_dim/2; i++) {
-        float tmptime = exp(i * scale);
-        int j;
-        for (j = 0; j < mm; j++) {
-            int sin_idx = j * feat_dim + i;
-            int cos_idx = j * feat_dim + i + feat_dim/2;
-            float coe = tmptime * (j + 1);
-            tmp[sin_idx] = sin(coe);
-            tmp[cos_idx] = cos(coe);
+
+    int half_dim = feat_dim/2;
+    if ((int)pos_inv_freq_.size() != half_dim) {
+        float scale = -0.0330119726594128;
+        pos_inv_freq_.resize(half_dim);
+        for (int i = 0; i < half_dim; i++) {
+            pos_inv_freq_[i] = exp(i * scale);
         }
     }
 
-    for (i = start_idx; i < start_idx + timesteps; i++) {
+    for (int t = 0; t < timesteps; t++) {
+        float* row = wav_feats[t].data();
         for (int j = 0; j < feat_dim; j++) {
-            wav_feats[i-start_idx][j] += tmp[i*feat_dim+j];
+            row[j] = (float)(row[j] * sqrt_factor);
+        }
+        float pos = start_idx + t + 1;
+        for (int i = 0; i < half_dim; i++) {
+            float coe = pos_inv_freq_[i] * pos;
+            row[i] += (float)sin(coe);
+            row[i + half_dim] += (float)cos(coe);
         }
     }
 }
 
 void ParaformerOnline::CifSearch(std::vector<std::vector<float>> hidden, std::vector<float> alphas, bool is_final, std::vector<std::vector<float>>& list_frame)
 {
+    StageTimer timer(STAGE_CIF);
     try{
         int hidden_size = 0;
         if(hidden.size() > 0){
@@ -352,6 +345,7 @@ void ParaformerOnline::InitCache(){
     hidden_cache_.clear();
     alphas_cache_.clear();
     feats_cache_.clear();
+    feats_history_.clear();
     decoder_onnx.clear();
 
     // cif cache
@@ -407,8 +401,26 @@ void ParaformerOnline::AddOverlapChunk(std::vector<std::vector<float>> &wav_feat
             }
         }
     }else{
+        auto cache_begin = wav_feats.end()-chunk_size[0]-chunk_size[2];
+        KeepHistory(wav_feats.begin(), cache_begin);
         feats_cache_.clear();
-        feats_cache_.insert(feats_cache_.begin(), wav_feats.end()-chunk_size[0]-chunk_size[2], wav_feats.end());        
+        feats_cache_.insert(feats_cache_.begin(), cache_begin, wav_feats.end());        
+    }
+}
+
+void ParaformerOnline::KeepHistory(std::vector<std::vector<float>>::const_iterator begin,
+                                   std::vector<std::vector<float>>::const_iterator end){
+    size_t keep = max_lookback_ > chunk_size[0] ? max_lookback_ - chunk_size[0] : 0;
+    if(keep == 0){
+        feats_history_.clear();
+        return;
+    }
+    if((size_t)(end - begin) > keep){
+        begin = end - keep;
+    }
+    feats_history_.insert(feats_history_.end(), begin, end);
+    if(feats_history_.size() > keep){
+        feats_history_.erase(feats_history_.begin(), feats_history_.end() - keep);
     }
 }
 
@@ -445,7 +457,9 @@ string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_fea
         input_onnx.emplace_back(std::move(onnx_feats));
         input_onnx.emplace_back(std::move(onnx_feats_len)); 
         
+        StageTimer encoder_timer(STAGE_ENCODER);
         auto encoder_tensor = encoder_session_->Run(Ort::RunOptions{nullptr}, en_szInputNames_.data(), input_onnx.data(), input_onnx.size(), en_szOutputNames_.data(), en_szOutputNames_.size());
+        encoder_timer.Stop();
 
         // get enc_vec
         std::vector<int64_t> enc_shape = encoder_tensor[0].GetTensorTypeAndShapeInfo().GetShape();
@@ -497,7 +511,9 @@ string ParaformerOnline::ForwardChunk(std::vector<std::vector<float>> &chunk_fea
                 m_memoryInfo, emb_length.data(), emb_length.size(), emb_length_shape, 1);
             decoder_onnx.insert(decoder_onnx.begin()+3, std::move(onnx_emb_len));
 
+            StageTimer decoder_timer(STAGE_DECODER);
             auto decoder_tensor = decoder_session_->Run(Ort::RunOptions{nullptr}, de_szInputNames_.data(), decoder_onnx.data(), decoder_onnx.size(), de_szOutputNames_.data(), de_szOutputNames_.size());
+            decoder_timer.Stop();
             // fsmn cache
             try{
                 decoder_onnx.clear();
@@ -545,12 +561,6 @@ string ParaformerOnline::Forward(float* din, int len, bool input_finished, const
         if(wav_feats.size() == 0){
             return result;
         }
-        
-        for (auto& row : wav_feats) {
-            for (auto& val : row) {
-                val *= sqrt_factor;
-            }
-        }
 
         GetPosEmb(wav_feats, wav_feats.size(), wav_feats[0].size());
         if(input_finished){
@@ -596,6 +606,39 @@ string ParaformerOnline::Forward(float* din, int len, bool input_finished, const
     return result;
 }
 
+bool ParaformerOnline::SetChunkSize(const std::vector<int> &new_chunk_size)
+{
+    if(new_chunk_size.size() != 3 || new_chunk_size[0] < 0 || new_chunk_size[1] <= 0 ||
+       new_chunk_size[2] != chunk_size[2]){
+        LOG(ERROR) << "chunk size can only change its lookback and chunk, not the lookahead of "
+                   << chunk_size[2];
+        return false;
+    }
+    // feats_cache_ is the lookback of the next chunk followed by the lookahead
+    // of the last one, the fsmn and cif caches do not depend on the chunk size.
+    // A longer lookback takes the frames before it from feats_history_, only
+    // the start of a stream has none and gets zeros as InitCache does
+    int diff = new_chunk_size[0] - chunk_size[0];
+    chunk_size = new_chunk_size;
+    if(diff < 0){
+        std::vector<std::vector<float>> dropped(feats_cache_.begin(), feats_cache_.begin() - diff);
+        feats_cache_.erase(feats_cache_.begin(), feats_cache_.begin() - diff);
+        KeepHistory(dropped.begin(), dropped.end());
+    }else if(diff > 0){
+        size_t from_history = std::min((size_t)diff, feats_history_.size());
+        feats_cache_.insert(feats_cache_.begin(), feats_history_.end() - from_history, feats_history_.end());
+        feats_cache_.insert(feats_cache_.begin(), diff - from_history, std::vector<float>(feat_dims, 0));
+        feats_history_.erase(feats_history_.end() - from_history, feats_history_.end());
+    }
+    chunk_len = chunk_size[1]*frame_shift*lfr_n*offline_handle_->GetAsrSampleRate()/1000;
+    return true;
+}
+
+void ParaformerOnline::SetMaxLookback(int max_lookback)
+{
+    max_lookback_ = std::max(0, max_lookback);
+}
+
 ParaformerOnline::~ParaformerOnline()
 {
 }
@@ -62,6 +62,7 @@ namespace funasr {
         Model* offline_handle_ = nullptr;
         // from offline_handle_
         knf::FbankOptions fbank_opts_;
+        std::shared_ptr<const FbankExtractor> fbank_extractor_;
         std::shared_ptr<Ort::Session> encoder_session_ = nullptr;
         std::shared_ptr<Ort::Session> decoder_session_ = nullptr;
         Ort::SessionOptions session_options_;
@@ -98,10 +99,19 @@ namespace funasr {
         std::vector<std::vector<float>> lfr_splice_cache_;
         // position index cache
         int start_idx_cache_ = 0;
+        // frequencies of the position encoding, exp(i * scale)
+        std::vector<float> pos_inv_freq_;
         // cif alpha
         std::vector<float> alphas_cache_;
         std::vector<std::vector<float>> hidden_cache_;
         std::vector<std::vector<float>> feats_cache_;
+        // real frames right before feats_cache_, up to max_lookback_ minus the
+        // current lookback, so that a lookback grown by SetChunkSize sees audio
+        std::vector<std::vector<float>> feats_history_;
+        int max_lookback_ = 0;
+        // appends the frames leaving feats_cache_ to feats_history_
+        void KeepHistory(std::vector<std::vector<float>>::const_iterator begin,
+                         std::vector<std::vector<float>>::const_iterator end);
         // fsmn init caches
         std::vector<float> fsmn_init_cache_;
         std::vector<Ort::Value> decoder_onnx;
@@ -122,6 +132,12 @@ namespace funasr {
         string ForwardChunk(std::vector<std::vector<float>> &wav_feats, bool input_finished);
         string Forward(float* din, int len, bool input_finished, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr);
         string Rescoring();
+        // between two Forward calls; the lookback may change, the lookahead
+        // must stay since its frames are cached but not decoded yet
+        bool SetChunkSize(const std::vector<int> &new_chunk_size);
+        // the largest lookback SetChunkSize may switch to, its frames are kept
+        void SetMaxLookback(int max_lookback);
+        const std::vector<int> &GetChunkSize() const { return chunk_size; }
 
         int GetAsrSampleRate() { return offline_handle_->GetAsrSampleRate(); };
 
@@ -27,6 +27,7 @@ void ParaformerTorch::InitAsr(const std::string &am_model, const std::string &am
     fbank_opts_.frame_opts.frame_length_ms = frame_length;
     fbank_opts_.energy_floor = 0;
     fbank_opts_.mel_opts.debug_mel = false;
+    fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
 
     vocab = new Vocab(token_file.c_str());
 	phone_set_ = new PhoneSet(token_file.c_str());
@@ -68,10 +69,10 @@ void ParaformerTorch::InitLm(const std::string &lm_file,
                         const std::string &lm_cfg_file, 
                         const std::string &lex_file) {
     try {
-        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(
-            fst::Fst<fst::StdArc>::Read(lm_file));
+        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(ReadFst(lm_file));
         if (lm_){
             lm_vocab = new Vocab(lm_cfg_file.c_str(), lex_file.c_str());
+            wfst_pool_ = std::make_shared<WfstDecoderPool>(lm_, phone_set_, lm_vocab);
             LOG(INFO) << "Successfully load lm file " << lm_file;
         }else{
             LOG(ERROR) << "Failed to load lm file " << lm_file;
@@ -169,19 +170,7 @@ void ParaformerTorch::Reset()
 }
 
 void ParaformerTorch::FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats) {
-    knf::OnlineFbank fbank_(fbank_opts_);
-    std::vector<float> buf(len);
-    for (int32_t i = 0; i != len; ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank_.AcceptWaveform(sample_rate, buf.data(), buf.size());
-
-    int32_t frames = fbank_.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank_.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        asr_feats.emplace_back(frame_vector);
-    }
+    fbank_extractor_->Compute(waves, len, 32768, asr_feats);
 }
 
 void ParaformerTorch::LoadCmvn(const char *filename)
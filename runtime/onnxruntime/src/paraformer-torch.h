@@ -70,6 +70,7 @@ namespace funasr {
         PhoneSet* GetPhoneSet();
 		
         knf::FbankOptions fbank_opts_;
+        std::shared_ptr<const FbankExtractor> fbank_extractor_;
         vector<float> means_list_;
         vector<float> vars_list_;
         int lfr_m = PARA_LFR_M;
@@ -80,6 +81,8 @@ namespace funasr {
 
         // lm
         std::shared_ptr<fst::Fst<fst::StdArc>> lm_ = nullptr;
+        // warm decoders over lm_, shared by the connections of this model
+        std::shared_ptr<WfstDecoderPool> wfst_pool_ = nullptr;
 
         string window_type = "hamming";
         int frame_length = 25;
@@ -29,10 +29,11 @@ void Paraformer::InitAsr(const std::string &am_model, const std::string &am_cmvn
     fbank_opts_.frame_opts.frame_length_ms = frame_length;
     fbank_opts_.energy_floor = 0;
     fbank_opts_.mel_opts.debug_mel = false;
+    fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
     // fbank_ = std::make_unique<knf::OnlineFbank>(fbank_opts);
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
@@ -65,9 +66,10 @@ void Paraformer::InitAsr(const std::string &en_model, const std::string &de_mode
     fbank_opts_.frame_opts.frame_length_ms = frame_length;
     fbank_opts_.energy_floor = 0;
     fbank_opts_.mel_opts.debug_mel = false;
+    fbank_extractor_ = FbankExtractor::Get(fbank_opts_);
 
     // session_options_.SetInterOpNumThreads(1);
-    session_options_.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(session_options_, thread_num);
     session_options_.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     session_options_.DisableCpuMemArena();
@@ -153,10 +155,10 @@ void Paraformer::InitLm(const std::string &lm_file,
                         const std::string &lm_cfg_file, 
                         const std::string &lex_file) {
     try {
-        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(
-            fst::Fst<fst::StdArc>::Read(lm_file));
+        lm_ = std::shared_ptr<fst::Fst<fst::StdArc>>(ReadFst(lm_file));
         if (lm_){
             lm_vocab = new Vocab(lm_cfg_file.c_str(), lex_file.c_str());
+            wfst_pool_ = std::make_shared<WfstDecoderPool>(lm_, phone_set_, lm_vocab);
             LOG(INFO) << "Successfully load lm file " << lm_file;
         }else{
             LOG(ERROR) << "Failed to load lm file " << lm_file;
@@ -233,7 +235,7 @@ void Paraformer::LoadOnlineConfigFromYaml(const char* filename){
 }
 
 void Paraformer::InitHwCompiler(const std::string &hw_model, int thread_num) {
-    hw_session_options.SetIntraOpNumThreads(thread_num);
+    SetSessionThreads(hw_session_options, thread_num);
     hw_session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
     // DisableCpuMemArena can improve performance
     hw_session_options.DisableCpuMemArena();
@@ -296,19 +298,8 @@ void Paraformer::Reset()
 }
 
 void Paraformer::FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats) {
-    knf::OnlineFbank fbank_(fbank_opts_);
-    std::vector<float> buf(len);
-    for (int32_t i = 0; i != len; ++i) {
-        buf[i] = waves[i] * 32768;
-    }
-    fbank_.AcceptWaveform(sample_rate, buf.data(), buf.size());
-
-    int32_t frames = fbank_.NumFramesReady();
-    for (int32_t i = 0; i != frames; ++i) {
-        const float *frame = fbank_.GetFrame(i);
-        std::vector<float> frame_vector(frame, frame + fbank_opts_.mel_opts.num_bins);
-        asr_feats.emplace_back(frame_vector);
-    }
+    StageTimer timer(STAGE_FBANK);
+    fbank_extractor_->Compute(waves, len, 32768, asr_feats);
 }
 
 void Paraformer::LoadCmvn(const char *filename)
@@ -350,7 +341,18 @@ void Paraformer::LoadCmvn(const char *filename)
 
 string Paraformer::GreedySearch(float * in, int n_len,  int64_t token_nums, bool is_stamp, std::vector<float> us_alphas, std::vector<float> us_cif_peak)
 {
-    vector<int> hyps;
+    FUNASR_SEG_RESULT seg;
+    GreedySearch(in, n_len, token_nums, seg, is_stamp, us_alphas, us_cif_peak);
+    if(!is_stamp){
+        return seg.text;
+    }
+    return SegResultToString(seg);
+}
+
+void Paraformer::GreedySearch(float * in, int n_len,  int64_t token_nums, FUNASR_SEG_RESULT &seg, bool is_stamp, std::vector<float> us_alphas, std::vector<float> us_cif_peak)
+{
+    vector<int> &hyps = seg.token_ids;
+    hyps.clear();
     int Tmax = n_len;
     for (int i = 0; i < Tmax; i++) {
         int max_idx;
@@ -359,7 +361,9 @@ string Paraformer::GreedySearch(float * in, int n_len,  int64_t token_nums, bool
         hyps.push_back(max_idx);
     }
     if(!is_stamp){
-        return vocab->Vector2StringV2(hyps, language);
+        seg.text = vocab->Vector2StringV2(hyps, language);
+        seg.pieces.clear();
+        seg.stamps.clear();
     }else{
         std::vector<string> char_list;
         std::vector<std::vector<float>> timestamp_list;
@@ -368,7 +372,7 @@ string Paraformer::GreedySearch(float * in, int n_len,  int64_t token_nums, bool
         std::vector<string> raw_char(char_list);
         TimestampOnnx(us_alphas, us_cif_peak, char_list, res_str, timestamp_list);
 
-        return PostProcess(raw_char, timestamp_list);
+        PostProcess(raw_char, timestamp_list, seg);
     }
 }
 
@@ -383,6 +387,12 @@ string Paraformer::FinalizeDecode(WfstDecoder* &wfst_decoder,
   return wfst_decoder->FinalizeDecode(is_stamp, us_alphas, us_cif_peak);
 }
 
+void Paraformer::FinalizeDecode(WfstDecoder* &wfst_decoder, FUNASR_SEG_RESULT &seg,
+                                bool is_stamp, std::vector<float> us_alphas, std::vector<float> us_cif_peak)
+{
+  wfst_decoder->FinalizeDecode(seg, is_stamp, us_alphas, us_cif_peak);
+}
+
 void Paraformer::LfrCmvn(std::vector<std::vector<float>> &asr_feats) {
 
     std::vector<std::vector<float>> out_feats;
@@ -427,8 +437,18 @@ void Paraformer::LfrCmvn(std::vector<std::vector<float>> &asr_feats) {
 
 std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in)
 {
+    std::vector<FUNASR_SEG_RESULT> segs = ForwardSegs(din, len, input_finished, hw_emb, decoder_handle, batch_in);
     std::vector<std::string> results;
-    string result="";
+    for (auto &seg : segs) {
+        results.push_back(SegResultToString(seg));
+    }
+    return results;
+}
+
+std::vector<FUNASR_SEG_RESULT> Paraformer::ForwardSegs(float** din, int* len, bool input_finished, const std::vector<std::vector<float>> &hw_emb, void* decoder_handle, int batch_in)
+{
+    std::vector<FUNASR_SEG_RESULT> results;
+    FUNASR_SEG_RESULT result;
     WfstDecoder* wfst_decoder = (WfstDecoder*)decoder_handle;
     int32_t in_feat_dim = fbank_opts_.mel_opts.num_bins;
 
@@ -503,7 +523,9 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
     }
 
     try {
+        StageTimer encoder_timer(STAGE_ENCODER);
         auto outputTensor = m_session_->Run(Ort::RunOptions{nullptr}, m_szInputNames.data(), input_onnx.data(), input_onnx.size(), m_szOutputNames.data(), m_szOutputNames.size());
+        encoder_timer.Stop();
         std::vector<int64_t> outputShape = outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
         //LOG(INFO) << "paraformer out shape " << outputShape[0] << " " << outputShape[1] << " " << outputShape[2];
 
@@ -526,20 +548,20 @@ std::vector<std::string> Paraformer::Forward(float** din, int* len, bool input_f
                 us_peaks[i] = us_peaks_data[i];
             }
 			if (lm_ == nullptr) {
-                result = GreedySearch(floatData, *encoder_out_lens, outputShape[2], true, us_alphas, us_peaks);
+                GreedySearch(floatData, *encoder_out_lens, outputShape[2], result, true, us_alphas, us_peaks);
 			} else {
-			    result = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
+			    result.text = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
                 if (input_finished) {
-                    result = FinalizeDecode(wfst_decoder, true, us_alphas, us_peaks);
+                    FinalizeDecode(wfst_decoder, result, true, us_alphas, us_peaks);
                 }
 			}
         }else{
 			if (lm_ == nullptr) {
-                result = GreedySearch(floatData, *encoder_out_lens, outputShape[2]);
+                GreedySearch(floatData, *encoder_out_lens, outputShape[2], result);
 			} else {
-			    result = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
+			    result.text = BeamSearch(wfst_decoder, floatData, *encoder_out_lens, outputShape[2]);
                 if (input_finished) {
-                    result = FinalizeDecode(wfst_decoder);
+                    FinalizeDecode(wfst_decoder, result);
                 }
 			}
         }
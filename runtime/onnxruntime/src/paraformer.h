@@ -54,8 +54,11 @@ namespace funasr {
         void Reset();
         void FbankKaldi(float sample_rate, const float* waves, int len, std::vector<std::vector<float>> &asr_feats);
         std::vector<std::string> Forward(float** din, int* len, bool input_finished=true, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1);
+        std::vector<FUNASR_SEG_RESULT> ForwardSegs(float** din, int* len, bool input_finished=true, const std::vector<std::vector<float>> &hw_emb={{0.0}}, void* wfst_decoder=nullptr, int batch_in=1);
         string GreedySearch( float* in, int n_len, int64_t token_nums,
                              bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
+        void GreedySearch( float* in, int n_len, int64_t token_nums, FUNASR_SEG_RESULT &seg,
+                           bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
 
         string Rescoring();
         string GetLang(){return language;};
@@ -67,11 +70,14 @@ namespace funasr {
         string BeamSearch(WfstDecoder* &wfst_decoder, float* in, int n_len, int64_t token_nums);
         string FinalizeDecode(WfstDecoder* &wfst_decoder,
                           bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
+        void FinalizeDecode(WfstDecoder* &wfst_decoder, FUNASR_SEG_RESULT &seg,
+                          bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
         Vocab* GetVocab();
         Vocab* GetLmVocab();
         PhoneSet* GetPhoneSet();
 		
         knf::FbankOptions fbank_opts_;
+        std::shared_ptr<const FbankExtractor> fbank_extractor_;
         vector<float> means_list_;
         vector<float> vars_list_;
         int lfr_m = PARA_LFR_M;
@@ -100,6 +106,8 @@ namespace funasr {
 
         // lm
         std::shared_ptr<fst::Fst<fst::StdArc>> lm_ = nullptr;
+        // warm decoders over lm_, shared by the connections of this model
+        std::shared_ptr<WfstDecoderPool> wfst_pool_ = nullptr;
 
         string window_type = "hamming";
         int frame_length = 25;
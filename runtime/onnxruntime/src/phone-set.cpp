@@ -28,10 +28,8 @@ void PhoneSet::LoadPhoneSetFromYaml(const char* filename) {
      exit(-1);
   }
   YAML::Node myList = config["token_list"];
-  int id = 0;
-  for (YAML::const_iterator it = myList.begin(); it != myList.end(); ++it, id++) {
-    phone_.push_back(it->as<string>());
-    phn2Id_.emplace(it->as<string>(), id);
+  for (YAML::const_iterator it = myList.begin(); it != myList.end(); ++it) {
+    phone_.Add(it->as<string>());
   }
 }
 
@@ -46,38 +44,30 @@ void PhoneSet::LoadPhoneSetFromJson(const char* filename) {
         exit(-1);
     }
 
-    int id = 0;
     for (const auto& element : json_array) {
-        phone_.push_back(element);
-        phn2Id_.emplace(element, id);
-        id++;
+        phone_.Add(element.get<std::string>());
     }
 }
 
 int PhoneSet::Size() const {
-  return phone_.size();
+  return phone_.Size();
 }
 
-int PhoneSet::String2Id(string phn_str) const {
-  if (phn2Id_.count(phn_str)) {
-    return phn2Id_.at(phn_str);
-  } else {
-    //LOG(INFO) << "Phone unit not exist.";
-    return -1;
-  }
+int PhoneSet::String2Id(const string &phn_str) const {
+  return phone_.Find(phn_str);
 }
 
 string PhoneSet::Id2String(int id) const {
-  if (id < 0 || id > Size()) {
+  if (id < 0 || id >= Size()) {
     //LOG(INFO) << "Phone id not exist.";
     return "";
   } else {
-    return phone_[id];
+    return phone_.Str(id);
   }
 }
 
-bool PhoneSet::Find(string phn_str) const {
-  return phn2Id_.count(phn_str) > 0;
+bool PhoneSet::Find(const string &phn_str) const {
+  return phone_.Find(phn_str) != -1;
 }
 
 int PhoneSet::GetBegSilPhnId() const {
@@ -4,8 +4,8 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include "nlohmann/json.hpp"
+#include "token-table.h"
 #define UNIT_BEG_SIL_SYMBOL "<s>"
 #define UNIT_END_SIL_SYMBOL "</s>"
 #define UNIT_BLK_SYMBOL "<blank>"
@@ -18,16 +18,15 @@ class PhoneSet {
     PhoneSet(const char *filename);
     ~PhoneSet();
     int Size() const;
-    int String2Id(string str) const;
+    int String2Id(const string &str) const;
     string Id2String(int id) const;
-    bool Find(string str) const;
+    bool Find(const string &str) const;
     int GetBegSilPhnId() const;
     int GetEndSilPhnId() const;
     int GetBlkPhnId() const;
 
   private:
-    vector<string> phone_;
-    unordered_map<string, int> phn2Id_;
+    TokenTable phone_;
     void LoadPhoneSetFromYaml(const char* filename);
     void LoadPhoneSetFromJson(const char* filename);
 };
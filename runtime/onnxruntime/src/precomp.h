@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <atomic>
 #include <deque>
 #include <iostream>
 #include <fstream>
@@ -44,6 +45,13 @@ using namespace std;
 #include "common-struct.h"
 #include "com-define.h"
 #include "commonfunc.h"
+#include "metrics.h"
+#include "worker-pool.h"
+#include "fbank-extractor.h"
+#include "stream-decoder.h"
+#include "const-fst-io.h"
+#include "result-cache.h"
+#include "token-table.h"
 #include "predefine-coe.h"
 #include "model.h"
 #include "vad-model.h"
@@ -59,6 +67,7 @@ using namespace std;
 #include "wfst-decoder.h"
 #include "audio.h"
 #include "fsmn-vad-online.h"
+#include "vad-windows.h"
 #include "tensor.h"
 #include "util.h"
 #include "seg_dict.h"
@@ -70,6 +79,12 @@ using namespace std;
 #endif
 #include "paraformer-online.h"
 #include "offline-stream.h"
+#include "progressive-stream.h"
 #include "tpass-stream.h"
 #include "tpass-online-stream.h"
 #include "funasrruntime.h"
+#include "batch-engine.h"
+#include "chunk-policy.h"
+#include "warm-up.h"
+#include "session-threads.h"
+#include "model-registry.h"
@@ -0,0 +1,92 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+ProgressiveStream::ProgressiveStream(OfflineStream* offline_stream, int32_t sampling_rate)
+    : offline_stream(offline_stream)
+{
+    dest_sample_rate_ = offline_stream->asr_handle->GetAsrSampleRate();
+    if (offline_stream->UseVad()) {
+        vad_online_ = make_unique<FsmnVadOnline>((FsmnVad*)(offline_stream->vad_handle).get());
+        segmenter_ = make_unique<VadSegmenter>(vad_online_.get());
+    }
+    if (sampling_rate != dest_sample_rate_) {
+        // the filter of Audio::WavResample, fed piece by piece
+        float min_freq = std::min<int32_t>(sampling_rate, dest_sample_rate_);
+        float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+        int32_t lowpass_filter_width = 6;
+        resampler_ = make_unique<LinearResample>(sampling_rate, dest_sample_rate_, lowpass_cutoff, lowpass_filter_width);
+    }
+}
+
+bool ProgressiveStream::AcceptPcm(const char* buf, int n_len)
+{
+    StageTimer timer(STAGE_AUDIO_DECODE);
+    if (finished_ || n_len < 0) {
+        return false;
+    }
+    std::vector<char> joined;
+    if (!odd_byte_.empty()) {
+        joined.assign(odd_byte_.begin(), odd_byte_.end());
+        joined.insert(joined.end(), buf, buf + n_len);
+        buf = joined.data();
+        n_len = joined.size();
+        odd_byte_.clear();
+    }
+    int sample_num = n_len / 2;
+    if (n_len % 2) {
+        odd_byte_.push_back(buf[n_len - 1]);
+    }
+
+    // the conversion of Audio::LoadPcmwav with data_type 1
+    std::vector<float> pcm(sample_num);
+    const uint8_t* byte_buf = reinterpret_cast<const uint8_t*>(buf);
+    for (int32_t i = 0; i < sample_num; ++i) {
+        int16_t val = (int16_t)((byte_buf[2 * i + 1] << 8) | byte_buf[2 * i]);
+        pcm[i] = (float)val / 32768.0f;
+    }
+    if (resampler_) {
+        StageTimer resample_timer(STAGE_RESAMPLE);
+        std::vector<float> resampled;
+        resampler_->Resample(pcm.data(), pcm.size(), false, &resampled);
+        samples_.insert(samples_.end(), resampled.begin(), resampled.end());
+    } else {
+        samples_.insert(samples_.end(), pcm.begin(), pcm.end());
+    }
+    return true;
+}
+
+void ProgressiveStream::Split(bool input_finished, std::vector<std::vector<int>> &segments)
+{
+    if (finished_) {
+        return;
+    }
+    if (input_finished) {
+        finished_ = true;
+        if (resampler_) {
+            std::vector<float> resampled;
+            resampler_->Resample(nullptr, 0, true, &resampled);
+            samples_.insert(samples_.end(), resampled.begin(), resampled.end());
+        }
+    }
+    int speech_len = samples_.size();
+    if (!vad_online_) {
+        // the whole audio is one segment, as FunOfflineInferBuffer does without vad
+        if (input_finished && speech_len > 0) {
+            segments.push_back({0, speech_len});
+        }
+        return;
+    }
+
+    std::vector<std::vector<int>> vad_segments;
+    segmenter_->Feed(samples_.data(), speech_len, input_finished, vad_segments);
+    int seg_sample = MODEL_SAMPLE_RATE / 1000;
+    for (std::vector<int> &vad_segment : vad_segments) {
+        // the vad may end the last segment past the audio, as in Audio::CutSplit
+        segments.push_back({vad_segment[0] * seg_sample, std::min(vad_segment[1] * seg_sample, speech_len)});
+    }
+}
+} // namespace funasr
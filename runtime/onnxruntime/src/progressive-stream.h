@@ -0,0 +1,57 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// One offline request transcribed while its audio is still arriving. The
+// audio goes through the VadSegmenter that Audio::CutSplit runs over a
+// complete buffer, so the segments and therefore the result are those of the
+// batch path; a segment is decoded as soon as the vad closes it and only the
+// tail is left when the input ends. The exception is a handle with
+// FunOfflineSetVadThreadNum: CutSplit then runs long audio in windows, whose
+// segments may differ near the window boundaries, while the audio here can
+// only go through the serial pass.
+#ifndef PROGRESSIVE_STREAM_H
+#define PROGRESSIVE_STREAM_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "offline-stream.h"
+#include "punc-model.h"
+#include "resample.h"
+#include "vad-model.h"
+#include "vad-windows.h"
+
+namespace funasr {
+class ProgressiveStream {
+  public:
+    ProgressiveStream(OfflineStream* offline_stream, int32_t sampling_rate);
+    ~ProgressiveStream(){};
+
+    // pcm bytes as FunOfflineInferBuffer takes them, a chunk may end inside a sample
+    bool AcceptPcm(const char* buf, int n_len);
+    // appends the segments closed by the audio so far as [start, end) in samples.
+    // Until input_finished the last second stays back, as CutSplit only knows
+    // which step is the final one at the end of the buffer.
+    void Split(bool input_finished, std::vector<std::vector<int>> &segments);
+    const float* GetSpeechData() const { return samples_.data(); }
+    float GetTimeLen() const { return (float)samples_.size() / dest_sample_rate_; }
+
+    OfflineStream* offline_stream;
+    // decoded segments in audio order and the punctuated prefix of their text
+    std::vector<FUNASR_SEG_RESULT> segs;
+    std::vector<float> seg_stimes;
+    PuncProgress punc_progress;
+    std::string prefix;
+    size_t punc_len = 0;
+
+  private:
+    std::unique_ptr<VadModel> vad_online_ = nullptr;
+    std::unique_ptr<VadSegmenter> segmenter_ = nullptr;
+    std::unique_ptr<LinearResample> resampler_ = nullptr;
+    std::vector<float> samples_;
+    std::vector<char> odd_byte_;
+    int dest_sample_rate_;
+    bool finished_ = false;
+};
+} // namespace funasr
+#endif
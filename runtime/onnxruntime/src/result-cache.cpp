@@ -0,0 +1,66 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+static size_t SegBytes(const FUNASR_SEG_RESULT &seg)
+{
+    size_t bytes = sizeof(seg) + seg.text.size() + seg.token_ids.size() * sizeof(int);
+    for (auto &piece : seg.pieces) {
+        bytes += sizeof(piece) + piece.size();
+    }
+    bytes += seg.stamps.size() * (sizeof(std::vector<int>) + 2 * sizeof(int));
+    return bytes;
+}
+
+static size_t ResultBytes(const FUNASR_RECOG_RESULT &result)
+{
+    size_t bytes = sizeof(result) + result.msg.size() + result.tpass_msg.size();
+    bytes += result.stamp_list.size() * (sizeof(std::vector<int>) + 2 * sizeof(int));
+    for (auto &sent : result.stamp_sent_list) {
+        bytes += sizeof(sent) + sent.text_seg.size() + sent.punc.size() + sent.ts_list.size() * sizeof(int);
+    }
+    return bytes;
+}
+
+ResultCache::ResultCache(size_t result_bytes, size_t seg_bytes)
+{
+    if (result_bytes > 0) {
+        results_ = make_unique<LruCache<FUNASR_RECOG_RESULT>>(result_bytes);
+    }
+    if (seg_bytes > 0) {
+        segs_ = make_unique<LruCache<FUNASR_SEG_RESULT>>(seg_bytes);
+    }
+}
+
+bool ResultCache::GetResult(const std::string &key, FUNASR_RECOG_RESULT &result)
+{
+    bool hit = results_->Get(key, result);
+    MetricsCount(hit ? COUNTER_RESULT_CACHE_HITS : COUNTER_RESULT_CACHE_MISSES);
+    return hit;
+}
+
+void ResultCache::PutResult(const std::string &key, const FUNASR_RECOG_RESULT &result)
+{
+    // the serialized strings are rebuilt on demand from the lists
+    FUNASR_RECOG_RESULT entry = result;
+    entry.stamp.clear();
+    entry.stamp_sents.clear();
+    entry.stamp_array.clear();
+    results_->Put(key, entry, ResultBytes(entry));
+}
+
+bool ResultCache::GetSeg(const std::string &key, FUNASR_SEG_RESULT &seg)
+{
+    bool hit = segs_->Get(key, seg);
+    MetricsCount(hit ? COUNTER_SEG_CACHE_HITS : COUNTER_SEG_CACHE_MISSES);
+    return hit;
+}
+
+void ResultCache::PutSeg(const std::string &key, const FUNASR_SEG_RESULT &seg)
+{
+    segs_->Put(key, seg, SegBytes(seg));
+}
+} // namespace funasr
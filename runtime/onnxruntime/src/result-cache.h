@@ -0,0 +1,92 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Finished offline results of an OfflineStream, keyed by a hash of the input
+// and every option that changes the output, so a retried upload or a
+// resubmitted file is answered without decoding it again. A second tier keeps
+// the decoded vad segments, keyed by their samples, so audio that shares only
+// part of its segments with an earlier request reuses those. Both tiers are
+// bounded by the estimated size of their entries and evict the least recently
+// used first.
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common-struct.h"
+
+namespace funasr {
+template<typename V>
+class LruCache {
+  public:
+    explicit LruCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    bool Get(const std::string &key, V &value) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        value = it->second->value;
+        return true;
+    }
+
+    void Put(const std::string &key, const V &value, size_t bytes) {
+        bytes += key.size();
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (bytes > max_bytes_) {
+            return;
+        }
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            bytes_ -= it->second->bytes;
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        lru_.push_front({key, value, bytes});
+        index_[key] = lru_.begin();
+        bytes_ += bytes;
+        while (bytes_ > max_bytes_) {
+            bytes_ -= lru_.back().bytes;
+            index_.erase(lru_.back().key);
+            lru_.pop_back();
+        }
+    }
+
+  private:
+    struct Entry {
+        std::string key;
+        V value;
+        size_t bytes;
+    };
+    std::mutex mtx_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+};
+
+class ResultCache {
+  public:
+    // a tier with 0 bytes is left out
+    ResultCache(size_t result_bytes, size_t seg_bytes);
+
+    bool UseResults() const { return results_ != nullptr; }
+    bool GetResult(const std::string &key, FUNASR_RECOG_RESULT &result);
+    void PutResult(const std::string &key, const FUNASR_RECOG_RESULT &result);
+    bool UseSegs() const { return segs_ != nullptr; }
+    bool GetSeg(const std::string &key, FUNASR_SEG_RESULT &seg);
+    void PutSeg(const std::string &key, const FUNASR_SEG_RESULT &seg);
+
+  private:
+    std::unique_ptr<LruCache<FUNASR_RECOG_RESULT>> results_ = nullptr;
+    std::unique_ptr<LruCache<FUNASR_SEG_RESULT>> segs_ = nullptr;
+};
+} // namespace funasr
+#endif
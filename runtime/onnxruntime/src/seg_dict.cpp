@@ -31,19 +31,26 @@ SegDict::SegDict(const char *filename)
         std::string word = line_item[0];
         std::string segs = line_item[1];
         std::vector<string> segs_vec = split(segs, ' ');
-        seg_dict[word] = segs_vec;
+        words_.Add(word, true);
+        for (auto &seg : segs_vec) {
+          seg_ids_.push_back(pieces_.Intern(seg));
+        }
+        seg_offsets_.push_back(seg_ids_.size());
       }
     }
     LOG(INFO) << "load seg dict successfully";
 }
 std::vector<std::string> SegDict::GetTokensByWord(const std::string &word) {
-  if (seg_dict.count(word))
-    return seg_dict[word];
-  else {
+  std::vector<string> vec;
+  int id = words_.Find(word);
+  if (id != -1) {
+    for (uint32_t i = seg_offsets_[id]; i < seg_offsets_[id + 1]; i++) {
+      vec.emplace_back(pieces_.Str(seg_ids_[i]));
+    }
+  } else {
     LOG(INFO)<< word <<" is OOV!";
-    std::vector<string> vec;
-    return vec;
   }
+  return vec;
 }
 
 SegDict::~SegDict()
@@ -8,13 +8,17 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
-#include <map>
+#include "token-table.h"
 using namespace std;
 
 namespace funasr {
 class SegDict {
   private:
-    std::map<string, std::vector<string>> seg_dict;
+    // the pieces of word i are pieces_ ids seg_ids_[seg_offsets_[i], seg_offsets_[i + 1])
+    TokenTable words_;
+    TokenTable pieces_;
+    std::vector<int> seg_ids_;
+    std::vector<uint32_t> seg_offsets_ = {0};
 
   public:
     SegDict(const char *filename);
@@ -64,6 +64,7 @@ namespace funasr {
         // PhoneSet* GetPhoneSet();
 		
         knf::FbankOptions fbank_opts_;
+        std::shared_ptr<const FbankExtractor> fbank_extractor_;
         vector<float> means_list_;
         vector<float> vars_list_;
         int lfr_m = PARA_LFR_M;
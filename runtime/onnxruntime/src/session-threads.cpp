@@ -0,0 +1,48 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#include <mutex>
+
+namespace funasr {
+static std::mutex shared_env_mtx;
+// kept for the life of the process, the Env of every model refers to it
+static std::unique_ptr<Ort::Env> shared_env;
+static std::atomic<bool> shared_pools(false);
+
+bool EnableSharedThreadPools(int intra_threads, int inter_threads)
+{
+    std::lock_guard<std::mutex> lock(shared_env_mtx);
+    if (shared_env) {
+        LOG(ERROR) << "Shared thread pools are already enabled";
+        return false;
+    }
+    try {
+        Ort::ThreadingOptions threading_options;
+        threading_options.SetGlobalIntraOpNumThreads(intra_threads);
+        threading_options.SetGlobalInterOpNumThreads(inter_threads);
+        shared_env = std::make_unique<Ort::Env>(threading_options, ORT_LOGGING_LEVEL_ERROR, "funasr");
+    } catch (std::exception const &e) {
+        LOG(ERROR) << "Error when creating the shared thread pools: " << e.what();
+        return false;
+    }
+    shared_pools = true;
+    LOG(INFO) << "Onnx sessions share a pool of " << intra_threads << " intra-op threads";
+    return true;
+}
+
+bool SharedThreadPoolsEnabled()
+{
+    return shared_pools;
+}
+
+void SetSessionThreads(Ort::SessionOptions &session_options, int thread_num)
+{
+    if (shared_pools) {
+        session_options.DisablePerSessionThreads();
+    } else {
+        session_options.SetIntraOpNumThreads(thread_num);
+    }
+}
+} // namespace funasr
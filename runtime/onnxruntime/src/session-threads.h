@@ -0,0 +1,26 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Thread pools of the onnx sessions. Each session owns an intra-op pool of
+// thread_num threads by default, so a process hosting several model sets runs
+// a pool per session and the pools compete for the cores. With shared pools,
+// the process-wide Ort::Env carries one global pool and every session created
+// afterwards runs on it. Ort keeps a single Env per process and takes the
+// threading options of the first one only, so EnableSharedThreadPools has to
+// run before any model loads.
+#ifndef SESSION_THREADS_H
+#define SESSION_THREADS_H
+
+namespace Ort {
+struct SessionOptions;
+}
+
+namespace funasr {
+// false if the pools are already set up or the Env cannot be created
+bool EnableSharedThreadPools(int intra_threads, int inter_threads = 1);
+bool SharedThreadPoolsEnabled();
+// SetIntraOpNumThreads(thread_num), or the shared pools once enabled
+void SetSessionThreads(Ort::SessionOptions &session_options, int thread_num);
+} // namespace funasr
+#endif
@@ -0,0 +1,309 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+#if !defined(__APPLE__)
+extern "C" {
+#include <libavutil/opt.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+#endif
+
+namespace funasr {
+#if defined(__APPLE__)
+StreamDecoder* StreamDecoder::Create(const std::string &format, int out_sample_rate)
+{
+    LOG(ERROR) << "Compressed streams are not supported on this platform: " << format;
+    return nullptr;
+}
+
+StreamDecoder::~StreamDecoder() {}
+
+bool StreamDecoder::Decode(const char *buf, int len, bool flush, std::vector<float> &samples)
+{
+    return false;
+}
+#else
+StreamDecoder* StreamDecoder::Create(const std::string &format, int out_sample_rate)
+{
+    std::string name = format;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    StreamDecoder *decoder = nullptr;
+    if (name == "opus" || name == "ogg" || name == "opus-packet") {
+        const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_OPUS);
+        if (codec == nullptr) {
+            LOG(ERROR) << "FFmpeg is built without an opus decoder";
+            return nullptr;
+        }
+        bool packet_per_chunk = (name == "opus-packet");
+        decoder = new StreamDecoder(codec, !packet_per_chunk, packet_per_chunk, out_sample_rate);
+        // the ogg stream carries the codec setup in its first packet
+        if (packet_per_chunk && !decoder->OpenCodec(nullptr, 0)) {
+            delete decoder;
+            return nullptr;
+        }
+        return decoder;
+    }
+
+    const AVCodec *codec = avcodec_find_decoder_by_name(name.c_str());
+    if (codec == nullptr) {
+        LOG(ERROR) << "Unsupported wav_format: " << format;
+        return nullptr;
+    }
+    AVCodecParserContext *parser = av_parser_init(codec->id);
+    if (parser == nullptr) {
+        // without a parser the chunk boundaries would have to be packet boundaries
+        LOG(ERROR) << "No stream parser for wav_format: " << format;
+        return nullptr;
+    }
+    decoder = new StreamDecoder(codec, false, false, out_sample_rate);
+    decoder->parser_ = parser;
+    if (!decoder->OpenCodec(nullptr, 0)) {
+        delete decoder;
+        return nullptr;
+    }
+    return decoder;
+}
+
+StreamDecoder::StreamDecoder(const AVCodec *codec, bool ogg, bool packet_per_chunk, int out_sample_rate)
+    : codec_(codec), out_sample_rate_(out_sample_rate), ogg_(ogg), packet_per_chunk_(packet_per_chunk)
+{
+    packet_ = av_packet_alloc();
+    frame_ = av_frame_alloc();
+}
+
+StreamDecoder::~StreamDecoder()
+{
+    if (parser_ != nullptr) {
+        av_parser_close(parser_);
+    }
+    avcodec_free_context(&codec_ctx_);
+    swr_free(&swr_ctx_);
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+}
+
+bool StreamDecoder::OpenCodec(const unsigned char *extradata, int extradata_size)
+{
+    codec_ctx_ = avcodec_alloc_context3(codec_);
+    if (codec_ctx_ == nullptr) {
+        LOG(ERROR) << "Failed to allocate codec context";
+        return false;
+    }
+    if (codec_->id == AV_CODEC_ID_OPUS) {
+        // raw packets carry no setup, decode them as mono; OpusHead has the channel count at byte 9
+        codec_ctx_->sample_rate = 48000;
+        codec_ctx_->channels = (extradata_size > 9) ? extradata[9] : 1;
+    }
+    if (extradata_size > 0) {
+        codec_ctx_->extradata = (uint8_t*)av_mallocz(extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        memcpy(codec_ctx_->extradata, extradata, extradata_size);
+        codec_ctx_->extradata_size = extradata_size;
+    }
+    if (avcodec_open2(codec_ctx_, codec_, nullptr) < 0) {
+        LOG(ERROR) << "Error: Could not open audio decoder.";
+        avcodec_free_context(&codec_ctx_);
+        return false;
+    }
+    return true;
+}
+
+bool StreamDecoder::Decode(const char *buf, int len, bool flush, std::vector<float> &samples)
+{
+    StageTimer timer(STAGE_AUDIO_DECODE);
+    if (ogg_) {
+        if (!DecodeOgg(buf, len, samples)) {
+            return false;
+        }
+    } else if (packet_per_chunk_) {
+        if (len > 0 && !DecodePacket((const unsigned char*)buf, len, samples)) {
+            return false;
+        }
+    } else {
+        // the parsers read past the end, hand them a padded copy
+        pending_.assign(buf, buf + len);
+        pending_.resize(len + AV_INPUT_BUFFER_PADDING_SIZE, 0);
+        const uint8_t *data = pending_.data();
+        int size = len;
+        while (size > 0 || flush) {
+            int ret = av_parser_parse2(parser_, codec_ctx_, &packet_->data, &packet_->size, data, size,
+                                       AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            if (ret < 0) {
+                LOG(ERROR) << "Error while parsing the audio stream";
+                return false;
+            }
+            data += ret;
+            size -= ret;
+            if (packet_->size > 0) {
+                if (avcodec_send_packet(codec_ctx_, packet_) < 0) {
+                    LOG(WARNING) << "Skip a corrupt audio packet";
+                } else if (!ReceiveFrames(samples)) {
+                    return false;
+                }
+            } else if (size == 0) {
+                // the parser has nothing left to return
+                break;
+            }
+        }
+        packet_->data = nullptr;
+        packet_->size = 0;
+    }
+
+    if (flush) {
+        if (codec_ctx_ != nullptr) {
+            avcodec_send_packet(codec_ctx_, nullptr);
+            if (!ReceiveFrames(samples)) {
+                return false;
+            }
+        }
+        if (swr_ctx_ != nullptr && !Resample(nullptr, 0, samples)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamDecoder::DecodeOgg(const char *buf, int len, std::vector<float> &samples)
+{
+    pending_.insert(pending_.end(), buf, buf + len);
+    size_t pos = 0;
+    while (pending_.size() - pos >= 27) {
+        const unsigned char *page = pending_.data() + pos;
+        if (memcmp(page, "OggS", 4) != 0) {
+            // resync at the next capture pattern
+            const unsigned char *end = pending_.data() + pending_.size();
+            const unsigned char *next = std::search(page + 1, end, "OggS", "OggS" + 4);
+            pos = next - pending_.data();
+            continue;
+        }
+        int segments = page[26];
+        if (pending_.size() - pos < 27 + segments) {
+            break;
+        }
+        const unsigned char *lacing = page + 27;
+        size_t body_len = 0;
+        for (int i = 0; i < segments; i++) {
+            body_len += lacing[i];
+        }
+        size_t page_len = 27 + segments + body_len;
+        if (pending_.size() - pos < page_len) {
+            break;
+        }
+
+        unsigned int serial = page[14] | (page[15] << 8) | (page[16] << 16) | ((unsigned int)page[17] << 24);
+        if (ogg_headers_ == 0 && ogg_packet_.empty()) {
+            ogg_serial_ = serial;
+        }
+        // other logical streams of a multiplexed file are skipped
+        if (serial == ogg_serial_) {
+            const unsigned char *data = lacing + segments;
+            for (int i = 0; i < segments; i++) {
+                ogg_packet_.insert(ogg_packet_.end(), data, data + lacing[i]);
+                data += lacing[i];
+                // a lacing value below 255 ends the packet
+                if (lacing[i] < 255) {
+                    bool ok = DecodeOggPacket(samples);
+                    ogg_packet_.clear();
+                    if (!ok) {
+                        return false;
+                    }
+                }
+            }
+        }
+        pos += page_len;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + pos);
+    return true;
+}
+
+bool StreamDecoder::DecodeOggPacket(std::vector<float> &samples)
+{
+    if (ogg_headers_ == 0) {
+        ogg_headers_++;
+        if (ogg_packet_.size() < 19 || memcmp(ogg_packet_.data(), "OpusHead", 8) != 0) {
+            LOG(ERROR) << "Only Opus is supported in an ogg stream";
+            return false;
+        }
+        return OpenCodec(ogg_packet_.data(), ogg_packet_.size());
+    }
+    if (ogg_headers_ == 1) {
+        // OpusTags
+        ogg_headers_++;
+        return true;
+    }
+    return DecodePacket(ogg_packet_.data(), ogg_packet_.size(), samples);
+}
+
+bool StreamDecoder::DecodePacket(const unsigned char *data, int size, std::vector<float> &samples)
+{
+    if (av_new_packet(packet_, size) < 0) {
+        LOG(ERROR) << "Failed to allocate an audio packet";
+        return false;
+    }
+    memcpy(packet_->data, data, size);
+    int ret = avcodec_send_packet(codec_ctx_, packet_);
+    av_packet_unref(packet_);
+    if (ret < 0) {
+        // a damaged packet costs its own 20ms, not the stream
+        LOG(WARNING) << "Skip a corrupt audio packet";
+        return true;
+    }
+    return ReceiveFrames(samples);
+}
+
+bool StreamDecoder::ReceiveFrames(std::vector<float> &samples)
+{
+    int ret;
+    while ((ret = avcodec_receive_frame(codec_ctx_, frame_)) >= 0) {
+        if (!Resample((const unsigned char**)frame_->extended_data, frame_->nb_samples, samples)) {
+            return false;
+        }
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        LOG(WARNING) << "Error while decoding the audio stream";
+    }
+    return true;
+}
+
+bool StreamDecoder::Resample(const unsigned char **in, int in_samples, std::vector<float> &samples)
+{
+    if (swr_ctx_ == nullptr) {
+        swr_in_rate_ = codec_ctx_->sample_rate;
+        swr_ctx_ = swr_alloc_set_opts(
+            nullptr,
+            AV_CH_LAYOUT_MONO,
+            AV_SAMPLE_FMT_FLT,
+            out_sample_rate_,
+            av_get_default_channel_layout(codec_ctx_->channels),
+            codec_ctx_->sample_fmt,
+            codec_ctx_->sample_rate,
+            0,
+            nullptr
+        );
+        if (swr_ctx_ == nullptr || swr_init(swr_ctx_) != 0) {
+            LOG(ERROR) << "Could not initialize resampler";
+            swr_free(&swr_ctx_);
+            return false;
+        }
+    }
+    int out_samples = av_rescale_rnd(swr_get_delay(swr_ctx_, swr_in_rate_) + in_samples,
+                                     out_sample_rate_, swr_in_rate_, AV_ROUND_UP);
+    size_t offset = samples.size();
+    samples.resize(offset + out_samples);
+    uint8_t *out = (uint8_t*)(samples.data() + offset);
+    int ret = swr_convert(swr_ctx_, &out, out_samples, (const uint8_t**)in, in_samples);
+    if (ret < 0) {
+        LOG(ERROR) << "Error resampling audio";
+        samples.resize(offset);
+        return false;
+    }
+    samples.resize(offset + ret);
+    return true;
+}
+#endif
+} // namespace funasr
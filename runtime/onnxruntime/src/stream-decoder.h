@@ -0,0 +1,65 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Incremental decoder of one compressed audio stream on the 2pass path. The
+// codec, parser and resampler live as long as the stream, so every chunk a
+// client sends is decoded when it arrives. Formats:
+//   opus          Ogg Opus byte stream (.opus files, most encoders), any chunking
+//   ogg           same as opus
+//   opus-packet   one raw Opus packet per chunk, as sent by WebRTC style clients
+//   anything else the name of an FFmpeg decoder with a parser (mp3, aac, flac, ...),
+//                 any chunking
+#ifndef STREAM_DECODER_H
+#define STREAM_DECODER_H
+#include <string>
+#include <vector>
+
+struct AVCodec;
+struct AVCodecContext;
+struct AVCodecParserContext;
+struct AVPacket;
+struct AVFrame;
+struct SwrContext;
+
+namespace funasr {
+class StreamDecoder {
+  public:
+    // nullptr if the format is not supported
+    static StreamDecoder* Create(const std::string &format, int out_sample_rate);
+    ~StreamDecoder();
+
+    // decodes len bytes of the stream and appends the samples to samples, mono
+    // float in [-1, 1] at out_sample_rate. flush drains the codec and the
+    // resampler at the end of the stream.
+    bool Decode(const char *buf, int len, bool flush, std::vector<float> &samples);
+
+  private:
+    StreamDecoder(const AVCodec *codec, bool ogg, bool packet_per_chunk, int out_sample_rate);
+    bool OpenCodec(const unsigned char *extradata, int extradata_size);
+    bool DecodeOgg(const char *buf, int len, std::vector<float> &samples);
+    bool DecodeOggPacket(std::vector<float> &samples);
+    bool DecodePacket(const unsigned char *data, int size, std::vector<float> &samples);
+    bool ReceiveFrames(std::vector<float> &samples);
+    bool Resample(const unsigned char **in, int in_samples, std::vector<float> &samples);
+
+    const AVCodec *codec_ = nullptr;
+    AVCodecContext *codec_ctx_ = nullptr;
+    AVCodecParserContext *parser_ = nullptr;
+    SwrContext *swr_ctx_ = nullptr;
+    AVPacket *packet_ = nullptr;
+    AVFrame *frame_ = nullptr;
+    int out_sample_rate_;
+    // the resampler follows the first decoded frame
+    int swr_in_rate_ = 0;
+    bool ogg_;
+    bool packet_per_chunk_;
+    // input not parsed yet, padded for the ffmpeg parsers
+    std::vector<unsigned char> pending_;
+    // ogg demuxing: the packet spanning pages, the stream serial and the header packets seen
+    std::vector<unsigned char> ogg_packet_;
+    unsigned int ogg_serial_ = 0;
+    int ogg_headers_ = 0;
+};
+} // namespace funasr
+#endif
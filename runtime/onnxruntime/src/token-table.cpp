@@ -0,0 +1,121 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+bool IsCjkChar(const char *data, size_t size)
+{
+    if (size != 3) {
+        return false;
+    }
+    if (((data[0] & 0xf0) != 0xe0) || ((data[1] & 0xc0) != 0x80) || ((data[2] & 0xc0) != 0x80)) {
+        return false;
+    }
+    int unicode = ((data[0] & 0x0f) << 12) | ((data[1] & 0x3f) << 6) | (data[2] & 0x3f);
+    return unicode >= 19968 && unicode <= 40959;
+}
+
+static bool Contains(const char *data, size_t size, const char *part)
+{
+    size_t len = strlen(part);
+    return std::search(data, data + size, part, part + len) != data + size;
+}
+
+static uint8_t PieceFlags(const char *data, size_t size)
+{
+    uint8_t flags = 0;
+    if (IsCjkChar(data, size)) {
+        flags |= TOKEN_CJK;
+    }
+    if (Contains(data, size, "@@")) {
+        flags |= TOKEN_SUBWORD;
+    }
+    if (Contains(data, size, "▁")) {
+        flags |= TOKEN_WORD_START;
+    }
+    TokenPiece piece = {data, size};
+    if (piece == "<s>" || piece == "</s>" || piece == "<unk>") {
+        flags |= TOKEN_SPECIAL;
+    }
+    return flags;
+}
+
+void TokenTable::Reserve(size_t pieces, size_t bytes)
+{
+    arena_.reserve(bytes);
+    offsets_.reserve(pieces + 1);
+    hashes_.reserve(pieces);
+    flags_.reserve(pieces);
+}
+
+size_t TokenTable::Slot(const char *data, size_t size, uint32_t hash) const
+{
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot] != -1) {
+        int id = slots_[slot];
+        if (hashes_[id] == hash && offsets_[id + 1] - offsets_[id] == size &&
+            memcmp(arena_.data() + offsets_[id], data, size) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void TokenTable::Grow()
+{
+    std::vector<int32_t> old;
+    old.swap(slots_);
+    slots_.assign(old.empty() ? 64 : old.size() * 2, -1);
+    size_t mask = slots_.size() - 1;
+    for (int32_t id : old) {
+        if (id == -1) {
+            continue;
+        }
+        // the old slots hold every piece at most once
+        size_t slot = hashes_[id] & mask;
+        while (slots_[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = id;
+    }
+}
+
+int TokenTable::Add(const char *data, size_t size, bool replace)
+{
+    if ((indexed_ + 1) * 2 > slots_.size()) {
+        Grow();
+    }
+    int id = flags_.size();
+    uint32_t hash = HashBytes(data, size);
+    size_t slot = Slot(data, size, hash);
+    arena_.append(data, size);
+    offsets_.push_back(arena_.size());
+    hashes_.push_back(hash);
+    flags_.push_back(PieceFlags(data, size));
+    if (slots_[slot] == -1) {
+        slots_[slot] = id;
+        indexed_++;
+    } else if (replace) {
+        slots_[slot] = id;
+    }
+    return id;
+}
+
+int TokenTable::Intern(const std::string &piece)
+{
+    int id = Find(piece);
+    return id != -1 ? id : Add(piece);
+}
+
+int TokenTable::Find(const char *data, size_t size) const
+{
+    if (slots_.empty()) {
+        return -1;
+    }
+    return slots_[Slot(data, size, HashBytes(data, size))];
+}
+} // namespace funasr
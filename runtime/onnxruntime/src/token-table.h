@@ -0,0 +1,69 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// The pieces of a token list packed into one string, with an open addressing
+// index from piece to id and the properties detokenization asks about computed
+// once per id at load. A lookup hashes the bytes where they are and a piece is
+// handed out as pointer and length, so neither side copies a token. The table
+// is filled while a model loads and only read afterwards.
+#ifndef TOKEN_TABLE_H
+#define TOKEN_TABLE_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace funasr {
+enum TokenFlag : uint8_t {
+    TOKEN_CJK = 1,          // one character of the CJK unified ideographs
+    TOKEN_SUBWORD = 2,      // a bpe piece with a continuation mark, "lo@@"
+    TOKEN_WORD_START = 4,   // a sentencepiece piece with the word boundary "▁"
+    TOKEN_SPECIAL = 8,      // <s>, </s> and <unk>
+};
+
+struct TokenPiece {
+    const char *data;
+    size_t size;
+
+    std::string Str() const { return std::string(data, size); }
+    bool operator==(const char *s) const { return size == strlen(s) && memcmp(data, s, size) == 0; }
+};
+
+// a utf-8 string of exactly one character between U+4E00 and U+9FFF
+bool IsCjkChar(const char *data, size_t size);
+
+class TokenTable {
+  public:
+    // the piece gets the next id even if it is already in the table; the index
+    // keeps pointing at its first id, or at the new one with replace
+    int Add(const char *data, size_t size, bool replace = false);
+    int Add(const std::string &piece, bool replace = false) { return Add(piece.data(), piece.size(), replace); }
+    // the id of the piece, added if it is not in the table yet
+    int Intern(const std::string &piece);
+    void Reserve(size_t pieces, size_t bytes);
+
+    // -1 if the piece is not in the table
+    int Find(const char *data, size_t size) const;
+    int Find(const std::string &piece) const { return Find(piece.data(), piece.size()); }
+    TokenPiece Piece(int id) const { return {arena_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]}; }
+    std::string Str(int id) const { return arena_.substr(offsets_[id], offsets_[id + 1] - offsets_[id]); }
+    uint8_t Flags(int id) const { return flags_[id]; }
+    int Size() const { return flags_.size(); }
+
+  private:
+    size_t Slot(const char *data, size_t size, uint32_t hash) const;
+    void Grow();
+
+    std::string arena_;
+    // piece i is arena_[offsets_[i], offsets_[i + 1])
+    std::vector<uint32_t> offsets_ = {0};
+    std::vector<uint32_t> hashes_;
+    std::vector<uint8_t> flags_;
+    // ids by hash, -1 for a free slot; at most half full
+    std::vector<int32_t> slots_;
+    size_t indexed_ = 0;
+};
+} // namespace funasr
+#endif
@@ -101,8 +101,7 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile)
 			{
 				if (Tokens[i].IsScalar())
 				{
-					m_id2token.push_back(Tokens[i].as<string>());
-					m_token2id.insert(make_pair<string, int>(Tokens[i].as<string>(), i));
+					m_tokens.Add(Tokens[i].as<string>());
 				}
 			}
 		}
@@ -113,11 +112,11 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile)
 			{
 				if (Puncs[i].IsScalar())
 				{ 
-					m_id2punc.push_back(Puncs[i].as<string>());
-					m_punc2id.insert(make_pair<string, int>(Puncs[i].as<string>(), i));
+					m_puncs.Add(Puncs[i].as<string>());
 				}
 			}
 		}
+		m_unk_id = std::max(m_tokens.Find(UNK_CHAR), 0);
 	}
 	catch (YAML::BadFile& e) {
 		LOG(ERROR) << "Read error!";
@@ -151,8 +150,7 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile, const char* token_file)
 			{
 				if (Puncs[i].IsScalar())
 				{ 
-					m_id2punc.push_back(Puncs[i].as<string>());
-					m_punc2id.insert(make_pair<string, int>(Puncs[i].as<string>(), i));
+					m_puncs.Add(Puncs[i].as<string>());
 				}
 			}
 		}
@@ -167,12 +165,10 @@ bool CTokenizer::OpenYaml(const char* sz_yamlfile, const char* token_file)
 			return  false;
 		}
 
-		int i = 0;
 		for (const auto& element : json_array) {
-			m_id2token.push_back(element);
-			m_token2id[element] = i;
-			i++;
+			m_tokens.Add(element.get<std::string>(), true);
 		}
+		m_unk_id = std::max(m_tokens.Find(UNK_CHAR), 0);
 	}
 	catch (YAML::BadFile& e) {
 		LOG(ERROR) << "Read error!";
@@ -187,31 +183,28 @@ vector<string> CTokenizer::Id2String(vector<int> input)
 	vector<string> result;
 	for (auto& item : input)
 	{
-		result.push_back(m_id2token[item]);
+		result.push_back(m_tokens.Str(item));
 	}
 	return result;
 }
 
-int CTokenizer::String2Id(string input)
+int CTokenizer::String2Id(const string& input)
 {
-	int nID = 0; // <blank>
-	if (m_token2id.find(input) != m_token2id.end())
-		nID=(m_token2id[input]);
-	else
-		nID=(m_token2id[UNK_CHAR]);
-	return nID;
+	int nID = m_tokens.Find(input);
+	return nID != -1 ? nID : m_unk_id;
 }
 
-vector<int> CTokenizer::String2Ids(vector<string> input)
+vector<int> CTokenizer::String2Ids(const vector<string>& input)
 {
 	vector<int> result;
+	result.reserve(input.size());
+	string lower;
 	for (auto& item : input)
 	{	
-		transform(item.begin(), item.end(), item.begin(), ::tolower);
-		if (m_token2id.find(item) != m_token2id.end())
-			result.push_back(m_token2id[item]);
-		else
-			result.push_back(m_token2id[UNK_CHAR]);
+		lower.assign(item);
+		transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+		int nID = m_tokens.Find(lower);
+		result.push_back(nID != -1 ? nID : m_unk_id);
 	}
 	return result;
 }
@@ -221,29 +214,29 @@ vector<string> CTokenizer::Id2Punc(vector<int> input)
 	vector<string> result;
 	for (auto& item : input)
 	{
-		result.push_back(m_id2punc[item]);
+		result.push_back(m_puncs.Str(item));
 	}
 	return result;
 }
 
 string CTokenizer::Id2Punc(int n_punc_id)
 {
-	return m_id2punc[n_punc_id];
+	return m_puncs.Str(n_punc_id);
 }
 
-vector<int> CTokenizer::Punc2Ids(vector<string> input)
+vector<int> CTokenizer::Punc2Ids(const vector<string>& input)
 {
 	vector<int> result;
 	for (auto& item : input)
 	{
-		result.push_back(m_punc2id[item]);
+		result.push_back(std::max(m_puncs.Find(item), 0));
 	}
 	return result;
 }
 
-bool CTokenizer::IsPunc(string& Punc)
+bool CTokenizer::IsPunc(const string& Punc)
 {
-	if (m_punc2id.find(Punc) != m_punc2id.end())
+	if (m_puncs.Find(Punc) != -1)
 		return true;
 	else
 		return false;
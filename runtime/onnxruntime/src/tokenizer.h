@@ -15,8 +15,8 @@ class CTokenizer {
 private:
 
 	bool  m_ready = false;
-	vector<string>   m_id2token,m_id2punc;
-	map<string, int>  m_token2id,m_punc2id;
+	TokenTable m_tokens,m_puncs;
+	int m_unk_id = 0;
 
 	cppjieba::DictTrie *jieba_dict_trie_=nullptr;
     cppjieba::HMMModel *jieba_model_=nullptr;
@@ -31,16 +31,16 @@ public:
 	bool OpenYaml(const char* sz_yamlfile, const char* token_file);
 	void ReadYaml(const YAML::Node& node);
 	vector<string> Id2String(vector<int> input);
-	vector<int> String2Ids(vector<string> input);
-	int String2Id(string input);
+	vector<int> String2Ids(const vector<string>& input);
+	int String2Id(const string& input);
 	vector<string> Id2Punc(vector<int> input);
 	string Id2Punc(int n_punc_id);
-	vector<int> Punc2Ids(vector<string> input);
+	vector<int> Punc2Ids(const vector<string>& input);
 	vector<string> SplitChineseString(const string& str_info);
 	vector<string> SplitChineseJieba(const string& str_info);
 	void StrSplit(const string& str, const char split, vector<string>& res);
 	void Tokenize(const char* str_info, vector<string>& str_out, vector<int>& id_out);
-	bool IsPunc(string& Punc);
+	bool IsPunc(const string& Punc);
 	bool seg_jieba = false;
 	void SetJiebaRes(cppjieba::DictTrie *dict, cppjieba::HMMModel *hmm);
 	void JiebaInit(std::string punc_config);
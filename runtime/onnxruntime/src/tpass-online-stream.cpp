@@ -16,6 +16,17 @@ TpassOnlineStream::TpassOnlineStream(TpassStream* tpass_stream, std::vector<int>
         LOG(ERROR)<<"asr_handle is null";
         exit(-1);
     }
+
+    if(tpass_obj->GetOfflinePool()){
+        offline_strand = make_unique<WorkerStrand>(tpass_obj->GetOfflinePool());
+    }
+}
+
+TpassOnlineStream::~TpassOnlineStream(){
+    // queued segments still use the stream and the caller's decoder handle
+    if(offline_strand){
+        offline_strand->Wait();
+    }
 }
 
 TpassOnlineStream* CreateTpassOnlineStream(void* tpass_stream, std::vector<int> chunk_size)
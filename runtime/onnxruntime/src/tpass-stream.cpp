@@ -135,6 +135,16 @@ TpassStream::TpassStream(std::map<std::string, std::string>& model_path, int thr
       
 }
 
+void TpassStream::SetOfflineThreadNum(int thread_num)
+{
+    if (thread_num > 0) {
+        // the second pass may lag, the online chunks may not
+        offline_pool_ = make_unique<WorkerPool>(thread_num, 10);
+    } else {
+        offline_pool_ = nullptr;
+    }
+}
+
 TpassStream *CreateTpassStream(std::map<std::string, std::string>& model_path, int thread_num)
 {
     TpassStream *mm;
@@ -395,84 +395,258 @@ std::string VectorToString(const std::vector<std::vector<int>>& vec, bool out_em
 }
 
 std::string TimestampSmooth(std::string &text, std::string &text_itn, std::string &str_time){
-    vector<vector<int>> timestamps_out;
-    std::string timestamps_str = "";
-    // process string to vector<string>
-    std::vector<std::string> characters;
-    funasr::TimestampSplitChiEngCharacters(text, characters);
-    
-    std::vector<std::string> characters_itn;
-    funasr::TimestampSplitChiEngCharacters(text_itn, characters_itn);
-    
     //convert string to vector<vector<int>>
     vector<vector<int>> timestamps = funasr::ParseTimestamps(str_time);
+    vector<vector<int>> timestamps_out;
+    if (!TimestampSmooth(text, text_itn, timestamps, timestamps_out)){
+        return "";
+    }
+    return VectorToString(timestamps_out);
+}
 
-    if (timestamps.size() == 0){
-        LOG(ERROR) << "Timestamp Smooth Failed: Length of timestamp is zero";
-        return timestamps_str;
+// tokens of an unchanged run that anchor the alignment, and the largest span
+// left to a single edit distance table (4 bytes a cell); larger spans are
+// aligned by TimestampAlignHirschberg in linear memory
+#define TIMESTAMP_ANCHOR_LEN 4
+#define TIMESTAMP_MAX_ALIGN_CELLS (1 << 20)
+
+// appends token idx, or nothing for punctuation, as TimestampAdd did
+static void TimestampAddIndex(std::vector<int> &alignment, const std::vector<std::string> &characters, int idx){
+    if(!TimestampIsPunctuation(characters[idx])){
+        alignment.push_back(idx);
     }
-    
-    // edit distance
-    int m = characters.size();
-    int n = characters_itn.size();
-    std::vector<std::vector<int>> dp(m + 1, std::vector<int>(n + 1, 0));
+}
+
+// true if the tokens before (i, j) agree for an anchor's length, or up to the
+// start of both transcripts
+static bool TimestampIsAnchor(const std::vector<std::string> &characters, int i,
+                              const std::vector<std::string> &characters_itn, int j){
+    for (int k = 1; k <= TIMESTAMP_ANCHOR_LEN; k++) {
+        if (i - k < 0 || j - k < 0) {
+            return i - k < 0 && j - k < 0;
+        }
+        if (characters[i - k] != characters_itn[j - k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the nearest anchor before (i, j) within window tokens of both, as the
+// distances a and b back from i and j
+static bool TimestampFindAnchor(const std::vector<std::string> &characters, int i,
+                                const std::vector<std::string> &characters_itn, int j,
+                                int window, int &a, int &b){
+    int max_a = std::min(i, window);
+    int max_b = std::min(j, window);
+    for (int sum = 1; sum <= max_a + max_b; sum++) {
+        for (a = std::max(0, sum - max_b); a <= std::min(sum, max_a); a++) {
+            b = sum - a;
+            if (TimestampIsAnchor(characters, i - a, characters_itn, j - b)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// the edit distance alignment of characters[i0, i1) and characters_itn[j0, j1),
+// backtracked from the end as the whole transcript was before; the pairs are
+// appended in reverse, -1 is a gap
+static void TimestampAlignSpan(const std::vector<std::string> &characters, int i0, int i1,
+                               const std::vector<std::string> &characters_itn, int j0, int j1,
+                               std::vector<int> &alignment_str1, std::vector<int> &alignment_str2){
+    int m = i1 - i0;
+    int n = j1 - j0;
+    std::vector<int> dp((m + 1) * (n + 1), 0);
+    auto at = [n](int i, int j) { return i * (n + 1) + j; };
 
     // init
     for (int i = 0; i <= m; ++i) {
-        dp[i][0] = i;
+        dp[at(i, 0)] = i;
     }
     for (int j = 0; j <= n; ++j) {
-        dp[0][j] = j;
+        dp[at(0, j)] = j;
     }
 
     // dp
     for (int i = 1; i <= m; ++i) {
         for (int j = 1; j <= n; ++j) {
-            if (characters[i - 1] == characters_itn[j - 1]) {
-                dp[i][j] = dp[i - 1][j - 1];
+            if (characters[i0 + i - 1] == characters_itn[j0 + j - 1]) {
+                dp[at(i, j)] = dp[at(i - 1, j - 1)];
             } else {
-                dp[i][j] = std::min({dp[i - 1][j], dp[i][j - 1], dp[i - 1][j - 1]}) + 1;
+                dp[at(i, j)] = std::min({dp[at(i - 1, j)], dp[at(i, j - 1)], dp[at(i - 1, j - 1)]}) + 1;
             }
         }
     }
 
     // backtrack
-    std::deque<string> alignment_str1, alignment_str2;
     int i = m, j = n;
     while (i > 0 || j > 0) {
-        if (i > 0 && j > 0 && dp[i][j] == dp[i - 1][j - 1]) {
-            funasr::TimestampAdd(alignment_str1, characters[i - 1]);
-            funasr::TimestampAdd(alignment_str2, characters_itn[j - 1]);
+        if (i > 0 && j > 0 && dp[at(i, j)] == dp[at(i - 1, j - 1)]) {
+            TimestampAddIndex(alignment_str1, characters, i0 + i - 1);
+            TimestampAddIndex(alignment_str2, characters_itn, j0 + j - 1);
             i -= 1;
             j -= 1;
-        } else if (i > 0 && dp[i][j] == dp[i - 1][j] + 1) {
-            funasr::TimestampAdd(alignment_str1, characters[i - 1]);
-            alignment_str2.push_front("");
+        } else if (i > 0 && dp[at(i, j)] == dp[at(i - 1, j)] + 1) {
+            TimestampAddIndex(alignment_str1, characters, i0 + i - 1);
+            alignment_str2.push_back(-1);
             i -= 1;
-        } else if (j > 0 && dp[i][j] == dp[i][j - 1] + 1) {
-            alignment_str1.push_front("");
-            funasr::TimestampAdd(alignment_str2, characters_itn[j - 1]);
+        } else if (j > 0 && dp[at(i, j)] == dp[at(i, j - 1)] + 1) {
+            alignment_str1.push_back(-1);
+            TimestampAddIndex(alignment_str2, characters_itn, j0 + j - 1);
             j -= 1;
         } else{
-            funasr::TimestampAdd(alignment_str1, characters[i - 1]);
-            funasr::TimestampAdd(alignment_str2, characters_itn[j - 1]);
+            TimestampAddIndex(alignment_str1, characters, i0 + i - 1);
+            TimestampAddIndex(alignment_str2, characters_itn, j0 + j - 1);
             i -= 1;
-            j -= 1;            
+            j -= 1;
+        }
+    }
+}
+
+// the edit distances of characters[i0, i1) against every prefix (forward) or
+// every suffix (backward) of characters_itn[j0, j1), kept in two rows
+static void TimestampEditRow(const std::vector<std::string> &characters, int i0, int i1,
+                             const std::vector<std::string> &characters_itn, int j0, int j1,
+                             bool backward, std::vector<int> &row){
+    int n = j1 - j0;
+    std::vector<int> prev(n + 1);
+    row.assign(n + 1, 0);
+    for (int j = 0; j <= n; ++j) {
+        prev[j] = backward ? n - j : j;
+    }
+    for (int k = 0; k < i1 - i0; ++k) {
+        const std::string &c = characters[backward ? i1 - 1 - k : i0 + k];
+        if (backward) {
+            row[n] = prev[n] + 1;
+            for (int j = n - 1; j >= 0; --j) {
+                row[j] = (c == characters_itn[j0 + j]) ? prev[j + 1]
+                                                       : std::min({prev[j], row[j + 1], prev[j + 1]}) + 1;
+            }
+        } else {
+            row[0] = prev[0] + 1;
+            for (int j = 1; j <= n; ++j) {
+                row[j] = (c == characters_itn[j0 + j - 1]) ? prev[j - 1]
+                                                           : std::min({prev[j], row[j - 1], prev[j - 1]}) + 1;
+            }
         }
+        prev.swap(row);
+    }
+    row.swap(prev);
+}
+
+// Hirschberg's split of a span too large for one table, in linear memory: the
+// span is cut where an optimal path crosses its middle row and the halves are
+// aligned on their own, appended in reverse like TimestampAlignSpan. The cut
+// may lie on another optimal path than the one the table backtracks, so the
+// pairs can differ from a single table where several alignments tie.
+static void TimestampAlignHirschberg(const std::vector<std::string> &characters, int i0, int i1,
+                                     const std::vector<std::string> &characters_itn, int j0, int j1,
+                                     std::vector<int> &alignment_str1, std::vector<int> &alignment_str2){
+    int64_t m = i1 - i0;
+    int64_t n = j1 - j0;
+    if (m <= 1 || (m + 1) * (n + 1) <= TIMESTAMP_MAX_ALIGN_CELLS) {
+        TimestampAlignSpan(characters, i0, i1, characters_itn, j0, j1, alignment_str1, alignment_str2);
+        return;
+    }
+    int mid = i0 + (int)(m / 2);
+    std::vector<int> head, tail;
+    TimestampEditRow(characters, i0, mid, characters_itn, j0, j1, false, head);
+    TimestampEditRow(characters, mid, i1, characters_itn, j0, j1, true, tail);
+    int split = 0;
+    for (int j = 1; j <= n; ++j) {
+        if (head[j] + tail[j] < head[split] + tail[split]) {
+            split = j;
+        }
+    }
+    head.clear();
+    head.shrink_to_fit();
+    tail.clear();
+    tail.shrink_to_fit();
+    TimestampAlignHirschberg(characters, mid, i1, characters_itn, j0 + split, j1, alignment_str1, alignment_str2);
+    TimestampAlignHirschberg(characters, i0, mid, characters_itn, j0, j0 + split, alignment_str1, alignment_str2);
+}
+
+bool TimestampSmooth(std::string &text, std::string &text_itn, const vector<vector<int>> &timestamps,
+                     vector<vector<int>> &timestamps_out){
+    StageTimer timer(STAGE_TIMESTAMP);
+    timestamps_out.clear();
+    // process string to vector<string>
+    std::vector<std::string> characters;
+    funasr::TimestampSplitChiEngCharacters(text, characters);
+    
+    std::vector<std::string> characters_itn;
+    funasr::TimestampSplitChiEngCharacters(text_itn, characters_itn);
+
+    if (timestamps.size() == 0){
+        LOG(ERROR) << "Timestamp Smooth Failed: Length of timestamp is zero";
+        return false;
     }
 
+    // The itn rewrites short spans (numbers, dates, units) and keeps the rest,
+    // so walking back from the end, equal tokens are paired right away and
+    // only the span back to the previous run of TIMESTAMP_ANCHOR_LEN unchanged
+    // tokens goes through an edit distance table. This is an approximation of
+    // the alignment over the whole transcript: it is the same whenever the
+    // anchors lie on that alignment's path, as they do for the usual itn
+    // rewrites, but a token repeated near a rewrite can be paired differently.
+    // Time and memory stay linear in the transcript instead of its square;
+    // when no anchor is found the rest is aligned exactly by Hirschberg.
+    std::vector<int> alignment_str1, alignment_str2;
+    alignment_str1.reserve(characters.size() + 16);
+    alignment_str2.reserve(characters_itn.size() + 16);
+    int i = characters.size();
+    int j = characters_itn.size();
+    while (i > 0 || j > 0) {
+        if (i > 0 && j > 0 && characters[i - 1] == characters_itn[j - 1]) {
+            TimestampAddIndex(alignment_str1, characters, i - 1);
+            TimestampAddIndex(alignment_str2, characters_itn, j - 1);
+            i -= 1;
+            j -= 1;
+            continue;
+        }
+        int a = 0, b = 0;
+        int window = 64;
+        bool found = true;
+        while (!TimestampFindAnchor(characters, i, characters_itn, j, window, a, b)) {
+            window *= 2;
+            if ((int64_t)window * window > TIMESTAMP_MAX_ALIGN_CELLS) {
+                found = false;
+                break;
+            }
+        }
+        if (!found) {
+            TimestampAlignHirschberg(characters, 0, i, characters_itn, 0, j, alignment_str1, alignment_str2);
+            break;
+        }
+        TimestampAlignSpan(characters, i - a, i, characters_itn, j - b, j, alignment_str1, alignment_str2);
+        i -= a;
+        j -= b;
+    }
+    std::reverse(alignment_str1.begin(), alignment_str1.end());
+    std::reverse(alignment_str2.begin(), alignment_str2.end());
+    // a skipped punctuation can leave one side shorter, its missing pairs are gaps
+    auto token1 = [&](size_t index) -> const std::string& {
+        static const std::string empty;
+        return (index < alignment_str1.size() && alignment_str1[index] >= 0) ? characters[alignment_str1[index]] : empty;
+    };
+    auto token2 = [&](size_t index) -> const std::string& {
+        static const std::string empty;
+        return (index < alignment_str2.size() && alignment_str2[index] >= 0) ? characters_itn[alignment_str2[index]] : empty;
+    };
     // smooth
     int itn_count = 0;
     int idx_tp = 0;
     int idx_itn = 0;
     vector<vector<int>> timestamps_tmp;
     for(int index = 0; index < alignment_str1.size(); index++){
-        if (alignment_str1[index] == alignment_str2[index]){
+        if (token1(index) == token2(index)){
             bool subsidy = false;
             if (itn_count > 0 && timestamps_tmp.size() == 0){
                 if(idx_tp >= timestamps.size()){
                     LOG(ERROR) << "Timestamp Smooth Failed: Index of tp is out of range. ";
-                    return timestamps_str;
+                    return false;
                 }
                 timestamps_tmp.push_back(timestamps[idx_tp]);
                 subsidy = true;
@@ -501,27 +675,27 @@ std::string TimestampSmooth(std::string &text, std::string &text_itn, std::strin
             if(!subsidy){
                 if(idx_tp >= timestamps.size()){
                     LOG(ERROR) << "Timestamp Smooth Failed: Index of tp is out of range. ";
-                    return timestamps_str;
+                    return false;
                 }
                 timestamps_out.push_back(timestamps[idx_tp]);
             }
             idx_tp++;
             itn_count = 0;
         }else{
-            if (!alignment_str1[index].empty()){
+            if (!token1(index).empty()){
                 if(idx_tp >= timestamps.size()){
                     LOG(ERROR) << "Timestamp Smooth Failed: Index of tp is out of range. ";
-                    return timestamps_str;
+                    return false;
                 }
                 timestamps_tmp.push_back(timestamps[idx_tp]);
                 idx_tp++;
             }
-            if (!alignment_str2[index].empty()){
+            if (!token2(index).empty()){
                 itn_count++;
             }
         }
         // count length of itn
-        if (!alignment_str2[index].empty()){
+        if (!token2(index).empty()){
             idx_itn++;
         }
     }
@@ -533,7 +707,7 @@ std::string TimestampSmooth(std::string &text, std::string &text_itn, std::strin
                 timestamps_out.pop_back();
             } else{
                 LOG(ERROR) << "Timestamp Smooth Failed: Last itn has no timestamp.";
-                return timestamps_str;
+                return false;
             }
         }
 
@@ -559,52 +733,58 @@ std::string TimestampSmooth(std::string &text, std::string &text_itn, std::strin
     }
     if(timestamps_out.size() != idx_itn){
         LOG(ERROR) << "Timestamp Smooth Failed: Timestamp length does not matched.";
-        return timestamps_str;
+        return false;
     }
-    
-    timestamps_str = VectorToString(timestamps_out);
-    return timestamps_str;
+    return true;
 }
 
 std::string TimestampSentence(std::string &text, std::string &str_time){
+    vector<vector<int>> timestamps = funasr::ParseTimestamps(str_time);
+    std::vector<FUNASR_STAMP_SENT> sentences;
+    TimestampSentence(text, timestamps, sentences);
+    return StampSentsToString(sentences);
+}
+
+static void AddStampSent(std::vector<FUNASR_STAMP_SENT> &sentences, std::string &text_seg, const std::string &punc,
+                         int start, int end, vector<vector<int>> &ts_seg){
+    FUNASR_STAMP_SENT sent;
+    sent.text_seg.swap(text_seg);
+    sent.punc = punc;
+    if(ts_seg.size() >0){
+        if (ts_seg[0].size() == 2){
+            start = ts_seg[0][0];
+        }
+        if (ts_seg[ts_seg.size()-1].size() == 2){
+            end = ts_seg[ts_seg.size()-1][1];
+        }
+    }
+    sent.start = start;
+    sent.end = end;
+    sent.ts_list.reserve(ts_seg.size() * 2);
+    for (auto &ts : ts_seg){
+        sent.ts_list.insert(sent.ts_list.end(), ts.begin(), ts.end());
+    }
+    sentences.emplace_back(std::move(sent));
+    text_seg.clear();
+    ts_seg.clear();
+}
+
+void TimestampSentence(std::string &text, const vector<vector<int>> &timestamps, std::vector<FUNASR_STAMP_SENT> &sentences){
+    StageTimer timer(STAGE_TIMESTAMP);
+    sentences.clear();
     std::vector<std::string> characters;
     funasr::TimestampSplitChiEngCharacters(text, characters);
-    vector<vector<int>> timestamps = funasr::ParseTimestamps(str_time);
     
     int idx_str = 0, idx_ts = 0;
+    // the first sentence defaults to -1 when it has no stamps, later ones to 0
     int start = -1, end = -1;
     std::string text_seg = "";
-    std::string ts_sentences = "";
-    std::string ts_sent = "";
     vector<vector<int>> ts_seg;
     while(idx_str < characters.size()){
         if (TimestampIsPunctuation(characters[idx_str])){
-            if(ts_seg.size() >0){
-                if (ts_seg[0].size() == 2){
-                    start = ts_seg[0][0];
-                }
-                if (ts_seg[ts_seg.size()-1].size() == 2){
-                    end = ts_seg[ts_seg.size()-1][1];
-                }
-            }
-            // format
-            ts_sent += "{\"text_seg\":\"" + text_seg + "\",";
-            ts_sent += "\"punc\":\"" + characters[idx_str] + "\",";
-            ts_sent += "\"start\":" + to_string(start) + ",";
-            ts_sent += "\"end\":" + to_string(end) + ",";
-            ts_sent += "\"ts_list\":" + VectorToString(ts_seg, false) + "}";
-            
-            if (idx_str == characters.size()-1){
-                ts_sentences += ts_sent;
-            } else{
-                ts_sentences += ts_sent + ",";
-            }
-            // clear
-            text_seg = "";
-            ts_sent = "";
+            AddStampSent(sentences, text_seg, characters[idx_str], start, end, ts_seg);
             start = 0;
             end = 0;
-            ts_seg.clear();
         } else if(idx_ts < timestamps.size()) {
             if (text_seg.empty()){
                 text_seg = characters[idx_str];
@@ -618,21 +798,32 @@ std::string TimestampSentence(std::string &text, std::string &str_time){
     }
     // for none punc results
     if(ts_seg.size() >0){
-        if (ts_seg[0].size() == 2){
-            start = ts_seg[0][0];
-        }
-        if (ts_seg[ts_seg.size()-1].size() == 2){
-            end = ts_seg[ts_seg.size()-1][1];
+        AddStampSent(sentences, text_seg, "", start, end, ts_seg);
+    }
+}
+
+std::string StampSentsToString(const std::vector<FUNASR_STAMP_SENT> &sentences){
+    std::string ts_sentences = "";
+    for (size_t i = 0; i < sentences.size(); i++){
+        const FUNASR_STAMP_SENT &sent = sentences[i];
+        std::string ts_list = "[";
+        for (size_t j = 0; j + 1 < sent.ts_list.size(); j += 2){
+            if (j > 0){
+                ts_list += ",";
+            }
+            ts_list += "[" + to_string(sent.ts_list[j]) + "," + to_string(sent.ts_list[j+1]) + "]";
         }
+        ts_list += "]";
         // format
-        ts_sent += "{\"text_seg\":\"" + text_seg + "\",";
-        ts_sent += "\"punc\":\"\",";
-        ts_sent += "\"start\":" + to_string(start) + ",";
-        ts_sent += "\"end\":" + to_string(end) + ",";
-        ts_sent += "\"ts_list\":" + VectorToString(ts_seg, false) + "}";
-        ts_sentences += ts_sent;
+        if (i > 0){
+            ts_sentences += ",";
+        }
+        ts_sentences += "{\"text_seg\":\"" + sent.text_seg + "\",";
+        ts_sentences += "\"punc\":\"" + sent.punc + "\",";
+        ts_sentences += "\"start\":" + to_string(sent.start) + ",";
+        ts_sentences += "\"end\":" + to_string(sent.end) + ",";
+        ts_sentences += "\"ts_list\":" + ts_list + "}";
     }
-
     return "[" +ts_sentences + "]";
 }
 
@@ -717,8 +908,9 @@ bool IsChinese(string ch)
     return false;
 }
 
-string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>> &timestamp_list){
+void PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>> &timestamp_list, FUNASR_SEG_RESULT &seg){
     std::vector<std::vector<float>> timestamp_merge;
+    std::vector<string> pieces;
     int i;
     list<string> words;
     int is_pre_english = false;
@@ -769,6 +961,7 @@ string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>
             // input word is chinese, not need process 
             if (IsChinese(word)) {
                 words.push_back(word);
+                pieces.push_back(word);
                 timestamp_merge.emplace_back(timestamp_list[i]);
                 is_pre_english = false;
             }
@@ -781,6 +974,7 @@ string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>
                     begin = (begin==-1)?timestamp_list[i][0]:begin;
                     std::vector<float> vec = {begin, timestamp_list[i][1]};
                     timestamp_merge.emplace_back(vec);
+                    pieces.push_back(word);
                     begin = -1;
                     pre_english_len = word.size();
                 }
@@ -797,6 +991,7 @@ string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>
                         begin = (begin==-1)?timestamp_list[i][0]:begin;
                         std::vector<float> vec = {begin, timestamp_list[i][1]};
                         timestamp_merge.emplace_back(vec);
+                        pieces.push_back(word);
                         begin = -1;
                         pre_english_len = word.size();
                     }
@@ -809,6 +1004,7 @@ string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>
                         begin = (begin==-1)?timestamp_list[i][0]:begin;
                         std::vector<float> vec = {begin, timestamp_list[i][1]};
                         timestamp_merge.emplace_back(vec);
+                        pieces.push_back(word);
                         begin = -1;
                         pre_english_len = word.size();
                     }
@@ -817,22 +1013,67 @@ string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>
             }
         }
     }
-    string stamp_str="";
+    stringstream ss;
+    for (auto it = words.begin(); it != words.end(); it++) {
+        ss << *it;
+    }
+    seg.text = ss.str();
+    seg.pieces.swap(pieces);
+    seg.stamps.clear();
+    seg.stamps.reserve(timestamp_merge.size());
     for (i=0; i<timestamp_merge.size(); i++) {
-        stamp_str += std::to_string(timestamp_merge[i][0]);
+        seg.stamps.push_back({(int)lround(timestamp_merge[i][0]*1000), (int)lround(timestamp_merge[i][1]*1000)});
+    }
+}
+
+string PostProcess(std::vector<string> &raw_char, std::vector<std::vector<float>> &timestamp_list){
+    FUNASR_SEG_RESULT seg;
+    PostProcess(raw_char, timestamp_list, seg);
+    return SegResultToString(seg);
+}
+
+// "text | begin, end,begin, end" with seconds, the format GreedySearch used to return
+string SegResultToString(const FUNASR_SEG_RESULT &seg){
+    string stamp_str="";
+    for (size_t i=0; i<seg.stamps.size(); i++) {
+        stamp_str += std::to_string(seg.stamps[i][0]/1000.0f);
         stamp_str += ", ";
-        stamp_str += std::to_string(timestamp_merge[i][1]);
-        if(i!=timestamp_merge.size()-1){
+        stamp_str += std::to_string(seg.stamps[i][1]/1000.0f);
+        if(i!=seg.stamps.size()-1){
             stamp_str += ",";
         }
     }
-
-    stringstream ss;
-    for (auto it = words.begin(); it != words.end(); it++) {
-        ss << *it;
+    if(stamp_str.empty()){
+        return seg.text;
     }
+    return seg.text+" | "+stamp_str;
+}
 
-    return ss.str()+" | "+stamp_str;
+// inverse of SegResultToString for models that only return strings
+void ParseSegResult(const string &msg, FUNASR_SEG_RESULT &seg){
+    seg.pieces.clear();
+    seg.stamps.clear();
+    size_t pos = msg.find(" | ");
+    if(pos == string::npos){
+        seg.text = msg;
+        return;
+    }
+    seg.text = msg.substr(0, pos);
+    const char* p = msg.c_str() + pos + 3;
+    char* next = nullptr;
+    while(*p != '\0'){
+        float begin = strtof(p, &next);
+        if(next == p || *next != ','){
+            break;
+        }
+        p = next + 1;
+        float end = strtof(p, &next);
+        if(next == p){
+            break;
+        }
+        seg.stamps.push_back({(int)lround(begin*1000), (int)lround(end*1000)});
+        p = (*next == ',') ? next + 1 : next;
+    }
 }
 
 void TimestampOnnx( std::vector<float>& us_alphas,
@@ -842,6 +1083,7 @@ void TimestampOnnx( std::vector<float>& us_alphas,
                     std::vector<std::vector<float>> &timestamp_vec, 
                     float begin_time, 
                     float total_offset){
+    StageTimer timer(STAGE_TIMESTAMP);
     if (char_list.empty()) {
         return ;
     }
@@ -1098,4 +1340,114 @@ void SmoothTimestamps(std::string &str_punc, std::string &str_itn, std::string &
     return;
 }
 
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t Rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input)
+{
+    acc += input * kPrime2;
+    acc = Rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= Round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+uint64_t HashBytes(const void* data, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += (uint64_t)len;
+    while (p + 8 <= end) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)Read32(p) * kPrime1;
+        h = Rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * kPrime5;
+        h = Rotl(h, 11) * kPrime1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+CacheKey& CacheKey::AddBytes(const void* data, size_t len)
+{
+    key_.append((const char*)data, len);
+    return *this;
+}
+
+CacheKey& CacheKey::AddHash(const void* data, size_t len)
+{
+    uint64_t hash = HashBytes(data, len);
+    uint64_t size = len;
+    AddBytes(&hash, sizeof(hash));
+    return AddBytes(&size, sizeof(size));
+}
+
+CacheKey& CacheKey::AddString(const std::string &str)
+{
+    // the length keeps "ab"+"c" apart from "a"+"bc"
+    uint64_t size = str.size();
+    AddBytes(&size, sizeof(size));
+    return AddBytes(str.data(), str.size());
+}
+
 } // namespace funasr
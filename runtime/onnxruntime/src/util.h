@@ -4,7 +4,9 @@
 #include <memory>
 #include <unordered_map>
 #include <deque>
+#include <string>
 #include "tensor.h"
+#include "common-struct.h"
 
 using namespace std;
 
@@ -47,7 +49,12 @@ void TimestampSplitChiEngCharacters(const std::string &input_str,
                                   std::vector<std::string> &characters);
 std::string VectorToString(const std::vector<std::vector<int>>& vec, bool out_empty=true);                                  
 std::string TimestampSmooth(std::string &text, std::string &text_itn, std::string &str_time);
+bool TimestampSmooth(std::string &text, std::string &text_itn, const vector<vector<int>> &timestamps,
+                     vector<vector<int>> &timestamps_out);
 std::string TimestampSentence(std::string &text, std::string &str_time);
+void TimestampSentence(std::string &text, const vector<vector<int>> &timestamps,
+                       std::vector<FUNASR_STAMP_SENT> &sentences);
+std::string StampSentsToString(const std::vector<FUNASR_STAMP_SENT> &sentences);
 std::vector<std::string> split(const std::string &s, char delim);
 std::vector<std::string> SplitStr(const std::string &s, string delimiter);
 
@@ -60,6 +67,10 @@ void SplitStringToVector(const std::string &full, const char *delim,
                          std::vector<std::string> *out);
 string PostProcess(std::vector<string> &raw_char,
                    std::vector<std::vector<float>> &timestamp_list);
+void PostProcess(std::vector<string> &raw_char,
+                 std::vector<std::vector<float>> &timestamp_list, FUNASR_SEG_RESULT &seg);
+string SegResultToString(const FUNASR_SEG_RESULT &seg);
+void ParseSegResult(const string &msg, FUNASR_SEG_RESULT &seg);
 void TimestampOnnx( std::vector<float>& us_alphas,
                     std::vector<float> us_cif_peak, 
                     std::vector<string>& char_list, 
@@ -68,6 +79,24 @@ void TimestampOnnx( std::vector<float>& us_alphas,
                     float begin_time = 0.0, 
                     float total_offset = -1.5);
 bool IsTargetFile(const std::string& filename, const std::string target);
+
+// xxh64, fast enough to hash the audio of every request
+uint64_t HashBytes(const void* data, size_t len, uint64_t seed = 0);
+
+// appends the parts of a key; the audio goes in as its hash and length, the
+// options as they are
+class CacheKey {
+  public:
+    CacheKey& AddBytes(const void* data, size_t len);
+    CacheKey& AddHash(const void* data, size_t len);
+    CacheKey& AddString(const std::string &str);
+    template<typename T>
+    CacheKey& Add(const T &value) { return AddBytes(&value, sizeof(value)); }
+    const std::string& Str() const { return key_; }
+
+  private:
+    std::string key_;
+};
 void ExtractHws(string hws_file, unordered_map<string, int> &hws_map);
 void ExtractHws(string hws_file, unordered_map<string, int> &hws_map, string& nn_hotwords_);
 } // namespace funasr
@@ -0,0 +1,150 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+
+namespace funasr {
+// step of the online vad, as in Audio::CutSplit
+static const int VAD_STEP_MS = 1000;
+
+VadSegmenter::VadSegmenter(VadModel* vad, int begin_ms)
+    : vad_(vad), begin_ms_(begin_ms)
+{
+    samples_per_ms_ = vad->GetVadSampleRate() / 1000;
+    offset_ = begin_ms * samples_per_ms_;
+}
+
+void VadSegmenter::Feed(const float* waves, int n_samples, bool input_finished,
+                        std::vector<std::vector<int>> &segments, int stop_ms)
+{
+    int step = samples_per_ms_ * VAD_STEP_MS;
+    while (!stopped_ && offset_ < n_samples) {
+        int len = step;
+        bool is_final = false;
+        if (offset_ + step >= n_samples - 1) {
+            if (!input_finished) {
+                break;
+            }
+            len = n_samples - offset_;
+            is_final = true;
+        }
+        std::vector<float> pcm_data(waves + offset_, waves + offset_ + len);
+        offset_ += len;
+        // [start, -1] opens a segment, [-1, end] closes it, [start, end] is both
+        for (const std::vector<int> &out : vad_->Infer(pcm_data, is_final)) {
+            if (out.size() != 2) {
+                LOG(ERROR) << "Size of vad_segment is not 2.";
+                continue;
+            }
+            if (out[0] != -1) {
+                speech_start_ = out[0] + begin_ms_;
+            }
+            if (out[1] != -1 && speech_start_ != -1) {
+                segments.push_back({speech_start_, out[1] + begin_ms_});
+                speech_start_ = -1;
+            }
+        }
+        if (stop_ms >= 0 && offset_ >= stop_ms * samples_per_ms_ && speech_start_ == -1) {
+            stopped_ = true;
+        }
+    }
+}
+
+// joins the segments of the next window, which starts its own audio at boundary_ms, to vad_segments: at the
+// first segment after the boundary both windows end at the same time, where their states agree again
+static void StitchVadWindow(std::vector<std::vector<int>> &vad_segments, const std::vector<std::vector<int>> &next,
+                            int boundary_ms)
+{
+    for (size_t i = 0; i < vad_segments.size(); i++) {
+        if (vad_segments[i][1] < boundary_ms) {
+            continue;
+        }
+        for (size_t j = 0; j < next.size() && next[j][1] <= vad_segments[i][1]; j++) {
+            if (next[j][1] == vad_segments[i][1]) {
+                vad_segments.resize(i + 1);
+                vad_segments.insert(vad_segments.end(), next.begin() + j + 1, next.end());
+                return;
+            }
+        }
+    }
+    // no agreement within the lookahead: each window keeps the segments that start on its side
+    int last_end = boundary_ms;
+    size_t keep = 0;
+    while (keep < vad_segments.size() && vad_segments[keep][0] < boundary_ms) {
+        last_end = std::max(boundary_ms, vad_segments[keep][1]);
+        keep++;
+    }
+    vad_segments.resize(keep);
+    for (const std::vector<int> &segment : next) {
+        if (segment[0] >= last_end) {
+            vad_segments.push_back(segment);
+            last_end = segment[1];
+        }
+    }
+}
+
+std::vector<std::vector<int>> OnlineVadSegments(VadModel* vad, const float* waves, int n_samples)
+{
+    std::vector<std::vector<int>> segments;
+    VadSegmenter(vad).Feed(waves, n_samples, true, segments);
+    return segments;
+}
+
+std::vector<std::vector<int>> WindowedVadSegments(const std::function<VadModel*()> &create_vad, int sample_rate,
+                                                  const float* waves, int n_samples, WorkerPool* pool,
+                                                  int window_ms, int warmup_ms, int lookahead_ms)
+{
+    window_ms = std::max(VAD_STEP_MS, window_ms / VAD_STEP_MS * VAD_STEP_MS);
+    warmup_ms = (std::max(warmup_ms, 0) + VAD_STEP_MS - 1) / VAD_STEP_MS * VAD_STEP_MS;
+    int total_ms = (int)((int64_t)n_samples * 1000 / sample_rate);
+    int window_num = std::max(1, (total_ms + window_ms - 1) / window_ms);
+    if (pool == nullptr || window_num == 1) {
+        std::unique_ptr<VadModel> vad(create_vad());
+        return OnlineVadSegments(vad.get(), waves, n_samples);
+    }
+
+    std::vector<std::vector<std::vector<int>>> window_segments(window_num);
+    int windows_left = window_num;
+    std::mutex mtx;
+    std::condition_variable cv;
+    for (int w = 0; w < window_num; w++) {
+        pool->Submit([&, w]() {
+            int begin_ms = std::max(0, w * window_ms - warmup_ms);
+            int stop_ms = w + 1 < window_num ? (w + 1) * window_ms + lookahead_ms : -1;
+            std::vector<std::vector<int>> segments;
+            try {
+                std::unique_ptr<VadModel> vad(create_vad());
+                VadSegmenter(vad.get(), begin_ms).Feed(waves, n_samples, true, segments, stop_ms);
+            } catch (std::exception const &e) {
+                LOG(ERROR) << e.what();
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            window_segments[w] = std::move(segments);
+            windows_left--;
+            cv.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return windows_left == 0; });
+    }
+
+    std::vector<std::vector<int>> vad_segments = std::move(window_segments[0]);
+    for (int w = 1; w < window_num; w++) {
+        StitchVadWindow(vad_segments, window_segments[w], w * window_ms);
+    }
+    return vad_segments;
+}
+
+std::vector<std::vector<int>> OfflineVadSegments(FsmnVad* vad, const float* waves, int n_samples)
+{
+    int sample_rate = vad->GetVadSampleRate();
+    if (vad->GetWindowPool() != nullptr && n_samples >= (int64_t)sample_rate / 1000 * vad->GetWindowMs() * 2) {
+        return WindowedVadSegments([vad]() { return CreateVadModel(vad); }, sample_rate, waves, n_samples,
+                                   vad->GetWindowPool(), vad->GetWindowMs());
+    }
+    std::unique_ptr<VadModel> vad_online(CreateVadModel(vad));
+    return OnlineVadSegments(vad_online.get(), waves, n_samples);
+}
+} // namespace funasr
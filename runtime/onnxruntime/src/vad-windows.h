@@ -0,0 +1,65 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Segmentation of offline audio by the online vad, the one routine behind
+// Audio::CutSplit and ProgressiveStream.
+//
+// Long audio can go through parallel windows instead (FunOfflineSetVadThreadNum).
+// Each window runs its own online vad from warmup_ms before its start, so
+// that the fsmn caches and the noise level have settled when it reaches its
+// own audio, and reads on lookahead_ms past its end and until its last
+// segment has closed. The windows are stitched in order at the first segment
+// after a boundary that both windows end at the same frame: the vad state is
+// reset at a segment end, so from there on the next window follows the
+// serial pass. Where no such segment is found, each window keeps the segments
+// that start on its side. Window boundaries lie on the 1 s grid of the serial
+// pass, so the frames of a window are the serial ones.
+#ifndef VAD_WINDOWS_H
+#define VAD_WINDOWS_H
+#include <functional>
+#include <vector>
+
+namespace funasr {
+class FsmnVad;
+class VadModel;
+class WorkerPool;
+
+// The serial pass: one online vad fed in 1 s steps, and the rest in one piece
+// once at most a second and a sample remain. The audio may arrive in pieces,
+// the segments are those of the whole buffer.
+class VadSegmenter {
+  public:
+    // vad is an online vad, begin_ms where in the audio it starts
+    explicit VadSegmenter(VadModel* vad, int begin_ms = 0);
+    // feeds waves[0, n_samples) on from where the last call stopped; the last
+    // second waits for input_finished, as only then is it known to be the last
+    // step. With stop_ms >= 0 it stops past stop_ms once no segment is open.
+    // Appends the segments closed meanwhile as [start_ms, end_ms]
+    void Feed(const float* waves, int n_samples, bool input_finished, std::vector<std::vector<int>> &segments,
+              int stop_ms = -1);
+
+  private:
+    VadModel* vad_;
+    int begin_ms_;
+    int samples_per_ms_;
+    int offset_;
+    int speech_start_ = -1;
+    bool stopped_ = false;
+};
+
+// the serial pass over a complete buffer
+std::vector<std::vector<int>> OnlineVadSegments(VadModel* vad, const float* waves, int n_samples);
+
+// the same from windows of window_ms run on pool, each with an online vad of
+// create_vad; the segments differ from the serial ones only around the window
+// boundaries
+std::vector<std::vector<int>> WindowedVadSegments(const std::function<VadModel*()> &create_vad, int sample_rate,
+                                                  const float* waves, int n_samples, WorkerPool* pool,
+                                                  int window_ms, int warmup_ms = 10000, int lookahead_ms = 5000);
+
+// the segments of a complete buffer for the offline asr: in windows when vad
+// has a window pool and the audio spans two windows, serially otherwise
+std::vector<std::vector<int>> OfflineVadSegments(FsmnVad* vad, const float* waves, int n_samples);
+} // namespace funasr
+#endif
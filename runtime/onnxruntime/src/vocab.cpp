@@ -35,11 +35,9 @@ void Vocab::LoadVocabFromYaml(const char* filename){
         exit(-1);
     }
     YAML::Node myList = config["token_list"];
-    int i = 0;
+    vocab_.Reserve(myList.size(), myList.size() * 4);
     for (YAML::const_iterator it = myList.begin(); it != myList.end(); ++it) {
-        vocab.push_back(it->as<string>());
-        token_id[it->as<string>()] = i;
-        i ++;
+        vocab_.Add(it->as<string>(), true);
     }
 }
 
@@ -54,11 +52,9 @@ void Vocab::LoadVocabFromJson(const char* filename){
         exit(-1);
     }
 
-    int i = 0;
+    vocab_.Reserve(json_array.size(), json_array.size() * 4);
     for (const auto& element : json_array) {
-        vocab.push_back(element);
-        token_id[element] = i;
-        i++;
+        vocab_.Add(element.get<std::string>(), true);
     }
 }
 
@@ -72,7 +68,8 @@ void Vocab::LoadLex(const char* filename){
         std::getline(iss, value);
 
         if (!key.empty() && !value.empty()) {
-            lex_map[key] = value;
+            lex_words_.Add(key, true);
+            lex_prons_.Add(value);
         }
     }
 
@@ -80,70 +77,47 @@ void Vocab::LoadLex(const char* filename){
 }
 
 string Vocab::Word2Lex(const std::string &word) const {
-    auto it = lex_map.find(word);
-    if (it != lex_map.end()) {
-        return it->second;
+    int id = lex_words_.Find(word);
+    if (id != -1) {
+        return lex_prons_.Str(id);
     }
     return "";
 }
 
 int Vocab::GetIdByToken(const std::string &token) const {
-    auto it = token_id.find(token);
-    if (it != token_id.end()) {
-        return it->second;
-    }
-    return -1;
+    return vocab_.Find(token);
 }
 
 void Vocab::Vector2String(vector<int> in, std::vector<std::string> &preds)
 {
     for (auto it = in.begin(); it != in.end(); it++) {
-        string word = vocab[*it];
-        preds.emplace_back(word);
+        preds.emplace_back(vocab_.Str(*it));
     }
 }
 
 string Vocab::Vector2String(vector<int> in)
 {
-    int i;
-    stringstream ss;
+    string text;
     for (auto it = in.begin(); it != in.end(); it++) {
-        ss << vocab[*it];
+        TokenPiece piece = vocab_.Piece(*it);
+        text.append(piece.data, piece.size);
     }
-    return ss.str();
-}
-
-int Str2Int(string str)
-{
-    const char *ch_array = str.c_str();
-    if (((ch_array[0] & 0xf0) != 0xe0) || ((ch_array[1] & 0xc0) != 0x80) ||
-        ((ch_array[2] & 0xc0) != 0x80))
-        return 0;
-    int val = ((ch_array[0] & 0x0f) << 12) | ((ch_array[1] & 0x3f) << 6) |
-              (ch_array[2] & 0x3f);
-    return val;
+    return text;
 }
 
 string Vocab::Id2String(int id) const
 {
-  if (id < 0 || id >= vocab.size()) {
+  if (id < 0 || id >= vocab_.Size()) {
     LOG(INFO) << "Error vocabulary id, this id do not exit.";
     return "";
   } else {
-    return vocab[id];
+    return vocab_.Str(id);
   }
 }
 
 bool Vocab::IsChinese(string ch)
 {
-    if (ch.size() != 3) {
-        return false;
-    }
-    int unicode = Str2Int(ch);
-    if (unicode >= 19968 && unicode <= 40959) {
-        return true;
-    }
-    return false;
+    return IsCjkChar(ch.data(), ch.size());
 }
 
 string Vocab::WordFormat(std::string word)
@@ -161,125 +135,105 @@ string Vocab::WordFormat(std::string word)
     }
 }
 
+// a word of an en-bpe hypothesis, separated from the one before
+static void AppendBpeWord(Vocab &vocab, const std::string &word, std::string &text)
+{
+    if (!text.empty()) {
+        text.push_back(' ');
+    }
+    text += vocab.WordFormat(word);
+}
+
 string Vocab::Vector2StringV2(vector<int> in, std::string language)
 {
-    int i;
-    list<string> words;
-    int is_pre_english = false;
-    int pre_english_len = 0;
-    int is_combining = false;
+    // the pieces are appended to the text as they are read, only a word put
+    // together from subword pieces goes through combine first
+    string text;
+    text.reserve(in.size() * 4);
+    bool en_bpe = (language == "en-bpe");
+    bool is_pre_english = false;
+    size_t pre_english_len = 0;
+    bool is_combining = false;
     std::string combine = "";
-    std::string unicodeChar = "▁";
+    std::string joined;
 
-    for (i=0; i<in.size(); i++){
-        string word = vocab[in[i]];
+    for (size_t i = 0; i < in.size(); i++) {
+        TokenPiece piece = vocab_.Piece(in[i]);
+        uint8_t flags = vocab_.Flags(in[i]);
         // step1 space character skips
-        if (word == "<s>" || word == "</s>" || word == "<unk>")
+        if (flags & TOKEN_SPECIAL)
             continue;
-        if (language == "en-bpe"){
-            size_t found = word.find(unicodeChar);
-            if(found != std::string::npos){
-                if (combine != ""){
-                    combine = WordFormat(combine);
-                    if (words.size() != 0){
-                        combine = " " + combine;
-                    }
-                    words.push_back(combine);
+        if (en_bpe) {
+            if (flags & TOKEN_WORD_START) {
+                if (combine != "") {
+                    AppendBpeWord(*this, combine, text);
                 }
-                combine = word.substr(3);
-            }else{
-                combine += word;
+                combine.assign(piece.data + 3, piece.size - 3);
+            } else {
+                combine.append(piece.data, piece.size);
             }
             continue;
         }
+        const char *word = piece.data;
+        size_t word_len = piece.size;
+        bool chinese = (flags & TOKEN_CJK);
         // step2 combie phoneme to full word
         {
-            int sub_word = !(word.find("@@") == string::npos);
             // process word start and middle part
-            if (sub_word) {
+            if (flags & TOKEN_SUBWORD) {
+                combine.append(piece.data, piece.size - 2);
                 // if badcase: lo@@ chinese
-                if (i == in.size()-1 || i<in.size()-1 && IsChinese(vocab[in[i+1]])){
-                    word = word.erase(word.length() - 2) + " ";
-                    if (is_combining) {
-                        combine += word;
-                        is_combining = false;
-                        word = combine;
-                        combine = "";
-                    }
-                }else{
-                    combine += word.erase(word.length() - 2);
+                if (i == in.size() - 1 || (vocab_.Flags(in[i + 1]) & TOKEN_CJK)) {
+                    combine.push_back(' ');
+                    is_combining = false;
+                } else {
                     is_combining = true;
                     continue;
                 }
             }
             // process word end part
             else if (is_combining) {
-                combine += word;
+                combine.append(piece.data, piece.size);
                 is_combining = false;
-                word = combine;
-                combine = "";
+            }
+            if (!combine.empty()) {
+                joined.swap(combine);
+                combine.clear();
+                word = joined.data();
+                word_len = joined.size();
+                chinese = IsCjkChar(word, word_len);
             }
         }
 
         // step3 process english word deal with space , turn abbreviation to upper case
         {
-            // input word is chinese, not need process 
-            if (IsChinese(word)) {
-                words.push_back(word);
+            // input word is chinese, not need process
+            if (chinese) {
+                text.append(word, word_len);
                 is_pre_english = false;
             }
             // input word is english word
             else {
-                // pre word is chinese
-                if (!is_pre_english) {
-                    // word[0] = word[0] - 32;
-                    words.push_back(word);
-                    pre_english_len = word.size();
-                }
-                // pre word is english word
-                else {
-                    // single letter turn to upper case
-                    // if (word.size() == 1) {
-                    //     word[0] = word[0] - 32;
-                    // }
-
-                    if (pre_english_len > 1) {
-                        words.push_back(" ");
-                        words.push_back(word);
-                        pre_english_len = word.size();
-                    } 
-                    else {
-                        if (word.size() > 1) {
-                            words.push_back(" ");
-                        }
-                        words.push_back(word);
-                        pre_english_len = word.size();
-                    }
+                // pre word is english word, a space unless both are single letters
+                if (is_pre_english && (pre_english_len > 1 || word_len > 1)) {
+                    text.push_back(' ');
                 }
+                text.append(word, word_len);
+                pre_english_len = word_len;
                 is_pre_english = true;
             }
         }
     }
 
-    if (language == "en-bpe" && combine != ""){
-        combine = WordFormat(combine);
-        if (words.size() != 0){
-            combine = " " + combine;
-        }
-        words.push_back(combine);
-    }
-
-    stringstream ss;
-    for (auto it = words.begin(); it != words.end(); it++) {
-        ss << *it;
+    if (en_bpe && combine != "") {
+        AppendBpeWord(*this, combine, text);
     }
-
-    return ss.str();
+    return text;
 }
 
 int Vocab::Size() const
 {
-    return vocab.size();
+    return vocab_.Size();
 }
 
 } // namespace funasr
@@ -5,16 +5,17 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
-#include <map>
 #include "nlohmann/json.hpp"
+#include "token-table.h"
 using namespace std;
 
 namespace funasr {
 class Vocab {
   private:
-    vector<string> vocab;
-    std::map<string, int> token_id;
-    std::map<string, string> lex_map;
+    TokenTable vocab_;
+    // lex_prons_ holds the pronunciation of lex_words_ under the same id
+    TokenTable lex_words_;
+    TokenTable lex_prons_;
     bool IsEnglish(string ch);
     void LoadVocabFromYaml(const char* filename);
     void LoadVocabFromJson(const char* filename);
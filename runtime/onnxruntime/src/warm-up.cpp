@@ -0,0 +1,214 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#include <chrono>
+#include <functional>
+#include <set>
+#include <thread>
+
+namespace funasr {
+// the online encoder/decoder sees the same chunks at any length, a few of them and the final one are enough
+static const int WARM_UP_ONLINE_MS = 3000;
+static const char* WARM_UP_HOTWORDS = "阿里巴巴 达摩院 语音识别 通义实验室";
+
+// samples in [-1, 1] as Audio keeps them: harmonics of a gliding pitch in syllables of 4 Hz over a little noise
+static std::vector<float> WarmUpSignal(int sample_rate, int ms)
+{
+    const double pi = 3.14159265358979;
+    int n_samples = (int)((int64_t)sample_rate * ms / 1000);
+    std::vector<float> samples(n_samples);
+    uint32_t seed = 12345;
+    double phase = 0;
+    for (int i = 0; i < n_samples; i++) {
+        double t = (double)i / sample_rate;
+        phase += 2 * pi * (150 + 50 * sin(2 * pi * 0.7 * t)) / sample_rate;
+        double voiced = 0;
+        for (int h = 1; h <= 8; h++) {
+            voiced += sin(h * phase) / h;
+        }
+        seed = seed * 1664525 + 1013904223;
+        double noise = ((seed >> 8) / 16777216.0 - 0.5) * 0.01;
+        samples[i] = (float)(0.1 * (0.5 + 0.5 * sin(2 * pi * 4 * t)) * voiced + noise);
+    }
+    return samples;
+}
+
+// the text of ms of mandarin speech, about four characters a second
+static std::string WarmUpText(int ms)
+{
+    static const char* chars[] = {"今", "天", "的", "会", "议", "我", "们", "讨", "论", "一", "下", "语", "音", "识", "别"};
+    int n_chars = std::max(1, ms * 4 / 1000);
+    std::string text;
+    for (int i = 0; i < n_chars; i++) {
+        text += chars[i % (sizeof(chars) / sizeof(chars[0]))];
+    }
+    return text;
+}
+
+static void WarmUpOfflineVad(VadModel* vad, const std::vector<int> &buckets_ms)
+{
+    FsmnVad* fsmn_vad = (FsmnVad*)vad;
+    for (int ms : buckets_ms) {
+        std::vector<float> waves = WarmUpSignal(vad->GetVadSampleRate(), ms);
+        // the path of Audio::CutSplit
+        OfflineVadSegments(fsmn_vad, waves.data(), waves.size());
+    }
+}
+
+// the online vad of the 2pass, which gets the audio a chunk at a time
+static void WarmUpOnlineVad(VadModel* vad, const std::vector<int> &buckets_ms, const std::vector<std::vector<int>> &chunk_sizes)
+{
+    int samples_per_ms = vad->GetVadSampleRate() / 1000;
+    for (const std::vector<int> &chunk_size : chunk_sizes) {
+        // the chunk_len of ParaformerOnline: 10 ms frames, PARA_LFR_N of them to a chunk step
+        int step = chunk_size[1] * 10 * PARA_LFR_N * samples_per_ms;
+        for (int ms : buckets_ms) {
+            std::vector<float> waves = WarmUpSignal(vad->GetVadSampleRate(), ms);
+            std::unique_ptr<VadModel> vad_online(CreateVadModel(vad));
+            for (int offset = 0; offset < (int)waves.size(); offset += step) {
+                int len = std::min(step, (int)waves.size() - offset);
+                std::vector<float> pcm_data(waves.begin() + offset, waves.begin() + offset + len);
+                vad_online->Infer(pcm_data, offset + len >= (int)waves.size());
+            }
+        }
+    }
+}
+
+// one segment of every bucket, with no hotwords and with a compiled list, alone and as a full batch
+static void WarmUpOfflineAsr(Model* asr, bool use_svs, const std::vector<int> &buckets_ms)
+{
+    std::string no_hotwords;
+    std::string hotwords = WARM_UP_HOTWORDS;
+    std::vector<std::vector<std::vector<float>>> hw_embs;
+    hw_embs.push_back(asr->CompileHotwordEmbedding(no_hotwords));
+    std::vector<std::vector<float>> hw_emb = asr->CompileHotwordEmbedding(hotwords);
+    if (!use_svs && hw_emb.size() > hw_embs[0].size()) {
+        hw_embs.push_back(hw_emb);
+    }
+    std::vector<int> batch_ins = {1};
+    if (asr->GetBatchSize() > 1) {
+        batch_ins.push_back(asr->GetBatchSize());
+    }
+    std::string svs_lang = "auto";
+    for (int ms : buckets_ms) {
+        std::vector<float> samples = WarmUpSignal(asr->GetAsrSampleRate(), ms);
+        for (int batch_in : batch_ins) {
+            std::vector<float*> buff(batch_in, samples.data());
+            std::vector<int> len(batch_in, (int)samples.size());
+            if (use_svs) {
+                asr->Forward(buff.data(), len.data(), true, svs_lang, false, batch_in);
+                continue;
+            }
+            for (const std::vector<std::vector<float>> &emb : hw_embs) {
+                asr->ForwardSegs(buff.data(), len.data(), true, emb, nullptr, batch_in);
+            }
+        }
+    }
+}
+
+static void WarmUpOnlineAsr(Model* asr, const std::string &model_type, const std::vector<int> &buckets_ms,
+                            const std::vector<std::vector<int>> &chunk_sizes)
+{
+    std::set<int> lengths_ms;
+    for (int ms : buckets_ms) {
+        lengths_ms.insert(std::min(ms, WARM_UP_ONLINE_MS));
+    }
+    for (const std::vector<int> &chunk_size : chunk_sizes) {
+        for (int ms : lengths_ms) {
+            ParaformerOnline asr_online(asr, chunk_size, model_type);
+            std::vector<float> samples = WarmUpSignal(asr->GetAsrSampleRate(), ms);
+            int chunk_len = asr_online.chunk_len;
+            for (int offset = 0; offset < (int)samples.size(); offset += chunk_len) {
+                int len = std::min(chunk_len, (int)samples.size() - offset);
+                asr_online.Forward(samples.data() + offset, len, offset + len >= (int)samples.size());
+            }
+        }
+    }
+}
+
+static void WarmUpOfflinePunc(PuncModel* punc, const std::string &lang, const std::vector<int> &buckets_ms)
+{
+    for (int ms : buckets_ms) {
+        punc->AddPunc(WarmUpText(ms).c_str(), lang);
+    }
+}
+
+static void WarmUpOnlinePunc(PuncModel* punc, const std::vector<int> &buckets_ms)
+{
+    for (int ms : buckets_ms) {
+        std::vector<std::string> punc_cache;
+        punc->AddPunc(WarmUpText(ms).c_str(), punc_cache);
+    }
+}
+
+// every job on a thread of its own
+static bool RunWarmUps(const std::vector<std::pair<std::string, std::function<void()>>> &jobs)
+{
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> threads;
+    for (const auto &job : jobs) {
+        threads.emplace_back([&ok, &job]() {
+            auto begin = std::chrono::steady_clock::now();
+            try {
+                job.second();
+            } catch (std::exception const &e) {
+                LOG(ERROR) << "Warm-up of the " << job.first << " failed: " << e.what();
+                ok = false;
+                return;
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+            LOG(INFO) << "Warm-up of the " << job.first << " took " << elapsed.count() << " ms";
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return ok;
+}
+
+bool WarmUpOfflineStream(OfflineStream* offline_stream, const std::vector<int> &buckets_ms)
+{
+    std::vector<std::pair<std::string, std::function<void()>>> jobs;
+    if (offline_stream->UseVad()) {
+        VadModel* vad = offline_stream->vad_handle.get();
+        jobs.push_back({"vad", [vad, &buckets_ms]() { WarmUpOfflineVad(vad, buckets_ms); }});
+    }
+    if (offline_stream->asr_handle) {
+        Model* asr = offline_stream->asr_handle.get();
+        bool use_svs = offline_stream->GetModelType() == MODEL_SVS;
+        jobs.push_back({"asr", [asr, use_svs, &buckets_ms]() { WarmUpOfflineAsr(asr, use_svs, buckets_ms); }});
+    }
+    if (offline_stream->UsePunc()) {
+        PuncModel* punc = offline_stream->punc_handle.get();
+        std::string lang = offline_stream->asr_handle ? offline_stream->asr_handle->GetLang() : "";
+        jobs.push_back({"punc", [punc, lang, &buckets_ms]() { WarmUpOfflinePunc(punc, lang, buckets_ms); }});
+    }
+    return RunWarmUps(jobs);
+}
+
+bool WarmUpTpassStream(TpassStream* tpass_stream, const std::vector<int> &buckets_ms,
+                       const std::vector<std::vector<int>> &chunk_sizes)
+{
+    std::vector<std::pair<std::string, std::function<void()>>> jobs;
+    if (tpass_stream->UseVad()) {
+        VadModel* vad = tpass_stream->vad_handle.get();
+        jobs.push_back({"vad", [vad, &buckets_ms, &chunk_sizes]() { WarmUpOnlineVad(vad, buckets_ms, chunk_sizes); }});
+    }
+    if (tpass_stream->asr_handle) {
+        Model* asr = tpass_stream->asr_handle.get();
+        bool use_svs = tpass_stream->GetModelType() == MODEL_SVS;
+        std::string model_type = tpass_stream->GetModelType();
+        jobs.push_back({"offline asr", [asr, use_svs, &buckets_ms]() { WarmUpOfflineAsr(asr, use_svs, buckets_ms); }});
+        jobs.push_back({"online asr", [asr, model_type, &buckets_ms, &chunk_sizes]() {
+            WarmUpOnlineAsr(asr, model_type, buckets_ms, chunk_sizes);
+        }});
+    }
+    if (tpass_stream->UsePunc()) {
+        PuncModel* punc = tpass_stream->punc_online_handle.get();
+        jobs.push_back({"punc", [punc, &buckets_ms]() { WarmUpOnlinePunc(punc, buckets_ms); }});
+    }
+    return RunWarmUps(jobs);
+}
+} // namespace funasr
@@ -0,0 +1,28 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Warm-up of the models of a handle before it serves. The first run of an
+// onnx session at a new input length selects kernels, grows the arenas and
+// prepacks weights, which the first requests would otherwise pay for. Each
+// model here runs over synthetic input of every length in buckets_ms: the
+// vad over whole buckets and in steps, the offline am over each bucket, also
+// as a full batch on gpu and with a compiled hotword list, the online
+// encoder/decoder in chunks of each chunk size and the punc over text of the
+// length a bucket of speech yields. The input is a voiced-like signal, so that
+// the predictor fires and the decoder sees tokens, though their number
+// depends on the model. The models run in parallel, one thread each.
+#ifndef WARM_UP_H
+#define WARM_UP_H
+#include <vector>
+
+namespace funasr {
+class OfflineStream;
+class TpassStream;
+
+// false if a model failed, the error is logged
+bool WarmUpOfflineStream(OfflineStream* offline_stream, const std::vector<int> &buckets_ms);
+bool WarmUpTpassStream(TpassStream* tpass_stream, const std::vector<int> &buckets_ms,
+                       const std::vector<std::vector<int>> &chunk_sizes);
+} // namespace funasr
+#endif
@@ -1,4 +1,6 @@
 #include <wfst-decoder.h>
+#include <map>
+#include "metrics.h"
 namespace funasr {
 WfstDecoder::WfstDecoder(fst::Fst<fst::StdArc>* lm,
                          PhoneSet* phone_set, Vocab* vocab,
@@ -12,6 +14,23 @@ WfstDecoder::WfstDecoder(fst::Fst<fst::StdArc>* lm,
 WfstDecoder::~WfstDecoder() {
 }
 
+WfstDecoder* WfstDecoder::Clone() {
+  WfstDecoder* decoder = nullptr;
+  if (pool_) {
+    decoder = pool_->Acquire(dec_opts_.beam, dec_opts_.lattice_beam, dec_opts_.acoustic_scale);
+  } else {
+    decoder = new WfstDecoder(lm_, phone_set_, vocab_, dec_opts_.beam,
+                              dec_opts_.lattice_beam, dec_opts_.acoustic_scale);
+  }
+  // the bias graph is only read while decoding, so it can be shared
+  if (bias_lm_) {
+    decoder->bias_lm_ = bias_lm_;
+    decoder->hws_hash_ = hws_hash_;
+    decoder->decoder_->SetBiasLm(bias_lm_);
+  }
+  return decoder;
+}
+
 void WfstDecoder::StartUtterance() {
   if (decoder_) {
     cur_frame_ = 0;
@@ -25,6 +44,7 @@ void WfstDecoder::EndUtterance() {
 }
 
 string WfstDecoder::Search(float *in, int len, int64_t token_num) {
+  StageTimer timer(STAGE_WFST);
   string result;
   if (len == 0) {
     return "";
@@ -57,9 +77,22 @@ string WfstDecoder::Search(float *in, int len, int64_t token_num) {
 }
 
 string WfstDecoder::FinalizeDecode(bool is_stamp, std::vector<float> us_alphas, std::vector<float> us_cif_peak) {
-  string result;
+  FUNASR_SEG_RESULT seg;
+  FinalizeDecode(seg, is_stamp, us_alphas, us_cif_peak);
+  if (!is_stamp) {
+    return seg.text;
+  }
+  return SegResultToString(seg);
+}
+
+void WfstDecoder::FinalizeDecode(FUNASR_SEG_RESULT &seg, bool is_stamp, std::vector<float> us_alphas, std::vector<float> us_cif_peak) {
+  StageTimer timer(STAGE_WFST);
+  seg.text = "";
+  seg.token_ids.clear();
+  seg.pieces.clear();
+  seg.stamps.clear();
   if (cur_token_ > 0) {
-    std::vector<int> words;
+    std::vector<int> &words = seg.token_ids;
     kaldi::Lattice lattice;
     decodable_.SetFinished();
     decoder_->FinalizeDecoding();
@@ -69,7 +102,7 @@ string WfstDecoder::FinalizeDecode(bool is_stamp, std::vector<float> us_alphas,
     fst::GetLinearSymbolSequence(lattice, &alignment, &words, &weight);
     
     if(!is_stamp){
-        return vocab_->Vector2StringV2(words);
+        seg.text = vocab_->Vector2StringV2(words);
     }else{
         std::vector<std::string> char_list;
         std::vector<std::vector<float>> timestamp_list;
@@ -85,10 +118,9 @@ string WfstDecoder::FinalizeDecode(bool is_stamp, std::vector<float> us_alphas,
         // std::vector<string> raw_char(char_list);
         TimestampOnnx(us_alphas, us_cif_peak, split_chars, res_str, timestamp_list);
 
-        return PostProcess(split_chars, timestamp_list);
+        PostProcess(split_chars, timestamp_list, seg);
     }
   }
-  return result;
 }
 
 void WfstDecoder::LoadHwsRes(int inc_bias, unordered_map<string, int> &hws_map) {
@@ -97,6 +129,13 @@ void WfstDecoder::LoadHwsRes(int inc_bias, unordered_map<string, int> &hws_map)
       bias_lm_ = std::make_shared<BiasLm>(hws_map, inc_bias,
                                           *phone_set_, *vocab_);
       decoder_->SetBiasLm(bias_lm_);
+      std::map<string, int> sorted(hws_map.begin(), hws_map.end());
+      CacheKey key;
+      key.Add(inc_bias);
+      for (auto &hw : sorted) {
+        key.AddString(hw.first).Add(hw.second);
+      }
+      hws_hash_ = HashBytes(key.Str().data(), key.Str().size());
     }
   } catch (std::exception const &e) {
         LOG(ERROR) << "Error when load wfst hotwords resource: " << e.what();
@@ -108,6 +147,104 @@ void WfstDecoder::UnloadHwsRes() {
   if (bias_lm_) {
     decoder_->ClearBiasLm();
     bias_lm_.reset();
+    hws_hash_ = 0;
+  }
+}
+
+void WfstDecoder::SetOptions(float glob_beam, float lat_beam, float am_scale) {
+  dec_opts_ = DecodeOptions(glob_beam, lat_beam, am_scale);
+  decodable_ = Decodable(dec_opts_.acoustic_scale);
+  decoder_->SetOptions(dec_opts_);
+}
+
+uint64_t WfstDecoder::ConfigHash() const {
+  CacheKey key;
+  key.Add(dec_opts_.beam).Add(dec_opts_.lattice_beam).Add(dec_opts_.acoustic_scale).Add(hws_hash_);
+  return HashBytes(key.Str().data(), key.Str().size());
+}
+
+void WfstDecoder::Release(WfstDecoder* decoder) {
+  if (decoder == nullptr) {
+    return;
+  }
+  // the pool may be gone with the model but for this reference, so it is
+  // released only after the decoder is back in it
+  std::shared_ptr<WfstDecoderPool> pool = std::move(decoder->pool_);
+  if (pool) {
+    pool->Put(decoder);
+  } else {
+    delete decoder;
+  }
+}
+
+WfstDecoderPool::WfstDecoderPool(std::shared_ptr<fst::Fst<fst::StdArc>> lm,
+                                 PhoneSet* phone_set, Vocab* vocab, int max_idle)
+:lm_(lm), phone_set_(phone_set), vocab_(vocab), max_idle_(max_idle) {
+}
+
+WfstDecoderPool::~WfstDecoderPool() {
+}
+
+WfstDecoder* WfstDecoderPool::Acquire(float glob_beam, float lat_beam, float am_scale) {
+  std::unique_ptr<WfstDecoder> decoder;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    in_use_++;
+    if (!idle_.empty()) {
+      decoder = std::move(idle_.back());
+      idle_.pop_back();
+      hits_++;
+    } else {
+      misses_++;
+    }
+  }
+  if (decoder) {
+    MetricsCount(COUNTER_WFST_POOL_HITS);
+    decoder->SetOptions(glob_beam, lat_beam, am_scale);
+  } else {
+    MetricsCount(COUNTER_WFST_POOL_MISSES);
+    decoder.reset(new WfstDecoder(lm_.get(), phone_set_, vocab_, glob_beam, lat_beam, am_scale));
+  }
+  decoder->pool_ = shared_from_this();
+  return decoder.release();
+}
+
+void WfstDecoderPool::Put(WfstDecoder* decoder) {
+  std::unique_ptr<WfstDecoder> owned(decoder);
+  owned->UnloadHwsRes();
+  // the tokens of the last utterance go back to the allocators now, not when
+  // the next connection starts
+  owned->StartUtterance();
+  std::lock_guard<std::mutex> lock(mtx_);
+  in_use_--;
+  if ((int)idle_.size() < max_idle_) {
+    idle_.push_back(std::move(owned));
+  }
+}
+
+void WfstDecoderPool::SetMaxIdle(int max_idle) {
+  std::vector<std::unique_ptr<WfstDecoder>> dropped;
+  std::lock_guard<std::mutex> lock(mtx_);
+  max_idle_ = std::max(max_idle, 0);
+  while ((int)idle_.size() > max_idle_) {
+    dropped.push_back(std::move(idle_.back()));
+    idle_.pop_back();
+  }
+}
+
+void WfstDecoderPool::GetStats(int* idle, int* in_use, long long* hits, long long* misses) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (idle) {
+    *idle = idle_.size();
+  }
+  if (in_use) {
+    *in_use = in_use_;
+  }
+  if (hits) {
+    *hits = hits_;
+  }
+  if (misses) {
+    *misses = misses_;
   }
 }
 
@@ -7,6 +7,9 @@
 #include "bias-lm.h"
 #include "phone-set.h"
 #include "util.h"
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #define MAX_SCORE 10.0f
 namespace funasr {
@@ -55,6 +58,7 @@ struct DecodeOptions : public kaldi::LatticeFasterDecoderConfig {
   float acoustic_scale;
 };
 
+class WfstDecoderPool;
 class WfstDecoder {
  public:
   WfstDecoder(fst::Fst<fst::StdArc>* lm,
@@ -64,14 +68,23 @@ class WfstDecoder {
               float lat_beam,
               float am_scale);
   ~WfstDecoder();
+  // same graph, beams and hotword bias, for decoding segments in parallel
+  WfstDecoder* Clone();
   void StartUtterance();
   void EndUtterance();
   string Search(float *in, int len, int64_t token_nums);
   string FinalizeDecode(bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
+  void FinalizeDecode(FUNASR_SEG_RESULT &seg, bool is_stamp=false, std::vector<float> us_alphas={0}, std::vector<float> us_cif_peak={0});
   void LoadHwsRes(int inc_bias, unordered_map<string, int> &hws_map);
   void UnloadHwsRes();
+  void SetOptions(float glob_beam, float lat_beam, float am_scale);
+  // beams, scale and hotword bias, everything besides the graph that changes the output
+  uint64_t ConfigHash() const;
+  // hands the decoder back to the pool it was taken from, or deletes it
+  static void Release(WfstDecoder* decoder);
 
  private:
+  friend class WfstDecoderPool;
   Vocab* vocab_ = nullptr;
   PhoneSet* phone_set_ = nullptr;
   int cur_frame_ = 0;
@@ -81,6 +94,40 @@ class WfstDecoder {
   fst::Fst<fst::StdArc>* lm_ = nullptr;
   std::shared_ptr<kaldi::LatticeFasterOnlineDecoder> decoder_ = nullptr;
   std::shared_ptr<BiasLm> bias_lm_ = nullptr;
+  uint64_t hws_hash_ = 0;
+  // set while the decoder is out of a pool, keeps the pool and its graph alive
+  std::shared_ptr<WfstDecoderPool> pool_ = nullptr;
+};
+
+// Idle decoders of one graph. A decoder handed back keeps its token and link
+// pools and its hash table, so the next connection only pays InitDecoding
+// instead of building a decoder and warming its allocators again. The hotword
+// bias is an overlay of the connection and is dropped on the way back.
+class WfstDecoderPool : public std::enable_shared_from_this<WfstDecoderPool> {
+ public:
+  WfstDecoderPool(std::shared_ptr<fst::Fst<fst::StdArc>> lm,
+                  PhoneSet* phone_set,
+                  Vocab* vocab,
+                  int max_idle = 64);
+  ~WfstDecoderPool();
+  WfstDecoder* Acquire(float glob_beam, float lat_beam, float am_scale);
+  // decoders beyond max_idle are deleted, 0 turns pooling off
+  void SetMaxIdle(int max_idle);
+  void GetStats(int* idle, int* in_use, long long* hits, long long* misses);
+
+ private:
+  friend class WfstDecoder;
+  void Put(WfstDecoder* decoder);
+
+  std::shared_ptr<fst::Fst<fst::StdArc>> lm_;
+  PhoneSet* phone_set_ = nullptr;
+  Vocab* vocab_ = nullptr;
+  std::mutex mtx_;
+  std::vector<std::unique_ptr<WfstDecoder>> idle_;
+  int max_idle_;
+  int in_use_ = 0;
+  long long hits_ = 0;
+  long long misses_ = 0;
 };
 } // namespace funasr
 #endif // WFST_DECODER_
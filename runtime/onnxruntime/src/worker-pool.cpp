@@ -0,0 +1,111 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+#include "precomp.h"
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace funasr {
+// a task that throws is logged and dropped instead of ending the process
+static void RunTask(const std::function<void()> &task)
+{
+    try {
+        task();
+    } catch (std::exception const &e) {
+        LOG(ERROR) << "worker task failed: " << e.what();
+    } catch (...) {
+        LOG(ERROR) << "worker task failed";
+    }
+}
+
+WorkerPool::WorkerPool(int thread_num, int nice) : nice_(nice)
+{
+    for (int i = 0; i < thread_num; i++) {
+        workers_.emplace_back(&WorkerPool::Run, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkerPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tasks_.push(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void WorkerPool::Run()
+{
+#if defined(__linux__)
+    // the nice value of a linux thread is its own
+    if (nice_ != 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice_) != 0) {
+        LOG(WARNING) << "Failed to set the priority of a worker thread";
+    }
+#endif
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            // pending tasks are still run on shutdown, their submitters wait for them
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        RunTask(task);
+    }
+}
+
+void WorkerStrand::Submit(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    tasks_.push_back(std::move(task));
+    if (!running_) {
+        running_ = true;
+        pool_->Submit([this] { RunNext(); });
+    }
+}
+
+void WorkerStrand::RunNext()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+    }
+    // the strand moves on whatever the task does, Wait() relies on it
+    RunTask(task);
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (tasks_.empty()) {
+        running_ = false;
+        cv_.notify_all();
+    } else {
+        pool_->Submit([this] { RunNext(); });
+    }
+}
+
+void WorkerStrand::Wait()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return !running_; });
+}
+} // namespace funasr
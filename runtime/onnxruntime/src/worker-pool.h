@@ -0,0 +1,59 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// Fixed-size thread pool owned by a stream. Every request of the stream
+// submits to the same pool, so the number of decoding threads stays bounded
+// however many requests run at once.
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace funasr {
+class WorkerPool {
+  public:
+    // nice > 0 runs the workers below the threads that submit to them (linux only)
+    explicit WorkerPool(int thread_num, int nice = 0);
+    ~WorkerPool();
+    void Submit(std::function<void()> task);
+    int Size() const { return (int)workers_.size(); }
+
+  private:
+    void Run();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    int nice_ = 0;
+};
+
+// Tasks of one stream on a shared pool: run one at a time in submission order,
+// and requeued behind the other streams after each task, so a stream with a
+// long backlog does not hold a worker.
+class WorkerStrand {
+  public:
+    explicit WorkerStrand(WorkerPool* pool) : pool_(pool) {}
+    ~WorkerStrand() { Wait(); }
+    void Submit(std::function<void()> task);
+    // returns once every task submitted so far has run
+    void Wait();
+
+  private:
+    void RunNext();
+
+    WorkerPool* pool_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool running_ = false;
+};
+} // namespace funasr
+#endif
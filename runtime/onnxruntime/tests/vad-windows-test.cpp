@@ -0,0 +1,152 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights Reserved.
+ * MIT License  (https://opensource.org/licenses/MIT)
+*/
+// The windowed vad against the serial pass, and the serial pass fed in pieces
+// against a complete buffer, on a fixed signal. An energy vad stands in for
+// the fsmn model: like E2EVadModel it reports [start, -1] and [-1, end] in ms
+// from its own start and forgets everything at the end of a segment, which is
+// what the stitching of the windows relies on.
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vad-model.h"
+#include "vad-windows.h"
+#include "worker-pool.h"
+
+namespace {
+const int kSampleRate = 16000;
+const int kFrameSamples = kSampleRate / 100;
+const float kSpeechEnergy = 0.01f;
+const int kEndSilenceFrames = 30;
+
+class EnergyVad : public funasr::VadModel {
+  public:
+    void InitVad(const std::string &vad_model, const std::string &vad_cmvn, const std::string &vad_config,
+                 int thread_num) {}
+    int GetVadSampleRate() { return kSampleRate; }
+
+    std::vector<std::vector<int>> Infer(std::vector<float> &waves, bool input_finished) {
+        std::vector<std::vector<int>> out;
+        pending_.insert(pending_.end(), waves.begin(), waves.end());
+        size_t used = 0;
+        for (; used + kFrameSamples <= pending_.size(); used += kFrameSamples) {
+            float energy = 0;
+            for (int i = 0; i < kFrameSamples; i++) {
+                energy += pending_[used + i] * pending_[used + i];
+            }
+            bool speech = energy / kFrameSamples > kSpeechEnergy;
+            int frame_ms = frame_ * 10;
+            frame_++;
+            if (!in_speech_) {
+                if (speech) {
+                    in_speech_ = true;
+                    silence_frames_ = 0;
+                    speech_end_ = frame_ms + 10;
+                    out.push_back({frame_ms, -1});
+                }
+            } else if (speech) {
+                silence_frames_ = 0;
+                speech_end_ = frame_ms + 10;
+            } else if (++silence_frames_ >= kEndSilenceFrames) {
+                in_speech_ = false;
+                out.push_back({-1, speech_end_});
+            }
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + used);
+        if (input_finished && in_speech_) {
+            in_speech_ = false;
+            out.push_back({-1, speech_end_});
+        }
+        return out;
+    }
+
+  private:
+    std::vector<float> pending_;
+    int frame_ = 0;
+    bool in_speech_ = false;
+    int silence_frames_ = 0;
+    int speech_end_ = 0;
+};
+
+// ten minutes of noise bursts of 0.5 to 20 s between pauses of 0.1 to 8 s
+std::vector<float> MakeSignal() {
+    uint32_t seed = 20240601;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    };
+    std::vector<float> waves;
+    size_t total = (size_t)kSampleRate * 600;
+    bool speech = false;
+    while (waves.size() < total) {
+        int ms = speech ? 500 + next() % 19500 : 100 + next() % 7900;
+        float amplitude = speech ? 0.5f : 0.01f;
+        for (int i = 0; i < ms * kSampleRate / 1000; i++) {
+            waves.push_back(amplitude * ((float)(next() % 2001) / 1000.0f - 1.0f));
+        }
+        speech = !speech;
+    }
+    waves.resize(total);
+    return waves;
+}
+
+bool Same(const char* name, const std::vector<std::vector<int>> &expected,
+          const std::vector<std::vector<int>> &actual) {
+    if (expected == actual) {
+        printf("%s: %zu segments match\n", name, expected.size());
+        return true;
+    }
+    printf("%s: %zu segments, expected %zu\n", name, actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size() || i < actual.size(); i++) {
+        if (i >= expected.size() || i >= actual.size() || expected[i] != actual[i]) {
+            printf("  first difference at %zu: ", i);
+            if (i < expected.size()) {
+                printf("expected [%d, %d] ", expected[i][0], expected[i][1]);
+            }
+            if (i < actual.size()) {
+                printf("got [%d, %d]", actual[i][0], actual[i][1]);
+            }
+            printf("\n");
+            break;
+        }
+    }
+    return false;
+}
+} // namespace
+
+int main() {
+    std::vector<float> waves = MakeSignal();
+    int n_samples = waves.size();
+
+    EnergyVad serial_vad;
+    std::vector<std::vector<int>> serial = funasr::OnlineVadSegments(&serial_vad, waves.data(), n_samples);
+    if (serial.size() < 20) {
+        printf("serial pass: only %zu segments\n", serial.size());
+        return 1;
+    }
+
+    bool ok = true;
+    funasr::WorkerPool pool(4);
+    for (int window_ms : {30000, 60000, 110000}) {
+        std::vector<std::vector<int>> windowed = funasr::WindowedVadSegments(
+            []() { return new EnergyVad(); }, kSampleRate, waves.data(), n_samples, &pool, window_ms);
+        std::string name = "windows of " + std::to_string(window_ms) + " ms";
+        ok = Same(name.c_str(), serial, windowed) && ok;
+    }
+
+    // the audio of a progressive request, in uneven pieces
+    EnergyVad piece_vad;
+    funasr::VadSegmenter segmenter(&piece_vad);
+    std::vector<std::vector<int>> pieces;
+    int received = 0;
+    for (int k = 0; received < n_samples; k++) {
+        received = std::min(n_samples, received + 3001 + (k * 7919) % 40000);
+        segmenter.Feed(waves.data(), received, received == n_samples, pieces);
+    }
+    ok = Same("fed in pieces", serial, pieces) && ok;
+    return ok ? 0 : 1;
+}
@@ -6,6 +6,7 @@
 // Main executable for HTTP ASR server
 
 #include "http-server.h"
+#include "warm-up-ms.h"
 #include <signal.h>
 #include <memory>
 
@@ -70,8 +71,28 @@ int main(int argc, char* argv[]) {
             "", "thread-num", "Number of threads", false, 8, "int");
         cmd.add(thread_num_arg);
         
+        TCLAP::ValueArg<std::string> warm_up_arg(
+            "", "warm-up-ms", "Audio lengths (ms) every model runs over before the server takes requests, "
+            "GET /ready answers 503 until then; empty disables the warm-up", false, "1000,3000,6000,10000,20000", "string");
+        cmd.add(warm_up_arg);
+        
+        TCLAP::SwitchArg enable_metrics_arg(
+            "", "enable-metrics", "Record per-stage metrics and serve them on GET /metrics", false);
+        cmd.add(enable_metrics_arg);
+        
         cmd.parse(argc, argv);
         
+        std::vector<int> warm_up_ms;
+        std::string bad_ms;
+        if (!funasr::ParseWarmUpMs(warm_up_arg.getValue(), warm_up_ms, bad_ms)) {
+            LOG(ERROR) << "bad warm-up-ms item \"" << bad_ms << "\", expected positive ms";
+            exit(-1);
+        }
+        
+        if (enable_metrics_arg.getValue()) {
+            FunASRMetricsEnable(true);
+        }
+        
         // Create and initialize server
         g_server = std::make_unique<HttpAsrServer>();
         
@@ -91,7 +112,7 @@ int main(int argc, char* argv[]) {
         LOG(INFO) << "Listening on: " << host_arg.getValue() << ":" << port_arg.getValue();
         
         // Start server (this blocks)
-        g_server->Start(host_arg.getValue(), port_arg.getValue());
+        g_server->Start(host_arg.getValue(), port_arg.getValue(), warm_up_ms);
         
     } catch (const TCLAP::ArgException& e) {
         LOG(ERROR) << "Command line argument error: " << e.error() << " for arg " << e.argId();
@@ -0,0 +1,555 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+// benchmark of the transports of funasr-wss-server-2pass: streams the same
+// pcm over websocket, the local socket or the local socket with a shared
+// memory ring, and reports the latency of the final results and, with
+// --server-pid, the cpu the server spent per second of audio
+
+#define ASIO_STANDALONE 1
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+#include "audio.h"
+#include "local-server.h"
+#include "nlohmann/json.hpp"
+#include "tclap/CmdLine.h"
+#include "util.h"
+
+typedef websocketpp::client<websocketpp::config::asio_client> ws_client;
+typedef std::chrono::steady_clock bench_clock;
+
+class Transport {
+ public:
+  virtual ~Transport() {}
+  virtual bool SendText(const std::string& text) = 0;
+  virtual bool SendAudio(const char* data, size_t len) = 0;
+  // blocks until the next text message; false when the connection is closed
+  virtual bool ReadText(std::string* text) = 0;
+};
+
+class WsTransport : public Transport {
+ public:
+  bool Connect(const std::string& uri) {
+    client_.clear_access_channels(websocketpp::log::alevel::all);
+    client_.clear_error_channels(websocketpp::log::elevel::all);
+    client_.init_asio();
+    client_.set_open_handler([this](websocketpp::connection_hdl) {
+      std::lock_guard<std::mutex> guard(mtx_);
+      open_ = true;
+      cv_.notify_all();
+    });
+    auto on_end = [this](websocketpp::connection_hdl) {
+      std::lock_guard<std::mutex> guard(mtx_);
+      closed_ = true;
+      cv_.notify_all();
+    };
+    client_.set_close_handler(on_end);
+    client_.set_fail_handler(on_end);
+    client_.set_message_handler(
+        [this](websocketpp::connection_hdl, ws_client::message_ptr msg) {
+          std::lock_guard<std::mutex> guard(mtx_);
+          texts_.push_back(msg->get_payload());
+          cv_.notify_all();
+        });
+    websocketpp::lib::error_code ec;
+    ws_client::connection_ptr con = client_.get_connection(uri, ec);
+    if (ec) {
+      LOG(ERROR) << "connect " << uri << ": " << ec.message();
+      return false;
+    }
+    hdl_ = con->get_handle();
+    client_.connect(con);
+    thread_ = std::thread([this]() { client_.run(); });
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this]() { return open_ || closed_; });
+    return open_ && !closed_;
+  }
+
+  ~WsTransport() {
+    websocketpp::lib::error_code ec;
+    client_.close(hdl_, websocketpp::close::status::going_away, "", ec);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  bool SendText(const std::string& text) override {
+    websocketpp::lib::error_code ec;
+    client_.send(hdl_, text, websocketpp::frame::opcode::text, ec);
+    return !ec;
+  }
+
+  bool SendAudio(const char* data, size_t len) override {
+    websocketpp::lib::error_code ec;
+    client_.send(hdl_, data, len, websocketpp::frame::opcode::binary, ec);
+    return !ec;
+  }
+
+  bool ReadText(std::string* text) override {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this]() { return !texts_.empty() || closed_; });
+    if (texts_.empty()) {
+      return false;
+    }
+    *text = texts_.front();
+    texts_.pop_front();
+    return true;
+  }
+
+ private:
+  ws_client client_;
+  websocketpp::connection_hdl hdl_;
+  std::thread thread_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<std::string> texts_;
+  bool open_ = false;
+  bool closed_ = false;
+};
+
+class LocalTransport : public Transport {
+ public:
+  bool Connect(const std::string& path, size_t ring_bytes) {
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd_ < 0 || connect(fd_, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+      LOG(ERROR) << "connect " << path << ": " << strerror(errno);
+      return false;
+    }
+    return ring_bytes == 0 || SetupRing(ring_bytes);
+  }
+
+  ~LocalTransport() {
+    if (ring_) {
+      munmap(ring_, sizeof(LocalRingHeader) + capacity_);
+    }
+    for (int fd : {fd_, data_fd_, space_fd_}) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  bool SendText(const std::string& text) override {
+    return SendFrame('T', text.data(), text.size());
+  }
+
+  bool SendAudio(const char* data, size_t len) override {
+    if (!ring_) {
+      return SendFrame('A', data, len);
+    }
+    uint64_t write_pos = ring_->write_pos.load(std::memory_order_relaxed);
+    while (len > 0) {
+      uint64_t read_pos = ring_->read_pos.load(std::memory_order_acquire);
+      size_t space = capacity_ - (write_pos - read_pos);
+      if (space == 0) {
+        // the server signals after every drain
+        struct pollfd pfd = {space_fd_, POLLIN, 0};
+        uint64_t count;
+        if (poll(&pfd, 1, 1000) < 0 ||
+            (pfd.revents && read(space_fd_, &count, sizeof(count)) < 0)) {
+          return false;
+        }
+        continue;
+      }
+      size_t offset = write_pos % capacity_;
+      size_t n = std::min({len, space, (size_t)(capacity_ - offset)});
+      memcpy(ring_data_ + offset, data, n);
+      write_pos += n;
+      data += n;
+      len -= n;
+      ring_->write_pos.store(write_pos, std::memory_order_release);
+      uint64_t one = 1;
+      if (write(data_fd_, &one, sizeof(one)) < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ReadText(std::string* text) override {
+    char head[5];
+    if (!ReadAll(head, sizeof(head))) {
+      return false;
+    }
+    uint32_t len = (uint8_t)head[1] | (uint8_t)head[2] << 8 |
+                   (uint8_t)head[3] << 16 | (uint32_t)(uint8_t)head[4] << 24;
+    text->resize(len);
+    return ReadAll(&(*text)[0], len);
+  }
+
+ private:
+  bool SetupRing(size_t ring_bytes) {
+    int mem_fd = memfd_create("funasr-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    data_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    space_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    size_t map_size = sizeof(LocalRingHeader) + ring_bytes;
+    if (mem_fd < 0 || data_fd_ < 0 || space_fd_ < 0 ||
+        ftruncate(mem_fd, map_size) != 0 ||
+        fcntl(mem_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0) {
+      LOG(ERROR) << "ring: " << strerror(errno);
+      return false;
+    }
+    void* mem =
+        mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    if (mem == MAP_FAILED) {
+      LOG(ERROR) << "ring: " << strerror(errno);
+      close(mem_fd);
+      return false;
+    }
+    ring_ = new (mem) LocalRingHeader();
+    ring_->write_pos.store(0);
+    ring_->read_pos.store(0);
+    ring_data_ = (char*)mem + sizeof(LocalRingHeader);
+    capacity_ = ring_bytes;
+
+    char head[5] = {'R', 0, 0, 0, 0};
+    struct iovec iov = {head, sizeof(head)};
+    union {
+      struct cmsghdr align;
+      char buf[CMSG_SPACE(sizeof(int) * 3)];
+    } control;
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
+    int fds[3] = {mem_fd, data_fd_, space_fd_};
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    bool sent = sendmsg(fd_, &msg, MSG_NOSIGNAL) == sizeof(head);
+    close(mem_fd);
+    std::string reply;
+    if (!sent || !ReadText(&reply)) {
+      LOG(ERROR) << "ring: the server closed the connection";
+      return false;
+    }
+    nlohmann::json result = nlohmann::json::parse(reply, nullptr, false);
+    if (!result.is_object() || result["ring"] != true) {
+      LOG(ERROR) << "ring refused: " << reply;
+      return false;
+    }
+    return true;
+  }
+
+  bool SendFrame(char type, const char* data, size_t len) {
+    char head[5] = {type, (char)(len & 0xff), (char)((len >> 8) & 0xff),
+                    (char)((len >> 16) & 0xff), (char)((len >> 24) & 0xff)};
+    struct iovec iov[2] = {{head, sizeof(head)}, {(void*)data, len}};
+    size_t left = sizeof(head) + len;
+    std::lock_guard<std::mutex> guard(send_mtx_);
+    while (left > 0) {
+      struct msghdr msg = {};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = 2;
+      ssize_t n = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      left -= n;
+      for (struct iovec& v : iov) {
+        size_t used = std::min((size_t)n, v.iov_len);
+        v.iov_base = (char*)v.iov_base + used;
+        v.iov_len -= used;
+        n -= used;
+      }
+    }
+    return true;
+  }
+
+  bool ReadAll(char* data, size_t len) {
+    while (len > 0) {
+      ssize_t n = read(fd_, data, len);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  int fd_ = -1;
+  int data_fd_ = -1;
+  int space_fd_ = -1;
+  std::mutex send_mtx_;
+  LocalRingHeader* ring_ = nullptr;
+  char* ring_data_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+struct StreamStats {
+  bool ok = false;
+  double final_ms = 0;  // from the end of the audio to the final result
+  std::string text;
+};
+
+// user + system cpu seconds of a process
+static double ProcessCpuSeconds(int pid) {
+  std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  size_t paren = stat.rfind(')');
+  if (paren == std::string::npos) {
+    return -1;
+  }
+  // utime and stime are fields 14 and 15, the state after the name is 3
+  std::istringstream fields(stat.substr(paren + 2));
+  std::string field;
+  double ticks = 0;
+  for (int i = 3; i <= 15 && fields >> field; i++) {
+    if (i >= 14) {
+      ticks += std::stod(field);
+    }
+  }
+  return ticks / sysconf(_SC_CLK_TCK);
+}
+
+static void RunStream(int index, const std::string& transport,
+                      const std::string& target, size_t ring_bytes,
+                      const std::vector<short>& pcm, int audio_fs,
+                      const std::vector<int>& chunk_size, int packet_ms,
+                      bool realtime, StreamStats* stats) {
+  std::unique_ptr<Transport> conn;
+  if (transport == "websocket") {
+    WsTransport* ws = new WsTransport();
+    conn.reset(ws);
+    if (!ws->Connect(target)) {
+      return;
+    }
+  } else {
+    LocalTransport* local = new LocalTransport();
+    conn.reset(local);
+    if (!local->Connect(target, transport == "shm" ? ring_bytes : 0)) {
+      return;
+    }
+  }
+  nlohmann::json begin;
+  begin["mode"] = "2pass";
+  begin["chunk_size"] = chunk_size;
+  begin["wav_name"] = "stream-" + std::to_string(index);
+  begin["wav_format"] = "pcm";
+  begin["audio_fs"] = audio_fs;
+  begin["is_speaking"] = true;
+  if (!conn->SendText(begin.dump())) {
+    return;
+  }
+
+  std::atomic<bool> audio_done(false);
+  bench_clock::time_point audio_end;
+  std::thread reader([&]() {
+    std::string text;
+    while (conn->ReadText(&text)) {
+      nlohmann::json result = nlohmann::json::parse(text, nullptr, false);
+      if (!result.is_object()) {
+        continue;
+      }
+      if (result["mode"] == "2pass-offline") {
+        stats->text += result["text"].get<std::string>();
+      }
+      if (result["is_final"] == true && audio_done) {
+        stats->final_ms = std::chrono::duration<double, std::milli>(
+                              bench_clock::now() - audio_end)
+                              .count();
+        stats->ok = true;
+        return;
+      }
+    }
+  });
+
+  size_t step = (size_t)audio_fs * packet_ms / 1000;
+  bench_clock::time_point start = bench_clock::now();
+  bool sent = true;
+  for (size_t pos = 0, n = 0; sent && pos < pcm.size(); pos += step, n++) {
+    if (realtime) {
+      std::this_thread::sleep_until(start +
+                                    std::chrono::milliseconds(n * packet_ms));
+    }
+    size_t len = std::min(step, pcm.size() - pos);
+    sent = conn->SendAudio((const char*)(pcm.data() + pos),
+                           len * sizeof(short));
+  }
+  audio_end = bench_clock::now();
+  audio_done = true;
+  if (sent) {
+    conn->SendText("{\"is_speaking\": false}");
+  }
+  reader.join();
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+
+  TCLAP::CmdLine cmd("funasr-local-client-2pass", ' ', "1.0");
+  TCLAP::ValueArg<std::string> transport_("", "transport",
+      "websocket, socket (local socket) or shm (local socket and shared "
+      "memory ring)", false, "socket", "string");
+  TCLAP::ValueArg<std::string> local_socket_("", "local-socket",
+      "the --local-socket of the server", false, "/tmp/funasr-2pass.sock",
+      "string");
+  TCLAP::ValueArg<std::string> uri_("", "uri", "server uri of websocket",
+                                    false, "ws://127.0.0.1:10095", "string");
+  TCLAP::ValueArg<std::string> wav_path_("", "wav-path",
+      "a wav or pcm file every stream sends", true, "", "string");
+  TCLAP::ValueArg<std::int32_t> audio_fs_("", "audio-fs",
+      "the sample rate of pcm", false, 16000, "int32_t");
+  TCLAP::ValueArg<std::string> chunk_size_("", "chunk-size",
+      "chunk_size of the streams", false, "5,10,5", "string");
+  TCLAP::ValueArg<int> streams_("", "streams", "concurrent streams", false, 1,
+                                "int");
+  TCLAP::ValueArg<int> packet_ms_("", "packet-ms", "audio per packet (ms)",
+                                  false, 100, "int");
+  TCLAP::ValueArg<int> realtime_("", "realtime",
+      "1 (Default) sends the packets in real time, 0 as fast as possible",
+      false, 1, "int");
+  TCLAP::ValueArg<int> ring_ms_("", "ring-ms",
+      "size of the shared memory ring (ms of audio)", false, 2000, "int");
+  TCLAP::ValueArg<int> server_pid_("", "server-pid",
+      "pid of the server, to report its cpu per second of audio", false, 0,
+      "int");
+  cmd.add(transport_);
+  cmd.add(local_socket_);
+  cmd.add(uri_);
+  cmd.add(wav_path_);
+  cmd.add(audio_fs_);
+  cmd.add(chunk_size_);
+  cmd.add(streams_);
+  cmd.add(packet_ms_);
+  cmd.add(realtime_);
+  cmd.add(ring_ms_);
+  cmd.add(server_pid_);
+  cmd.parse(argc, argv);
+
+  std::string transport = transport_.getValue();
+  if (transport != "websocket" && transport != "socket" && transport != "shm") {
+    LOG(ERROR) << "Wrong transport: " << transport;
+    return -1;
+  }
+  std::vector<int> chunk_size;
+  std::stringstream ss(chunk_size_.getValue());
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    chunk_size.push_back(std::atoi(item.c_str()));
+  }
+  if (chunk_size.size() != 3 || packet_ms_.getValue() <= 0) {
+    LOG(ERROR) << "Wrong chunk-size or packet-ms";
+    return -1;
+  }
+
+  funasr::Audio audio(1);
+  int32_t audio_fs = audio_fs_.getValue();
+  std::string wav_path = wav_path_.getValue();
+  bool loaded = funasr::IsTargetFile(wav_path, "wav")
+                    ? audio.LoadWav(wav_path.c_str(), &audio_fs, false)
+                    : audio.LoadPcmwav(wav_path.c_str(), &audio_fs, false);
+  if (!loaded) {
+    LOG(ERROR) << "Failed to load " << wav_path;
+    return -1;
+  }
+  std::vector<short> pcm;
+  float* buff;
+  int len;
+  int flag = 0;
+  while (audio.Fetch(buff, len, flag) > 0) {
+    for (int i = 0; i < len; i++) {
+      pcm.push_back((short)(buff[i] * 32768));
+    }
+  }
+  double audio_s = (double)pcm.size() / audio_fs;
+  size_t ring_bytes = (size_t)audio_fs * 2 * ring_ms_.getValue() / 1000;
+  std::string target =
+      transport == "websocket" ? uri_.getValue() : local_socket_.getValue();
+
+  int server_pid = server_pid_.getValue();
+  double server_cpu = server_pid > 0 ? ProcessCpuSeconds(server_pid) : 0;
+  struct rusage usage_begin, usage_end;
+  getrusage(RUSAGE_SELF, &usage_begin);
+  bench_clock::time_point start = bench_clock::now();
+
+  int streams = streams_.getValue();
+  std::vector<StreamStats> stats(streams);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < streams; i++) {
+    threads.emplace_back(RunStream, i, transport, target, ring_bytes,
+                         std::cref(pcm), audio_fs, chunk_size,
+                         packet_ms_.getValue(), realtime_.getValue() != 0,
+                         &stats[i]);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  double wall_s =
+      std::chrono::duration<double>(bench_clock::now() - start).count();
+  getrusage(RUSAGE_SELF, &usage_end);
+  auto cpu_s = [](const struct rusage& u) {
+    return u.ru_utime.tv_sec + u.ru_stime.tv_sec +
+           (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e6;
+  };
+  int ok = 0;
+  std::vector<double> final_ms;
+  for (const StreamStats& s : stats) {
+    if (s.ok) {
+      ok++;
+      final_ms.push_back(s.final_ms);
+    }
+  }
+  std::sort(final_ms.begin(), final_ms.end());
+  std::cout << "transport: " << transport << "\n";
+  std::cout << "streams: " << ok << " of " << streams << " finished\n";
+  std::cout << "audio: " << audio_s * streams << " s, wall: " << wall_s
+            << " s\n";
+  if (!final_ms.empty()) {
+    std::cout << "final result after end of audio: p50 "
+              << final_ms[final_ms.size() / 2] << " ms, max "
+              << final_ms.back() << " ms\n";
+  }
+  std::cout << "client cpu: " << cpu_s(usage_end) - cpu_s(usage_begin)
+            << " s\n";
+  if (server_pid > 0) {
+    server_cpu = ProcessCpuSeconds(server_pid) - server_cpu;
+    std::cout << "server cpu: " << server_cpu << " s, "
+              << server_cpu * 1000 / (audio_s * streams)
+              << " ms per second of audio\n";
+  }
+  if (ok > 0) {
+    std::cout << "text of stream 0: " << stats[0].text << "\n";
+  }
+  return ok == streams ? 0 : -1;
+}
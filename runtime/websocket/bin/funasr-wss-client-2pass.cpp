@@ -198,7 +198,13 @@ class WebsocketClient {
     } else if (funasr::IsTargetFile(wav_path.c_str(), "pcm")) {
       if (!audio.LoadPcmwav(wav_path.c_str(), &sampling_rate, false)) return;
     } else {
+      // compressed files the server decodes while they stream in
       wav_format = "others";
+      for (const char* format : {"opus", "ogg", "mp3", "aac", "flac"}) {
+        if (funasr::IsTargetFile(wav_path.c_str(), format)) {
+          wav_format = format;
+        }
+      }
       if (!audio.LoadOthers2Char(wav_path.c_str())) return;
     }
 
@@ -12,6 +12,8 @@
 #endif
 #include <fstream>
 #include "util.h"
+#include "metrics-server.h"
+#include "warm-up-ms.h"
 
 // hotwords
 std::unordered_map<std::string, int> hws_map_;
@@ -103,12 +105,66 @@ int main(int argc, char* argv[]) {
     TCLAP::ValueArg<std::string> listen_ip("", "listen-ip", "listen ip", false,
                                            "0.0.0.0", "string");
     TCLAP::ValueArg<int> port("", "port", "port", false, 10095, "int");
+    TCLAP::ValueArg<int> metrics_port("", "metrics-port",
+        "port of the http metrics endpoint (GET /metrics, prometheus text), "
+        "0 (Default) disables metrics", false, 0, "int");
+    TCLAP::ValueArg<std::string> metrics_ip("", "metrics-ip",
+        "listen ip of the http metrics endpoint", false, "127.0.0.1", "string");
+    TCLAP::ValueArg<std::string> local_socket("", "local-socket",
+        "path of a unix domain socket for media servers on the same host, "
+        "the websocket protocol in small frames with an optional shared "
+        "memory ring for the audio (see local-server.h). Empty (Default) "
+        "disables it, linux only", false, "", "string");
     TCLAP::ValueArg<int> io_thread_num("", "io-thread-num", "io thread num",
                                        false, 2, "int");
     TCLAP::ValueArg<int> decoder_thread_num(
         "", "decoder-thread-num", "decoder thread num", false, 8, "int");
     TCLAP::ValueArg<int> model_thread_num("", "model-thread-num",
                                           "model thread num", false, 2, "int");
+    TCLAP::ValueArg<int> offline_thread_num("", "offline-thread-num",
+        "threads of the offline pass, which then runs apart from the online "
+        "chunks and sends its results with a seq_id when ready, 0 (Default) "
+        "runs it in the decoder threads", false, 0, "int");
+    TCLAP::ValueArg<int> max_pending_ms("", "max-pending-ms",
+        "audio (ms) a stream may have waiting for the decoder; above it the "
+        "connection is not read until half of it is decoded, so tcp flow "
+        "control slows the client down. 0 (Default) is unbounded", false, 0,
+        "int");
+    TCLAP::ValueArg<std::string> chunk_sizes("", "chunk-sizes",
+        "chunk sizes of the online pass to switch between with the load, "
+        "e.g. 5,10,5;5,20,5;5,40,5, all with the same lookahead. A stream "
+        "starts with its own chunk_size and follows the load if that has the "
+        "same lookahead; clients may limit it with latency low (smallest "
+        "size), normal (up to the middle one) or high. Empty (Default) keeps "
+        "the client's chunk_size", false, "", "string");
+    TCLAP::ValueArg<int> chunk_target_ms("", "chunk-target-ms",
+        "with chunk-sizes, the p95 decoding lag (ms) above which streams go "
+        "to a larger chunk size", false, 300, "int");
+    TCLAP::ValueArg<std::string> warm_up_ms("", "warm-up-ms",
+        "audio lengths (ms) every model runs over before the server takes "
+        "streams, e.g. 1000,3000,6000,10000,20000 (Default); until then "
+        "handshakes get 503 and GET /ready on the metrics port 503. Empty "
+        "disables the warm-up", false, "1000,3000,6000,10000,20000",
+        "string");
+    TCLAP::ValueArg<int> speculate_ms("", "speculate-ms",
+        "start the offline pass of a segment after this much of its end "
+        "silence (ms) instead of when the vad confirms the end, wasted when "
+        "speech goes on; needs offline-thread-num > 0, 0 (Default) disables "
+        "it", false, 0, "int");
+    TCLAP::ValueArg<std::string> model_sets("", "model-sets",
+        "json file of further model sets, {\"name\": {\"model-dir\": ..., "
+        "\"online-model-dir\": ...}} with the keys of the model flags and "
+        "local dirs, keys left out are taken from the flags. A stream picks "
+        "a set with \"model\": name in its first message, the flags are the "
+        "set default. The sets load when first picked", false, "", "string");
+    TCLAP::ValueArg<int> model_memory_mb("", "model-memory-mb",
+        "memory (MB) the loaded model sets may take, estimated from their "
+        "model files; beyond it idle sets are unloaded, least recently used "
+        "first. 0 (Default) keeps every set loaded", false, 0, "int");
+    TCLAP::ValueArg<int> shared_threads("", "shared-threads",
+        "run the onnx sessions of all model sets on one pool of this many "
+        "threads instead of model-thread-num threads per session; 0 "
+        "(Default) disables it", false, 0, "int");
 
     TCLAP::ValueArg<std::string> certfile(
         "", "certfile",
@@ -164,11 +220,32 @@ int main(int argc, char* argv[]) {
 
     cmd.add(listen_ip);
     cmd.add(port);
+    cmd.add(metrics_port);
+    cmd.add(metrics_ip);
+    cmd.add(local_socket);
     cmd.add(io_thread_num);
     cmd.add(decoder_thread_num);
+    cmd.add(offline_thread_num);
+    cmd.add(speculate_ms);
+    cmd.add(model_sets);
+    cmd.add(model_memory_mb);
+    cmd.add(shared_threads);
+    cmd.add(max_pending_ms);
+    cmd.add(chunk_sizes);
+    cmd.add(chunk_target_ms);
+    cmd.add(warm_up_ms);
     cmd.add(model_thread_num);
     cmd.parse(argc, argv);
 
+    std::vector<int> warm_up_buckets;
+    std::string bad_ms;
+    if (!funasr::ParseWarmUpMs(warm_up_ms.getValue(), warm_up_buckets,
+                               bad_ms)) {
+      LOG(ERROR) << "bad warm-up-ms item \"" << bad_ms
+                 << "\", expected positive ms";
+      exit(-1);
+    }
+
     std::map<std::string, std::string> model_path;
     GetValue(offline_model_dir, OFFLINE_MODEL_DIR, model_path);
     GetValue(online_model_dir, ONLINE_MODEL_DIR, model_path);
@@ -566,11 +643,61 @@ int main(int argc, char* argv[]) {
     WebSocketServer websocket_srv(
         io_decoder, is_ssl, server, wss_server, s_certfile,
         s_keyfile);  // websocket server for asr engine
-    websocket_srv.initAsr(model_path, s_model_thread_num);  // init asr model
+    websocket_srv.initAsr(model_path, s_model_thread_num,
+                          offline_thread_num.getValue(),
+                          speculate_ms.getValue(), model_memory_mb.getValue(),
+                          shared_threads.getValue());  // init asr model
+    if (!model_sets.getValue().empty()) {
+      try {
+        std::ifstream sets_file(model_sets.getValue());
+        nlohmann::json sets_json = nlohmann::json::parse(sets_file);
+        for (auto& set : sets_json.items()) {
+          std::map<std::string, std::string> set_path = model_path;
+          for (auto& kv : set.value().items()) {
+            set_path[kv.key()] = kv.value().get<std::string>();
+          }
+          if (!websocket_srv.add_model_set(set.key(), set_path)) {
+            exit(-1);
+          }
+        }
+      } catch (std::exception const& e) {
+        LOG(ERROR) << "model-sets " << model_sets.getValue() << ": "
+                   << e.what();
+        exit(-1);
+      }
+    }
+    websocket_srv.set_max_pending_ms(max_pending_ms.getValue());
+    // the chunk sizes the online streams may use, for the warm-up
+    std::vector<std::vector<int>> chunk_size_set = {{5, 10, 5}};
+    if (!chunk_sizes.getValue().empty()) {
+      if (!funasr::ChunkSizePolicy::Parse(chunk_sizes.getValue(),
+                                          chunk_size_set)) {
+        exit(-1);
+      }
+      websocket_srv.set_chunk_policy(chunk_size_set,
+                                     chunk_target_ms.getValue());
+    }
+
+    std::unique_ptr<MetricsServer> metrics_srv;
+    if (metrics_port.getValue() > 0) {
+      FunASRMetricsEnable(true);
+      metrics_srv.reset(new MetricsServer(
+          io_server, metrics_ip.getValue(), metrics_port.getValue(),
+          [&websocket_srv]() { return websocket_srv.GetStreamMetrics(); },
+          [&websocket_srv]() { return websocket_srv.is_ready(); }));
+    }
 
     LOG(INFO) << "decoder-thread-num: " << s_decoder_thread_num;
     LOG(INFO) << "io-thread-num: " << s_io_thread_num;
     LOG(INFO) << "model-thread-num: " << s_model_thread_num;
+    LOG(INFO) << "offline-thread-num: " << offline_thread_num.getValue();
+    LOG(INFO) << "speculate-ms: " << speculate_ms.getValue();
+    LOG(INFO) << "max-pending-ms: " << max_pending_ms.getValue();
+    LOG(INFO) << "chunk-sizes: " << chunk_sizes.getValue();
+    LOG(INFO) << "warm-up-ms: " << warm_up_ms.getValue();
+    LOG(INFO) << "model-sets: " << model_sets.getValue();
+    LOG(INFO) << "model-memory-mb: " << model_memory_mb.getValue();
+    LOG(INFO) << "shared-threads: " << shared_threads.getValue();
     LOG(INFO) << "asr model init finished. listen on port:" << s_port;
 
     // Start the ASIO network io_service run loop
@@ -579,6 +706,33 @@ int main(int argc, char* argv[]) {
     for (size_t i = 0; i < s_io_thread_num; i++) {
       ts.emplace_back([&io_server]() { io_server.run(); });
     }
+
+    // the io threads answer the readiness probes and refuse handshakes
+    // meanwhile
+    if (!websocket_srv.warm_up(warm_up_buckets, chunk_size_set)) {
+      LOG(ERROR) << "warm-up failed, the server takes streams cold";
+    }
+    if (metrics_srv) {
+      // the metrics start from the warm server
+      FunASRMetricsReset();
+    }
+#if defined(__linux__)
+    std::unique_ptr<LocalServer> local_srv;
+    if (!local_socket.getValue().empty()) {
+      try {
+        local_srv.reset(new LocalServer(io_server, local_socket.getValue(),
+                                        websocket_srv.local_handlers()));
+      } catch (std::exception const& e) {
+        LOG(ERROR) << "local-socket " << local_socket.getValue() << ": "
+                   << e.what();
+        exit(-1);
+      }
+    }
+#else
+    if (!local_socket.getValue().empty()) {
+      LOG(ERROR) << "local-socket is not supported on this platform";
+    }
+#endif
     // wait for theads
     for (size_t i = 0; i < s_io_thread_num; i++) {
       ts[i].join();
@@ -12,6 +12,8 @@
 #endif
 #include <fstream>
 #include "util.h"
+#include "metrics-server.h"
+#include "warm-up-ms.h"
 
 // hotwords
 std::unordered_map<std::string, int> hws_map_;
@@ -98,12 +100,43 @@ int main(int argc, char* argv[]) {
     TCLAP::ValueArg<std::string> listen_ip("", "listen-ip", "listen ip", false,
                                            "0.0.0.0", "string");
     TCLAP::ValueArg<int> port("", "port", "port", false, 10095, "int");
+    TCLAP::ValueArg<int> metrics_port("", "metrics-port",
+        "port of the http metrics endpoint (GET /metrics, prometheus text), "
+        "0 (Default) disables metrics", false, 0, "int");
+    TCLAP::ValueArg<std::string> metrics_ip("", "metrics-ip",
+        "listen ip of the http metrics endpoint", false, "127.0.0.1", "string");
+    TCLAP::ValueArg<std::string> warm_up_ms("", "warm-up-ms",
+        "audio lengths (ms) every model runs over before the server takes "
+        "requests, e.g. 1000,3000,6000,10000,20000 (Default); until then "
+        "handshakes get 503 and GET /ready on the metrics port 503. Empty "
+        "disables the warm-up", false, "1000,3000,6000,10000,20000",
+        "string");
     TCLAP::ValueArg<int> io_thread_num("", "io-thread-num", "io thread num",
                                        false, 2, "int");
     TCLAP::ValueArg<int> decoder_thread_num(
         "", "decoder-thread-num", "decoder thread num", false, 8, "int");
     TCLAP::ValueArg<int> model_thread_num("", "model-thread-num",
                                           "model thread num", false, 1, "int");
+    TCLAP::ValueArg<int> seg_thread_num("", "seg-thread-num",
+        "threads shared by all connections to decode the vad segments of one request in parallel, 1 decodes them one by one",
+        false, 1, "int");
+    TCLAP::ValueArg<int> result_cache_mb("", "result-cache-mb",
+        "MB of finished results kept for requests that resubmit the same audio with the same options, 0 for none",
+        false, 0, "int");
+    TCLAP::ValueArg<int> seg_cache_mb("", "seg-cache-mb",
+        "MB of decoded vad segments kept for requests that share segments with earlier ones, 0 for none",
+        false, 0, "int");
+    TCLAP::ValueArg<int> max_queue("", "max-queue",
+        "offline requests waiting for a decoder thread, more are rejected", false, 1024, "int");
+    TCLAP::ValueArg<float> max_audio_sec("", "max-audio-sec",
+        "seconds of audio queued and being decoded, more are rejected with a retry hint, 0 for no limit",
+        false, 7200, "float");
+    TCLAP::ValueArg<int> max_request_mb("", "max-request-mb",
+        "MB of request data queued and being decoded, more are rejected with a retry hint, 0 for no limit",
+        false, 2048, "int");
+    TCLAP::ValueArg<float> sched_aging("", "sched-aging",
+        "audio seconds a waiting request is moved ahead per second of waiting, so long files are not starved",
+        false, 10, "float");
 
     TCLAP::ValueArg<std::string> certfile("", "certfile", 
         "default: ../../../ssl_key/server.crt, path of certficate for WSS connection. if it is empty, it will be in WS mode.",
@@ -126,6 +159,8 @@ int main(int argc, char* argv[]) {
     TCLAP::ValueArg<std::int32_t> fst_inc_wts("", FST_INC_WTS, 
         "the fst hotwords incremental bias", false, 20, "int32_t");
     TCLAP::SwitchArg use_gpu("", INFER_GPU, "Whether to use GPU, default is false", false);
+    TCLAP::SwitchArg progressive("", "progressive",
+        "decode the vad segments of a pcm upload while it is still arriving, default is false", false);
     TCLAP::ValueArg<std::int32_t> batch_size("", BATCHSIZE, "batch_size for ASR model when using GPU", false, 4, "int32_t");
 
     // add file
@@ -155,13 +190,33 @@ int main(int argc, char* argv[]) {
 
     cmd.add(listen_ip);
     cmd.add(port);
+    cmd.add(metrics_port);
+    cmd.add(metrics_ip);
+    cmd.add(warm_up_ms);
     cmd.add(io_thread_num);
     cmd.add(decoder_thread_num);
     cmd.add(model_thread_num);
+    cmd.add(seg_thread_num);
+    cmd.add(result_cache_mb);
+    cmd.add(seg_cache_mb);
+    cmd.add(progressive);
+    cmd.add(max_queue);
+    cmd.add(max_audio_sec);
+    cmd.add(max_request_mb);
+    cmd.add(sched_aging);
     cmd.add(use_gpu);
     cmd.add(batch_size);
     cmd.parse(argc, argv);
 
+    std::vector<int> warm_up_buckets;
+    std::string bad_ms;
+    if (!funasr::ParseWarmUpMs(warm_up_ms.getValue(), warm_up_buckets,
+                               bad_ms)) {
+      LOG(ERROR) << "bad warm-up-ms item \"" << bad_ms
+                 << "\", expected positive ms";
+      exit(-1);
+    }
+
     std::map<std::string, std::string> model_path;
     GetValue(model_dir, MODEL_DIR, model_path);
     GetValue(quantize, QUANTIZE, model_path);
@@ -508,11 +563,36 @@ int main(int argc, char* argv[]) {
     WebSocketServer websocket_srv(
         io_decoder, is_ssl, server, wss_server, s_certfile,
         s_keyfile);  // websocket server for asr engine
-    websocket_srv.initAsr(model_path, s_model_thread_num, use_gpu_, batch_size_);  // init asr model
-
+    websocket_srv.initAsr(model_path, s_model_thread_num, use_gpu_, batch_size_,
+                          seg_thread_num.getValue());  // init asr model
+    SchedulerOptions sched_opts;
+    sched_opts.max_running = s_decoder_thread_num;
+    sched_opts.max_queue = max_queue.getValue();
+    sched_opts.max_audio_sec = max_audio_sec.getValue();
+    sched_opts.max_bytes = (size_t)std::max(0, max_request_mb.getValue()) << 20;
+    sched_opts.aging = sched_aging.getValue();
+    websocket_srv.initScheduler(sched_opts);
+    websocket_srv.setProgressive(progressive.getValue());
+    websocket_srv.setResultCache((size_t)std::max(0, result_cache_mb.getValue()) << 20,
+                                 (size_t)std::max(0, seg_cache_mb.getValue()) << 20);
+
+    std::unique_ptr<MetricsServer> metrics_srv;
+    if (metrics_port.getValue() > 0) {
+      FunASRMetricsEnable(true);
+      OfflineScheduler* scheduler = websocket_srv.getScheduler();
+      metrics_srv.reset(new MetricsServer(
+          io_server, metrics_ip.getValue(), metrics_port.getValue(),
+          [scheduler]() { return scheduler->GetMetrics(); },
+          [&websocket_srv]() { return websocket_srv.is_ready(); }));
+    }
     LOG(INFO) << "decoder-thread-num: " << s_decoder_thread_num;
     LOG(INFO) << "io-thread-num: " << s_io_thread_num;
     LOG(INFO) << "model-thread-num: " << s_model_thread_num;
+    LOG(INFO) << "seg-thread-num: " << seg_thread_num.getValue();
+    LOG(INFO) << "progressive: " << progressive.getValue();
+    LOG(INFO) << "result-cache-mb: " << result_cache_mb.getValue()
+              << ", seg-cache-mb: " << seg_cache_mb.getValue();
+    LOG(INFO) << "warm-up-ms: " << warm_up_ms.getValue();
     LOG(INFO) << "asr model init finished. listen on port:" << s_port;
 
     // Start the ASIO network io_service run loop
@@ -521,6 +601,16 @@ int main(int argc, char* argv[]) {
     for (size_t i = 0; i < s_io_thread_num; i++) {
       ts.emplace_back([&io_server]() { io_server.run(); });
     }
+
+    // the io threads answer the readiness probes and refuse handshakes
+    // meanwhile
+    if (!websocket_srv.warm_up(warm_up_buckets)) {
+      LOG(ERROR) << "warm-up failed, the server takes requests cold";
+    }
+    if (metrics_srv) {
+      // the metrics start from the warm server
+      FunASRMetricsReset();
+    }
     // wait for theads
     for (size_t i = 0; i < s_io_thread_num; i++) {
       ts[i].join();
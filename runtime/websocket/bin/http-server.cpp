@@ -63,6 +63,12 @@ void HttpAsrServer::InitAsr(const std::string& model_dir,
 void HttpAsrServer::handle_recognize(const httplib::Request& req, httplib::Response& res) {
     auto start_time = std::chrono::high_resolution_clock::now();
     
+    if (!ready) {
+        res.status = 503;
+        res.set_content("{\"error\":\"Warming up\"}", "application/json");
+        return;
+    }
+
     try {
         // Check if request has file upload
         auto file_iter = req.files.find("file");
@@ -185,7 +191,6 @@ void HttpAsrServer::handle_recognize(const httplib::Request& req, httplib::Respo
             try {
                 std::string asr_result = FunASRGetResult(result, 0);
                 std::string timestamp = FunASRGetStamp(result);
-                std::string stamp_sents = FunASRGetStampSents(result);
                 
                 response["text"] = asr_result;
                 response["mode"] = "offline";
@@ -196,14 +201,8 @@ void HttpAsrServer::handle_recognize(const httplib::Request& req, httplib::Respo
                     response["timestamp"] = timestamp;
                 }
                 
-                if (!stamp_sents.empty()) {
-                    try {
-                        nlohmann::json json_stamp = nlohmann::json::parse(stamp_sents);
-                        response["stamp_sents"] = json_stamp;
-                    } catch (const std::exception& e) {
-                        LOG(WARNING) << "Failed to parse stamp_sents: " << e.what();
-                        response["stamp_sents"] = "";
-                    }
+                if (FunASRGetStampSentNum(result) > 0) {
+                    response["stamp_sents"] = funasr::GetStampSentsJson(result);
                 }
                 
                 FunASRFreeResult(result);
@@ -241,11 +240,21 @@ void HttpAsrServer::handle_recognize(const httplib::Request& req, httplib::Respo
     }
 }
 
-void HttpAsrServer::Start(const std::string& host, int port) {
+void HttpAsrServer::Start(const std::string& host, int port, const std::vector<int>& warm_up_ms) {
     if (asr_handle == nullptr) {
         throw std::runtime_error("ASR model not initialized");
     }
     
+    warm_up_thread = std::thread([this, warm_up_ms]() {
+        if (!warm_up_ms.empty() && !FunOfflineWarmUp(asr_handle, warm_up_ms)) {
+            LOG(ERROR) << "Warm-up failed, the server takes requests cold";
+        }
+        // the metrics start from the warm server
+        FunASRMetricsReset();
+        ready = true;
+        LOG(INFO) << "Server is ready";
+    });
+    
     // Set up single endpoint that clients use
     server->Post("/transcribe/normal", [this](const httplib::Request& req, httplib::Response& res) {
         handle_recognize(req, res);
@@ -258,6 +267,17 @@ void HttpAsrServer::Start(const std::string& host, int port) {
         res.set_header("Access-Control-Allow-Headers", "Content-Type");
     });
     
+    // Runtime metrics in prometheus text format, recorded only when enabled
+    server->Get("/metrics", [](const httplib::Request& req, httplib::Response& res) {
+        res.set_content(FunASRGetMetrics(), "text/plain; version=0.0.4");
+    });
+    
+    // Readiness probe: 200 once the models are warm
+    server->Get("/ready", [this](const httplib::Request& req, httplib::Response& res) {
+        res.status = ready ? 200 : 503;
+        res.set_content(ready ? "ready\n" : "warming up\n", "text/plain");
+    });
+    
     LOG(INFO) << "Starting HTTP server on " << host << ":" << port;
     
     if (!server->listen(host, port)) {
@@ -274,6 +294,9 @@ void HttpAsrServer::Stop() {
 
 HttpAsrServer::~HttpAsrServer() {
     Stop();
+    if (warm_up_thread.joinable()) {
+        warm_up_thread.join();
+    }
     if (asr_handle) {
         FunOfflineUninit(asr_handle);
         LOG(INFO) << "ASR handle released";
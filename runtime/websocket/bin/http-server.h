@@ -9,6 +9,7 @@
 #ifndef HTTP_SERVER_H_
 #define HTTP_SERVER_H_
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -18,6 +19,7 @@
 #include <glog/logging.h>
 #include "funasrruntime.h"
 #include "nlohmann/json.hpp"
+#include "stamp-sents-json.h"
 #include "tclap/CmdLine.h"
 #include "com-define.h"
 
@@ -46,6 +48,10 @@ private:
     // Configuration
     int thread_num = 8;
     int decoder_thread_num = 8;
+
+    // requests get 503 until the warm-up is done
+    std::atomic<bool> ready{false};
+    std::thread warm_up_thread;
     
     
     // Handle recognition request
@@ -65,8 +71,10 @@ public:
                  const std::string& itn_verbalizer_fst_dir,
                  int thread_num);
     
-    // Start HTTP server
-    void Start(const std::string& host, int port);
+    // Start HTTP server; the models are warmed up over warm_up_ms of
+    // synthetic audio meanwhile (FunOfflineWarmUp) and GET /ready answers
+    // 503 until then
+    void Start(const std::string& host, int port, const std::vector<int>& warm_up_ms = {});
     
     // Stop server
     void Stop();
@@ -0,0 +1,457 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+#include "local-server.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+const size_t kFrameHeader = 5;
+const uint32_t kMaxFrame = 16 << 20;
+const size_t kReadSize = 64 << 10;
+
+std::string MakeFrame(char type, const std::string& payload) {
+  std::string frame(kFrameHeader, '\0');
+  uint32_t len = payload.size();
+  frame[0] = type;
+  for (int i = 0; i < 4; i++) {
+    frame[1 + i] = (char)((len >> (8 * i)) & 0xff);
+  }
+  return frame + payload;
+}
+
+// Everything but set_paused and send_text runs on the strand. Frames are
+// handed to the server straight from the receive buffer and ring audio
+// straight from the shared memory, the stream's pending buffer is the only
+// copy.
+class LocalSession : public LocalPeer,
+                     public std::enable_shared_from_this<LocalSession> {
+ public:
+  LocalSession(asio::io_context& io_context,
+               asio::local::stream_protocol::socket socket,
+               const LocalHandlers& handlers)
+      : strand_(io_context),
+        socket_(std::move(socket)),
+        ring_event_(io_context),
+        handlers_(handlers) {}
+
+  // only reached for a session that never started or has closed: a paused
+  // one is held by self_
+  ~LocalSession() {
+    close();
+    if (ring_) {
+      munmap(ring_, ring_map_size_);
+    }
+  }
+
+  void start() {
+    hdl_ = shared_from_this();
+    asio::error_code ec;
+    // the socket is read with recvmsg to receive the fds of the ring
+    socket_.native_non_blocking(true, ec);
+    if (ec) {
+      LOG(ERROR) << "local connection: " << ec.message();
+      return;
+    }
+    handlers_.on_open(shared_from_this());
+    auto self(shared_from_this());
+    strand_.dispatch([self]() { self->wait_socket(); });
+  }
+
+  void send_text(const std::string& text) override {
+    auto self(shared_from_this());
+    std::string frame = MakeFrame('T', text);
+    strand_.post([self, frame]() {
+      if (self->closed_) {
+        return;
+      }
+      self->outbound_.push_back(frame);
+      if (!self->writing_) {
+        self->do_write();
+      }
+    });
+  }
+
+  void set_paused(bool paused) override {
+    paused_ = paused;
+    auto self(shared_from_this());
+    if (paused) {
+      // a paused session has no read or wait pending that would own it
+      strand_.post([self]() {
+        if (self->paused_ && !self->closed_) {
+          self->self_ = self;
+        }
+      });
+    } else {
+      strand_.post([self]() { self->resume(); });
+    }
+  }
+
+  bool is_open() const override { return !closed_; }
+
+ private:
+  void wait_socket() {
+    reading_ = true;
+    auto self(shared_from_this());
+    socket_.async_wait(asio::socket_base::wait_read,
+                       strand_.wrap([self](const asio::error_code& ec) {
+                         self->reading_ = false;
+                         if (ec) {
+                           self->close();
+                           return;
+                         }
+                         self->read_socket();
+                       }));
+  }
+
+  void read_socket() {
+    while (!closed_) {
+      if (!parse_frames()) {
+        close();
+        return;
+      }
+      if (paused_) {
+        // resume() reads on
+        return;
+      }
+      if (rx_.size() - rx_end_ < kReadSize) {
+        std::copy(rx_.begin() + rx_begin_, rx_.begin() + rx_end_, rx_.begin());
+        rx_end_ -= rx_begin_;
+        rx_begin_ = 0;
+        if (rx_.size() - rx_end_ < kReadSize) {
+          rx_.resize(rx_end_ + kReadSize);
+        }
+      }
+      struct iovec iov;
+      iov.iov_base = rx_.data() + rx_end_;
+      iov.iov_len = rx_.size() - rx_end_;
+      union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * 8)];
+      } control;
+      struct msghdr msg = {};
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof(control.buf);
+      ssize_t n = recvmsg(socket_.native_handle(), &msg, MSG_CMSG_CLOEXEC);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          wait_socket();
+          return;
+        }
+        LOG(ERROR) << "local connection: " << strerror(errno);
+        close();
+        return;
+      }
+      for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+           cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+          int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+          const int* fds = (const int*)CMSG_DATA(cmsg);
+          fds_.insert(fds_.end(), fds, fds + count);
+        }
+      }
+      if (msg.msg_flags & MSG_CTRUNC) {
+        LOG(ERROR) << "local connection: too many fds";
+        close();
+        return;
+      }
+      if (n == 0) {
+        parse_frames();
+        close();
+        return;
+      }
+      rx_end_ += n;
+    }
+  }
+
+  // false on a protocol error
+  bool parse_frames() {
+    while (!paused_ && !closed_ && rx_end_ - rx_begin_ >= kFrameHeader) {
+      const unsigned char* head = (const unsigned char*)rx_.data() + rx_begin_;
+      uint32_t len = (uint32_t)head[1] | (uint32_t)head[2] << 8 |
+                     (uint32_t)head[3] << 16 | (uint32_t)head[4] << 24;
+      if (len > kMaxFrame) {
+        LOG(ERROR) << "local connection: frame of " << len << " bytes";
+        return false;
+      }
+      if (rx_end_ - rx_begin_ < kFrameHeader + len) {
+        break;
+      }
+      char type = head[0];
+      const char* payload = rx_.data() + rx_begin_ + kFrameHeader;
+      rx_begin_ += kFrameHeader + len;
+      switch (type) {
+        case 'T':
+          // the audio written to the ring before this message goes first
+          drain_ring();
+          handlers_.on_frame(hdl_, true, payload, len);
+          break;
+        case 'A':
+          handlers_.on_frame(hdl_, false, payload, len);
+          break;
+        case 'R':
+          setup_ring();
+          break;
+        default:
+          LOG(ERROR) << "local connection: unknown frame type " << (int)type;
+          return false;
+      }
+    }
+    if (rx_begin_ == rx_end_) {
+      rx_begin_ = rx_end_ = 0;
+    }
+    return true;
+  }
+
+  void setup_ring() {
+    std::string error;
+    if (ring_) {
+      error = "the stream has a ring already";
+    } else if (fds_.size() < 3) {
+      error = "the ring frame needs the memory fd and two eventfds";
+    }
+    if (!error.empty()) {
+      send_text("{\"ring\": false, \"error\": \"" + error + "\"}");
+      return;
+    }
+    int mem_fd = fds_[0];
+    int data_fd = fds_[1];
+    int space_fd = fds_[2];
+    fds_.erase(fds_.begin(), fds_.begin() + 3);
+    // a ring the client could still shrink would fault the server on its
+    // next read
+    int seals = fcntl(mem_fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+      ::close(mem_fd);
+      ::close(data_fd);
+      ::close(space_fd);
+      send_text(
+          "{\"ring\": false, \"error\": \"the ring memory needs "
+          "F_SEAL_SHRINK\"}");
+      return;
+    }
+    struct stat st;
+    void* mem = MAP_FAILED;
+    if (fstat(mem_fd, &st) == 0 &&
+        st.st_size > (off_t)sizeof(LocalRingHeader)) {
+      mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 mem_fd, 0);
+    }
+    ::close(mem_fd);
+    if (mem == MAP_FAILED) {
+      ::close(data_fd);
+      ::close(space_fd);
+      send_text("{\"ring\": false, \"error\": \"cannot map the ring\"}");
+      return;
+    }
+    ring_ = (LocalRingHeader*)mem;
+    ring_map_size_ = st.st_size;
+    ring_data_ = (const char*)mem + sizeof(LocalRingHeader);
+    ring_capacity_ = ring_map_size_ - sizeof(LocalRingHeader);
+    space_fd_ = space_fd;
+    asio::error_code ec;
+    ring_event_.assign(data_fd, ec);
+    if (ec) {
+      ::close(data_fd);
+      send_text("{\"ring\": false, \"error\": \"" + ec.message() + "\"}");
+      return;
+    }
+    LOG(INFO) << "local connection: ring of " << ring_capacity_ << " bytes";
+    send_text("{\"ring\": true}");
+    wait_ring();
+  }
+
+  void wait_ring() {
+    ring_waiting_ = true;
+    auto self(shared_from_this());
+    ring_event_.async_wait(
+        asio::posix::stream_descriptor::wait_read,
+        strand_.wrap([self](const asio::error_code& ec) {
+          self->ring_waiting_ = false;
+          if (ec || self->closed_) {
+            return;
+          }
+          uint64_t count;
+          if (::read(self->ring_event_.native_handle(), &count,
+                     sizeof(count)) < 0 &&
+              errno != EAGAIN) {
+            self->close();
+            return;
+          }
+          self->drain_ring();
+          if (!self->paused_ && !self->closed_) {
+            self->wait_ring();
+          }
+        }));
+  }
+
+  void drain_ring() {
+    if (!ring_ || closed_) {
+      return;
+    }
+    uint64_t write_pos = ring_->write_pos.load(std::memory_order_acquire);
+    uint64_t read_pos = ring_->read_pos.load(std::memory_order_relaxed);
+    if (write_pos < read_pos || write_pos - read_pos > ring_capacity_) {
+      LOG(ERROR) << "local connection: ring positions " << read_pos << ", "
+                 << write_pos << " out of order";
+      close();
+      return;
+    }
+    if (write_pos == read_pos) {
+      return;
+    }
+    while (read_pos < write_pos) {
+      uint64_t offset = read_pos % ring_capacity_;
+      size_t len = std::min(write_pos - read_pos, ring_capacity_ - offset);
+      handlers_.on_frame(hdl_, false, ring_data_ + offset, len);
+      read_pos += len;
+    }
+    ring_->read_pos.store(read_pos, std::memory_order_release);
+    uint64_t one = 1;
+    if (::write(space_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG(ERROR) << "local connection: " << strerror(errno);
+    }
+  }
+
+  void resume() {
+    if (closed_ || paused_) {
+      return;
+    }
+    self_.reset();
+    if (ring_ && !ring_waiting_) {
+      drain_ring();
+      if (!paused_ && !closed_) {
+        wait_ring();
+      }
+    }
+    if (!reading_ && !paused_ && !closed_) {
+      read_socket();
+    }
+  }
+
+  void do_write() {
+    writing_ = true;
+    auto self(shared_from_this());
+    asio::async_write(
+        socket_, asio::buffer(outbound_.front()),
+        strand_.wrap([self](const asio::error_code& ec, std::size_t) {
+          self->writing_ = false;
+          if (ec) {
+            self->close();
+            return;
+          }
+          self->outbound_.pop_front();
+          if (!self->outbound_.empty() && !self->closed_) {
+            self->do_write();
+          }
+        }));
+  }
+
+  void close() {
+    if (closed_.exchange(true)) {
+      return;
+    }
+    asio::error_code ec;
+    socket_.close(ec);
+    ring_event_.close(ec);
+    if (space_fd_ >= 0) {
+      ::close(space_fd_);
+      space_fd_ = -1;
+    }
+    for (int fd : fds_) {
+      ::close(fd);
+    }
+    fds_.clear();
+    handlers_.on_close(hdl_);
+    self_.reset();
+  }
+
+  asio::io_context::strand strand_;
+  asio::local::stream_protocol::socket socket_;
+  asio::posix::stream_descriptor ring_event_;
+  LocalHandlers handlers_;
+  std::weak_ptr<void> hdl_;
+  // set while paused, from set_paused(true) until resume() or close()
+  std::shared_ptr<LocalSession> self_;
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> paused_{false};
+  bool reading_ = false;
+  bool ring_waiting_ = false;
+  bool writing_ = false;
+
+  // received bytes not parsed yet are [rx_begin_, rx_end_)
+  std::vector<char> rx_;
+  size_t rx_begin_ = 0;
+  size_t rx_end_ = 0;
+  // fds received with the frames, taken by the ring frame
+  std::vector<int> fds_;
+  std::deque<std::string> outbound_;
+
+  LocalRingHeader* ring_ = nullptr;
+  size_t ring_map_size_ = 0;
+  const char* ring_data_ = nullptr;
+  uint64_t ring_capacity_ = 0;
+  int space_fd_ = -1;
+};
+
+}  // namespace
+
+LocalServer::LocalServer(asio::io_context& io_context, const std::string& path,
+                         LocalHandlers handlers)
+    : io_context_(io_context),
+      acceptor_(io_context),
+      path_(path),
+      handlers_(std::move(handlers)) {
+  ::unlink(path.c_str());
+  asio::local::stream_protocol::endpoint endpoint(path);
+  acceptor_.open(endpoint.protocol());
+  acceptor_.bind(endpoint);
+  // for the user of the server only, before anyone can connect
+  if (::chmod(path.c_str(), 0600) != 0) {
+    throw std::system_error(errno, std::generic_category(), "chmod " + path);
+  }
+  acceptor_.listen();
+  LOG(INFO) << "local transport listens on " << path;
+  do_accept();
+}
+
+LocalServer::~LocalServer() {
+  asio::error_code ec;
+  acceptor_.close(ec);
+  ::unlink(path_.c_str());
+}
+
+void LocalServer::do_accept() {
+  acceptor_.async_accept(
+      [this](asio::error_code ec, asio::local::stream_protocol::socket socket) {
+        if (!ec) {
+          std::make_shared<LocalSession>(io_context_, std::move(socket),
+                                         handlers_)
+              ->start();
+        } else if (ec == asio::error::operation_aborted) {
+          return;
+        }
+        do_accept();
+      });
+}
+#endif  // __linux__
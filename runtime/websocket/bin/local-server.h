@@ -0,0 +1,92 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+// Local transport of the 2pass server for media servers on the same host. A
+// unix domain socket carries a small framed protocol instead of websocket
+// framing, masking and TLS, and a stream may hand over a shared memory ring
+// so that its audio needs no syscall and no copy on the way in.
+//
+// Frames, in both directions: 1 byte type, 4 bytes payload length (little
+// endian), payload.
+//   'T'  text: the json messages of the websocket protocol, the client's
+//        start and end messages and the server's results
+//   'A'  audio, like a binary websocket message
+//   'R'  ring: the client hands over a shared memory ring for its audio. The
+//        payload is empty, the frame carries three fds as SCM_RIGHTS: the
+//        ring memory (a memfd sealed with F_SEAL_SHRINK, so that it cannot
+//        shrink under the server's mapping), an eventfd the client signals
+//        after writing and an eventfd the server signals after reading. The
+//        server answers {"ring": true} or {"ring": false, "error": ...}.
+// The ring is a LocalRingHeader followed by the data. The positions only
+// grow, the byte at pos is data[pos % capacity]. The client writes between
+// write_pos and read_pos + capacity and publishes write_pos before it
+// signals. The audio in the ring reaches the stream before any later frame
+// of the socket, so {"is_speaking": false} may follow the last write right
+// away. The ring carries a byte stream: pcm, or a compressed format with any
+// chunking; packet formats such as opus-packet go in 'A' frames.
+
+#ifndef LOCAL_SERVER_H_
+#define LOCAL_SERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#define ASIO_STANDALONE 1  // not boost
+#include <glog/logging.h>
+
+#include "asio.hpp"
+
+struct LocalRingHeader {
+  std::atomic<uint64_t> write_pos;
+  char pad0[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> read_pos;
+  char pad1[64 - sizeof(std::atomic<uint64_t>)];
+};
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "the ring positions are shared between processes");
+
+// a local connection as the 2pass server sees it, the connection_hdl of the
+// stream points to it
+class LocalPeer {
+ public:
+  virtual ~LocalPeer() {}
+  virtual void send_text(const std::string& text) = 0;
+  // a paused connection reads neither its socket nor its ring, the client
+  // then blocks on a full socket or ring
+  virtual void set_paused(bool paused) = 0;
+  virtual bool is_open() const = 0;
+};
+
+struct LocalHandlers {
+  std::function<void(std::shared_ptr<LocalPeer>)> on_open;
+  std::function<void(std::weak_ptr<void>)> on_close;
+  // data is only valid during the call
+  std::function<void(std::weak_ptr<void>, bool is_text, const char* data,
+                     size_t len)>
+      on_frame;
+};
+
+// linux only: the rings are memfds passed with recvmsg
+#if defined(__linux__)
+class LocalServer {
+ public:
+  // replaces a socket file left at path, the new one is for the user only
+  LocalServer(asio::io_context& io_context, const std::string& path,
+              LocalHandlers handlers);
+  ~LocalServer();
+
+ private:
+  void do_accept();
+
+  asio::io_context& io_context_;
+  asio::local::stream_protocol::acceptor acceptor_;
+  std::string path_;
+  LocalHandlers handlers_;
+};
+#endif  // __linux__
+
+#endif  // LOCAL_SERVER_H_
@@ -0,0 +1,106 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+#include "metrics-server.h"
+
+namespace {
+
+// one request per connection, the reply closes it
+class MetricsSession : public std::enable_shared_from_this<MetricsSession> {
+ public:
+  MetricsSession(asio::ip::tcp::socket socket,
+                 std::function<std::string()> extra_metrics,
+                 std::function<bool()> ready)
+      : socket_(std::move(socket)),
+        extra_metrics_(extra_metrics),
+        ready_(ready) {}
+
+  void start() {
+    auto self(shared_from_this());
+    asio::async_read_until(
+        socket_, asio::dynamic_buffer(request_, 8192), "\r\n\r\n",
+        [this, self](asio::error_code ec, std::size_t) {
+          if (ec) {
+            return;
+          }
+          reply();
+        });
+  }
+
+ private:
+  void reply() {
+    std::string body;
+    std::string status;
+    if (request_.compare(0, 13, "GET /metrics ") == 0 ||
+        request_.compare(0, 13, "GET /metrics?") == 0) {
+      status = "200 OK";
+      body = FunASRGetMetrics();
+      if (extra_metrics_) {
+        body += extra_metrics_();
+      }
+    } else if (request_.compare(0, 11, "GET /ready ") == 0 ||
+               request_.compare(0, 11, "GET /ready?") == 0) {
+      if (!ready_ || ready_()) {
+        status = "200 OK";
+        body = "ready\n";
+      } else {
+        status = "503 Service Unavailable";
+        body = "warming up\n";
+      }
+    } else {
+      status = "404 Not Found";
+      body = "only GET /metrics and GET /ready are served here\n";
+    }
+    response_ = "HTTP/1.1 " + status +
+                "\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) +
+                "\r\nConnection: close\r\n\r\n" + body;
+    auto self(shared_from_this());
+    asio::async_write(socket_, asio::buffer(response_),
+                      [this, self](asio::error_code ec, std::size_t) {
+                        asio::error_code ignored_ec;
+                        socket_.shutdown(asio::ip::tcp::socket::shutdown_both,
+                                         ignored_ec);
+                      });
+  }
+
+  asio::ip::tcp::socket socket_;
+  std::function<std::string()> extra_metrics_;
+  std::function<bool()> ready_;
+  std::string request_;
+  std::string response_;
+};
+
+}  // namespace
+
+MetricsServer::MetricsServer(asio::io_context& io_context,
+                             const std::string& listen_ip, int port,
+                             std::function<std::string()> extra_metrics,
+                             std::function<bool()> ready)
+    : acceptor_(io_context,
+                asio::ip::tcp::endpoint(asio::ip::make_address(listen_ip),
+                                        port)),
+      extra_metrics_(extra_metrics),
+      ready_(ready) {
+  LOG(INFO) << "metrics are served on http://" << listen_ip << ":" << port
+            << "/metrics";
+  do_accept();
+}
+
+void MetricsServer::do_accept() {
+  acceptor_.async_accept(
+      [this](asio::error_code ec, asio::ip::tcp::socket socket) {
+        if (!ec) {
+          std::make_shared<MetricsSession>(std::move(socket), extra_metrics_,
+                                           ready_)
+              ->start();
+        } else {
+          LOG(ERROR) << "metrics accept error: " << ec.message();
+        }
+        if (acceptor_.is_open()) {
+          do_accept();
+        }
+      });
+}
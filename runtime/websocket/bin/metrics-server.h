@@ -0,0 +1,40 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+// Minimal HTTP endpoint that serves the runtime metrics (FunASRGetMetrics) in
+// Prometheus text format on GET /metrics, and on GET /ready 200 once the
+// server is ready and 503 before, for the probes of a load balancer. It
+// shares the io_context of the websocket server and is meant to listen on a
+// local address only.
+
+#ifndef METRICS_SERVER_H_
+#define METRICS_SERVER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#define ASIO_STANDALONE 1  // not boost
+#include <glog/logging.h>
+
+#include "asio.hpp"
+#include "funasrruntime.h"
+
+class MetricsServer {
+ public:
+  // extra_metrics, when set, is appended to the runtime metrics; without
+  // ready the server is always ready
+  MetricsServer(asio::io_context& io_context, const std::string& listen_ip,
+                int port, std::function<std::string()> extra_metrics = nullptr,
+                std::function<bool()> ready = nullptr);
+
+ private:
+  void do_accept();
+
+  asio::ip::tcp::acceptor acceptor_;
+  std::function<std::string()> extra_metrics_;
+  std::function<bool()> ready_;
+};
+
+#endif  // METRICS_SERVER_H_
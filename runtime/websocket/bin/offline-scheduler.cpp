@@ -0,0 +1,171 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+#include "offline-scheduler.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+// multiplies the cost of a job by its priority class
+const double kPriorityScale[SCHED_PRIORITY_NUM] = {0.25, 1.0, 4.0};
+}  // namespace
+
+OfflineScheduler::OfflineScheduler(const SchedulerOptions& opts,
+                                   Executor executor)
+    : opts_(opts), executor_(std::move(executor)) {
+  opts_.max_running = std::max(1, opts_.max_running);
+}
+
+bool OfflineScheduler::Submit(std::function<void()> job, double audio_sec,
+                              size_t bytes, int priority,
+                              int* retry_after_ms) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  // with nothing in flight a job is always taken, even one above the budget
+  bool busy = running_ > 0 || !queue_.empty();
+  if ((int)queue_.size() >= opts_.max_queue ||
+      (busy && opts_.max_audio_sec > 0 &&
+       inflight_sec_ + audio_sec > opts_.max_audio_sec) ||
+      (busy && opts_.max_bytes > 0 &&
+       inflight_bytes_ + bytes > opts_.max_bytes)) {
+    rejected_++;
+    if (retry_after_ms) {
+      *retry_after_ms = RetryAfterMs();
+    }
+    return false;
+  }
+  std::shared_ptr<Job> new_job = std::make_shared<Job>();
+  new_job->run = std::move(job);
+  new_job->audio_sec = audio_sec;
+  new_job->bytes = bytes;
+  new_job->priority =
+      std::min(std::max(priority, 0), (int)SCHED_PRIORITY_NUM - 1);
+  new_job->enqueue_time = Clock::now();
+  queue_.push_back(new_job);
+  inflight_sec_ += audio_sec;
+  inflight_bytes_ += bytes;
+  admitted_++;
+  Dispatch(lock);
+  return true;
+}
+
+void OfflineScheduler::Dispatch(std::unique_lock<std::mutex>& lock) {
+  std::vector<std::shared_ptr<Job>> ready;
+  Clock::time_point now = Clock::now();
+  while (running_ < opts_.max_running && !queue_.empty()) {
+    size_t best = 0;
+    double best_score = 0;
+    for (size_t i = 0; i < queue_.size(); i++) {
+      double wait_sec =
+          std::chrono::duration<double>(now - queue_[i]->enqueue_time).count();
+      double score = queue_[i]->audio_sec * kPriorityScale[queue_[i]->priority] -
+                     wait_sec * opts_.aging;
+      if (i == 0 || score < best_score) {
+        best = i;
+        best_score = score;
+      }
+    }
+    double wait_sec =
+        std::chrono::duration<double>(now - queue_[best]->enqueue_time).count();
+    wait_sum_ += wait_sec;
+    wait_count_++;
+    wait_max_ = std::max(wait_max_, wait_sec);
+    ready.push_back(queue_[best]);
+    queue_.erase(queue_.begin() + best);
+    running_++;
+  }
+  lock.unlock();
+  for (auto& job : ready) {
+    executor_([this, job]() { RunJob(job); });
+  }
+}
+
+void OfflineScheduler::RunJob(std::shared_ptr<Job> job) {
+  Clock::time_point start = Clock::now();
+  try {
+    job->run();
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "offline job failed: " << e.what();
+  }
+  double decode_sec =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  running_--;
+  inflight_sec_ = std::max(0.0, inflight_sec_ - job->audio_sec);
+  inflight_bytes_ -= std::min(inflight_bytes_, job->bytes);
+  // very short jobs are dominated by fixed overhead and would skew the estimate
+  if (job->audio_sec >= 1.0) {
+    rtf_ = 0.8 * rtf_ + 0.2 * (decode_sec / job->audio_sec);
+  }
+  Dispatch(lock);
+}
+
+// time until the work in flight is expected to be drained, called locked
+int OfflineScheduler::RetryAfterMs() {
+  double drain_sec = inflight_sec_ * rtf_ / opts_.max_running;
+  return (int)std::min(600000.0, std::max(1000.0, drain_sec * 1000));
+}
+
+int OfflineScheduler::QueueDepth() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return (int)queue_.size();
+}
+
+std::string OfflineScheduler::GetMetrics() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  Clock::time_point now = Clock::now();
+  double oldest_wait = 0;
+  for (auto& job : queue_) {
+    oldest_wait = std::max(
+        oldest_wait,
+        std::chrono::duration<double>(now - job->enqueue_time).count());
+  }
+  std::ostringstream oss;
+  oss << "# HELP funasr_sched_queue_depth Offline jobs waiting to be decoded.\n";
+  oss << "# TYPE funasr_sched_queue_depth gauge\n";
+  oss << "funasr_sched_queue_depth " << queue_.size() << "\n";
+  oss << "# TYPE funasr_sched_running gauge\n";
+  oss << "funasr_sched_running " << running_ << "\n";
+  oss << "# TYPE funasr_sched_inflight_audio_seconds gauge\n";
+  oss << "funasr_sched_inflight_audio_seconds " << inflight_sec_ << "\n";
+  oss << "# TYPE funasr_sched_inflight_bytes gauge\n";
+  oss << "funasr_sched_inflight_bytes " << inflight_bytes_ << "\n";
+  oss << "# TYPE funasr_sched_oldest_wait_seconds gauge\n";
+  oss << "funasr_sched_oldest_wait_seconds " << oldest_wait << "\n";
+  oss << "# HELP funasr_sched_wait_seconds Time from admission to decoding.\n";
+  oss << "# TYPE funasr_sched_wait_seconds summary\n";
+  oss << "funasr_sched_wait_seconds_sum " << wait_sum_ << "\n";
+  oss << "funasr_sched_wait_seconds_count " << wait_count_ << "\n";
+  oss << "# TYPE funasr_sched_wait_seconds_max gauge\n";
+  oss << "funasr_sched_wait_seconds_max " << wait_max_ << "\n";
+  oss << "# TYPE funasr_sched_admitted_total counter\n";
+  oss << "funasr_sched_admitted_total " << admitted_ << "\n";
+  oss << "# TYPE funasr_sched_rejected_total counter\n";
+  oss << "funasr_sched_rejected_total " << rejected_ << "\n";
+  return oss.str();
+}
+
+double OfflineScheduler::EstimateAudioSec(size_t bytes,
+                                          const std::string& wav_format,
+                                          int audio_fs) {
+  if (wav_format == "pcm" || wav_format == "PCM" || wav_format == "wav" ||
+      wav_format == "WAV") {
+    return (double)bytes / (2.0 * std::max(audio_fs, 1));
+  }
+  return (double)bytes / 16000.0;
+}
+
+int OfflineScheduler::ParsePriority(const std::string& name) {
+  if (name == "high" || name == "0") {
+    return SCHED_PRIORITY_HIGH;
+  }
+  if (name == "low" || name == "2") {
+    return SCHED_PRIORITY_LOW;
+  }
+  return SCHED_PRIORITY_NORMAL;
+}
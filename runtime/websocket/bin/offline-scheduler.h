@@ -0,0 +1,92 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+
+// Admission control and ordering of offline decode jobs. A job is costed by
+// its audio duration; waiting jobs run shortest first within their priority
+// class, and a job that has waited long enough overtakes shorter ones
+// (aging). Once the in-flight audio or memory budget is used up, new jobs are
+// rejected at once with a hint when to retry instead of queueing unbounded.
+// Used by the offline websocket server and by the http server.
+
+#ifndef OFFLINE_SCHEDULER_H_
+#define OFFLINE_SCHEDULER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum SchedPriority {
+  SCHED_PRIORITY_HIGH = 0,
+  SCHED_PRIORITY_NORMAL,
+  SCHED_PRIORITY_LOW,
+  SCHED_PRIORITY_NUM
+};
+
+struct SchedulerOptions {
+  int max_running = 1;     // jobs decoded at the same time
+  int max_queue = 1024;    // jobs waiting to be decoded
+  double max_audio_sec = 7200;  // queued and running audio, 0 for no limit
+  size_t max_bytes = (size_t)2048 << 20;  // queued and running request data, 0 for no limit
+  double aging = 10;  // audio seconds a job is forgiven per second of waiting
+};
+
+class OfflineScheduler {
+ public:
+  // runs a task on a decoder thread, e.g. asio::post onto io_decoder
+  typedef std::function<void(std::function<void()>)> Executor;
+
+  OfflineScheduler(const SchedulerOptions& opts, Executor executor);
+
+  // queues a job; when the server is saturated the job is dropped, false is
+  // returned and retry_after_ms tells the client when to come back
+  bool Submit(std::function<void()> job, double audio_sec, size_t bytes,
+              int priority, int* retry_after_ms);
+
+  int QueueDepth();
+  // queue depth, in-flight load and wait times in Prometheus text format
+  std::string GetMetrics();
+
+  // audio duration of a request body; compressed formats are assumed to be
+  // encoded at 128 kbit/s since their length is unknown before decoding
+  static double EstimateAudioSec(size_t bytes, const std::string& wav_format,
+                                 int audio_fs);
+  // "high", "normal", "low" or 0..2, anything else is normal
+  static int ParsePriority(const std::string& name);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  struct Job {
+    std::function<void()> run;
+    double audio_sec;
+    size_t bytes;
+    int priority;
+    Clock::time_point enqueue_time;
+  };
+
+  void Dispatch(std::unique_lock<std::mutex>& lock);
+  void RunJob(std::shared_ptr<Job> job);
+  int RetryAfterMs();
+
+  SchedulerOptions opts_;
+  Executor executor_;
+  std::mutex mtx_;
+  std::vector<std::shared_ptr<Job>> queue_;
+  int running_ = 0;
+  double inflight_sec_ = 0;
+  size_t inflight_bytes_ = 0;
+  // decode seconds per audio second, smoothed over finished jobs
+  double rtf_ = 0.1;
+  int64_t admitted_ = 0;
+  int64_t rejected_ = 0;
+  double wait_sum_ = 0;
+  int64_t wait_count_ = 0;
+  double wait_max_ = 0;
+};
+
+#endif  // OFFLINE_SCHEDULER_H_
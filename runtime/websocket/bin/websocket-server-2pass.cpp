@@ -12,6 +12,8 @@
 
 #include "websocket-server-2pass.h"
 
+#include <algorithm>
+#include <sstream>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -20,6 +22,9 @@ extern std::unordered_map<std::string, int> hws_map_;
 extern int fst_inc_wts_;
 extern float global_beam_, lattice_beam_, am_scale_;
 
+// the set of the model flags, for streams that name none
+static const char* DEFAULT_MODEL_SET = "default";
+
 context_ptr WebSocketServer::on_tls_init(tls_mode mode,
                                          websocketpp::connection_hdl hdl,
                                          std::string& s_certfile,
@@ -81,17 +86,10 @@ nlohmann::json handle_result(FUNASR_RESULT result) {
     jsonresult["timestamp"] = tmp_stamp_msg;
   }
 
-  std::string tmp_stamp_sents = FunASRGetStampSents(result);
-  if (tmp_stamp_sents != "") {
-    try{
-      nlohmann::json json_stamp = nlohmann::json::parse(tmp_stamp_sents);
-      LOG(INFO) << "offline stamp_sents : " << json_stamp;
-      jsonresult["stamp_sents"] = json_stamp;
-    }catch (std::exception const &e)
-    {
-      LOG(ERROR)<< tmp_stamp_sents << e.what();
-      jsonresult["stamp_sents"] = "";
-    }
+  if (FunASRGetStampSentNum(result) > 0) {
+    nlohmann::json json_stamp = funasr::GetStampSentsJson(result);
+    LOG(INFO) << "offline stamp_sents : " << json_stamp;
+    jsonresult["stamp_sents"] = json_stamp;
   }
 
   return jsonresult;
@@ -110,15 +108,14 @@ void WebSocketServer::do_decoder(
     bool itn,
     int audio_fs,
     std::string wav_format,
+    FUNASR_HANDLE tpass_handle,
     FUNASR_HANDLE& tpass_online_handle,
     FUNASR_DEC_HANDLE& decoder_handle,
     std::string svs_lang,
     bool sys_itn) {
-  // lock for each connection
+  // the decode turn calling this holds an access of the connection
   if(!tpass_online_handle){
-    scoped_lock guard(thread_lock);
 	  LOG(INFO) << "tpass_online_handle  is free, return";
-	  msg["access_num"]=(int)msg["access_num"]-1;
 	  return;
   }
   try {
@@ -132,9 +129,15 @@ void WebSocketServer::do_decoder(
       asr_mode_ = 2;
     }
 
-    while (buffer.size() >= 800 * 2 && !msg["is_eof"]) {
-      std::vector<char> subvector = {buffer.begin(), buffer.begin() + 800 * 2};
-      buffer.erase(buffer.begin(), buffer.begin() + 800 * 2);
+    // pcm is fed in whole 100ms steps, all of a backlog in one call, a
+    // compressed stream as it arrived since the decoder keeps its state
+    // across chunks
+    bool is_pcm = (wav_format == "pcm" || wav_format == "PCM");
+    size_t step = is_pcm ? buffer.size() / (800 * 2) * (800 * 2)
+                         : std::max<size_t>(buffer.size(), 1);
+    while (step > 0 && buffer.size() >= step && !msg["is_eof"]) {
+      std::vector<char> subvector = {buffer.begin(), buffer.begin() + step};
+      buffer.erase(buffer.begin(), buffer.begin() + step);
 
       try {
         if (tpass_online_handle) {
@@ -146,29 +149,18 @@ void WebSocketServer::do_decoder(
                                        svs_lang, sys_itn);
 
         } else {
-          scoped_lock guard(thread_lock);
-          msg["access_num"]=(int)msg["access_num"]-1;
           return;
         }
       } catch (std::exception const& e) {
-        scoped_lock guard(thread_lock);
         LOG(ERROR) << e.what();
-        msg["access_num"]=(int)msg["access_num"]-1;
         return;
       }
       if (Result) {
-        websocketpp::lib::error_code ec;
         nlohmann::json jsonresult = handle_result(Result);
         jsonresult["wav_name"] = wav_name;
         jsonresult["is_final"] = false;
         if (jsonresult["text"] != "") {
-          if (is_ssl) {
-            wss_server_->send(hdl, jsonresult.dump(),
-                              websocketpp::frame::opcode::text, ec);
-          } else {
-            server_->send(hdl, jsonresult.dump(),
-                          websocketpp::frame::opcode::text, ec);
-          }
+          send_text(hdl, jsonresult.dump());
         }
         FunASRFreeResult(Result);
       }
@@ -183,14 +175,10 @@ void WebSocketServer::do_decoder(
                                        hotwords_embedding, itn, decoder_handle,
                                        svs_lang, sys_itn);
         } else {
-          scoped_lock guard(thread_lock);
-          msg["access_num"]=(int)msg["access_num"]-1;	 
           return;
         }
       } catch (std::exception const& e) {
-        scoped_lock guard(thread_lock);
         LOG(ERROR) << e.what();
-        msg["access_num"]=(int)msg["access_num"]-1;
         return;
       }
       if(punc_cache.size()>0){
@@ -199,32 +187,21 @@ void WebSocketServer::do_decoder(
         }
       }
       if (Result) {
-        websocketpp::lib::error_code ec;
         nlohmann::json jsonresult = handle_result(Result);
         jsonresult["wav_name"] = wav_name;
-        jsonresult["is_final"] = true;
-        if (is_ssl) {
-          wss_server_->send(hdl, jsonresult.dump(),
-                            websocketpp::frame::opcode::text, ec);
-        } else {
-          server_->send(hdl, jsonresult.dump(),
-                        websocketpp::frame::opcode::text, ec);
+        // with the offline lane the final message is its last result
+        jsonresult["is_final"] = !async_offline_;
+        if (!async_offline_ || jsonresult["text"] != "") {
+          send_text(hdl, jsonresult.dump());
         }
         FunASRFreeResult(Result);
       }else{
-        if(wav_format != "pcm" && wav_format != "PCM"){
-          websocketpp::lib::error_code ec;
+        if(!is_pcm){
           nlohmann::json jsonresult;
-          jsonresult["text"] = "ERROR. Real-time transcription service ONLY SUPPORT PCM stream.";
+          jsonresult["text"] = "ERROR. Real-time transcription service could not decode the " + wav_format + " stream.";
           jsonresult["wav_name"] = wav_name;
           jsonresult["is_final"] = true;
-          if (is_ssl) {
-            wss_server_->send(hdl, jsonresult.dump(),
-                              websocketpp::frame::opcode::text, ec);
-          } else {
-            server_->send(hdl, jsonresult.dump(),
-                          websocketpp::frame::opcode::text, ec);
-          }
+          send_text(hdl, jsonresult.dump());
         }
       }
     }
@@ -232,9 +209,288 @@ void WebSocketServer::do_decoder(
   } catch (std::exception const& e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
-  scoped_lock guard(thread_lock);
-  msg["access_num"]=(int)msg["access_num"]-1;
- 
+}
+
+static bool IsPcm(const nlohmann::json& msg) {
+  return msg["wav_format"] == "pcm" || msg["wav_format"] == "PCM";
+}
+
+// bytes of a stream per ms of audio, a compressed one is counted at 128kbit/s
+static double BytesPerMs(const nlohmann::json& msg) {
+  if (!IsPcm(msg)) {
+    return 16.0;
+  }
+  int audio_fs = msg["audio_fs"];
+  return std::max(audio_fs, 1) * 2 / 1000.0;
+}
+
+static double PendingMs(const FUNASR_MESSAGE& msg_data) {
+  return (msg_data.received_bytes - msg_data.decoded_bytes) /
+         BytesPerMs(msg_data.msg);
+}
+
+void WebSocketServer::schedule_decoder(
+    websocketpp::connection_hdl hdl, std::shared_ptr<FUNASR_MESSAGE> msg_data) {
+  if (msg_data->decode_queued || msg_data->msg["is_eof"] == true ||
+      msg_data->hotwords_embedding == nullptr) {
+    return;
+  }
+  msg_data->decode_queued = true;
+  msg_data->msg["access_num"] = (int)(msg_data->msg["access_num"]) + 1;
+  msg_data->strand_->post(
+      [this, hdl, msg_data]() { run_decoder(hdl, msg_data); });
+}
+
+// one decode turn of a stream, on its strand: takes the pending audio, feeds
+// it and queues the next turn if more came meanwhile
+void WebSocketServer::run_decoder(websocketpp::connection_hdl hdl,
+                                  std::shared_ptr<FUNASR_MESSAGE> msg_data) {
+  std::vector<std::vector<char>> buffers;
+  std::vector<std::vector<float>> hotwords_embedding;
+  bool is_final = false;
+  std::string wav_name, modetype, wav_format, svs_lang;
+  bool itn = true, svs_itn = true;
+  int audio_fs = 16000;
+  size_t taken = 0;
+  std::chrono::steady_clock::time_point taken_since;
+  std::vector<int> chunk_size;
+  {
+    scoped_lock guard(*msg_data->thread_lock);
+    std::vector<char>& samples = *msg_data->samples;
+    is_final = msg_data->input_end;
+    msg_data->input_end = false;
+    if (IsPcm(msg_data->msg)) {
+      taken = is_final ? samples.size()
+                       : samples.size() / (800 * 2) * (800 * 2);
+      buffers.emplace_back(samples.begin(), samples.begin() + taken);
+    } else {
+      for (size_t size : msg_data->packet_sizes) {
+        buffers.emplace_back(samples.begin() + taken,
+                             samples.begin() + taken + size);
+        taken += size;
+      }
+      msg_data->packet_sizes.clear();
+    }
+    samples.erase(samples.begin(), samples.begin() + taken);
+    taken_since = msg_data->pending_since;
+    if (msg_data->adaptive_chunk) {
+      chunk_size = chunk_policy_->Pick(msg_data->latency_class);
+      if (chunk_size == msg_data->chunk_size) {
+        chunk_size.clear();
+      }
+    }
+    wav_name = msg_data->msg["wav_name"].get<std::string>();
+    modetype = msg_data->msg["mode"].get<std::string>();
+    wav_format = msg_data->msg["wav_format"].get<std::string>();
+    svs_lang = msg_data->msg["svs_lang"].get<std::string>();
+    itn = msg_data->msg["itn"].get<bool>();
+    svs_itn = msg_data->msg["svs_itn"].get<bool>();
+    audio_fs = msg_data->msg["audio_fs"].get<int>();
+    hotwords_embedding = *msg_data->hotwords_embedding;
+  }
+  if (buffers.empty() && is_final) {
+    buffers.emplace_back();
+  }
+  // a turn starts on a chunk boundary, the last call drained the online queue
+  if (!chunk_size.empty() && msg_data->tpass_online_handle &&
+      FunTpassOnlineSetChunkSize(msg_data->tpass_online_handle, chunk_size)) {
+    LOG(INFO) << wav_name << " chunk size " << chunk_size[0] << ","
+              << chunk_size[1] << "," << chunk_size[2];
+  } else {
+    chunk_size.clear();
+  }
+  for (size_t i = 0; i < buffers.size(); i++) {
+    bool buffer_final = is_final && i + 1 == buffers.size();
+    do_decoder(buffers[i], hdl, msg_data->msg, *msg_data->punc_cache,
+               hotwords_embedding, *msg_data->thread_lock, buffer_final,
+               wav_name, modetype, itn, audio_fs, wav_format,
+               msg_data->tpass_handle, msg_data->tpass_online_handle,
+               msg_data->decoder_handle,
+               svs_lang, svs_itn);
+  }
+
+  if (chunk_policy_ && taken > 0) {
+    chunk_policy_->Report(std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - taken_since)
+                              .count());
+  }
+
+  scoped_lock guard(*msg_data->thread_lock);
+  if (!chunk_size.empty()) {
+    msg_data->chunk_size = chunk_size;
+  }
+  msg_data->decoded_bytes += taken;
+  msg_data->decode_queued = false;
+  msg_data->msg["access_num"] = (int)(msg_data->msg["access_num"]) - 1;
+  if (msg_data->received_bytes > msg_data->decoded_bytes) {
+    msg_data->pending_since = std::chrono::steady_clock::now();
+  }
+  if (msg_data->paused && PendingMs(*msg_data) <= max_pending_ms_ / 2) {
+    set_paused(hdl, *msg_data, false);
+  }
+  // the next turn goes behind the turns other streams queued meanwhile
+  if (msg_data->input_end || !msg_data->packet_sizes.empty() ||
+      (IsPcm(msg_data->msg) && msg_data->samples->size() >= 800 * 2)) {
+    schedule_decoder(hdl, msg_data);
+  }
+}
+
+void WebSocketServer::set_paused(websocketpp::connection_hdl hdl,
+                                 FUNASR_MESSAGE& msg_data, bool paused) {
+  websocketpp::lib::error_code ec;
+  bool is_local = false;
+  std::shared_ptr<LocalPeer> peer = local_peer(hdl, &is_local);
+  try {
+    if (is_local) {
+      if (!peer) {
+        return;
+      }
+      peer->set_paused(paused);
+    } else if (is_ssl) {
+      wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
+      ec = paused ? con->pause_reading() : con->resume_reading();
+    } else {
+      server::connection_ptr con = server_->get_con_from_hdl(hdl);
+      ec = paused ? con->pause_reading() : con->resume_reading();
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << e.what();
+    return;
+  }
+  if (ec) {
+    LOG(ERROR) << "pause/resume reading failed: " << ec.message();
+    return;
+  }
+  msg_data.paused = paused;
+  LOG(INFO) << (paused ? "pause" : "resume") << " reading "
+            << msg_data.msg["wav_name"] << ", pending "
+            << (int)PendingMs(msg_data) << " ms";
+}
+
+std::string WebSocketServer::GetStreamMetrics() {
+  std::ostringstream oss;
+  std::ostringstream pending, lag, max_lag;
+  int streams = 0, paused = 0;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  scoped_lock guard(m_lock);
+  for (auto& it : data_map) {
+    FUNASR_MESSAGE& msg_data = *it.second;
+    scoped_lock guard_decoder(*msg_data.thread_lock);
+    if (msg_data.msg["is_eof"] == true) {
+      continue;
+    }
+    streams++;
+    paused += msg_data.paused ? 1 : 0;
+    double lag_ms = 0;
+    if (msg_data.received_bytes > msg_data.decoded_bytes) {
+      lag_ms = std::chrono::duration<double, std::milli>(
+                   now - msg_data.pending_since).count();
+    }
+    msg_data.max_lag_ms = std::max(msg_data.max_lag_ms, lag_ms);
+    std::string wav_name;
+    for (char c : msg_data.msg["wav_name"].get<std::string>()) {
+      if (c == '"' || c == '\\') {
+        wav_name += '\\';
+      }
+      wav_name += (c == '\n') ? ' ' : c;
+    }
+    std::string labels = "{stream=\"" + std::to_string(msg_data.stream_id) +
+                         "\",wav_name=\"" + wav_name + "\"}";
+    pending << "funasr_2pass_stream_pending_ms" << labels << " "
+            << PendingMs(msg_data) << "\n";
+    lag << "funasr_2pass_stream_lag_ms" << labels << " " << lag_ms << "\n";
+    max_lag << "funasr_2pass_stream_max_lag_ms" << labels << " "
+            << msg_data.max_lag_ms << "\n";
+  }
+  oss << "# TYPE funasr_2pass_streams gauge\n";
+  oss << "funasr_2pass_streams " << streams << "\n";
+  oss << "# HELP funasr_2pass_streams_paused Streams not read until their "
+         "pending audio is decoded.\n";
+  oss << "# TYPE funasr_2pass_streams_paused gauge\n";
+  oss << "funasr_2pass_streams_paused " << paused << "\n";
+  oss << "# HELP funasr_2pass_stream_pending_ms Audio received and not "
+         "decoded yet.\n";
+  oss << "# TYPE funasr_2pass_stream_pending_ms gauge\n";
+  oss << pending.str();
+  oss << "# HELP funasr_2pass_stream_lag_ms Time the oldest pending audio "
+         "has waited.\n";
+  oss << "# TYPE funasr_2pass_stream_lag_ms gauge\n";
+  oss << lag.str();
+  oss << "# TYPE funasr_2pass_stream_max_lag_ms gauge\n";
+  oss << max_lag.str();
+  if (chunk_policy_) {
+    oss << "# HELP funasr_2pass_chunk_level Index of the chunk size adaptive "
+           "streams may use, 0 is the smallest.\n";
+    oss << "# TYPE funasr_2pass_chunk_level gauge\n";
+    oss << "funasr_2pass_chunk_level " << chunk_policy_->Level() << "\n";
+  }
+  oss << FunModelRegistryGetMetrics(model_registry_);
+  return oss.str();
+}
+
+// is_local is set for a stream of the local transport, whose peer is null
+// once its session is gone
+std::shared_ptr<LocalPeer> WebSocketServer::local_peer(
+    websocketpp::connection_hdl hdl, bool* is_local) {
+  scoped_lock guard(local_lock_);
+  auto it = local_peers_.find(hdl);
+  *is_local = it != local_peers_.end();
+  return *is_local ? it->second.lock() : nullptr;
+}
+
+void WebSocketServer::send_text(websocketpp::connection_hdl hdl,
+                                const std::string& text) {
+  websocketpp::lib::error_code ec;
+  bool is_local = false;
+  std::shared_ptr<LocalPeer> peer = local_peer(hdl, &is_local);
+  if (is_local) {
+    if (peer) {
+      peer->send_text(text);
+    }
+  } else if (is_ssl) {
+    wss_server_->send(hdl, text, websocketpp::frame::opcode::text, ec);
+  } else {
+    server_->send(hdl, text, websocketpp::frame::opcode::text, ec);
+  }
+}
+
+LocalHandlers WebSocketServer::local_handlers() {
+  LocalHandlers handlers;
+  handlers.on_open = [this](std::shared_ptr<LocalPeer> peer) {
+    websocketpp::connection_hdl hdl = peer;
+    {
+      scoped_lock guard(local_lock_);
+      local_peers_.emplace(hdl, peer);
+    }
+    on_open(hdl);
+  };
+  handlers.on_close = [this](websocketpp::connection_hdl hdl) {
+    on_close(hdl);
+  };
+  handlers.on_frame = [this](websocketpp::connection_hdl hdl, bool is_text,
+                             const char* data, size_t len) {
+    on_frame(hdl, is_text, data, len);
+  };
+  return handlers;
+}
+
+// called on an offline pool thread, the connection may be gone by now
+void WebSocketServer::send_offline_result(websocketpp::connection_hdl hdl,
+                                          FUNASR_RESULT result, int seq_id,
+                                          bool is_final,
+                                          const std::string& wav_name) {
+  try {
+    nlohmann::json jsonresult = handle_result(result);
+    jsonresult["wav_name"] = wav_name;
+    jsonresult["seq_id"] = seq_id;
+    jsonresult["is_final"] = is_final;
+    if (jsonresult["text"] != "" || is_final) {
+      send_text(hdl, jsonresult.dump());
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << e.what();
+  }
+  FunASRFreeResult(result);
 }
 
 void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
@@ -256,12 +512,10 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
     data_msg->msg["is_eof"]=false; // if this connection is closed
     data_msg->msg["svs_lang"]="auto";
     data_msg->msg["svs_itn"]=true;
-    FUNASR_DEC_HANDLE decoder_handle =
-      FunASRWfstDecoderInit(tpass_handle, ASR_TWO_PASS, global_beam_, lattice_beam_, am_scale_);
-    data_msg->decoder_handle = decoder_handle;
     data_msg->punc_cache =
         std::make_shared<std::vector<std::vector<std::string>>>(2);
   	data_msg->strand_ =	std::make_shared<asio::io_context::strand>(io_decoder_);
+    data_msg->stream_id = stream_seq_++;
 
     data_map.emplace(hdl, data_msg);
   }catch (std::exception const& e) {
@@ -269,7 +523,11 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
   }
 }
 
-void remove_hdl(
+// takes a closed stream with no decode turn left out of data_map and returns
+// it; the caller frees its handles once it has dropped the locks, as the
+// online uninit waits for the offline backlog of the stream and the release
+// may unload the model set
+std::shared_ptr<FUNASR_MESSAGE> remove_hdl(
     websocketpp::connection_hdl hdl,
     std::map<websocketpp::connection_hdl, std::shared_ptr<FUNASR_MESSAGE>,
              std::owner_less<websocketpp::connection_hdl>>& data_map) {
@@ -279,21 +537,19 @@ void remove_hdl(
   if (it_data != data_map.end()) {
     data_msg = it_data->second;
   } else {
-    return;
+    return nullptr;
   }
   // scoped_lock guard_decoder(*(data_msg->thread_lock));  //wait for do_decoder
   // finished and avoid access freed tpass_online_handle
   unique_lock guard_decoder(*(data_msg->thread_lock));
   if (data_msg->msg["access_num"]==0 && data_msg->msg["is_eof"]==true) {
-    FunWfstDecoderUnloadHwsRes(data_msg->decoder_handle);
-    FunASRWfstDecoderUninit(data_msg->decoder_handle);
-    data_msg->decoder_handle = nullptr;
-    FunTpassOnlineUninit(data_msg->tpass_online_handle);
-    data_msg->tpass_online_handle = nullptr;
 	  data_map.erase(hdl);
+  } else {
+    data_msg = nullptr;
   }
  
   guard_decoder.unlock();
+  return data_msg;
 }
 
 void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
@@ -319,7 +575,14 @@ void WebSocketServer::check_and_clean_connection() {
     while (iter != data_map.end()) {  // loop to find closed connection
       websocketpp::connection_hdl hdl = iter->first;
       try{
-        if (is_ssl) {
+        bool is_local = false;
+        std::shared_ptr<LocalPeer> peer = local_peer(hdl, &is_local);
+        if (is_local) {
+          if (!peer || !peer->is_open()) {
+            on_close(hdl);
+            to_remove.push_back(hdl);
+          }
+        } else if (is_ssl) {
           wss_server::connection_ptr con = wss_server_->get_con_from_hdl(hdl);
           if (con->get_state() != 1) {  // session::state::open ==1
             to_remove.push_back(hdl);
@@ -351,15 +614,47 @@ void WebSocketServer::check_and_clean_connection() {
       iter++;
     }
     for (auto hdl : to_remove) {
+      std::shared_ptr<FUNASR_MESSAGE> data_msg = nullptr;
       {
         unique_lock lock(m_lock);
-        remove_hdl(hdl, data_map);
+        data_msg = remove_hdl(hdl, data_map);
+        if (data_map.find(hdl) == data_map.end()) {
+          scoped_lock guard(local_lock_);
+          local_peers_.erase(hdl);
+        }
+      }
+      if (data_msg == nullptr) {
+        continue;
       }
+      // first, it waits for the queued offline segments that use the decoder
+      FunTpassOnlineUninit(data_msg->tpass_online_handle);
+      data_msg->tpass_online_handle = nullptr;
+      FunWfstDecoderUnloadHwsRes(data_msg->decoder_handle);
+      FunASRWfstDecoderUninit(data_msg->decoder_handle);
+      data_msg->decoder_handle = nullptr;
+      // the model set may be unloaded from here on
+      FunModelRegistryRelease(model_registry_, data_msg->tpass_handle);
+      data_msg->tpass_handle = nullptr;
     }
   }
 }
 void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
                                  message_ptr msg) {
+  const std::string& payload = msg->get_payload();
+  switch (msg->get_opcode()) {
+    case websocketpp::frame::opcode::text:
+      on_frame(hdl, true, payload.data(), payload.size());
+      break;
+    case websocketpp::frame::opcode::binary:
+      on_frame(hdl, false, payload.data(), payload.size());
+      break;
+    default:
+      break;
+  }
+}
+
+void WebSocketServer::on_frame(websocketpp::connection_hdl hdl, bool is_text,
+                               const char* data, size_t len, bool replay) {
   unique_lock lock(m_lock);
   // find the sample data vector according to one connection
 
@@ -378,8 +673,6 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
   }
 
   std::shared_ptr<std::vector<char>> sample_data_p = msg_data->samples;
-  std::shared_ptr<std::vector<std::vector<std::string>>> punc_cache_p =
-      msg_data->punc_cache;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock_p = msg_data->thread_lock;
 
   lock.unlock();
@@ -389,13 +682,30 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
     return;
   }
 
-  const std::string& payload = msg->get_payload();  // get msg type
   unique_lock guard_decoder(*(thread_lock_p)); // mutex for one connection
-  switch (msg->get_opcode()) {
+  if (msg_data->model_loading && !replay) {
+    msg_data->deferred_frames.emplace_back(is_text, std::string(data, len));
+    // deferred audio is pending audio: it is counted now, not at the replay,
+    // and pauses the connection like audio waiting for its decode turn
+    if (!is_text && isonline) {
+      if (msg_data->received_bytes == msg_data->decoded_bytes) {
+        msg_data->pending_since = std::chrono::steady_clock::now();
+      }
+      msg_data->received_bytes += len;
+      if (max_pending_ms_ > 0 && !msg_data->paused &&
+          PendingMs(*msg_data) > max_pending_ms_) {
+        set_paused(hdl, *msg_data, true);
+      }
+    }
+    guard_decoder.unlock();
+    return;
+  }
+  switch (is_text ? websocketpp::frame::opcode::text
+                  : websocketpp::frame::opcode::binary) {
     case websocketpp::frame::opcode::text: {
       nlohmann::json jsonresult;
       try{
-        jsonresult = nlohmann::json::parse(payload);
+        jsonresult = nlohmann::json::parse(data, data + len);
       }catch (std::exception const &e)
       {
         LOG(ERROR)<<e.what();
@@ -414,6 +724,24 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
         msg_data->msg["wav_format"] = jsonresult["wav_format"];
       }
 
+      // the model set of the stream, named by its first message. A set that
+      // is not loaded yet would hold up the io thread of the connection and
+      // all its other streams, so the acquire goes to a decoder thread and
+      // this message waits for it with the frames after it
+      if (msg_data->tpass_handle == nullptr) {
+        std::string model_set = DEFAULT_MODEL_SET;
+        if (jsonresult.contains("model")) {
+          model_set = jsonresult["model"];
+        }
+        msg_data->model_loading = true;
+        msg_data->deferred_frames.emplace_back(true, std::string(data, len));
+        guard_decoder.unlock();
+        asio::post(io_decoder_, [this, hdl, msg_data, model_set]() {
+          load_model_set(hdl, msg_data, model_set);
+        });
+        return;
+      }
+
       // hotwords: fst/nn
       if(msg_data->hotwords_embedding == nullptr){
         std::unordered_map<std::string, int> merged_hws_map;
@@ -455,7 +783,7 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
         FunWfstDecoderLoadHwsRes(msg_data->decoder_handle, fst_inc_wts_, merged_hws_map);
 
         // nn
-        std::vector<std::vector<float>> new_hotwords_embedding = CompileHotwordEmbedding(tpass_handle, nn_hotwords, ASR_TWO_PASS);
+        std::vector<std::vector<float>> new_hotwords_embedding = CompileHotwordEmbedding(msg_data->tpass_handle, nn_hotwords, ASR_TWO_PASS);
         msg_data->hotwords_embedding =
             std::make_shared<std::vector<std::vector<float>>>(new_hotwords_embedding);
       }
@@ -463,15 +791,45 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
       if (jsonresult.contains("audio_fs")) {
         msg_data->msg["audio_fs"] = jsonresult["audio_fs"];
       }
+      if (jsonresult.contains("latency")) {
+        std::string latency_class = jsonresult["latency"];
+        if (latency_class == "low" || latency_class == "normal" ||
+            latency_class == "high") {
+          msg_data->latency_class = latency_class;
+        } else {
+          LOG(ERROR) << "Wrong latency: " << latency_class;
+        }
+      }
       if (jsonresult.contains("chunk_size")) {
         if (msg_data->tpass_online_handle == nullptr) {
           std::vector<int> chunk_size_vec =
               jsonresult["chunk_size"].get<std::vector<int>>();
           // check chunk_size_vec
           if(chunk_size_vec.size() == 3 && chunk_size_vec[1] != 0){
+            // the client's size is only the start of an adaptive stream
+            msg_data->adaptive_chunk =
+                chunk_policy_ && chunk_policy_->Compatible(chunk_size_vec);
+            if (chunk_policy_ && !msg_data->adaptive_chunk) {
+              LOG(INFO) << "the lookahead of the client keeps its chunk size";
+            }
+            msg_data->chunk_size = chunk_size_vec;
             FUNASR_HANDLE tpass_online_handle =
-                FunTpassOnlineInit(tpass_handle, chunk_size_vec);
+                FunTpassOnlineInit(msg_data->tpass_handle, chunk_size_vec);
             msg_data->tpass_online_handle = tpass_online_handle;
+            if (msg_data->adaptive_chunk) {
+              FunTpassOnlineSetMaxLookback(tpass_online_handle,
+                                           chunk_policy_->MaxLookback());
+            }
+            if (async_offline_) {
+              std::string wav_name = msg_data->msg["wav_name"];
+              FunTpassOnlineSetOfflineCallback(
+                  tpass_online_handle,
+                  [this, hdl, wav_name](FUNASR_RESULT result, int seq_id,
+                                        bool is_final) {
+                    send_offline_result(hdl, result, seq_id, is_final,
+                                        wav_name);
+                  });
+            }
           }else{
             LOG(ERROR) << "Wrong chunk_size!";
             break;
@@ -495,82 +853,41 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
           msg_data->hotwords_embedding != nullptr) {
         LOG(INFO) << "client done";
 
-        // if it is in final message, post the sample_data to decode
-        try{
-		  
-          std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
-          msg_data->strand_->post(
-              std::bind(&WebSocketServer::do_decoder, this,
-                        std::move(*(sample_data_p.get())), std::move(hdl),
-                        std::ref(msg_data->msg), std::ref(*(punc_cache_p.get())),
-                        std::move(hotwords_embedding_),
-                        std::ref(*thread_lock_p), std::move(true),
-                        msg_data->msg["wav_name"],
-                        msg_data->msg["mode"],
-                        msg_data->msg["itn"],
-                        msg_data->msg["audio_fs"],
-                        msg_data->msg["wav_format"],
-                        std::ref(msg_data->tpass_online_handle),
-                        std::ref(msg_data->decoder_handle),
-                        msg_data->msg["svs_lang"],
-                        msg_data->msg["svs_itn"]));
-		      msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
-        }
-        catch (std::exception const &e)
-        {
-            LOG(ERROR)<<e.what();
-        }
+        // if it is in final message, the next turn decodes the rest
+        msg_data->input_end = true;
+        schedule_decoder(hdl, msg_data);
       }
       break;
     }
     case websocketpp::frame::opcode::binary: {
       // recived binary data
-      const auto* pcm_data = static_cast<const char*>(payload.data());
-      int32_t num_samples = payload.size();
+      const char* pcm_data = data;
+      int32_t num_samples = len;
 
       if (isonline) {
+        // replayed audio was counted when it was deferred
+        if (!replay) {
+          if (msg_data->received_bytes == msg_data->decoded_bytes) {
+            msg_data->pending_since = std::chrono::steady_clock::now();
+          }
+          msg_data->received_bytes += num_samples;
+        }
         sample_data_p->insert(sample_data_p->end(), pcm_data,
                               pcm_data + num_samples);
-        int setpsize =
-            800 * 2;  // TODO, need get from client
-                      // if sample_data size > setpsize, we post data to decode
-        if (sample_data_p->size() > setpsize) {
-          int chunksize = floor(sample_data_p->size() / setpsize);
-          // make sure the subvector size is an integer multiple of setpsize
-          std::vector<char> subvector = {
-              sample_data_p->begin(),
-              sample_data_p->begin() + chunksize * setpsize};
-          // keep remain in sample_data
-          sample_data_p->erase(sample_data_p->begin(),
-                               sample_data_p->begin() + chunksize * setpsize);
-
-          try{
-            // post to decode
-            if (msg_data->msg["is_eof"] != true && msg_data->hotwords_embedding != nullptr) {
-              std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
-              msg_data->strand_->post(
-                        std::bind(&WebSocketServer::do_decoder, this,
-                                  std::move(subvector), std::move(hdl),
-                                  std::ref(msg_data->msg),
-                                  std::ref(*(punc_cache_p.get())),
-                                  std::move(hotwords_embedding_),
-                                  std::ref(*thread_lock_p), std::move(false),
-                                  msg_data->msg["wav_name"],
-                                  msg_data->msg["mode"],
-                                  msg_data->msg["itn"],
-                                  msg_data->msg["audio_fs"],
-                                  msg_data->msg["wav_format"],
-                                  std::ref(msg_data->tpass_online_handle),
-                                  std::ref(msg_data->decoder_handle),
-                                  msg_data->msg["svs_lang"],
-                                  msg_data->msg["svs_itn"]));
-              msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
-            }
-          }
-          catch (std::exception const &e)
-          {
-            LOG(ERROR)<<e.what();
-          }
+        // pcm is decoded from 100ms on, a compressed stream message by
+        // message since its packets may not survive being split or joined
+        bool is_pcm = IsPcm(msg_data->msg);
+        if (!is_pcm) {
+          msg_data->packet_sizes.push_back(num_samples);
+        }
+        if (sample_data_p->size() >= 800 * 2 || !is_pcm) {
+          schedule_decoder(hdl, msg_data);
+        }
+        // only a stream with a turn to come drains and gets resumed
+        if (max_pending_ms_ > 0 && !msg_data->paused &&
+            msg_data->decode_queued &&
+            PendingMs(*msg_data) > max_pending_ms_) {
+          set_paused(hdl, *msg_data, true);
         }
       } else {
         sample_data_p->insert(sample_data_p->end(), pcm_data,
@@ -584,12 +901,82 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
   guard_decoder.unlock();
 }
 
+void WebSocketServer::load_model_set(websocketpp::connection_hdl hdl,
+                                     std::shared_ptr<FUNASR_MESSAGE> msg_data,
+                                     std::string model_set) {
+  FUNASR_HANDLE tpass_handle =
+      FunModelRegistryAcquire(model_registry_, model_set);
+  unique_lock guard_decoder(*(msg_data->thread_lock));
+  if (tpass_handle == nullptr || msg_data->msg["is_eof"] == true) {
+    if (tpass_handle == nullptr) {
+      LOG(ERROR) << "Wrong model: " << model_set;
+    }
+    // a wrong set ends the stream, a closed stream gives its set back
+    msg_data->msg["is_eof"] = true;
+    msg_data->model_loading = false;
+    msg_data->deferred_frames.clear();
+    msg_data->decoded_bytes = msg_data->received_bytes;
+    if (msg_data->paused) {
+      // the connection is read again to see its close
+      set_paused(hdl, *msg_data, false);
+    }
+    guard_decoder.unlock();
+    FunModelRegistryRelease(model_registry_, tpass_handle);
+    return;
+  }
+  msg_data->tpass_handle = tpass_handle;
+  msg_data->decoder_handle =
+      FunASRWfstDecoderInit(msg_data->tpass_handle, ASR_TWO_PASS,
+                            global_beam_, lattice_beam_, am_scale_);
+  // frames that come during the replay queue up behind it
+  while (!msg_data->deferred_frames.empty()) {
+    std::pair<bool, std::string> frame =
+        std::move(msg_data->deferred_frames.front());
+    msg_data->deferred_frames.pop_front();
+    guard_decoder.unlock();
+    on_frame(hdl, frame.first, frame.second.data(), frame.second.size(), true);
+    guard_decoder.lock();
+  }
+  msg_data->model_loading = false;
+  // a stream paused while its set loaded is resumed by the decode turn the
+  // replay queued, or here if the replay queued none
+  if (msg_data->paused && !msg_data->decode_queued) {
+    set_paused(hdl, *msg_data, false);
+  }
+}
+
 // init asr model
 void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
-                              int thread_num) {
+                              int thread_num, int offline_thread_num,
+                              int speculate_ms, size_t memory_budget_mb,
+                              int shared_threads) {
   try {
-    tpass_handle = FunTpassInit(model_path, thread_num);
-    if (!tpass_handle) {
+    async_offline_ = offline_thread_num > 0;
+    // every set gets the settings of the server when it loads, and the
+    // warm-up once the server is ready, the default set has its own
+    model_registry_ = FunModelRegistryInit(
+        ASR_TWO_PASS, thread_num, memory_budget_mb, shared_threads,
+        [this, offline_thread_num, speculate_ms](FUNASR_HANDLE tpass_handle) {
+          if (offline_thread_num > 0) {
+            FunTpassSetOfflineThreadNum(tpass_handle, offline_thread_num);
+          }
+          FunTpassSetSpeculation(tpass_handle, speculate_ms);
+          if (ready_ && !warm_up_buckets_.empty()) {
+            FunTpassWarmUp(tpass_handle, warm_up_buckets_,
+                           warm_up_chunk_sizes_);
+          }
+        });
+    if (!model_registry_) {
+      LOG(ERROR) << "FunModelRegistryInit init failed";
+      exit(-1);
+    }
+    // the default set is loaded now and held as long as the server runs
+    if (!FunModelRegistryAdd(model_registry_, DEFAULT_MODEL_SET, model_path)) {
+      exit(-1);
+    }
+    default_handle_ =
+        FunModelRegistryAcquire(model_registry_, DEFAULT_MODEL_SET);
+    if (!default_handle_) {
       LOG(ERROR) << "FunTpassInit init failed";
       exit(-1);
     }
@@ -602,3 +989,26 @@ void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
     LOG(INFO) << e.what();
   }
 }
+
+bool WebSocketServer::add_model_set(
+    const std::string& name, std::map<std::string, std::string>& model_path) {
+  return FunModelRegistryAdd(model_registry_, name, model_path);
+}
+
+bool WebSocketServer::warm_up(const std::vector<int>& buckets_ms,
+                              const std::vector<std::vector<int>>& chunk_sizes) {
+  bool ok = true;
+  warm_up_buckets_ = buckets_ms;
+  warm_up_chunk_sizes_ = chunk_sizes;
+  if (!buckets_ms.empty()) {
+    auto begin = std::chrono::steady_clock::now();
+    ok = FunTpassWarmUp(default_handle_, buckets_ms, chunk_sizes);
+    LOG(INFO) << "warm-up finished in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count()
+              << " ms";
+  }
+  ready_ = true;
+  return ok;
+}
@@ -13,6 +13,10 @@
 #ifndef WEBSOCKET_SERVER_H_
 #define WEBSOCKET_SERVER_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -30,9 +34,12 @@
 #include <websocketpp/server.hpp>
 
 #include "asio.hpp"
+#include "chunk-policy.h"
 #include "com-define.h"
 #include "funasrruntime.h"
+#include "local-server.h"
 #include "nlohmann/json.hpp"
+#include "stamp-sents-json.h"
 #include "tclap/CmdLine.h"
 typedef websocketpp::server<websocketpp::config::asio> server;
 typedef websocketpp::server<websocketpp::config::asio_tls> wss_server;
@@ -57,11 +64,38 @@ typedef struct {
   std::shared_ptr<std::vector<std::vector<std::string>>> punc_cache;
   std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding=nullptr;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock; // lock for each connection
+  // the model set of the stream, held in the registry until the stream is
+  // removed
+  FUNASR_HANDLE tpass_handle=nullptr;
   FUNASR_HANDLE tpass_online_handle=nullptr;
   std::string online_res = "";
   std::string tpass_res = "";
   std::shared_ptr<asio::io_context::strand>  strand_; // for data execute in order
   FUNASR_DEC_HANDLE decoder_handle=nullptr; 
+  // audio not handed to the decoder yet stays in samples. A stream has at
+  // most one decode turn queued or running and the turn takes all of it, so
+  // a backlog goes to the engine in one call instead of many 100ms ones
+  bool decode_queued = false;
+  bool input_end = false;  // the client is done, the next turn is the final one
+  bool paused = false;     // the connection is not read, too much audio pending
+  // the model set named by the first message loads on a decoder thread;
+  // meanwhile the frames of the stream, that first message included, wait
+  // here in order
+  bool model_loading = false;
+  std::deque<std::pair<bool, std::string>> deferred_frames;
+  // message sizes of a compressed stream, whose packets are fed one by one
+  std::deque<size_t> packet_sizes;
+  uint64_t stream_id = 0;
+  uint64_t received_bytes = 0;
+  uint64_t decoded_bytes = 0;
+  // arrival of about the oldest byte not decoded yet
+  std::chrono::steady_clock::time_point pending_since;
+  double max_lag_ms = 0;
+  // chunk size of the online pass; it follows the load when the server has a
+  // chunk policy and the stream started with a size of the same lookahead
+  std::vector<int> chunk_size;
+  bool adaptive_chunk = false;
+  std::string latency_class = "normal";  // low, normal or high, from the client
 } FUNASR_MESSAGE;
 
 // See https://wiki.mozilla.org/Security/Server_Side_TLS for more details about
@@ -91,6 +125,16 @@ class WebSocketServer {
       // set close handle
       wss_server_->set_close_handler(
           [this](websocketpp::connection_hdl hdl) { on_close(hdl); });
+      // refuse handshakes until the models are warm
+      wss_server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) {
+            if (ready_) {
+              return true;
+            }
+            wss_server_->get_con_from_hdl(hdl)->set_status(
+                websocketpp::http::status_code::service_unavailable);
+            return false;
+          });
       // begin accept
       wss_server_->start_accept();
       // not print log
@@ -108,6 +152,16 @@ class WebSocketServer {
       // set close handle
       server_->set_close_handler(
           [this](websocketpp::connection_hdl hdl) { on_close(hdl); });
+      // refuse handshakes until the models are warm
+      server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) {
+            if (ready_) {
+              return true;
+            }
+            server_->get_con_from_hdl(hdl)->set_status(
+                websocketpp::http::status_code::service_unavailable);
+            return false;
+          });
       // begin accept
       server_->start_accept();
       // not print log
@@ -124,26 +178,95 @@ class WebSocketServer {
                   bool itn,
                   int audio_fs,
                   std::string wav_format,
+                  FUNASR_HANDLE tpass_handle,
                   FUNASR_HANDLE& tpass_online_handle,
                   FUNASR_DEC_HANDLE& decoder_handle,
                   std::string svs_lang,
                   bool sys_itn);
 
-  void initAsr(std::map<std::string, std::string>& model_path, int thread_num);
+  // offline_thread_num > 0 moves the offline pass to threads of its own, its
+  // results are sent when ready and carry a seq_id. speculate_ms > 0 starts
+  // the offline pass of a segment after that much of its end silence.
+  // model_path is the default set, loaded here and kept; the sets added
+  // later load when a stream names them and give way to others when idle
+  // and over memory_budget_mb. shared_threads > 0 runs all sets on one
+  // pool of that many threads instead of thread_num per session
+  void initAsr(std::map<std::string, std::string>& model_path, int thread_num,
+               int offline_thread_num = 0, int speculate_ms = 0,
+               size_t memory_budget_mb = 0, int shared_threads = 0);
+  // a set streams may pick with "model": name in their first message
+  bool add_model_set(const std::string& name,
+                     std::map<std::string, std::string>& model_path);
+  // audio pending in one stream above which its connection is not read until
+  // half of it is decoded, so tcp flow control holds the client back; 0 is
+  // unbounded
+  void set_max_pending_ms(int max_pending_ms) {
+    max_pending_ms_ = max_pending_ms;
+  }
+  // online streams pick their chunk size from chunk_sizes with the load,
+  // which is the lag of the decode turns measured against target_ms
+  void set_chunk_policy(const std::vector<std::vector<int>>& chunk_sizes,
+                        int target_ms) {
+    chunk_policy_.reset(new funasr::ChunkSizePolicy(chunk_sizes, target_ms));
+  }
+  // runs every model over synthetic input of each length in buckets_ms, the
+  // online ones in chunks of every size in chunk_sizes (FunTpassWarmUp). The
+  // server refuses websocket handshakes with 503 and is_ready() is false
+  // until this returns; empty buckets_ms only marks the server ready. The
+  // sets loaded later are warmed up the same way before their first stream
+  bool warm_up(const std::vector<int>& buckets_ms,
+               const std::vector<std::vector<int>>& chunk_sizes);
+  bool is_ready() const { return ready_; }
+  // pending audio and lag of every stream and the model sets, prometheus
+  // text for the metrics server
+  std::string GetStreamMetrics();
+  void send_offline_result(websocketpp::connection_hdl hdl,
+                           FUNASR_RESULT result, int seq_id, bool is_final,
+                           const std::string& wav_name);
   void on_message(websocketpp::connection_hdl hdl, message_ptr msg);
+  // a text or binary message of either transport; replay is set for the
+  // frames held while the model set of the stream loaded
+  void on_frame(websocketpp::connection_hdl hdl, bool is_text,
+                const char* data, size_t len, bool replay = false);
   void on_open(websocketpp::connection_hdl hdl);
   void on_close(websocketpp::connection_hdl hdl);
+  // streams of the local transport, whose hdl points to the LocalPeer
+  LocalHandlers local_handlers();
   context_ptr on_tls_init(tls_mode mode, websocketpp::connection_hdl hdl,
                           std::string& s_certfile, std::string& s_keyfile);
 
  private:
   void check_and_clean_connection();
+  void send_text(websocketpp::connection_hdl hdl, const std::string& text);
+  std::shared_ptr<LocalPeer> local_peer(websocketpp::connection_hdl hdl,
+                                        bool* is_local);
+  // with the stream lock held
+  void schedule_decoder(websocketpp::connection_hdl hdl,
+                        std::shared_ptr<FUNASR_MESSAGE> msg_data);
+  void run_decoder(websocketpp::connection_hdl hdl,
+                   std::shared_ptr<FUNASR_MESSAGE> msg_data);
+  // on a decoder thread: acquires the model set of a stream, then replays
+  // the frames deferred meanwhile
+  void load_model_set(websocketpp::connection_hdl hdl,
+                      std::shared_ptr<FUNASR_MESSAGE> msg_data,
+                      std::string model_set);
+  // with the stream lock held
+  void set_paused(websocketpp::connection_hdl hdl, FUNASR_MESSAGE& msg_data,
+                  bool paused);
   asio::io_context& io_decoder_;  // threads for asr decoder
   // std::ofstream fout;
   // FUNASR_HANDLE asr_handle;  // asr engine handle
-  FUNASR_HANDLE tpass_handle=nullptr;
+  FUNASR_HANDLE model_registry_ = nullptr;
+  FUNASR_HANDLE default_handle_ = nullptr;
+  std::vector<int> warm_up_buckets_;
+  std::vector<std::vector<int>> warm_up_chunk_sizes_;
+  bool async_offline_ = false;
+  std::atomic<bool> ready_{false};
   bool isonline = true;  // online or offline engine, now only support offline
   bool is_ssl = true;
+  int max_pending_ms_ = 0;
+  std::unique_ptr<funasr::ChunkSizePolicy> chunk_policy_;
+  uint64_t stream_seq_ = 0;  // under m_lock
   server* server_;          // websocket server
   wss_server* wss_server_;  // websocket server
 
@@ -154,6 +277,11 @@ class WebSocketServer {
            std::owner_less<websocketpp::connection_hdl>>
       data_map;
   websocketpp::lib::mutex m_lock;  // mutex for sample_map
+  // connections of the local transport; taken inside the stream locks
+  std::map<websocketpp::connection_hdl, std::weak_ptr<LocalPeer>,
+           std::owner_less<websocketpp::connection_hdl>>
+      local_peers_;
+  websocketpp::lib::mutex local_lock_;
 };
 
 #endif  // WEBSOCKET_SERVER_H_
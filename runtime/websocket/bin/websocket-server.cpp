@@ -57,6 +57,38 @@ context_ptr WebSocketServer::on_tls_init(tls_mode mode,
   return ctx;
 }
 
+// sends the offline result json, an empty text when result is nullptr
+void WebSocketServer::send_result(websocketpp::connection_hdl& hdl,
+                                  FUNASR_RESULT result,
+                                  const std::string& wav_name) {
+  websocketpp::lib::error_code ec;
+  nlohmann::json jsonresult;        // result json
+  jsonresult["text"] = "";  // put result in 'text'
+  if (result != nullptr) {
+    jsonresult["text"] = FunASRGetResult(result, 0);  // get decode result
+    std::string stamp_res = FunASRGetStamp(result);
+    if(stamp_res != ""){
+      jsonresult["timestamp"] = stamp_res;
+    }
+    if (FunASRGetStampSentNum(result) > 0) {
+      jsonresult["stamp_sents"] = funasr::GetStampSentsJson(result);
+    }
+  }
+  jsonresult["mode"] = "offline";
+  jsonresult["is_final"] = false;
+  jsonresult["wav_name"] = wav_name;
+
+  // send the json to client
+  if (is_ssl) {
+    wss_server_->send(hdl, jsonresult.dump(),
+                      websocketpp::frame::opcode::text, ec);
+  } else {
+    server_->send(hdl, jsonresult.dump(), websocketpp::frame::opcode::text,
+                  ec);
+  }
+  LOG(INFO) << "result json=" << jsonresult.dump();
+}
+
 // feed buffer to asr engine for decoder
 void WebSocketServer::do_decoder(const std::vector<char>& buffer,
                                  websocketpp::connection_hdl& hdl,
@@ -71,77 +103,28 @@ void WebSocketServer::do_decoder(const std::vector<char>& buffer,
                                  std::string svs_lang,
                                  bool sys_itn) {
   try {
-    int num_samples = buffer.size();  // the size of the buf
-
     if (!buffer.empty() && hotwords_embedding.size() > 0) {
-      std::string asr_result="";
-      std::string stamp_res="";
-      std::string stamp_sents="";
+      FUNASR_RESULT Result = nullptr;
       try{
-        FUNASR_RESULT Result = FunOfflineInferBuffer(
+        Result = FunOfflineInferBuffer(
             asr_handle, buffer.data(), buffer.size(), RASR_NONE, nullptr, 
             hotwords_embedding, audio_fs, wav_format, itn, decoder_handle,
             svs_lang, sys_itn);
-        if (Result != nullptr){
-          asr_result = FunASRGetResult(Result, 0);  // get decode result
-          stamp_res = FunASRGetStamp(Result);
-          stamp_sents = FunASRGetStampSents(Result);
-          FunASRFreeResult(Result);
-        } else{
+        if (Result == nullptr){
           std::this_thread::sleep_for(std::chrono::milliseconds(20));
           LOG(ERROR) << "FUNASR_RESULT is nullptr.";
         }
       }catch (std::exception const& e) {
         LOG(ERROR) << e.what();
       }
-
-      websocketpp::lib::error_code ec;
-      nlohmann::json jsonresult;        // result json
-      jsonresult["text"] = asr_result;  // put result in 'text'
-      jsonresult["mode"] = "offline";
-	    jsonresult["is_final"] = false;
-      if(stamp_res != ""){
-        jsonresult["timestamp"] = stamp_res;
-      }
-      if(stamp_sents != ""){
-        try{
-          nlohmann::json json_stamp = nlohmann::json::parse(stamp_sents);
-          jsonresult["stamp_sents"] = json_stamp;
-        }catch (std::exception const &e)
-        {
-          LOG(ERROR)<<e.what();
-          jsonresult["stamp_sents"] = "";
-        }
+      send_result(hdl, Result, wav_name);
+      if (Result != nullptr) {
+        FunASRFreeResult(Result);
       }
-      jsonresult["wav_name"] = wav_name;
-
-      // send the json to client
-      if (is_ssl) {
-        wss_server_->send(hdl, jsonresult.dump(),
-                          websocketpp::frame::opcode::text, ec);
-      } else {
-        server_->send(hdl, jsonresult.dump(), websocketpp::frame::opcode::text,
-                      ec);
-      }
-
-      LOG(INFO) << "buffer.size=" << buffer.size() << ",result json=" << jsonresult.dump();
+      LOG(INFO) << "buffer.size=" << buffer.size();
     }else{
       LOG(INFO) << "Sent empty msg";
-      websocketpp::lib::error_code ec;
-      nlohmann::json jsonresult;        // result json
-      jsonresult["text"] = "";  // put result in 'text'
-      jsonresult["mode"] = "offline";
-	    jsonresult["is_final"] = false;
-      jsonresult["wav_name"] = wav_name;
-
-      // send the json to client
-      if (is_ssl) {
-        wss_server_->send(hdl, jsonresult.dump(),
-                          websocketpp::frame::opcode::text, ec);
-      } else {
-        server_->send(hdl, jsonresult.dump(), websocketpp::frame::opcode::text,
-                      ec);
-      }
+      send_result(hdl, nullptr, wav_name);
     }
 
   } catch (std::exception const& e) {
@@ -151,6 +134,40 @@ void WebSocketServer::do_decoder(const std::vector<char>& buffer,
   msg["access_num"]=(int)msg["access_num"]-1;
 }
 
+void WebSocketServer::do_progressive(
+    std::shared_ptr<FUNASR_MESSAGE> msg_data, FUNASR_HANDLE progressive_handle,
+    std::shared_ptr<std::vector<char>> buffer, websocketpp::connection_hdl hdl,
+    bool is_final,
+    std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding,
+    std::string wav_name, bool itn, std::string svs_lang, bool svs_itn) {
+  try {
+    if (!buffer->empty() &&
+        !FunOfflineProgressiveFeed(progressive_handle, buffer->data(),
+                                   buffer->size(), *hotwords_embedding,
+                                   msg_data->decoder_handle, svs_lang,
+                                   svs_itn)) {
+      LOG(ERROR) << "FunOfflineProgressiveFeed failed.";
+    }
+    if (is_final) {
+      FUNASR_RESULT Result = FunOfflineProgressiveFinish(
+          progressive_handle, *hotwords_embedding, itn,
+          msg_data->decoder_handle, svs_lang, svs_itn);
+      FunOfflineProgressiveUninit(progressive_handle);
+      if (Result == nullptr) {
+        LOG(ERROR) << "FUNASR_RESULT is nullptr.";
+      }
+      send_result(hdl, Result, wav_name);
+      if (Result != nullptr) {
+        FunASRFreeResult(Result);
+      }
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << e.what();
+  }
+  scoped_lock guard(*(msg_data->thread_lock));
+  msg_data->msg["access_num"]=(int)msg_data->msg["access_num"]-1;
+}
+
 void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
   scoped_lock guard(m_lock);     // for threads safty
   std::shared_ptr<FUNASR_MESSAGE> data_msg =
@@ -170,6 +187,7 @@ void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
   FUNASR_DEC_HANDLE decoder_handle =
     FunASRWfstDecoderInit(asr_handle, ASR_OFFLINE, global_beam_, lattice_beam_, am_scale_);
   data_msg->decoder_handle = decoder_handle;
+  data_msg->strand_ = std::make_shared<asio::io_context::strand>(io_decoder_);
   data_map.emplace(hdl, data_msg);
   LOG(INFO) << "on_open, active connections: " << data_map.size();
 }
@@ -207,6 +225,11 @@ void remove_hdl(
     FunWfstDecoderUnloadHwsRes(data_msg->decoder_handle);
     FunASRWfstDecoderUninit(data_msg->decoder_handle);
     data_msg->decoder_handle = nullptr;
+    // an upload cut off before its end
+    if (data_msg->progressive_handle != nullptr) {
+      FunOfflineProgressiveUninit(data_msg->progressive_handle);
+      data_msg->progressive_handle = nullptr;
+    }
 	  data_map.erase(hdl);
     LOG(INFO) << "remove one connection";
   }
@@ -368,28 +391,81 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
       if (jsonresult.contains("svs_itn")) {
         msg_data->msg["svs_itn"] = jsonresult["svs_itn"];
       }
+      if (jsonresult.contains("priority")) {
+        msg_data->msg["priority"] = jsonresult["priority"].is_string()
+                                        ? jsonresult["priority"].get<std::string>()
+                                        : jsonresult["priority"].dump();
+      }
       if ((jsonresult["is_speaking"] == false ||
           jsonresult["is_finished"] == true) && 
           msg_data->msg["is_eof"] != true && 
           msg_data->hotwords_embedding != nullptr) {
         LOG(INFO) << "client done";
+        if (msg_data->progressive_handle != nullptr) {
+          // most of the upload is decoded already, only the tail is left
+          std::shared_ptr<std::vector<char>> buffer =
+              std::make_shared<std::vector<char>>(std::move(*(sample_data_p.get())));
+          sample_data_p->clear();
+          FUNASR_HANDLE progressive_handle = msg_data->progressive_handle;
+          msg_data->progressive_handle = nullptr;
+          msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
+          msg_data->strand_->post(std::bind(
+              &WebSocketServer::do_progressive, this, msg_data,
+              progressive_handle, buffer, hdl, true,
+              msg_data->hotwords_embedding,
+              msg_data->msg["wav_name"].get<std::string>(),
+              msg_data->msg["itn"].get<bool>(),
+              msg_data->msg["svs_lang"].get<std::string>(),
+              msg_data->msg["svs_itn"].get<bool>()));
+          break;
+        }
         // for offline, send all receive data to decoder engine
-        std::vector<std::vector<float>> hotwords_embedding_(*(msg_data->hotwords_embedding));
-        asio::post(io_decoder_,
-                    std::bind(&WebSocketServer::do_decoder, this,
-                              std::move(*(sample_data_p.get())),
-                              std::move(hdl), 
-                              std::ref(msg_data->msg),
-                              std::ref(*thread_lock_p),
-                              std::move(hotwords_embedding_),
-                              msg_data->msg["wav_name"],
-                              msg_data->msg["itn"],
-                              msg_data->msg["audio_fs"],
-                              msg_data->msg["wav_format"],
-                              std::ref(msg_data->decoder_handle),
-                              msg_data->msg["svs_lang"],
-                              msg_data->msg["svs_itn"]));
+        std::shared_ptr<std::vector<char>> buffer =
+            std::make_shared<std::vector<char>>(std::move(*(sample_data_p.get())));
+        sample_data_p->clear();
+        std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding_ =
+            std::make_shared<std::vector<std::vector<float>>>(*(msg_data->hotwords_embedding));
+        std::string wav_name = msg_data->msg["wav_name"];
+        bool itn = msg_data->msg["itn"];
+        int audio_fs = msg_data->msg["audio_fs"];
+        std::string wav_format = msg_data->msg["wav_format"];
+        std::string svs_lang = msg_data->msg["svs_lang"];
+        bool svs_itn = msg_data->msg["svs_itn"];
+        std::string priority = msg_data->msg.value("priority", "normal");
+        auto decode_job = [this, msg_data, buffer, hdl, hotwords_embedding_,
+                           wav_name, itn, audio_fs, wav_format, svs_lang,
+                           svs_itn]() mutable {
+          do_decoder(*buffer, hdl, msg_data->msg, *(msg_data->thread_lock),
+                     *hotwords_embedding_, wav_name, itn, audio_fs, wav_format,
+                     msg_data->decoder_handle, svs_lang, svs_itn);
+        };
+        int retry_after_ms = 0;
         msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
+        if (!scheduler_->Submit(
+                decode_job,
+                OfflineScheduler::EstimateAudioSec(buffer->size(), wav_format,
+                                                   audio_fs),
+                buffer->size(), OfflineScheduler::ParsePriority(priority),
+                &retry_after_ms)) {
+          msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])-1;
+          LOG(WARNING) << "server busy, reject " << wav_name
+                       << ", retry after " << retry_after_ms << " ms";
+          nlohmann::json busy_result;
+          busy_result["text"] = "";
+          busy_result["mode"] = "offline";
+          busy_result["is_final"] = true;
+          busy_result["wav_name"] = wav_name;
+          busy_result["error"] = "server busy";
+          busy_result["retry_after_ms"] = retry_after_ms;
+          websocketpp::lib::error_code ec;
+          if (is_ssl) {
+            wss_server_->send(hdl, busy_result.dump(),
+                              websocketpp::frame::opcode::text, ec);
+          } else {
+            server_->send(hdl, busy_result.dump(),
+                          websocketpp::frame::opcode::text, ec);
+          }
+        }
       }
       break;
     }
@@ -404,6 +480,31 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
         // for offline, we add receive data to end of the sample data vector
         sample_data_p->insert(sample_data_p->end(), pcm_data,
                               pcm_data + num_samples);
+        std::string wav_format = msg_data->msg["wav_format"];
+        if (progressive_ && (wav_format == "pcm" || wav_format == "PCM") &&
+            msg_data->hotwords_embedding != nullptr) {
+          int audio_fs = msg_data->msg["audio_fs"];
+          if (msg_data->progressive_handle == nullptr) {
+            msg_data->progressive_handle =
+                FunOfflineProgressiveInit(asr_handle, audio_fs);
+          }
+          // hand the audio over a second at a time, the vad steps are that long
+          if (msg_data->progressive_handle != nullptr &&
+              sample_data_p->size() >= (size_t)audio_fs * 2) {
+            std::shared_ptr<std::vector<char>> buffer =
+                std::make_shared<std::vector<char>>(std::move(*(sample_data_p.get())));
+            sample_data_p->clear();
+            msg_data->msg["access_num"]=(int)(msg_data->msg["access_num"])+1;
+            msg_data->strand_->post(std::bind(
+                &WebSocketServer::do_progressive, this, msg_data,
+                msg_data->progressive_handle, buffer, hdl, false,
+                msg_data->hotwords_embedding,
+                msg_data->msg["wav_name"].get<std::string>(),
+                msg_data->msg["itn"].get<bool>(),
+                msg_data->msg["svs_lang"].get<std::string>(),
+                msg_data->msg["svs_itn"].get<bool>()));
+          }
+        }
       }
       break;
     }
@@ -413,13 +514,22 @@ void WebSocketServer::on_message(websocketpp::connection_hdl hdl,
   guard_decoder.unlock();
 }
 
+void WebSocketServer::initScheduler(const SchedulerOptions& opts) {
+  scheduler_.reset(new OfflineScheduler(
+      opts, [this](std::function<void()> task) {
+        asio::post(io_decoder_, std::move(task));
+      }));
+}
+
 // init asr model
 void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
-                              int thread_num, bool use_gpu, int batch_size) {
+                              int thread_num, bool use_gpu, int batch_size,
+                              int seg_thread_num) {
   try {
     // init model with api
 
     asr_handle = FunOfflineInit(model_path, thread_num, use_gpu, batch_size);
+    FunOfflineSetSegThreadNum(asr_handle, seg_thread_num);
     LOG(INFO) << "model successfully inited";
     
     LOG(INFO) << "initAsr run check_and_clean_connection";
@@ -431,3 +541,18 @@ void WebSocketServer::initAsr(std::map<std::string, std::string>& model_path,
     LOG(INFO) << e.what();
   }
 }
+
+bool WebSocketServer::warm_up(const std::vector<int>& buckets_ms) {
+  bool ok = true;
+  if (!buckets_ms.empty()) {
+    auto begin = std::chrono::steady_clock::now();
+    ok = FunOfflineWarmUp(asr_handle, buckets_ms);
+    LOG(INFO) << "warm-up finished in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count()
+              << " ms";
+  }
+  ready_ = true;
+  return ok;
+}
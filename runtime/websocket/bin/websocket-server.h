@@ -13,6 +13,8 @@
 #ifndef WEBSOCKET_SERVER_H_
 #define WEBSOCKET_SERVER_H_
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -34,6 +36,8 @@
 #include "com-define.h"
 #include "funasrruntime.h"
 #include "nlohmann/json.hpp"
+#include "stamp-sents-json.h"
+#include "offline-scheduler.h"
 #include "tclap/CmdLine.h"
 typedef websocketpp::server<websocketpp::config::asio> server;
 typedef websocketpp::server<websocketpp::config::asio_tls> wss_server;
@@ -61,6 +65,8 @@ typedef struct {
   std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding=nullptr;
   std::shared_ptr<websocketpp::lib::mutex> thread_lock; // lock for each connection
   FUNASR_DEC_HANDLE decoder_handle=nullptr;
+  FUNASR_HANDLE progressive_handle=nullptr;  // upload being decoded as it arrives
+  std::shared_ptr<asio::io_context::strand> strand_;  // progressive jobs in order
 } FUNASR_MESSAGE;
 
 // See https://wiki.mozilla.org/Security/Server_Side_TLS for more details about
@@ -90,6 +96,16 @@ class WebSocketServer {
       // set close handle
       wss_server_->set_close_handler(
           [this](websocketpp::connection_hdl hdl) { on_close(hdl); });
+      // refuse handshakes until the models are warm
+      wss_server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) {
+            if (ready_) {
+              return true;
+            }
+            wss_server_->get_con_from_hdl(hdl)->set_status(
+                websocketpp::http::status_code::service_unavailable);
+            return false;
+          });
       // begin accept
       wss_server_->start_accept();
       // not print log
@@ -107,6 +123,16 @@ class WebSocketServer {
       // set close handle
       server_->set_close_handler(
           [this](websocketpp::connection_hdl hdl) { on_close(hdl); });
+      // refuse handshakes until the models are warm
+      server_->set_validate_handler(
+          [this](websocketpp::connection_hdl hdl) {
+            if (ready_) {
+              return true;
+            }
+            server_->get_con_from_hdl(hdl)->set_status(
+                websocketpp::http::status_code::service_unavailable);
+            return false;
+          });
       // begin accept
       server_->start_accept();
       // not print log
@@ -126,7 +152,31 @@ class WebSocketServer {
                   std::string svs_lang,
                   bool sys_itn);
 
-  void initAsr(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1);
+  // feeds a pcm upload to a progressive handle, the final call returns the result
+  void do_progressive(std::shared_ptr<FUNASR_MESSAGE> msg_data,
+                      FUNASR_HANDLE progressive_handle,
+                      std::shared_ptr<std::vector<char>> buffer,
+                      websocketpp::connection_hdl hdl, bool is_final,
+                      std::shared_ptr<std::vector<std::vector<float>>> hotwords_embedding,
+                      std::string wav_name, bool itn, std::string svs_lang,
+                      bool svs_itn);
+
+  void initAsr(std::map<std::string, std::string>& model_path, int thread_num, bool use_gpu=false, int batch_size=1,
+               int seg_thread_num=1);
+  void setProgressive(bool progressive) { progressive_ = progressive; }
+  // after initAsr, before the server accepts connections
+  void setResultCache(size_t result_bytes, size_t seg_bytes) {
+    FunOfflineSetResultCache(asr_handle, result_bytes, seg_bytes);
+  }
+  // must run before the server accepts connections
+  void initScheduler(const SchedulerOptions& opts);
+  // runs every model over synthetic input of each length in buckets_ms
+  // (FunOfflineWarmUp), after the other settings. The server refuses
+  // websocket handshakes with 503 and is_ready() is false until this returns;
+  // empty buckets_ms only marks the server ready
+  bool warm_up(const std::vector<int>& buckets_ms);
+  bool is_ready() const { return ready_; }
+  OfflineScheduler* getScheduler() { return scheduler_.get(); }
   void on_message(websocketpp::connection_hdl hdl, message_ptr msg);
   void on_open(websocketpp::connection_hdl hdl);
   void on_close(websocketpp::connection_hdl hdl);
@@ -135,10 +185,15 @@ class WebSocketServer {
 
  private:
   void check_and_clean_connection();
+  void send_result(websocketpp::connection_hdl& hdl, FUNASR_RESULT result,
+                   const std::string& wav_name);
   asio::io_context& io_decoder_;  // threads for asr decoder
   // std::ofstream fout;
   FUNASR_HANDLE asr_handle;  // asr engine handle
+  std::unique_ptr<OfflineScheduler> scheduler_;  // orders the decode jobs
   bool isonline = false;  // online or offline engine, now only support offline
+  bool progressive_ = false;  // decode pcm uploads while they arrive
+  std::atomic<bool> ready_{false};
   bool is_ssl = true;
   server* server_;          // websocket server
   wss_server* wss_server_;  // websocket server
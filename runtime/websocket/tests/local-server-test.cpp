@@ -0,0 +1,164 @@
+/**
+ * Copyright FunASR (https://github.com/alibaba-damo-academy/FunASR). All Rights
+ * Reserved. MIT License  (https://opensource.org/licenses/MIT)
+ */
+// A local stream paused for its pending audio and resumed later from another
+// thread, as the 2pass server does, still gets the final result of its end
+// message. The handlers hold the peer only weakly, like local_peers_.
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "local-server.h"
+
+namespace {
+const int kAudioFrames = 20;
+const size_t kAudioBytes = 3200;
+
+struct Stream {
+  std::mutex mtx;
+  std::weak_ptr<LocalPeer> peer;
+  size_t audio_bytes = 0;
+  bool paused = false;
+  bool closed = false;
+};
+
+bool SendFrame(int fd, char type, const std::string& payload) {
+  size_t len = payload.size();
+  std::string frame = {type, (char)(len & 0xff), (char)((len >> 8) & 0xff),
+                       (char)((len >> 16) & 0xff), (char)((len >> 24) & 0xff)};
+  frame += payload;
+  return send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) ==
+         (ssize_t)frame.size();
+}
+
+// the payload of the next text frame, empty on a closed connection or after
+// timeout_ms
+std::string ReadText(int fd, int timeout_ms) {
+  std::string rx;
+  while (true) {
+    if (rx.size() >= 5) {
+      uint32_t len = (uint8_t)rx[1] | (uint8_t)rx[2] << 8 |
+                     (uint8_t)rx[3] << 16 | (uint32_t)(uint8_t)rx[4] << 24;
+      if (rx.size() >= 5 + len) {
+        return rx.substr(5, len);
+      }
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+      return "";
+    }
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      return "";
+    }
+    rx.append(buf, n);
+  }
+}
+}  // namespace
+
+int main() {
+  std::string path = "/tmp/funasr-local-server-test-" +
+                     std::to_string(getpid()) + ".sock";
+  asio::io_context io_context;
+  Stream stream;
+
+  LocalHandlers handlers;
+  handlers.on_open = [&stream](std::shared_ptr<LocalPeer> peer) {
+    std::lock_guard<std::mutex> lock(stream.mtx);
+    stream.peer = peer;
+  };
+  handlers.on_close = [&stream](std::weak_ptr<void>) {
+    std::lock_guard<std::mutex> lock(stream.mtx);
+    stream.closed = true;
+  };
+  handlers.on_frame = [&stream](std::weak_ptr<void>, bool is_text,
+                                const char* data, size_t len) {
+    std::lock_guard<std::mutex> lock(stream.mtx);
+    std::shared_ptr<LocalPeer> peer = stream.peer.lock();
+    if (!peer) {
+      return;
+    }
+    if (!is_text) {
+      stream.audio_bytes += len;
+      // the first audio is too much: the rest waits in the socket
+      if (!stream.paused) {
+        stream.paused = true;
+        peer->set_paused(true);
+      }
+      return;
+    }
+    peer->send_text("{\"is_final\": true, \"bytes\": " +
+                    std::to_string(stream.audio_bytes) + "}");
+  };
+  LocalServer server(io_context, path, handlers);
+  std::thread io_thread([&io_context]() { io_context.run(); });
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  bool ok = fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+  for (int i = 0; ok && i < kAudioFrames; i++) {
+    ok = SendFrame(fd, 'A', std::string(kAudioBytes, (char)i));
+  }
+  ok = ok && SendFrame(fd, 'T', "{\"is_speaking\": false}");
+  if (!ok) {
+    printf("cannot talk to %s\n", path.c_str());
+  }
+
+  // while paused the session is held by nothing but itself; the decoder
+  // resumes it a while later
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard<std::mutex> lock(stream.mtx);
+    std::shared_ptr<LocalPeer> peer = stream.peer.lock();
+    if (!stream.paused || !peer || stream.closed) {
+      printf("the paused session is gone\n");
+      ok = false;
+    } else {
+      peer->set_paused(false);
+    }
+  }
+
+  std::string expected = "{\"is_final\": true, \"bytes\": " +
+                         std::to_string(kAudioFrames * kAudioBytes) + "}";
+  std::string result = ok ? ReadText(fd, 5000) : "";
+  if (ok && result != expected) {
+    printf("final result %s, expected %s\n", result.c_str(),
+           expected.c_str());
+    ok = false;
+  }
+  if (ok) {
+    printf("the resumed stream got %s\n", result.c_str());
+  }
+
+  // a closed client closes the session
+  if (fd >= 0) {
+    close(fd);
+  }
+  bool closed = false;
+  for (int i = 0; ok && !closed && i < 100; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::lock_guard<std::mutex> lock(stream.mtx);
+    closed = stream.closed;
+  }
+  if (ok && !closed) {
+    printf("the session did not close with the client\n");
+    ok = false;
+  }
+  io_context.stop();
+  io_thread.join();
+  return ok ? 0 : 1;
+}